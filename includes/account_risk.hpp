@@ -0,0 +1,19 @@
+#ifndef ACCOUNT_RISK_HPP
+#define ACCOUNT_RISK_HPP
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @struct AccountRisk
+ * Running exposure of an account, checked by the risk gate before each of its orders.
+ *
+ * The counters are updated by the orders of the account themselves, as they fill and close,
+ * from whichever thread matches them, so they are atomics read and written without a lock.
+ */
+struct AccountRisk {
+    std::atomic<uint32_t> open_orders{0}; ///< Orders accepted that have not yet filled or been cancelled.
+    std::atomic<int64_t> position{0}; ///< Quantity bought minus quantity sold.
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "memory_usage.hpp"
+#include "page_size.hpp"
+
+/**
+ * @struct ArenaStats
+ * Usage counters of an arena.
+ */
+struct ArenaStats {
+    size_t reserved_bytes = 0; ///< Size of the reserved region.
+    size_t carved_bytes = 0; ///< Bytes of the region handed out at least once.
+    size_t live_bytes = 0; ///< Bytes currently allocated from the region.
+    uint64_t allocations = 0; ///< Allocations served from the region.
+    uint64_t fallbacks = 0; ///< Allocations served from the heap because the region was exhausted.
+    PageSize page_size = PageSize::STANDARD_PAGES; ///< Pages actually backing the region.
+    std::array<size_t, NUM_MEMORY_CATEGORIES> category_bytes{}; ///< Live bytes of every MemoryCategory, from the region and the heap.
+};
+
+/**
+ * @class Arena
+ * A region of memory reserved and pre-faulted up front, from which a book allocates its
+ * orders, price levels and index tables.
+ *
+ * Blocks are carved off the region in size classes (16 byte steps up to 256 bytes, powers
+ * of two above) and freed blocks are kept on a free list per class for reuse, so the region
+ * never returns memory to the system. Once the region is exhausted further allocations go
+ * to the heap, and are counted as fallbacks. A spinlock guards the free lists: books are
+ * only modified under the exchange lock, but the last reference to an order can be dropped
+ * anywhere.
+ *
+ * An arena without a capacity reserves nothing and serves every allocation from the heap. Either
+ * way the arena keeps the live bytes of every memory category, counted with relaxed atomics
+ * outside the lock, so a book's footprint can be read at any time.
+ */
+class Arena {
+public:
+    static constexpr size_t SMALL_STEP = 16; ///< Granularity of the small size classes, and the alignment of every block.
+    static constexpr size_t SMALL_LIMIT = 256; ///< Largest block served from a small size class.
+    static constexpr size_t CLASS_COUNT = 64; ///< Number of size classes.
+
+    /**
+     * Reserve and pre-fault a region.
+     *
+     * @param capacity Bytes to reserve, or 0 to allocate everything from the heap.
+     * @param page_size Pages to back the region with; standard pages are used if the hugetlb pool cannot supply them.
+     * @throws std::runtime_error if the region cannot be mapped.
+     */
+    Arena(size_t capacity, PageSize page_size = PageSize::STANDARD_PAGES);
+
+    /**
+     * Unmap the region; every block allocated from it must have been freed.
+     */
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * Allocate a block.
+     *
+     * @param size Size of the block.
+     * @param alignment Alignment of the block; larger than SMALL_STEP is served from the heap.
+     * @param category What the block holds.
+     * @return The block.
+     */
+    void* Allocate(size_t size, size_t alignment, MemoryCategory category = MemoryCategory::MEMORY_OTHER);
+
+    /**
+     * Free a block.
+     *
+     * @param block The block.
+     * @param size Size it was allocated with.
+     * @param alignment Alignment it was allocated with.
+     * @param category Category it was allocated with.
+     */
+    void Deallocate(void* block, size_t size, size_t alignment, MemoryCategory category = MemoryCategory::MEMORY_OTHER);
+
+    // Getters
+    ArenaStats GetStats();
+private:
+    /**
+     * Get the size class of a block size.
+     */
+    static size_t ClassIndex(size_t size);
+
+    /**
+     * Get the block size of a size class.
+     */
+    static size_t ClassSize(size_t index);
+
+    void Lock();
+    void Unlock();
+
+    char* base_; ///< Start of the region.
+    size_t mapping_size_; ///< Size of the mapping, a multiple of the page size.
+    size_t offset_; ///< Bytes carved off the region so far.
+    std::array<void*, CLASS_COUNT> free_lists_; ///< Freed blocks of every size class, linked through their first word.
+    std::atomic_flag lock_; ///< Guards the free lists and counters.
+    ArenaStats stats_; ///< Usage counters.
+    std::array<std::atomic<size_t>, NUM_MEMORY_CATEGORIES> category_bytes_; ///< Live bytes of every category.
+};
+
+/**
+ * @class ArenaAllocator
+ * Standard allocator drawing from an arena, or from the heap when constructed without one.
+ *
+ * The allocator shares ownership of its arena, so blocks such as orders can safely outlive
+ * the book that allocated them.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+
+    /**
+     * Construct an allocator drawing from an arena.
+     *
+     * @param arena The arena, or nullptr to use the heap.
+     * @param category What the allocations hold, counted by the arena; copies rebound to the
+     *                 container's nodes and buckets keep it.
+     */
+    ArenaAllocator(std::shared_ptr<Arena> arena, MemoryCategory category = MemoryCategory::MEMORY_OTHER) noexcept
+        : arena_{std::move(arena)}, category_{category} {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_{other.arena_}, category_{other.category_} {}
+
+    T* allocate(size_t count) {
+        if (!arena_) return std::allocator<T>().allocate(count);
+        return static_cast<T*>(arena_->Allocate(count * sizeof(T), alignof(T), category_));
+    }
+
+    void deallocate(T* block, size_t count) noexcept {
+        if (!arena_) return std::allocator<T>().deallocate(block, count);
+        arena_->Deallocate(block, count * sizeof(T), alignof(T), category_);
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept {
+        // blocks are counted against the category they were allocated with
+        return arena_ == other.arena_ && category_ == other.category_;
+    }
+
+    // Getters
+    const std::shared_ptr<Arena>& GetArena() const noexcept {
+        return arena_;
+    }
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    std::shared_ptr<Arena> arena_; ///< Arena to allocate from, or nullptr for the heap.
+    MemoryCategory category_ = MemoryCategory::MEMORY_OTHER; ///< What the allocations hold.
+};
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef BOOK_VIEW_HPP
+#define BOOK_VIEW_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "order_book.hpp"
+#include "trading_phase.hpp"
+#include "utils.hpp"
+
+/**
+ * @struct BookView
+ * Read-only picture of the top of a book, as it stood after one change.
+ */
+struct BookView {
+    static constexpr size_t MAX_DEPTH = 32; ///< Most levels a view holds on each side.
+
+    uint64_t version = 0; ///< Number of views of the book published up to and including this one.
+    Timestamp published_at = 0; ///< When the view was published.
+    OrderPrice last_price = 0; ///< Price of the last trade, or 0 before the first.
+    TradingPhase phase = TradingPhase::CONTINUOUS; ///< Matching mode of the book.
+    size_t bid_count = 0; ///< Number of bid levels held.
+    size_t ask_count = 0; ///< Number of ask levels held.
+    std::array<BookLevel, MAX_DEPTH> bids; ///< Best bid levels, best first.
+    std::array<BookLevel, MAX_DEPTH> asks; ///< Best ask levels, best first.
+};
+
+/**
+ * @class BookViewPublisher
+ * Publishes views of a book to reader threads, read-copy-update style.
+ *
+ * The thread changing the book, which already holds the exchange lock, fills a spare view and
+ * swaps it in with one atomic exchange. Readers copy whichever view is current without any lock,
+ * announcing the epoch they read in so the writer knows which replaced views may still be in use.
+ * Replaced views are recycled once every reader that could hold them has moved on; until then the
+ * writer takes another, so a stalled reader costs memory but never holds up matching.
+ */
+class BookViewPublisher {
+public:
+    static constexpr size_t MAX_READERS = 64; ///< Readers a book can have at once.
+
+    /**
+     * Construct a publisher with nothing published yet.
+     *
+     * @param depth Levels to publish on each side.
+     * @throws std::invalid_argument if the depth is 0 or over BookView::MAX_DEPTH.
+     */
+    explicit BookViewPublisher(size_t depth);
+
+    /**
+     * Free every view. No reader may be left.
+     */
+    ~BookViewPublisher();
+
+    BookViewPublisher(const BookViewPublisher&) = delete;
+    BookViewPublisher& operator=(const BookViewPublisher&) = delete;
+
+    /**
+     * Publish a view of the book as it stands. Only one thread may publish at a time.
+     *
+     * @param book The book.
+     */
+    void Publish(OrderBook& book);
+
+    /**
+     * Get the number of levels published on each side.
+     *
+     * @return The depth.
+     */
+    size_t GetDepth() const;
+
+    /**
+     * Get the number of views allocated so far, the current one, the spares and those waiting for
+     * readers included.
+     *
+     * @return The number of views.
+     */
+    size_t GetAllocatedViews() const;
+private:
+    friend class BookViewReader;
+
+    static constexpr size_t RECLAIM_BATCH = 16; ///< Replaced views gathered before the readers are scanned for them.
+    static constexpr uint64_t IDLE = 0; ///< Epoch of a reader outside a read.
+
+    /**
+     * @struct ReaderSlot
+     * Announcement of one reader, on a cache line of its own.
+     */
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch{IDLE}; ///< Epoch the reader is reading in, or IDLE.
+        std::atomic<bool> claimed{false}; ///< Whether a reader holds the slot.
+    };
+
+    /**
+     * Take a view to fill: a spare one, one no reader can hold any more, or a new one.
+     */
+    BookView* Acquire();
+
+    /**
+     * Move every replaced view older than the epochs of all readers to the spares.
+     */
+    void Reclaim();
+
+    size_t depth_; ///< Levels published on each side.
+    alignas(64) std::atomic<BookView*> current_; ///< Latest view, or nullptr before the first.
+    std::atomic<uint64_t> epoch_; ///< Epoch of reads starting now; advanced every time a view is replaced.
+    uint64_t version_; ///< Views published so far.
+    std::atomic<size_t> allocated_; ///< Views allocated so far.
+    std::vector<std::pair<uint64_t, BookView*>> retired_; ///< Replaced views and the epoch they were replaced in, oldest first.
+    std::vector<BookView*> spares_; ///< Views no reader can hold, ready to be filled.
+    std::array<ReaderSlot, MAX_READERS> readers_; ///< Announcements of the readers.
+};
+
+/**
+ * @class BookViewReader
+ * A reader of the views of one book, for a single thread. Reads never wait for the writer and
+ * never make it wait.
+ */
+class BookViewReader {
+public:
+    /**
+     * Construct a reader, taking one of the publisher's reader slots.
+     *
+     * @param publisher The publisher of the book.
+     * @throws std::runtime_error if the book already has BookViewPublisher::MAX_READERS readers.
+     */
+    explicit BookViewReader(std::shared_ptr<BookViewPublisher> publisher);
+
+    /**
+     * Destroy the reader, giving its slot back.
+     */
+    ~BookViewReader();
+
+    BookViewReader(BookViewReader&& other) noexcept;
+    BookViewReader& operator=(BookViewReader&&) = delete;
+    BookViewReader(const BookViewReader&) = delete;
+    BookViewReader& operator=(const BookViewReader&) = delete;
+
+    /**
+     * Copy the latest view of the book.
+     *
+     * @param view The view to copy into; only the levels held are written.
+     * @return true if a view was copied, false if none has been published yet.
+     */
+    bool Read(BookView& view);
+private:
+    std::shared_ptr<BookViewPublisher> publisher_; ///< Publisher of the book, or nullptr once moved from.
+    BookViewPublisher::ReaderSlot* slot_; ///< Slot announcing the reader's epoch.
+};
+
+#endif
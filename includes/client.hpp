@@ -4,17 +4,16 @@
 #include <string>
 #include <unordered_set>
 #include <optional>
+#include <memory>
+#include <sys/types.h>
 
 #include "hffix.hpp"
 #include "order_side.hpp"
 #include "order_type.hpp"
 #include "utils.hpp"
 #include "order.hpp"
-
-/**
- * Constant for the maximum buffer size used in network operations.
- */
-constexpr size_t BUFFER_SIZE = 1024;
+#include "shm_channel.hpp"
+#include "transport_type.hpp"
 
 /**
  * @class Client
@@ -40,10 +39,11 @@ public:
      * 
      * @param exchange_host The hostname or IP address of the exchange.
      * @param exchange_port The port number on which the exchange is listening.
+     * @param transport How to carry messages after the logon; SHARED_MEMORY requires the exchange to be on this host.
      * @throws std::runtime_error If connection fails.
      * @throws std::invalid_argument If invalid host given.
      */
-    void Start(std::string exchange_host, int exchange_port);
+    void Start(std::string exchange_host, int exchange_port, TransportType transport = TransportType::TCP);
 
     /**
      * Disconnects the client from the exchange.
@@ -63,11 +63,18 @@ public:
      * @param ticker The ticker symbol of the instrument.
      * @param side The side of the order.
      * @param type The type of the order.
-     * @param price The price of the order.
+     * @param price The price of the order, ignored for MARKET orders.
      * @param quantity The quantity of the order.
+     * @param stop_price The trigger price of a STOP or STOP_LIMIT order, 0 for other types.
+     * @param display_quantity The quantity an iceberg shows at a time, 0 to show all of it.
+     * @param peg_type The reference price a pegged resting order tracks instead of its price.
+     * @param peg_offset The amount added to the reference price of a pegged order.
+     * @param expire_time The time a GOOD_TIL_DATE order expires at, 0 for other types.
      * @return true if the order was successfully placed, false otherwise.
      */
-    bool PlaceOrder(std::string ticker, OrderSide side, OrderType type, OrderPrice price, OrderQuantity quantity);
+    bool PlaceOrder(std::string ticker, OrderSide side, OrderType type, OrderPrice price, OrderQuantity quantity,
+        OrderPrice stop_price = 0, OrderQuantity display_quantity = 0, PegType peg_type = PegType::NO_PEG,
+        PriceOffset peg_offset = 0, Timestamp expire_time = 0);
 
     /**
      * Cancels an existing order on the exchange.
@@ -84,9 +91,36 @@ public:
      * @return An optional containing the Order if found, or empty if not found.
      */
     std::optional<Order> GetOrderStatus(OrderID id);
+
+    /**
+     * Gets the ID the exchange gave the last order placed successfully.
+     * 
+     * @return The order ID, or 0 if no order was placed yet.
+     */
+    OrderID GetLastOrderID();
 private:
+    /**
+     * Sends a message to the exchange over the active transport.
+     * 
+     * @param message The encoded message.
+     * @param length The length of the message.
+     * @return true if the message was sent, false otherwise.
+     */
+    bool SendMessage(const char* message, size_t length);
+
+    /**
+     * Waits for a message from the exchange over the active transport.
+     * 
+     * @param buffer The buffer to read the message into.
+     * @param size The size of the buffer.
+     * @return The length of the message, or 0 or less on failure.
+     */
+    ssize_t ReceiveMessage(char* buffer, size_t size);
+
     int client_sock_; ///< The socket descriptor for the client connection.
+    std::unique_ptr<ShmChannel> channel_; ///< Shared memory channel to the exchange, or nullptr when using TCP.
     std::unordered_set<OrderID> orders_; ///< Set of order IDs placed by this client.
+    OrderID last_order_id_; ///< ID of the last order placed by this client.
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,125 @@
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * @class Clock
+ * Process-wide nanosecond wall clock backed by the CPU timestamp counter.
+ *
+ * On CPUs with an invariant TSC the clock is anchored against CLOCK_REALTIME and the TSC rate
+ * is measured against CLOCK_MONOTONIC, after which a timestamp costs one rdtsc and a fixed-point
+ * multiply. The anchor is refreshed about once a second by whichever thread notices it is due,
+ * so the rate estimate keeps improving and NTP adjustments are followed. Without an invariant
+ * TSC the clock falls back to clock_gettime(CLOCK_REALTIME).
+ */
+class Clock {
+public:
+    /**
+     * Get the current time in nanoseconds since epoch.
+     *
+     * @return Current timestamp.
+     */
+    static uint64_t Now() {
+        uint64_t ticks = ReadTicks();
+        uint64_t sequence;
+        uint64_t base_ticks;
+        uint64_t base_nanos;
+        uint64_t multiplier;
+        do {
+            sequence = sequence_.load(std::memory_order_acquire);
+            if (sequence == 0) return SlowNow();
+            base_ticks = base_ticks_.load(std::memory_order_relaxed);
+            base_nanos = base_nanos_.load(std::memory_order_relaxed);
+            multiplier = multiplier_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequence & 1) || sequence != sequence_.load(std::memory_order_relaxed));
+
+        // ticks may predate a calibration published while this thread was reading them
+        if (ticks < base_ticks) return base_nanos - Scale(base_ticks - ticks, multiplier);
+        uint64_t elapsed = ticks - base_ticks;
+        if (elapsed > recalibration_ticks_.load(std::memory_order_relaxed)) Recalibrate();
+        return base_nanos + Scale(elapsed, multiplier);
+    }
+
+    /**
+     * Read the raw timestamp counter, for measuring short durations.
+     *
+     * @return The current tick count (TSC on x86, steady clock nanoseconds elsewhere).
+     */
+    static uint64_t ReadTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return SteadyNanos();
+#endif
+    }
+
+    /**
+     * Convert a duration measured with ReadTicks to nanoseconds.
+     *
+     * @param ticks The duration in ticks.
+     * @return The duration in nanoseconds.
+     */
+    static uint64_t TicksToNanos(uint64_t ticks);
+
+    /**
+     * Get the length of a tick.
+     *
+     * @return Nanoseconds per tick.
+     */
+    static double NanosPerTick();
+
+    /**
+     * Check whether timestamps come from the TSC rather than the clock_gettime fallback.
+     *
+     * @return true if the TSC is invariant and in use, false otherwise.
+     */
+    static bool UsesTsc();
+
+    /**
+     * Re-anchor the clock against CLOCK_REALTIME and refine the TSC rate.
+     * Called automatically from Now(); concurrent calls are coalesced.
+     */
+    static void Recalibrate();
+private:
+    /**
+     * Calibrate on first use, or read CLOCK_REALTIME if the TSC is unusable.
+     *
+     * @return Current timestamp.
+     */
+    static uint64_t SlowNow();
+
+    /**
+     * Read the monotonic clock used to measure the TSC rate.
+     *
+     * @return Nanoseconds on CLOCK_MONOTONIC.
+     */
+    static uint64_t SteadyNanos();
+
+    /**
+     * Multiply ticks by a 32.32 fixed-point nanoseconds per tick multiplier.
+     *
+     * @param ticks Number of ticks.
+     * @param multiplier Nanoseconds per tick, shifted left by 32 bits.
+     * @return Nanoseconds.
+     */
+    static uint64_t Scale(uint64_t ticks, uint64_t multiplier) {
+        __extension__ using uint128 = unsigned __int128;
+        return static_cast<uint64_t>((static_cast<uint128>(ticks) * multiplier) >> 32);
+    }
+
+    // Calibration published through a sequence lock: odd while being written, 0 until calibrated.
+    static inline std::atomic<uint64_t> sequence_{0}; ///< Sequence number of the calibration.
+    static inline std::atomic<uint64_t> base_ticks_{0}; ///< Tick count at the anchor.
+    static inline std::atomic<uint64_t> base_nanos_{0}; ///< Wall clock time at the anchor.
+    static inline std::atomic<uint64_t> multiplier_{0}; ///< Nanoseconds per tick in 32.32 fixed point.
+    static inline std::atomic<uint64_t> recalibration_ticks_{UINT64_MAX}; ///< Ticks after the anchor at which to recalibrate.
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef ENGINE_MESSAGE_HPP
+#define ENGINE_MESSAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @enum EngineMessageType
+ * Represents the kind of a message between a gateway and the matching engine.
+ */
+enum EngineMessageType : uint8_t {
+    ENGINE_NEW_ORDER = 'D', ///< Gateway request to place an order.
+    ENGINE_CANCEL_ORDER = 'F', ///< Gateway request to cancel an order.
+    ENGINE_ORDER_STATUS = 'H', ///< Gateway request for the status of an order.
+    ENGINE_ACCEPTED = 'a', ///< Engine placed the order.
+    ENGINE_CANCELLED = 'c', ///< Engine cancelled the order.
+    ENGINE_STATUS = 's', ///< Engine reports the order.
+    ENGINE_REJECTED = 'r' ///< Engine refused the request.
+};
+
+/**
+ * @struct EngineMessage
+ * A request from a gateway or the engine's response to it, laid out exactly as copied through the
+ * shared memory rings between them.
+ *
+ * A response reuses the request's message: the engine overwrites the type, fills in the order as
+ * it now stands or the reason of the rejection, and keeps the correlation the gateway chose.
+ */
+struct EngineMessage {
+    static constexpr size_t TICKER_SIZE = 16; ///< Bytes of the ticker, NUL padded.
+    static constexpr size_t REASON_SIZE = 40; ///< Bytes of a rejection reason, NUL padded.
+
+    uint64_t correlation; ///< Chosen by the gateway to match the response to its request.
+    uint64_t order_id; ///< ID of the order; assigned by the engine for new orders.
+    uint64_t expire_time; ///< Expire time of the order.
+    uint32_t owner; ///< Owner of the order, unique within its gateway (new orders only).
+    uint32_t price; ///< Limit price of the order.
+    uint32_t quantity; ///< Quantity of the order.
+    uint32_t filled; ///< Quantity filled so far (responses only).
+    uint32_t stop_price; ///< Stop price of the order.
+    uint32_t display_quantity; ///< Display quantity (new orders only).
+    int32_t peg_offset; ///< Peg offset (new orders only).
+    uint8_t type; ///< An EngineMessageType.
+    uint8_t side; ///< An OrderSide.
+    uint8_t order_type; ///< An OrderType.
+    uint8_t peg_type; ///< A PegType (new orders only).
+    uint8_t status; ///< An OrderStatus (responses only).
+    uint8_t reserved[3]; ///< Padding, always 0.
+    char ticker[TICKER_SIZE]; ///< Instrument of the order.
+    char reason[REASON_SIZE]; ///< Reason of a rejection.
+};
+
+static_assert(sizeof(EngineMessage) == 120, "EngineMessage must match the gateway ring format");
+
+#endif
@@ -3,19 +3,38 @@
 
 #include <unordered_map>
 #include <shared_mutex>
+#include <mutex>
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <ostream>
+#include <stop_token>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "utils.hpp"
+#include "book_view.hpp"
+#include "engine_message.hpp"
+#include "fix_decoder.hpp"
+#include "fix_encoder.hpp"
 #include "order.hpp"
 #include "order_book.hpp"
+#include "order_table.hpp"
+#include "latency.hpp"
+#include "session.hpp"
+#include "gateway_backend.hpp"
+#include "replicator.hpp"
+#include "risk_gate.hpp"
+#include "thread_placement.hpp"
 #include "hffix.hpp"
 
 /**
- * Constant for the maximum buffer size used in network operations.
+ * @typedef ExecutionReportHandler
+ * Callback receiving the unsolicited execution reports of a session's orders, along with the owner of the session.
  */
-constexpr size_t BUFFER_SIZE = 1024;
+using ExecutionReportHandler = std::function<void(OwnerID, std::string_view)>;
 
 /**
  * @class Exchange
@@ -23,6 +42,19 @@ constexpr size_t BUFFER_SIZE = 1024;
  * 
  * This class manages the core functionality of the exchange, including client connections,
  * order processing, and maintaining order books for different instruments.
+ * 
+ * While running, a timer thread expires DAY and GOOD_TIL_DATE orders as their time in force
+ * runs out. Sessions only ever answer requests, so the execution reports of expired orders
+ * go to the execution report handler, like a drop copy, rather than down the sessions.
+ * 
+ * Every session is held to the throttle limits, so one client flooding the exchange cannot
+ * monopolize the books. When too many new orders are waiting for the books at once, further
+ * new orders are shed with a reject until the backlog clears; cancels and status requests
+ * are never shed, since they only relieve the books.
+ * 
+ * An exchange can stand in for another: a primary journals every command that changes its books
+ * to a backup, which applies them in the same order to books of its own. Promoting the backup
+ * then serves clients from the books it already holds, without replaying anything.
  */
 class Exchange {
 public:
@@ -40,23 +72,148 @@ public:
      * Start the exchange on the specified port.
      * 
      * @param port The port number to listen on for incoming connections.
+     * @param backend How to serve client connections; IO_URING falls back to SOCKETS if the kernel lacks support.
      * @throws std::runtime_error if the exchange fails to start.
      */
-    void Start(int port);
+    void Start(int port, GatewayBackend backend = GatewayBackend::SOCKETS);
+
+    /**
+     * Start the exchange as a matching engine behind gateway processes on the specified port.
+     * Gateways attach over TCP and forward their clients' requests through shared memory, so
+     * the engine itself neither parses FIX nor touches client sockets.
+     * 
+     * @param port The port number gateways attach on.
+     * @throws std::runtime_error if the engine fails to start.
+     */
+    void ServeGateways(int port);
 
     /**
      * Stop the exchange and all its operations.
      */
     void Stop();
     
+    /**
+     * Set the cores the exchange threads run on and how they wait for input.
+     * Set it before adding instruments for their books to be allocated on the matching node.
+     * 
+     * @param placement The thread placement.
+     * @throws std::runtime_error if the exchange is running.
+     * @throws std::invalid_argument if a core is not available to the process.
+     */
+    void SetThreadPlacement(const ThreadPlacement& placement);
+
+    /**
+     * Set what happens when an order would trade with a resting order placed through the same session.
+     * Applies to orders received from then on.
+     * 
+     * @param self_trade_prevention The self-trade prevention mode, NO_STP to let such orders trade.
+     */
+    void SetSelfTradePrevention(SelfTradePrevention self_trade_prevention);
+
+    /**
+     * Set the pre-trade limits every new order is checked against. Accounts are sessions.
+     * 
+     * @param limits The limits; the default enforces none.
+     * @throws std::runtime_error if the exchange is running.
+     */
+    void SetRiskLimits(const RiskLimits& limits);
+
+    /**
+     * Set the message rate every session is held to, and what happens to messages beyond it.
+     * Sessions of the io_uring gateway share its thread and cannot wait their turn, so their
+     * excess messages are rejected under THROTTLE_QUEUE.
+     * 
+     * @param limits The limits; the default lets every message through.
+     * @throws std::runtime_error if the exchange is running.
+     * @throws std::invalid_argument if a rate is given with a burst of 0.
+     */
+    void SetThrottleLimits(const ThrottleLimits& limits);
+
+    /**
+     * Set how many new orders may wait for the books at once before new orders are shed.
+     * 
+     * @param max_pending_orders The number of orders, or 0 to never shed.
+     * @throws std::runtime_error if the exchange is running.
+     */
+    void SetOverloadLimit(uint32_t max_pending_orders);
+
+    /**
+     * Set the end of the trading session, when DAY orders placed from then on expire.
+     * 
+     * @param session_end The end of the session, or 0 for the next midnight UTC after each order.
+     */
+    void SetSessionEnd(Timestamp session_end);
+
+    /**
+     * Set the callback receiving the execution reports of expired orders.
+     * 
+     * @param handler The callback, or nullptr to drop the reports.
+     * @throws std::runtime_error if the exchange is running.
+     */
+    void SetExecutionReportHandler(ExecutionReportHandler handler);
+
+    /**
+     * Expire every DAY and GOOD_TIL_DATE order whose time in force is over, and report each one.
+     * Called by the timer thread while running.
+     * 
+     * @param now Current time.
+     * @return The number of orders expired.
+     */
+    size_t ExpireOrders(Timestamp now);
+
+    /**
+     * Journal every command that changes the books to a backup from then on.
+     * The backup must be serving replication with the same instruments added.
+     * 
+     * @param host Address of the backup.
+     * @param port Replication port of the backup.
+     * @param mode Whether clients are acknowledged before or after the backup applies their commands.
+     * @throws std::runtime_error if the exchange is running or the backup cannot be reached.
+     * @throws std::invalid_argument if the host is invalid or a ticker is too long to journal.
+     */
+    void ReplicateTo(const std::string& host, int port, ReplicationMode mode = ReplicationMode::REPLICATE_SYNC);
+
+    /**
+     * Follow a primary as its backup: accept the primary on the port and apply its journal to the
+     * books until it disconnects or the backup is promoted. Clients are not served meanwhile.
+     * 
+     * @param port The port to accept the primary on.
+     * @throws std::runtime_error if the exchange is running, the port cannot be listened on, or the
+     *         journal names an instrument the backup does not have.
+     */
+    void ServeReplication(int port);
+
+    /**
+     * Stop following the primary, so the exchange can be started with the books it holds.
+     */
+    void Promote();
+
+    /**
+     * Check whether the exchange is following a primary, from the time it listens for the primary.
+     * 
+     * @return true while following.
+     */
+    bool IsFollowing();
+
+    /**
+     * Get how far the journal has been streamed and applied.
+     * 
+     * @return The replication counters.
+     */
+    ReplicationStats GetReplicationStats();
+
     /**
      * Add a new instrument to the exchange.
      * 
+     * Instruments are numbered in the order they are added, and the number leads the IDs of
+     * their orders, so a backup has to add the primary's instruments in the same order.
+     * 
      * @param ticker The ticker symbol of the instrument to add.
-     * @throws std::runtime_error if the exchange is running.
-     * @throws std::invalid_argument if the instrument already exists.
+     * @param capacity Expected size of the book, to reserve and pre-fault its memory at startup; the default allocates from the heap.
+     * @throws std::runtime_error if the exchange is running, has run out of instrument numbers or the book's memory cannot be reserved.
+     * @throws std::invalid_argument if the instrument already exists, or its ticker is too long to journal to a backup.
      */
-    void AddInstrument(std::string ticker);
+    void AddInstrument(std::string ticker, const BookCapacity& capacity = {});
     
     /**
      * Remove an instrument from the exchange.
@@ -66,7 +223,132 @@ public:
      * @throws std::invalid_argument if the instrument doesn't exist.
      */
     void RemoveInstrument(std::string ticker);
+
+    /**
+     * Start an auction on an instrument. Orders rest without matching until it is uncrossed.
+     * 
+     * @param ticker The ticker symbol of the instrument.
+     * @throws std::invalid_argument if the instrument doesn't exist.
+     */
+    void StartAuction(std::string ticker);
+
+    /**
+     * Uncross the auction of an instrument and resume continuous matching.
+     * 
+     * @param ticker The ticker symbol of the instrument.
+     * @param reference_price Price to break ties towards, or 0 for none.
+     * @return The equilibrium price and volume the auction executed at.
+     * @throws std::invalid_argument if the instrument doesn't exist.
+     */
+    AuctionResult Uncross(std::string ticker, OrderPrice reference_price = 0);
+
+    /**
+     * Get the usage of an instrument's arena.
+     * 
+     * @param ticker The ticker symbol of the instrument.
+     * @return The arena counters, all zero if the book was added without a capacity.
+     * @throws std::invalid_argument if the instrument doesn't exist.
+     */
+    ArenaStats GetArenaStats(std::string ticker);
+
+    /**
+     * Get the memory footprint of an instrument: its book, the orders allocated alongside it and
+     * its table of orders by ID.
+     * 
+     * @param ticker The ticker symbol of the instrument.
+     * @return The live bytes of every memory category and the per order and per level averages.
+     * @throws std::invalid_argument if the instrument doesn't exist.
+     */
+    MemoryUsage GetMemoryUsage(std::string ticker);
+
+    /**
+     * Print the memory footprint of every instrument, one line each, and their total.
+     * 
+     * @param out The stream to print to.
+     */
+    void DumpMemoryUsage(std::ostream& out);
+
+    /**
+     * Dump the memory footprint from the timer thread at an interval while the exchange runs.
+     * 
+     * @param out The stream to dump to, or nullptr to stop dumping.
+     * @param interval Time between dumps.
+     * @throws std::runtime_error if the exchange is running.
+     */
+    void SetMemoryReport(std::ostream* out, std::chrono::milliseconds interval = std::chrono::seconds(10));
+
+    /**
+     * Publish a view of the top of every book after each change, for readers on other threads.
+     * Reading a view takes no lock, so analytics, market data and admin threads can watch the
+     * books as often as they like without holding up matching.
+     * 
+     * @param depth Levels to publish on each side, up to BookView::MAX_DEPTH, or 0 to stop publishing.
+     * @throws std::runtime_error if the exchange is running.
+     * @throws std::invalid_argument if the depth is over BookView::MAX_DEPTH.
+     */
+    void SetBookViewDepth(size_t depth);
+
+    /**
+     * Open a reader of an instrument's book views, for one thread. The reader keeps seeing the
+     * last view published should the instrument be removed.
+     * 
+     * @param ticker The ticker symbol of the instrument.
+     * @return The reader.
+     * @throws std::invalid_argument if the instrument doesn't exist.
+     * @throws std::runtime_error if book views are not published, or the book has too many readers.
+     */
+    BookViewReader OpenBookView(std::string ticker);
+
+    /**
+     * Get the hot path latency histograms of every stage, merged across all threads.
+     * 
+     * @return One histogram per LatencyStage, in nanoseconds. Empty if probes are compiled out.
+     */
+    LatencyReport GetLatencyReport();
+
+    /**
+     * Get the number of client messages received, network syscalls made and messages refused so far.
+     * Socket sessions report their syscalls when they end.
+     * 
+     * @return The gateway counters.
+     */
+    GatewayStats GetGatewayStats();
 private:
+    static constexpr std::chrono::milliseconds EXPIRY_INTERVAL{1}; ///< How often the timer thread looks for expired orders.
+    static constexpr size_t REPLICATION_BATCH = 1024; ///< Most journal entries a backup applies per acknowledgement.
+    static constexpr int GATEWAY_OWNER_SHIFT = 24; ///< Owners of a gateway's sessions carry the gateway's number above this bit.
+
+    /**
+     * @struct Shard
+     * An instrument's book and the orders placed on it, which their IDs lead straight to.
+     */
+    struct Shard {
+        std::string ticker; ///< Ticker of the instrument.
+        std::unique_ptr<OrderBook> book; ///< Book of the instrument.
+        OrderTable orders; ///< Orders placed on the book, by slot.
+        std::shared_ptr<BookViewPublisher> views; ///< Publisher of the book's views, or nullptr when they are off.
+    };
+
+    /**
+     * Expire orders every EXPIRY_INTERVAL until the exchange stops or the thread is asked to stop.
+     * 
+     * @param stop Token of the timer thread.
+     */
+    void RunExpiry(std::stop_token stop);
+
+    /**
+     * Serve every client from the calling thread through io_uring until the exchange stops.
+     * 
+     * @param server_sock The listening socket.
+     * @throws std::runtime_error if io_uring cannot be set up.
+     */
+    void RunUringGateway(int server_sock);
+
+    /**
+     * Pin the calling session thread to its core and apply the memory policy of the placement.
+     */
+    void PlaceSessionThread();
+
     /**
      * Handle a client connection.
      * 
@@ -76,89 +358,186 @@ private:
     int HandleClient(int conn);
 
     /**
-     * Process a logon message from a client.
+     * Serve a gateway process: apply the requests it forwards over the shared memory region it names.
      * 
-     * @param reader The FIX message reader.
-     * @return true if logon is successful, false otherwise.
+     * @param gateway_sock The gateway's control socket descriptor.
+     * @return int Returns 0 on success, -1 on failure.
+     */
+    int HandleGateway(int gateway_sock);
+
+    /**
+     * Apply a request forwarded by a gateway and turn the message into the response.
+     * 
+     * @param message The request, overwritten with the response.
+     * @param owner_base Range of owners of the gateway's sessions.
+     * @param accounts Risk accounts of the gateway's sessions, by owner.
      */
-    bool ProcessLogon(hffix::message_reader& reader);
+    void ProcessEngineRequest(EngineMessage& message, OwnerID owner_base,
+        std::unordered_map<OwnerID, std::shared_ptr<AccountRisk>>& accounts);
 
     /**
      * Send a logon response to a client.
      * 
-     * @param client_sock The client socket descriptor.
+     * @param session The client session.
      */
-    void SendLogonResponse(int client_sock);
+    void SendLogonResponse(Session& session);
 
     /**
-     * Process an incoming FIX message.
+     * Process an incoming FIX message, once the session's throttle lets it through.
      * 
      * @param reader The FIX message reader.
-     * @param client_sock The client socket descriptor.
+     * @param session The client session.
+     * @return false if the session is to be closed, true otherwise.
      */
-    void ProcessMessage(hffix::message_reader& reader, int client_sock);
+    bool ProcessMessage(hffix::message_reader& reader, Session& session);
 
     /**
      * Process a new order request.
      * 
      * @param reader The FIX message reader.
-     * @param client_sock The client socket descriptor.
+     * @param session The client session.
      */
-    void ProcessNewOrder(hffix::message_reader& reader, int client_sock);
+    void ProcessNewOrder(hffix::message_reader& reader, Session& session);
 
     /**
      * Send a new order acknowledgement to a client.
      * 
-     * @param client_sock The client socket descriptor.
+     * @param session The client session.
      * @param order The new order.
      */
-    void SendNewOrderAck(int client_sock, std::shared_ptr<Order>& order);
+    void SendNewOrderAck(Session& session, std::shared_ptr<Order>& order);
 
     /**
      * Process an order cancellation request.
      * 
      * @param reader The FIX message reader.
-     * @param client_sock The client socket descriptor.
+     * @param session The client session.
      */
-    void ProcessCancelOrder(hffix::message_reader& reader, int client_sock);
+    void ProcessCancelOrder(hffix::message_reader& reader, Session& session);
 
     /**
      * Send an order cancellation acknowledgement to a client.
      * 
-     * @param client_sock The client socket descriptor.
+     * @param session The client session.
      * @param order_id The ID of the cancelled order.
      */
-    void SendCancelOrderAck(int client_sock, OrderID order_id);
+    void SendCancelOrderAck(Session& session, OrderID order_id);
 
     /**
      * Process an order status request.
      * 
      * @param reader The FIX message reader.
-     * @param client_sock The client socket descriptor.
+     * @param session The client session.
      */
-    void ProcessGetOrderStatus(hffix::message_reader& reader, int client_sock);
+    void ProcessGetOrderStatus(hffix::message_reader& reader, Session& session);
 
     /**
      * Send an order status to a client.
      * 
-     * @param client_sock The client socket descriptor.
+     * @param session The client session.
      * @param order The order whose status is being sent.
      */
-    void SendOrderStatus(int client_sock, std::shared_ptr<Order>& order);
+    void SendOrderStatus(Session& session, std::shared_ptr<Order>& order);
+
+    /**
+     * Place a new order on its book.
+     * 
+     * @param request The requested order.
+     * @param owner Owner of the order.
+     * @param account Risk account of the owner.
+     * @param order Set to the order placed, once it has been given an ID.
+     * @return The reason the order was rejected, or empty if it was placed.
+     */
+    std::string_view PlaceOrder(const OrderRequest& request, OwnerID owner, const std::shared_ptr<AccountRisk>& account,
+        std::shared_ptr<Order>& order);
+
+    /**
+     * Cancel a resting order.
+     * 
+     * @param id The ID of the order.
+     * @return The reason the cancel was rejected, or empty if the order was cancelled.
+     */
+    std::string_view CancelOrder(OrderID id);
+
+    /**
+     * Find an order by ID.
+     * 
+     * @param id The ID of the order.
+     * @return The order, or nullptr if there is none with that ID.
+     */
+    std::shared_ptr<Order> FindOrder(OrderID id);
+
+    /**
+     * Find the shard of an instrument. Called with the mutex held.
+     * 
+     * @param ticker The ticker of the instrument.
+     * @return The shard, or nullptr if the instrument does not exist.
+     */
+    Shard* FindShard(const std::string& ticker);
+
+    /**
+     * Find the shard an order ID leads to, without looking at the order. Called with the mutex held.
+     * 
+     * @param id The ID of the order.
+     * @return The shard, or nullptr if the ID leads to no instrument.
+     */
+    Shard* FindShard(OrderID id);
+
+    /**
+     * Wait for the backup to apply a journaled command, in synchronous replication.
+     * 
+     * @param sequence The sequence number of the command, or 0 to return right away.
+     */
+    void AwaitReplication(uint64_t sequence);
+
+    /**
+     * Apply a command journaled by the primary. Called with the mutex held.
+     * 
+     * @param entry The command.
+     * @throws std::runtime_error if the command's instrument does not exist.
+     */
+    void ApplyJournalEntry(const JournalEntry& entry);
 
     /**
      * Send a rejection message to a client.
      * 
-     * @param client_sock The client socket descriptor.
+     * @param session The client session.
      * @param reason The reason for the rejection.
      */
-    void SendRejection(int client_sock, std::string reason);
+    void SendRejection(Session& session, std::string_view reason);
 
     std::atomic<bool> running_; ///< Flag indicating if the exchange is running.
-    std::atomic<OrderID> next_order_id_; ///< The next available order ID.
+    std::atomic<int> server_sock_; ///< Socket clients or gateways are accepted on while running, or -1.
     mutable std::shared_mutex mutex_; ///< Mutex for thread safe operations.
-    std::unordered_map<OrderID, std::shared_ptr<Order>> orders_; ///< Map of all orders.
-    std::unordered_map<std::string, std::unique_ptr<OrderBook>> order_books_; ///< Map of order books for each instrument.
+    std::unordered_map<std::string, InstrumentID> instruments_; ///< Number of each instrument, by ticker.
+    std::vector<std::unique_ptr<Shard>> shards_; ///< Shard of each instrument by number, nullptr once removed.
+    std::atomic<uint64_t> messages_received_; ///< Client messages received.
+    std::atomic<uint64_t> network_syscalls_; ///< Network syscalls made by the gateway.
+    std::atomic<uint64_t> throttled_; ///< Messages refused by session throttles.
+    std::atomic<uint64_t> queued_; ///< Messages held back by session throttles.
+    std::atomic<uint64_t> disconnects_; ///< Sessions closed by their throttles.
+    std::atomic<uint64_t> shed_; ///< New orders shed under overload.
+    ThrottleLimits throttle_limits_; ///< Limits every session is held to.
+    uint32_t max_pending_orders_; ///< New orders allowed to wait for the books at once, or 0 for no limit.
+    std::atomic<uint32_t> pending_orders_; ///< New orders waiting for or holding the books.
+    ThreadPlacement placement_; ///< Where threads run and how they wait for input.
+    std::atomic<size_t> next_session_cpu_; ///< Index into the session cores of the next session thread.
+    std::atomic<SelfTradePrevention> self_trade_prevention_; ///< Self-trade prevention applied to new orders.
+    RiskGate risk_gate_; ///< Pre-trade checks in front of the books, read without the mutex while running.
+    Timestamp session_end_; ///< Session end given to the books, or 0 for the next midnight UTC.
+    std::mutex expiry_mutex_; ///< Serializes expiry passes, which share the encoder and buffer below.
+    ExecutionReportHandler execution_report_handler_; ///< Callback receiving the reports of expired orders.
+    FixEncoder expiry_encoder_; ///< Encoder of expiry reports.
+    std::vector<OrderID> expired_; ///< Orders expired by a book, reused across passes.
+    std::ostream* memory_report_; ///< Stream the timer thread dumps the memory footprint to, or nullptr.
+    std::chrono::milliseconds memory_report_interval_; ///< Time between memory footprint dumps.
+    size_t book_view_depth_; ///< Levels of every book published to view readers, or 0 for none.
+    std::unique_ptr<Replicator> replicator_; ///< Stream of the journal to the backup, or nullptr without one.
+    std::atomic<bool> following_; ///< Whether the exchange is the backup of a primary.
+    std::atomic<int> replication_sock_; ///< Socket the primary is accepted on while following it, or -1.
+    std::atomic<int> primary_sock_; ///< Connection from the primary while following it, or -1.
+    std::atomic<uint64_t> applied_; ///< Journaled commands applied as a backup.
+    std::atomic<uint32_t> next_gateway_; ///< Number of the next gateway to attach.
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef FIX_DECODER_HPP
+#define FIX_DECODER_HPP
+
+#include <string>
+#include <string_view>
+
+#include "order.hpp"
+#include "utils.hpp"
+#include "hffix.hpp"
+
+/**
+ * @struct OrderRequest
+ * A new order as requested by a client, before the exchange gives it an ID and owner.
+ */
+struct OrderRequest {
+    std::string ticker; ///< Instrument of the order.
+    OrderSide side = OrderSide::BID; ///< Side of the order.
+    OrderType type = OrderType::GOOD_TIL_CANCELED; ///< Type of the order.
+    OrderPrice price = 0; ///< Limit price, 0 for market orders.
+    OrderQuantity quantity = 0; ///< Quantity of the order.
+    OrderPrice stop_price = 0; ///< Trigger price of a stop order.
+    OrderQuantity display_quantity = 0; ///< Quantity an iceberg shows at a time.
+    PegType peg_type = PegType::NO_PEG; ///< Reference price a pegged order tracks.
+    PriceOffset peg_offset = 0; ///< Amount added to the reference price of a pegged order.
+    Timestamp expire_time = 0; ///< Time a GOOD_TIL_DATE order expires at.
+};
+
+/**
+ * @class FixDecoder
+ * Decodes the FIX requests of clients into what the exchange acts on.
+ *
+ * Decoding checks everything about a request that does not depend on the books, so whatever
+ * serves the session, in the exchange or in a gateway process in front of it, rejects the
+ * same malformed requests with the same reasons.
+ */
+class FixDecoder {
+public:
+    /**
+     * Decode a logon.
+     *
+     * @param reader The FIX message reader.
+     * @param channel_name Set to the shared memory region named by the client, if any.
+     * @return true if the logon is valid, false otherwise.
+     */
+    static bool DecodeLogon(hffix::message_reader& reader, std::string& channel_name);
+
+    /**
+     * Decode a new order single.
+     *
+     * @param reader The FIX message reader.
+     * @param request Set to the requested order.
+     * @return The reason to reject the request with, or empty if it is valid.
+     */
+    static std::string_view DecodeNewOrder(hffix::message_reader& reader, OrderRequest& request);
+
+    /**
+     * Check a new order request against the rules every order has to meet, wherever the request
+     * came from: a limit order needs a price, a stop order a stop price, and icebergs, pegs and
+     * expire times need an order type that rests.
+     *
+     * @param request The requested order.
+     * @return The reason to reject the request with, or empty if it is valid.
+     */
+    static std::string_view ValidateNewOrder(const OrderRequest& request);
+
+    /**
+     * Decode the order a cancel or status request refers to.
+     *
+     * @param reader The FIX message reader.
+     * @param id Set to the ID of the order.
+     * @return true if the request names an order, false otherwise.
+     */
+    static bool DecodeOrderID(hffix::message_reader& reader, OrderID& id);
+};
+
+#endif
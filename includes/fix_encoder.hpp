@@ -0,0 +1,192 @@
+#ifndef FIX_ENCODER_HPP
+#define FIX_ENCODER_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "order.hpp"
+#include "utils.hpp"
+
+/**
+ * @class FixEncoder
+ * Encodes the exchange's FIX responses for a single session.
+ *
+ * Everything that is constant for a message type and session (the header fields and any
+ * constant body fields) is rendered once at construction together with its checksum
+ * contribution. Encoding a response then only formats the variable fields into a reusable
+ * output buffer, summing their bytes as they are written, and patches BodyLength and
+ * CheckSum at the end. No heap allocation happens on the encoding path.
+ */
+class FixEncoder {
+public:
+    /**
+     * Construct a new FixEncoder, pre-rendering the templates for the session.
+     *
+     * @param sender_comp_id The SenderCompID of responses (the exchange).
+     * @param target_comp_id The TargetCompID of responses (the client).
+     */
+    FixEncoder(std::string_view sender_comp_id = "SERVER", std::string_view target_comp_id = "CLIENT");
+
+    /**
+     * Copying would leave the output views pointing into the source buffer.
+     */
+    FixEncoder(const FixEncoder&) = delete;
+    FixEncoder& operator=(const FixEncoder&) = delete;
+
+    /**
+     * Encode a logon response.
+     *
+     * @return View of the encoded message, valid until the next call on this encoder.
+     */
+    std::string_view EncodeLogonResponse();
+
+    /**
+     * Encode a new order acknowledgement execution report.
+     *
+     * @param order The acknowledged order.
+     * @return View of the encoded message, valid until the next call on this encoder.
+     */
+    std::string_view EncodeNewOrderAck(Order& order);
+
+    /**
+     * Encode an order cancellation acknowledgement execution report.
+     *
+     * @param order_id The ID of the cancelled order.
+     * @return View of the encoded message, valid until the next call on this encoder.
+     */
+    std::string_view EncodeCancelOrderAck(OrderID order_id);
+
+    /**
+     * Encode an order status execution report.
+     *
+     * @param order The order whose status is being sent.
+     * @return View of the encoded message, valid until the next call on this encoder.
+     */
+    std::string_view EncodeOrderStatus(Order& order);
+
+    /**
+     * Encode the unsolicited execution report of an order that expired.
+     *
+     * @param order The expired order.
+     * @return View of the encoded message, valid until the next call on this encoder.
+     */
+    std::string_view EncodeExpiry(Order& order);
+
+    /**
+     * Encode a reject message.
+     *
+     * @param reason The reason for the rejection, truncated if it does not fit the buffer.
+     * @return View of the encoded message, valid until the next call on this encoder.
+     */
+    std::string_view EncodeRejection(std::string_view reason);
+private:
+    /**
+     * @struct Fragment
+     * A pre-rendered run of "tag=value<SOH>" fields along with the sum of its bytes.
+     */
+    struct Fragment {
+        char text[96]; ///< The rendered fields.
+        size_t length; ///< Number of bytes in text.
+        unsigned sum; ///< Sum of the bytes in text, for the checksum.
+    };
+
+    /**
+     * @struct Tag
+     * A pre-rendered "tag=" prefix along with the sum of its bytes.
+     */
+    struct Tag {
+        char text[8]; ///< The rendered prefix.
+        size_t length; ///< Number of bytes in text.
+        unsigned sum; ///< Sum of the bytes in text, for the checksum.
+    };
+
+    /**
+     * Render a "tag=" prefix at compile time.
+     *
+     * @param tag The FIX tag number.
+     * @return The rendered prefix.
+     */
+    static constexpr Tag MakeTag(int tag) {
+        Tag result{};
+        char digits[6] = {};
+        size_t count = 0;
+        do {
+            digits[count++] = '0' + tag % 10;
+            tag /= 10;
+        } while (tag);
+        while (count) result.text[result.length++] = digits[--count];
+        result.text[result.length++] = '=';
+        for (size_t i = 0; i < result.length; ++i) result.sum += static_cast<unsigned char>(result.text[i]);
+        return result;
+    }
+
+    /**
+     * Render a fragment of fields at construction time.
+     *
+     * @param fields The fields, already joined with SOH separators.
+     * @return The rendered fragment.
+     * @throws std::length_error if the fields do not fit a fragment.
+     */
+    static Fragment MakeFragment(const std::string& fields);
+
+    /**
+     * Start a message body from a pre-rendered template.
+     *
+     * @param fragment The template holding the header and constant body fields.
+     */
+    void Begin(const Fragment& fragment);
+
+    /**
+     * Append an unsigned integer field.
+     *
+     * @param tag The pre-rendered tag.
+     * @param value The value to format.
+     */
+    void PutInt(const Tag& tag, uint64_t value);
+
+    /**
+     * Append a single character field.
+     *
+     * @param tag The pre-rendered tag.
+     * @param value The character value.
+     */
+    void PutChar(const Tag& tag, char value);
+
+    /**
+     * Append a string field, truncated to the space left in the buffer.
+     *
+     * @param tag The pre-rendered tag.
+     * @param value The string value.
+     */
+    void PutString(const Tag& tag, std::string_view value);
+
+    /**
+     * Write BodyLength in front of the body and append the CheckSum trailer.
+     *
+     * @return View of the complete message.
+     */
+    std::string_view Finish();
+
+    /**
+     * Maximum size of the BeginString and BodyLength fields written in front of a body.
+     */
+    static constexpr size_t HEADER_RESERVE = 20;
+
+    /**
+     * Space string fields leave free at the end of the buffer for the fields and trailer after them.
+     */
+    static constexpr size_t TAIL_RESERVE = 192;
+
+    Fragment logon_; ///< Complete logon response body.
+    Fragment new_order_ack_; ///< Header and constant fields of a new order acknowledgement.
+    Fragment cancel_order_ack_; ///< Header and constant fields of a cancel acknowledgement.
+    Fragment order_status_; ///< Header and constant fields of an order status report.
+    Fragment expiry_; ///< Header and constant fields of an expiry report.
+    Fragment rejection_; ///< Header fields of a reject.
+    char buffer_[BUFFER_SIZE]; ///< Output buffer reused by every message of the session.
+    char* cursor_; ///< Next free byte of the body being written.
+    unsigned sum_; ///< Running byte sum of the body being written.
+};
+
+#endif
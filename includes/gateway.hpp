@@ -0,0 +1,130 @@
+#ifndef GATEWAY_HPP
+#define GATEWAY_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "engine_message.hpp"
+#include "gateway_backend.hpp"
+#include "session.hpp"
+#include "shm_channel.hpp"
+#include "hffix.hpp"
+
+/**
+ * @class Gateway
+ * Serves FIX clients in front of a matching engine running in another process.
+ *
+ * The gateway does everything the exchange does for a session short of matching: it accepts the
+ * clients, runs one thread per session, decodes their FIX requests and encodes the responses.
+ * Requests go to the engine as fixed size binary messages through a shared memory channel, which
+ * every session of the gateway shares. A dispatcher thread hands each response back to the
+ * session that is waiting for it. Several gateways can serve one engine, so client handling
+ * scales apart from matching, and a gateway that crashes takes only its own sessions with it.
+ */
+class Gateway {
+public:
+    /**
+     * Construct a gateway that is not attached to an engine yet.
+     */
+    Gateway();
+
+    /**
+     * Detach from the engine and stop serving clients.
+     */
+    ~Gateway();
+
+    Gateway(const Gateway&) = delete;
+    Gateway& operator=(const Gateway&) = delete;
+
+    /**
+     * Attach to a matching engine.
+     *
+     * @param engine_host Address of the engine.
+     * @param engine_port Port the engine serves gateways on.
+     * @throws std::invalid_argument if the host is invalid.
+     * @throws std::runtime_error if the gateway is already attached or the engine cannot be reached.
+     */
+    void Connect(const std::string& engine_host, int engine_port);
+
+    /**
+     * Serve clients on the specified port until stopped.
+     *
+     * @param port The port number to listen on for incoming connections.
+     * @throws std::runtime_error if the gateway is not attached or fails to start.
+     */
+    void Start(int port);
+
+    /**
+     * Stop serving clients.
+     */
+    void Stop();
+
+    /**
+     * Get the number of client messages received and network syscalls made so far.
+     * Sessions report their syscalls when they end.
+     *
+     * @return The gateway counters.
+     */
+    GatewayStats GetGatewayStats();
+private:
+    static constexpr uint64_t FAILED_CALL = UINT64_MAX; ///< Correlation of the response to a call the engine never answered.
+
+    /**
+     * Handle a client connection.
+     *
+     * @param client_sock The client socket descriptor.
+     * @return int Returns 0 on success, -1 on failure.
+     */
+    int HandleClient(int client_sock);
+
+    /**
+     * Forward a client's request to the engine and answer the client.
+     *
+     * @param reader The FIX message reader.
+     * @param session The client session.
+     */
+    void ProcessMessage(hffix::message_reader& reader, Session& session);
+
+    /**
+     * Send a rejection message to a client.
+     *
+     * @param session The client session.
+     * @param reason The reason for the rejection.
+     */
+    void SendRejection(Session& session, std::string_view reason);
+
+    /**
+     * Send a request to the engine and wait for its response.
+     *
+     * @param message The request, overwritten with the response.
+     * @return false if the engine is gone, true otherwise.
+     */
+    bool Call(EngineMessage& message);
+
+    /**
+     * Hand responses from the engine to the sessions waiting for them, until the engine is gone.
+     */
+    void RunResponses();
+
+    std::atomic<bool> running_; ///< Flag indicating if the gateway is serving clients.
+    std::atomic<int> server_sock_; ///< Socket clients are accepted on while serving, or -1.
+    int engine_sock_; ///< Control connection to the engine, or -1.
+    std::unique_ptr<ShmChannel> engine_; ///< Channel carrying requests and responses.
+    std::mutex calls_mutex_; ///< Guards the calls below.
+    std::mutex send_mutex_; ///< Serializes the sessions producing into the channel.
+    std::unordered_map<uint64_t, std::promise<EngineMessage>> calls_; ///< Requests awaiting a response, by correlation.
+    uint64_t next_correlation_; ///< Correlation of the next request.
+    bool connected_; ///< Whether the engine is still there.
+    std::jthread responses_; ///< Dispatches responses from the engine.
+    std::atomic<uint64_t> messages_received_; ///< Client messages received.
+    std::atomic<uint64_t> network_syscalls_; ///< Network syscalls made by the sessions.
+};
+
+#endif
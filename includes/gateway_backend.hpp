@@ -0,0 +1,28 @@
+#ifndef GATEWAY_BACKEND_HPP
+#define GATEWAY_BACKEND_HPP
+
+#include <cstdint>
+
+/**
+ * @enum GatewayBackend
+ * Represents how the exchange serves client connections.
+ */
+enum GatewayBackend {
+    SOCKETS, ///< One thread per session, blocking on recv and send.
+    IO_URING ///< A single thread serving every session through io_uring.
+};
+
+/**
+ * @struct GatewayStats
+ * Counters of the network work done by the exchange.
+ */
+struct GatewayStats {
+    uint64_t messages = 0; ///< Client messages received.
+    uint64_t syscalls = 0; ///< Network syscalls made to receive them and send the responses.
+    uint64_t throttled = 0; ///< Messages refused for exceeding their session's rate limit.
+    uint64_t queued = 0; ///< Messages held back until their session's rate allowed them.
+    uint64_t disconnects = 0; ///< Sessions closed for exceeding their rate limit.
+    uint64_t shed = 0; ///< New orders rejected while the exchange was overloaded.
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @enum JournalAction
+ * Represents the kind of a journaled command.
+ */
+enum JournalAction : uint8_t {
+    JOURNAL_NEW = 'N', ///< Place a new order.
+    JOURNAL_CANCEL = 'C', ///< Cancel a resting order.
+    JOURNAL_EXPIRE = 'E', ///< Expire a resting order.
+    JOURNAL_AUCTION = 'A', ///< Start an auction on an instrument.
+    JOURNAL_UNCROSS = 'U' ///< Uncross the auction of an instrument.
+};
+
+/**
+ * @struct JournalEntry
+ * A single command that changed the books of an exchange, laid out exactly as streamed to a backup.
+ *
+ * Entries carry everything needed to apply the command again, including the order ID and owner
+ * the primary assigned, so a backup applying them in sequence ends up with the same books.
+ */
+struct JournalEntry {
+    static constexpr size_t TICKER_SIZE = 16; ///< Bytes of the ticker, NUL padded.
+
+    uint64_t sequence; ///< Position of the command in the journal, starting at 1.
+    uint64_t order_id; ///< ID of the order placed, cancelled or expired.
+    uint64_t expire_time; ///< Expire time (new orders only).
+    uint32_t price; ///< Limit price of a new order, or reference price of an uncross.
+    uint32_t quantity; ///< Quantity (new orders only).
+    uint32_t stop_price; ///< Stop price (new orders only).
+    uint32_t display_quantity; ///< Display quantity (new orders only).
+    int32_t peg_offset; ///< Peg offset (new orders only).
+    uint32_t owner; ///< Owner of the order (new orders only).
+    uint8_t action; ///< A JournalAction.
+    uint8_t side; ///< An OrderSide (new orders only).
+    uint8_t type; ///< An OrderType (new orders only).
+    uint8_t peg_type; ///< A PegType (new orders only).
+    uint8_t self_trade_prevention; ///< A SelfTradePrevention mode (new orders only).
+    uint8_t reserved[3]; ///< Padding, always 0.
+    char ticker[TICKER_SIZE]; ///< Instrument of the command.
+};
+
+static_assert(sizeof(JournalEntry) == 72, "JournalEntry must match the replication stream format");
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+#include "clock.hpp"
+
+/**
+ * @enum LatencyStage
+ * Represents the instrumented stages of the exchange hot path.
+ */
+enum LatencyStage {
+    RECEIVE, ///< Reading a message that has already arrived off the client socket or channel, not waiting for it.
+    DECODE, ///< Parsing the FIX fields of a received message.
+    RISK_CHECK, ///< Running a new order through the pre-trade risk gate.
+    LOCK_WAIT, ///< Waiting to acquire the exchange mutex.
+    PLACE_ORDER, ///< Running an order through OrderBook::PlaceOrder.
+    REPLICATE, ///< Waiting for the backup to apply a command, in synchronous replication.
+    ENCODE, ///< Building a FIX response.
+    SEND, ///< Writing a response to the client socket.
+    NUM_LATENCY_STAGES ///< Number of instrumented stages.
+};
+
+/**
+ * @class LatencyHistogram
+ * A fixed-size, log-linear (HDR style) histogram of latency samples.
+ *
+ * Values below 128 are stored exactly; larger values are stored in buckets whose width
+ * doubles every 64 buckets, giving a relative error below 1.6% across the whole range.
+ * Recording is a handful of instructions and never allocates. Counters are atomics so that
+ * a histogram owned by one thread can be read by another while it is being recorded into.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 7; ///< Bits of precision kept for every value.
+    static constexpr uint64_t SUB_BUCKET_COUNT = 1ULL << SUB_BUCKET_BITS; ///< Number of exactly stored values.
+    static constexpr uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2; ///< Number of buckets per power of two.
+    static constexpr int MAX_SHIFT = 40; ///< Largest bucket shift, bounding the trackable range to ~2^47.
+    static constexpr size_t BUCKET_COUNT = SUB_BUCKET_COUNT + MAX_SHIFT * SUB_BUCKET_HALF; ///< Total number of buckets.
+
+    /**
+     * Construct an empty histogram.
+     */
+    LatencyHistogram();
+
+    /**
+     * Construct a histogram holding a snapshot of another histogram.
+     *
+     * @param other The histogram to copy.
+     */
+    LatencyHistogram(const LatencyHistogram& other);
+
+    /**
+     * Replace the contents of this histogram with a snapshot of another histogram.
+     *
+     * @param other The histogram to copy.
+     * @return Reference to this histogram.
+     */
+    LatencyHistogram& operator=(const LatencyHistogram& other);
+
+    /**
+     * Record a single sample. Must only be called by the thread owning the histogram.
+     *
+     * @param value The sample to record; values past the trackable range are clamped.
+     */
+    void Record(uint64_t value);
+
+    /**
+     * Record the same sample multiple times.
+     *
+     * @param value The sample to record.
+     * @param count The number of times to record it.
+     */
+    void Record(uint64_t value, uint64_t count);
+
+    /**
+     * Add all samples of another histogram to this one.
+     *
+     * @param other The histogram to merge in.
+     */
+    void Merge(const LatencyHistogram& other);
+
+    /**
+     * Remove all recorded samples.
+     */
+    void Reset();
+
+    /**
+     * Get the number of recorded samples.
+     *
+     * @return Sample count.
+     */
+    uint64_t GetCount() const;
+
+    /**
+     * Get the smallest recorded sample.
+     *
+     * @return Minimum sample, or 0 if the histogram is empty.
+     */
+    uint64_t GetMin() const;
+
+    /**
+     * Get the largest recorded sample.
+     *
+     * @return Maximum sample, or 0 if the histogram is empty.
+     */
+    uint64_t GetMax() const;
+
+    /**
+     * Get the mean of the recorded samples.
+     *
+     * @return Mean sample, or 0 if the histogram is empty.
+     */
+    double GetMean() const;
+
+    /**
+     * Get the value below which the given percentage of samples fall.
+     *
+     * @param percentile Percentile in the range [0, 100].
+     * @return The highest value equivalent to the bucket holding the percentile.
+     */
+    uint64_t GetValueAtPercentile(double percentile) const;
+
+    /**
+     * Get a copy of this histogram with every sample multiplied by a factor.
+     *
+     * @param factor The factor to scale samples by (e.g. nanoseconds per tick).
+     * @return The scaled histogram.
+     */
+    LatencyHistogram Scaled(double factor) const;
+private:
+    /**
+     * Get the bucket a value is recorded in.
+     *
+     * @param value The value.
+     * @return The bucket index.
+     */
+    static size_t BucketIndex(uint64_t value);
+
+    /**
+     * Get the highest value that is recorded in a bucket.
+     *
+     * @param index The bucket index.
+     * @return The highest equivalent value.
+     */
+    static uint64_t BucketValue(size_t index);
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts_; ///< Number of samples in every bucket.
+    std::atomic<uint64_t> count_; ///< Total number of samples.
+    std::atomic<uint64_t> sum_; ///< Sum of all samples, used for the mean.
+    std::atomic<uint64_t> min_; ///< Smallest sample recorded.
+    std::atomic<uint64_t> max_; ///< Largest sample recorded.
+};
+
+/**
+ * @typedef LatencyReport
+ * One histogram per latency stage, indexed by LatencyStage.
+ */
+using LatencyReport = std::array<LatencyHistogram, NUM_LATENCY_STAGES>;
+
+/**
+ * @class LatencyRecorder
+ * Records hot path stage latencies into per-thread histograms.
+ *
+ * Every thread records into its own set of histograms, so probes never contend. Histograms
+ * are registered globally and merged on demand; when a thread exits its samples are folded
+ * into a retired set so that session threads do not lose their data.
+ */
+class LatencyRecorder {
+public:
+    /**
+     * Record a stage latency into the calling thread's histograms.
+     *
+     * @param stage The stage being measured.
+     * @param ticks The duration of the stage in ticks.
+     */
+    static void Record(LatencyStage stage, uint64_t ticks);
+
+    /**
+     * Merge the histograms of all threads, converted to nanoseconds.
+     *
+     * @return The merged histograms.
+     */
+    static LatencyReport Snapshot();
+
+    /**
+     * Discard all recorded samples.
+     */
+    static void Reset();
+
+    /**
+     * Print a percentile summary of every stage.
+     *
+     * @param out The stream to print to.
+     */
+    static void Dump(std::ostream& out);
+
+    /**
+     * Print a summary to standard error whenever the process receives a signal.
+     *
+     * @param signum The signal to dump on (e.g. SIGUSR1).
+     * @throws std::runtime_error if the handler cannot be installed.
+     */
+    static void DumpOnSignal(int signum);
+
+    /**
+     * Get the display name of a stage.
+     *
+     * @param stage The stage.
+     * @return The stage name.
+     */
+    static const char* GetStageName(LatencyStage stage);
+};
+
+#ifndef DISABLE_LATENCY_PROBES
+/**
+ * Take a timestamp for a later LATENCY_RECORD.
+ */
+#define LATENCY_PROBE(name) const uint64_t name = Clock::ReadTicks()
+
+/**
+ * Record the time elapsed since a LATENCY_PROBE against a stage.
+ */
+#define LATENCY_RECORD(stage, start) LatencyRecorder::Record(stage, Clock::ReadTicks() - (start))
+#else
+#define LATENCY_PROBE(name)
+#define LATENCY_RECORD(stage, start)
+#endif
+
+#endif
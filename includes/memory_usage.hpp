@@ -0,0 +1,65 @@
+#ifndef MEMORY_USAGE_HPP
+#define MEMORY_USAGE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @enum MemoryCategory
+ * Represents what an allocation made for a book holds.
+ */
+enum MemoryCategory : uint8_t {
+    MEMORY_ORDERS, ///< Orders allocated with the book's allocator, and their reference counts.
+    MEMORY_LEVELS, ///< Price level tables and the levels in them, peg groups included.
+    MEMORY_QUEUES, ///< Queue entries of the orders resting at each level.
+    MEMORY_INDEXES, ///< Hash tables locating orders by ID, in the book and in each level.
+    MEMORY_SETS, ///< Sorted sets: the best price ladders and the waiting stops.
+    MEMORY_TIMERS, ///< Expiry timers and their index.
+    MEMORY_ORDER_TABLE, ///< The exchange's table of every order placed on the book.
+    MEMORY_OTHER, ///< Allocations made without a category.
+    NUM_MEMORY_CATEGORIES ///< Number of categories.
+};
+
+/**
+ * @struct MemoryUsage
+ * Footprint of a book, broken down by what the memory holds.
+ *
+ * Bytes are live bytes: the block sizes handed out by a book's arena, or the requested sizes of
+ * allocations served from the heap, so the heap allocator's own overhead is not included.
+ */
+struct MemoryUsage {
+    std::array<size_t, NUM_MEMORY_CATEGORIES> bytes{}; ///< Live bytes of every MemoryCategory.
+    size_t total_bytes = 0; ///< Live bytes across the categories.
+    size_t resting_orders = 0; ///< Orders in the book, waiting stops included.
+    size_t price_levels = 0; ///< Price levels and peg groups across both sides.
+    double bytes_per_order = 0; ///< Bytes of everything but levels and sets per resting order, or 0 without any.
+    double bytes_per_level = 0; ///< Bytes of levels and sets per price level, or 0 without any.
+};
+
+/**
+ * Work out the total and the averages of a footprint from its bytes and counts.
+ *
+ * @param usage The footprint, with bytes and counts filled in.
+ */
+inline void SummarizeMemoryUsage(MemoryUsage& usage) {
+    usage.total_bytes = 0;
+    for (size_t bytes : usage.bytes) usage.total_bytes += bytes;
+    size_t level_bytes = usage.bytes[MemoryCategory::MEMORY_LEVELS] + usage.bytes[MemoryCategory::MEMORY_SETS];
+    usage.bytes_per_order = usage.resting_orders ? static_cast<double>(usage.total_bytes - level_bytes) / usage.resting_orders : 0;
+    usage.bytes_per_level = usage.price_levels ? static_cast<double>(level_bytes) / usage.price_levels : 0;
+}
+
+/**
+ * Get the name of a memory category, for reports.
+ *
+ * @param category The category.
+ * @return The name in lower case.
+ */
+inline const char* GetMemoryCategoryName(MemoryCategory category) {
+    static constexpr const char* NAMES[NUM_MEMORY_CATEGORIES] = {
+        "orders", "levels", "queues", "indexes", "sets", "timers", "order_table", "other"};
+    return category < NUM_MEMORY_CATEGORIES ? NAMES[category] : "unknown";
+}
+
+#endif
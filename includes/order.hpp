@@ -2,13 +2,19 @@
 #define ORDER_HPP
 
 #include <cstdint>
+#include <memory>
 #include <string>
 
+#include "account_risk.hpp"
 #include "order_side.hpp"
+#include "peg_type.hpp"
+#include "self_trade_prevention.hpp"
 #include "order_type.hpp"
 #include "order_status.hpp"
 #include "utils.hpp"
 
+class OrderTable;
+
 /**
  * @class Order
  * Represents an order in the trading system.
@@ -27,14 +33,21 @@ public:
      *
      * @param order_id Unique identifier for the order
      * @param ticker Stock ticker symbol
-     * @param order_price Price of the order
+     * @param order_price Price of the order; ignored for MARKET orders, which take any price
      * @param order_quantity Quantity of the order
      * @param order_side Side of the order (BID or ASK)
      * @param order_type Type of the order (e.g., GOOD_TIL_CANCELED, FILL_OR_KILL)
-     * @throws std::invalid_argument if order_quantity is 0
+     * @param stop_price Last trade price that triggers a STOP or STOP_LIMIT order; ignored for other types
+     * @param display_quantity Quantity shown at a time by an iceberg order, or 0 to show all of it
+     * @param peg_type Reference price a pegged order tracks, in place of order_price
+     * @param peg_offset Amount added to the reference price of a pegged order
+     * @param expire_time Time a GOOD_TIL_DATE order expires at; ignored for other types
+     * @throws std::invalid_argument if order_quantity is 0, a stop order has no stop price, a good til date
+     *         order has no expire time, or an order that never rests has a display quantity or a peg
      */
     Order(OrderID order_id, std::string ticker, OrderPrice order_price, OrderQuantity order_quantity,
-        OrderSide order_side, OrderType order_type);
+        OrderSide order_side, OrderType order_type, OrderPrice stop_price = 0, OrderQuantity display_quantity = 0,
+        PegType peg_type = PegType::NO_PEG, PriceOffset peg_offset = 0, Timestamp expire_time = 0);
 
     /**
      * Get the remaining unfilled quantity of the order.
@@ -58,6 +71,78 @@ public:
      */
     bool IsFilled();
 
+    /**
+     * Reduce the quantity of the order without trading it, cancelling the order if nothing remains.
+     * 
+     * @param amount Amount to take off the remaining quantity
+     * @throws std::invalid_argument if amount is greater than remaining quantity
+     */
+    void Reduce(OrderQuantity amount);
+
+    /**
+     * Check if what is left of the order after matching rests in the book.
+     * 
+     * @return true for GOOD_TIL_CANCELED, DAY and GOOD_TIL_DATE orders, false otherwise
+     */
+    bool CanRest();
+
+    /**
+     * Check if the order leaves the book on its own at the end of its time in force.
+     * 
+     * @return true for DAY and GOOD_TIL_DATE orders, false otherwise
+     */
+    bool CanExpire();
+
+    /**
+     * Check if the order is a stop waiting for its trigger.
+     * 
+     * @return true if the order is a STOP or STOP_LIMIT order, false otherwise
+     */
+    bool IsStop();
+
+    /**
+     * Turn a triggered stop into the order it stands for: a STOP becomes an
+     * IMMEDIATE_OR_CANCEL order at any price, a STOP_LIMIT a GOOD_TIL_CANCELED
+     * order at its limit price.
+     * 
+     * @throws std::invalid_argument if the order is not a stop
+     */
+    void Trigger();
+
+    /**
+     * Check if the order is an iceberg, showing only part of its quantity at a time.
+     * 
+     * @return true if the order has a display quantity, false otherwise
+     */
+    bool IsIceberg();
+
+    /**
+     * Show the next tranche of an iceberg: the display quantity, or whatever remains if less.
+     * Does nothing for other orders, which always show their whole remaining quantity.
+     */
+    void Replenish();
+
+    /**
+     * Get the quantity currently shown in the book.
+     * 
+     * @return The shown quantity, the remaining quantity for orders that are not icebergs
+     */
+    OrderQuantity GetVisible();
+
+    /**
+     * Get the remaining quantity held back from the book.
+     * 
+     * @return The hidden reserve, 0 for orders that are not icebergs
+     */
+    OrderQuantity GetHidden();
+
+    /**
+     * Check if the order is pegged, trading at a price derived from the book instead of its own.
+     * 
+     * @return true if the order has a peg type, false otherwise
+     */
+    bool IsPegged();
+
     // Getters
     Timestamp GetCreatedAt();
     OrderID GetID();
@@ -68,6 +153,13 @@ public:
     OrderSide GetSide();
     OrderType GetType();
     OrderStatus GetStatus();
+    OrderPrice GetStopPrice();
+    OrderQuantity GetDisplayQuantity();
+    PegType GetPegType();
+    PriceOffset GetPegOffset();
+    Timestamp GetExpireTime();
+    OwnerID GetOwner();
+    SelfTradePrevention GetSelfTradePrevention();
 
     /**
      * Set the status of the order.
@@ -76,6 +168,29 @@ public:
      * @throws std::invalid_argument for invalid state transitions
      */
     void SetStatus(OrderStatus status);
+
+    /**
+     * Set who the order belongs to and what it does when about to trade with another order of theirs.
+     * 
+     * @param owner The owner
+     * @param self_trade_prevention What to do instead of trading with the owner's resting orders
+     * @throws std::invalid_argument if self-trades are to be prevented for an order without an owner
+     */
+    void SetOwner(OwnerID owner, SelfTradePrevention self_trade_prevention = SelfTradePrevention::NO_STP);
+
+    /**
+     * Attach the order to the exposure of its account, which it then updates as it fills and closes.
+     * 
+     * @param account The account's exposure, already counting the order as open
+     */
+    void SetAccount(std::shared_ptr<AccountRisk> account);
+
+    /**
+     * Have the order give its slot back to the table holding it once it closes, however it closes.
+     * 
+     * @param table The table, or nullptr
+     */
+    void SetTable(OrderTable* table);
 private:
     Timestamp created_at_; ///< Timestamp when the order was created.
     OrderID id_; ///< Unique identifier for the order.
@@ -86,6 +201,16 @@ private:
     OrderSide side_; ///< Side of the order.
     OrderType type_; ///< Type of the order.
     OrderStatus status_; ///< Current status of the order.
+    OrderPrice stop_price_; ///< Last trade price that triggers a stop order, or 0.
+    OrderQuantity display_quantity_; ///< Quantity an iceberg shows at a time, or 0.
+    OrderQuantity visible_; ///< Part of the current iceberg tranche not yet filled.
+    PegType peg_type_; ///< Reference price a pegged order tracks.
+    PriceOffset peg_offset_; ///< Amount added to the reference price of a pegged order.
+    Timestamp expire_time_; ///< Time a good til date order expires at, or 0.
+    OwnerID owner_; ///< Participant the order belongs to, or NO_OWNER.
+    SelfTradePrevention self_trade_prevention_; ///< What the order does instead of trading with its owner's resting orders.
+    std::shared_ptr<AccountRisk> account_; ///< Exposure of the account the order counts against, or nullptr.
+    OrderTable* table_; ///< Table the order's slot goes back to once it closes, or nullptr.
 };
 
 #endif
\ No newline at end of file
@@ -1,12 +1,53 @@
 #ifndef ORDER_BOOK_HPP
 #define ORDER_BOOK_HPP
 
+#include <atomic>
 #include <unordered_map>
-#include <set>
+#include <map>
 #include <memory>
+#include <vector>
 
+#include "arena.hpp"
+#include "memory_usage.hpp"
 #include "order.hpp"
+#include "page_size.hpp"
+#include "peg_type.hpp"
+#include "price_ladder.hpp"
 #include "price_level.hpp"
+#include "timer_wheel.hpp"
+#include "trade.hpp"
+#include "trading_phase.hpp"
+
+/**
+ * @struct AuctionResult
+ * Represents the outcome of uncrossing an auction.
+ */
+struct AuctionResult {
+    OrderPrice price = 0; ///< Equilibrium price, or 0 if the book is not crossed.
+    Quantity volume = 0; ///< Quantity executable at the equilibrium price.
+    Quantity surplus = 0; ///< Quantity left unmatched at the equilibrium price.
+    OrderSide surplus_side = OrderSide::BID; ///< Side the surplus is on.
+};
+
+/**
+ * @struct BookLevel
+ * Aggregate of the limit orders resting at one price.
+ */
+struct BookLevel {
+    OrderPrice price = 0; ///< Price of the level.
+    Quantity quantity = 0; ///< Quantity resting at the price, hidden iceberg quantity included.
+    Quantity displayed = 0; ///< Quantity shown at the price.
+};
+
+/**
+ * @struct BookCapacity
+ * Expected size of a book, used to reserve its memory up front.
+ */
+struct BookCapacity {
+    size_t orders = 0; ///< Orders resting in the book at once.
+    size_t price_levels = 0; ///< Price levels across both sides at once.
+    PageSize page_size = PageSize::STANDARD_PAGES; ///< Pages to back the book's arena with.
+};
 
 /**
  * @class OrderBook
@@ -14,11 +55,52 @@
  * 
  * The OrderBook class manages the bids and asks for a particular instrument,
  * handling order placement, cancellation, and matching.
+ * 
+ * An aggressive order walks the levels best price first and drops every level it emptied in
+ * one go once it stops, so a sweep through many levels costs about one step per fill.
+ * 
+ * Stop orders are held outside the visible book, in one trigger index per side sorted by
+ * stop price. After every order the book takes all stops crossed by the last trade price
+ * off the index in one range extraction and places them: buy stops first, lowest stop price
+ * first, then sell stops, highest stop price first, in arrival order within a stop price.
+ * Trades made by triggered stops can cross further stops, which are taken in the next round.
+ * 
+ * Pegged orders are held apart from the price levels too, grouped per side by peg type and
+ * offset into levels of their own: every order in a group sits at the same distance from the
+ * same reference, so a change of the best bid or ask moves whole groups at no cost. A group's
+ * price is only worked out when an incoming order may trade with it, from the limit orders in
+ * the book as the incoming order found them. Pegged orders only provide liquidity: they are
+ * kept a tick inside the opposite best limit price, never trade with each other, rank behind
+ * limit orders at the same price, and sit out auctions.
+ * 
+ * Self-trade prevention applies to continuous matching only; an uncross trades orders of the
+ * same owner with each other.
+ * 
+ * DAY and GOOD_TIL_DATE orders that rest get a timer in the book's timer wheel, which is taken
+ * off again when they leave the book early. The book never looks at the clock itself: whoever
+ * drives it advances time through ExpireOrders and is handed the orders that lapsed.
  */
 class OrderBook {
 public:
+    static constexpr size_t BYTES_PER_ORDER = 512; ///< Arena bytes reserved per order of capacity, covering the order and its index entries.
+    static constexpr size_t BYTES_PER_LEVEL = 512; ///< Arena bytes reserved per price level of capacity.
+
+    /**
+     * Construct an order book.
+     * 
+     * With a non-zero capacity, the book's orders, levels and index tables are allocated from
+     * an arena reserved and pre-faulted here, and the index tables are pre-sized. Past the
+     * capacity the book keeps working, with allocations falling back to the heap. Without one
+     * the arena reserves nothing and only counts what the book allocates from the heap.
+     * 
+     * @param capacity Expected size of the book, or the default to allocate from the heap.
+     * @throws std::runtime_error if the arena cannot be mapped.
+     */
+    explicit OrderBook(const BookCapacity& capacity = {});
+
     /**
      * Places a new order in the book or matches it against existing orders.
+     * Stop orders are held until triggered, which may be immediately.
      * 
      * @param order A shared pointer to the Order to be placed.
      * @return true if the order was successfully placed or fully matched, false otherwise.
@@ -48,12 +130,312 @@ public:
      * @param order A shared pointer to the Order to be filled.
      */
     void Fill(std::shared_ptr<Order> order);
+
+    /**
+     * Checks if an order is resting in the book, or waiting for its stop price.
+     * 
+     * @param order_id The ID of the order.
+     * @return true if the order is in the book, false otherwise.
+     */
+    bool HasOrder(OrderID order_id);
+
+    /**
+     * Sets the callback invoked for every trade produced by matching.
+     * 
+     * @param handler The callback, or nullptr to stop reporting trades.
+     */
+    void SetTradeHandler(TradeHandler handler);
+
+    /**
+     * Switches the book to the auction phase, in which new orders rest without matching.
+     * Only orders that rest are accepted during an auction.
+     */
+    void StartAuction();
+
+    /**
+     * Sets the end of the trading session, when DAY orders placed from then on expire.
+     * 
+     * @param session_end The end of the session, or 0 for the next midnight UTC after each order was created.
+     */
+    void SetSessionEnd(Timestamp session_end);
+
+    /**
+     * Removes every DAY and GOOD_TIL_DATE order whose time in force is over.
+     * Like CancelOrder, leaves setting the status of the orders to the caller.
+     * 
+     * @param now Current time.
+     * @param expired Receives the IDs of the removed orders.
+     */
+    void ExpireOrders(Timestamp now, std::vector<OrderID>& expired);
+
+    /**
+     * Get a time before which no order of the book expires, so ExpireOrders can be skipped until then.
+     * 
+     * @return The time, or TimerWheel::NEVER if no order can expire.
+     */
+    Timestamp GetNextExpiry();
+
+    /**
+     * Computes the price an auction would uncross at, without executing anything.
+     * 
+     * The price maximizes executable volume. Ties are broken by the smallest surplus, then by
+     * market pressure (the highest price if every tied price has buy surplus, the lowest if every
+     * one has sell surplus), then by proximity to the reference price.
+     * 
+     * @param reference_price Price to break remaining ties towards, or 0 to use the middle of the tied prices.
+     * @return The equilibrium, with zero volume if the book is not crossed.
+     */
+    AuctionResult GetEquilibrium(OrderPrice reference_price = 0);
+
+    /**
+     * Executes all crossing orders at the equilibrium price and returns the book to continuous matching.
+     * Trades are reported with the buy order as the aggressor.
+     * 
+     * @param reference_price Price to break remaining ties towards, or 0 to use the middle of the tied prices.
+     * @return The equilibrium the book was uncrossed at.
+     */
+    AuctionResult Uncross(OrderPrice reference_price = 0);
+
+    /**
+     * Gets the current matching mode of the book.
+     * 
+     * @return The trading phase.
+     */
+    TradingPhase GetPhase();
+
+    /**
+     * Gets the price a pegged order would trade at right now.
+     * 
+     * @param order_id The ID of the pegged order.
+     * @return The price, or 0 if the prices it tracks are missing from the book.
+     * @throws std::invalid_argument if no pegged order with the ID is in the book.
+     */
+    OrderPrice GetPegPrice(OrderID order_id);
+
+    /**
+     * Gets the best price levels of a side, best first. Pegged orders are left out, since their
+     * prices move with the levels.
+     * 
+     * @param side The side.
+     * @param levels Array receiving the levels.
+     * @param depth Most levels to get.
+     * @return The number of levels written.
+     */
+    size_t GetLevels(OrderSide side, BookLevel* levels, size_t depth);
+
+    /**
+     * Gets the price of the last trade. Safe to call while another thread matches.
+     * 
+     * @return The last trade price, or 0 if the book has not traded.
+     */
+    OrderPrice GetLastPrice();
+
+    /**
+     * Gets the arena the book allocates from, for allocating its orders alongside with
+     * MemoryCategory::MEMORY_ORDERS so they count towards the book's footprint.
+     * 
+     * @return The arena.
+     */
+    const std::shared_ptr<Arena>& GetArena();
+
+    /**
+     * Gets the usage of the book's arena.
+     * 
+     * @return The arena counters; the region counters are all zero if the book allocates from the heap.
+     */
+    ArenaStats GetArenaStats();
+
+    /**
+     * Gets the memory footprint of the book. Orders only count while they are alive and only if
+     * they were allocated from the book's arena, as the exchange does; the counters are read
+     * without stopping the book, so they may be a few allocations apart.
+     * 
+     * @return The live bytes of every memory category and the per order and per level averages.
+     */
+    MemoryUsage GetMemoryUsage();
 private:
-    std::unordered_map<OrderPrice, PriceLevel> asks_; ///< Map of ask price levels.
-    std::unordered_map<OrderPrice, PriceLevel> bids_; ///< Map of bid price levels.
-    std::unordered_map<OrderID, std::tuple<OrderSide, OrderPrice>> orders_; ///< Map of all orders in the book.
-    std::set<OrderPrice, std::less<OrderPrice>> best_asks_; ///< Sorted set of best ask prices.
-    std::set<OrderPrice, std::greater<OrderPrice>> best_bids_; ///< Sorted set of best bid prices.
+    using LevelMap = std::unordered_map<OrderPrice, PriceLevel, std::hash<OrderPrice>, std::equal_to<OrderPrice>,
+        ArenaAllocator<std::pair<const OrderPrice, PriceLevel>>>;
+    using OrderIndex = std::unordered_map<OrderID, std::tuple<OrderSide, OrderPrice>, std::hash<OrderID>, std::equal_to<OrderID>,
+        ArenaAllocator<std::pair<const OrderID, std::tuple<OrderSide, OrderPrice>>>>;
+
+    using PegKey = std::pair<PegType, PriceOffset>;
+    using PegMap = std::map<PegKey, PriceLevel, std::less<PegKey>, ArenaAllocator<std::pair<const PegKey, PriceLevel>>>;
+    using PegIndex = std::unordered_map<OrderID, std::tuple<OrderSide, PegKey>, std::hash<OrderID>, std::equal_to<OrderID>,
+        ArenaAllocator<std::pair<const OrderID, std::tuple<OrderSide, PegKey>>>>;
+
+    /**
+     * @struct ResolvedPeg
+     * A group of pegged orders with the price it trades at.
+     */
+    struct ResolvedPeg {
+        OrderPrice price; ///< Price the group trades at.
+        PegMap::iterator group; ///< The group.
+    };
+
+    template <typename Compare>
+    using StopIndex = std::multimap<OrderPrice, std::shared_ptr<Order>, Compare,
+        ArenaAllocator<std::pair<const OrderPrice, std::shared_ptr<Order>>>>;
+
+    /**
+     * Gets the level at a price, creating it in the book's arena if needed.
+     */
+    PriceLevel& GetLevel(LevelMap& book, OrderPrice price);
+
+    /**
+     * @struct RestPolicy
+     * Matching policy of orders that rest what they do not fill: GOOD_TIL_CANCELED, DAY and GOOD_TIL_DATE.
+     */
+    struct RestPolicy {
+        static constexpr bool ALL_OR_NONE = false; ///< Whether the order is killed unless it can fill in full.
+        static constexpr bool RESTS = true; ///< Whether what is left of the order rests in the book.
+    };
+
+    /**
+     * @struct ImmediatePolicy
+     * Matching policy of orders that cancel what they do not fill: IMMEDIATE_OR_CANCEL and MARKET.
+     */
+    struct ImmediatePolicy {
+        static constexpr bool ALL_OR_NONE = false; ///< Whether the order is killed unless it can fill in full.
+        static constexpr bool RESTS = false; ///< Whether what is left of the order rests in the book.
+    };
+
+    /**
+     * @struct AllOrNonePolicy
+     * Matching policy of FILL_OR_KILL orders.
+     */
+    struct AllOrNonePolicy {
+        static constexpr bool ALL_OR_NONE = true; ///< Whether the order is killed unless it can fill in full.
+        static constexpr bool RESTS = false; ///< Whether what is left of the order rests in the book.
+    };
+
+    using Kernel = bool (OrderBook::*)(std::shared_ptr<Order>&);
+
+    /**
+     * Matches an order and rests what is left of it, without looking at stops.
+     *
+     * Continuous matching dispatches to the Match kernel of the order's side and type.
+     * 
+     * @return true if the order was placed or fully matched, false otherwise.
+     */
+    bool Execute(std::shared_ptr<Order> order);
+
+    /**
+     * Matches an order on a side with the policy of its type and rests what is left if the policy allows.
+     * 
+     * @return true if the order was placed or matched, false if it was killed without trading.
+     */
+    template <OrderSide Side, typename Policy>
+    bool Match(std::shared_ptr<Order>& order);
+
+    /**
+     * Checks if an incoming order on a side can be fully filled.
+     */
+    template <OrderSide Side>
+    bool CanFill(Order& order);
+
+    /**
+     * Fills an incoming order on a side against the opposite side, limit and pegged orders alike.
+     */
+    template <OrderSide Side>
+    void Fill(std::shared_ptr<Order>& order);
+
+    /**
+     * Adds an order to its level on a side and starts its expiry timer.
+     */
+    template <OrderSide Side>
+    void Rest(std::shared_ptr<Order>& order);
+
+    /**
+     * Gets the price levels of a side.
+     */
+    template <OrderSide Side>
+    LevelMap& Levels();
+
+    /**
+     * Gets the best price ladder of a side.
+     */
+    template <OrderSide Side>
+    auto& Best();
+
+    /**
+     * Gets the groups of pegged orders of a side.
+     */
+    template <OrderSide Side>
+    PegMap& Pegs();
+
+    /**
+     * Copies the best levels of a side, best first, for GetLevels.
+     */
+    template <typename Ladder>
+    size_t CopyLevels(LevelMap& book, const Ladder& best, BookLevel* levels, size_t depth);
+
+    /**
+     * Starts the timer of an order that rests with a time in force.
+     */
+    void ScheduleExpiry(Order& order);
+
+    /**
+     * Drops the levels a sweep emptied: the best prices of a side up to the first one it left standing.
+     */
+    template <typename Ladder>
+    void EraseLevels(LevelMap& book, Ladder& best, typename Ladder::iterator end);
+
+    /**
+     * Places every stop crossed by the last trade price, round after round until no stop is crossed.
+     */
+    void TriggerStops();
+
+    /**
+     * Works out the price of a group of pegged orders from the best limit prices.
+     * 
+     * @return The price, or 0 if the prices the group tracks are missing from the book.
+     */
+    OrderPrice ResolvePeg(OrderSide side, const PegKey& key);
+
+    /**
+     * Prices every group of pegged orders on a side.
+     * 
+     * @return The groups with a price, best price first.
+     */
+    std::vector<ResolvedPeg> ResolvePegs(OrderSide side);
+
+    /**
+     * Fills an incoming order against a group of pegged orders at the group's price.
+     */
+    void FillPeg(PegMap& pegs, const ResolvedPeg& peg, std::shared_ptr<Order>& order);
+
+    /**
+     * Removes a pegged order from its group.
+     * 
+     * @return true if the order was a pegged order in the book.
+     */
+    bool CancelPeg(OrderID id);
+
+    /**
+     * Removes a stop from its trigger index.
+     * 
+     * @return true if the stop was waiting in the index.
+     */
+    bool CancelStop(OrderID id);
+
+    std::shared_ptr<Arena> arena_; ///< Arena backing and counting the containers below.
+    LevelMap asks_; ///< Map of ask price levels.
+    LevelMap bids_; ///< Map of bid price levels.
+    OrderIndex orders_; ///< Map of all orders in the book.
+    PriceLadder<std::less<OrderPrice>> best_asks_; ///< Ask prices, best first.
+    PriceLadder<std::greater<OrderPrice>> best_bids_; ///< Bid prices, best first.
+    StopIndex<std::less<OrderPrice>> buy_stops_; ///< Buy stops by stop price, triggered by a last price at or above it.
+    StopIndex<std::greater<OrderPrice>> sell_stops_; ///< Sell stops by stop price, triggered by a last price at or below it.
+    OrderIndex stops_; ///< Side and stop price of every waiting stop.
+    PegMap ask_pegs_; ///< Groups of pegged asks by peg type and offset.
+    PegMap bid_pegs_; ///< Groups of pegged bids by peg type and offset.
+    PegIndex pegs_; ///< Side and group of every pegged order.
+    std::atomic<OrderPrice> last_price_{0}; ///< Price of the last trade, or 0 before the first; read by the risk gate without the exchange lock.
+    TradeHandler trade_handler_; ///< Callback invoked for every trade.
+    TradingPhase phase_ = TradingPhase::CONTINUOUS; ///< Current matching mode.
+    TimerWheel timers_; ///< Expiry of every resting DAY and GOOD_TIL_DATE order.
+    Timestamp session_end_ = 0; ///< Expiry of new DAY orders, or 0 for the next midnight UTC.
 };
 
 #endif
\ No newline at end of file
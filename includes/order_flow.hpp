@@ -0,0 +1,212 @@
+#ifndef ORDER_FLOW_HPP
+#define ORDER_FLOW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "client.hpp"
+#include "latency.hpp"
+#include "order_book.hpp"
+#include "replay.hpp"
+#include "utils.hpp"
+
+/**
+ * @enum ArrivalProcess
+ * Represents how the times between events are drawn.
+ */
+enum ArrivalProcess {
+    ARRIVAL_POISSON, ///< Independent arrivals at a constant rate.
+    ARRIVAL_HAWKES ///< Self-exciting arrivals: every event raises the rate for a while, so events cluster.
+};
+
+/**
+ * @enum PriceDistribution
+ * Represents how far from the reference price zero-intelligence orders rest.
+ */
+enum PriceDistribution {
+    PRICE_UNIFORM, ///< Any distance up to the depth is equally likely.
+    PRICE_EXPONENTIAL ///< Distances fall off exponentially, a mean of a quarter of the depth from the touch.
+};
+
+/**
+ * @struct FlowParams
+ * Parameters of a synthetic order flow.
+ */
+struct FlowParams {
+    uint64_t seed = 1; ///< Seed of the flow's random numbers; equal parameters give equal flows.
+    uint32_t instruments = 1; ///< Instruments the flow trades, chosen uniformly per event.
+    ArrivalProcess arrival = ArrivalProcess::ARRIVAL_POISSON; ///< How event times are drawn.
+    double rate = 100000; ///< Events per second; the baseline rate of a Hawkes process.
+    double excitation = 0.5; ///< Hawkes branching ratio: events each event triggers on average, below 1.
+    double decay = 1000; ///< Hawkes decay rate per second of the excitation an event adds.
+    uint32_t market_makers = 4; ///< Market makers quoting every instrument.
+    double maker_share = 0.2; ///< Share of events that are a market maker requoting.
+    double cancel_ratio = 0.3; ///< Share of zero-intelligence events that cancel a resting order.
+    double market_ratio = 0.1; ///< Share of zero-intelligence orders sent through the book as immediate-or-cancel.
+    PriceDistribution price_distribution = PriceDistribution::PRICE_EXPONENTIAL; ///< Where limit orders rest.
+    OrderPrice start_price = 10000; ///< Reference price every instrument starts at.
+    OrderPrice spread = 4; ///< Ticks between the quotes of a market maker.
+    OrderPrice depth = 40; ///< Most ticks behind the touch a limit order rests.
+    OrderPrice volatility = 1; ///< Most ticks the reference price moves per event on an instrument.
+    OrderQuantity max_quantity = 100; ///< Largest quantity of an order.
+};
+
+/**
+ * @struct FlowEvent
+ * A generated command and the time it is due at.
+ */
+struct FlowEvent {
+    Timestamp time; ///< Nanoseconds since the start of the flow.
+    ReplayCommand command; ///< The command, with the generator's order ID.
+};
+
+/**
+ * @struct FlowStats
+ * Summary of driving a target with a flow.
+ */
+struct FlowStats {
+    uint64_t events = 0; ///< Commands sent.
+    uint64_t orders = 0; ///< New orders sent.
+    uint64_t cancels = 0; ///< Cancels sent.
+    uint64_t rejected = 0; ///< Commands the target refused, mostly cancels of orders that had filled already.
+    double seconds = 0; ///< Wall clock time spent driving the target.
+};
+
+/**
+ * @class OrderFlow
+ * Generates realistic synthetic order flow for load testing.
+ *
+ * Events arrive as a Poisson process or as a Hawkes process with an exponential kernel, drawn
+ * by Ogata thinning. Each event picks an instrument, moves its reference price by up to the
+ * volatility and lets an agent act on it:
+ *   - a market maker cancels its quotes on the instrument and requotes a bid and an ask around
+ *     the reference price, the spread apart, all at the event's time;
+ *   - a zero-intelligence trader cancels one of the flow's resting orders at random, sends an
+ *     immediate-or-cancel order through the book, or rests a limit order on a random side at a
+ *     distance behind the touch drawn from the price distribution.
+ *
+ * The flow never looks at the target, so one flow can be generated up front, saved as a replay
+ * file or sent live. It tracks the orders it rested to pick cancels from; those may have filled
+ * in the meantime, which targets report as rejected cancels. A driver that sees the book can
+ * re-anchor the reference price with Follow so the flow stays around the traded price.
+ *
+ * Generation needs no locks and no allocation per event beyond the resting order set, so a
+ * flow produces millions of events per second on one core, well ahead of the books it drives,
+ * and many flows run independently.
+ */
+class OrderFlow {
+public:
+    static constexpr int STREAM_SHIFT = 40; ///< Order IDs carry the stream above this bit.
+
+    /**
+     * Construct a flow.
+     *
+     * @param params Parameters of the flow.
+     * @param stream Index of the flow among flows driving the same target; keeps order IDs and
+     *               random numbers of the flows apart.
+     * @throws std::invalid_argument if the parameters describe no valid flow.
+     */
+    explicit OrderFlow(const FlowParams& params, uint32_t stream = 0);
+
+    /**
+     * Generate the next event.
+     *
+     * @return The event.
+     */
+    FlowEvent Next();
+
+    /**
+     * Move the reference price of an instrument to where the target book trades.
+     *
+     * @param instrument Index of the instrument.
+     * @param price Last traded price, ignored if 0.
+     */
+    void Follow(uint32_t instrument, OrderPrice price);
+
+    /**
+     * Generate many flows in parallel.
+     *
+     * @param params Parameters shared by the flows.
+     * @param streams Number of flows, each seeded and numbered by its index.
+     * @param events Events per flow.
+     * @param threads Number of workers, or 0 for one per hardware thread.
+     * @return The events of every flow by stream.
+     * @throws std::invalid_argument if the parameters describe no valid flow.
+     */
+    static std::vector<std::vector<FlowEvent>> Generate(const FlowParams& params, uint32_t streams, size_t events,
+        unsigned threads = 0);
+
+    /**
+     * Send a flow straight to a set of order books on the calling thread, re-anchoring the flow
+     * on the books' last prices as it goes.
+     *
+     * @param flow The flow.
+     * @param books One book per instrument of the flow.
+     * @param events Number of events to send.
+     * @return Summary of the run.
+     * @throws std::invalid_argument if there are fewer books than instruments.
+     */
+    static FlowStats RunBooks(OrderFlow& flow, std::vector<std::unique_ptr<OrderBook>>& books, size_t events);
+
+    /**
+     * Send a flow to an exchange through a connected client session.
+     *
+     * @param flow The flow.
+     * @param client A started client.
+     * @param tickers Ticker of every instrument of the flow on the exchange.
+     * @param events Number of events to send.
+     * @param paced Whether to hold every event back until it is due, rather than sending as fast as possible.
+     * @param latencies Receives the round trip of every command in nanoseconds, if not nullptr.
+     * @return Summary of the run.
+     * @throws std::invalid_argument if there are fewer tickers than instruments.
+     */
+    static FlowStats RunClient(OrderFlow& flow, Client& client, const std::vector<std::string>& tickers, size_t events,
+        bool paced = false, LatencyHistogram* latencies = nullptr);
+
+    /**
+     * Get the default ticker of an instrument, used when a flow is saved or served on its own.
+     *
+     * @param instrument Index of the instrument.
+     * @return The ticker.
+     */
+    static std::string GetTicker(uint32_t instrument);
+private:
+    /**
+     * Advance the clock to the next arrival.
+     */
+    void Arrive();
+
+    /**
+     * Draw a uniform number in [0, 1).
+     *
+     * @return The number.
+     */
+    double Uniform();
+
+    /**
+     * Queue a new order.
+     */
+    void Place(uint32_t instrument, OrderSide side, OrderType type, OrderPrice price);
+
+    /**
+     * Queue a cancel.
+     */
+    void Cancel(uint32_t instrument, OrderID id);
+
+    FlowParams params_; ///< Parameters of the flow.
+    std::mt19937_64 random_; ///< Source of every random choice.
+    double time_; ///< Seconds since the start of the flow.
+    double excitation_; ///< Hawkes intensity above the baseline at time_.
+    OrderID next_id_; ///< Next order ID, carrying the stream in its high bits.
+    OrderPrice floor_; ///< Lowest reference price, keeping every order price above 0.
+    std::vector<OrderPrice> reference_; ///< Reference price of every instrument.
+    std::vector<std::vector<OrderID>> resting_; ///< Limit orders rested by zero-intelligence traders, per instrument.
+    std::vector<OrderID> quotes_; ///< Bid and ask of every market maker per instrument, 0 if none.
+    std::vector<ReplayCommand> pending_; ///< Commands of the current event not handed out yet, in reverse.
+};
+
+#endif
@@ -8,7 +8,8 @@
 enum OrderStatus {
     OPEN,  ///< The order is active and can be filled or cancelled.
     CLOSED, ///< The order has been completely filled.
-    CANCELLED ///< The order has been cancelled and is no longer active.
+    CANCELLED, ///< The order has been cancelled and is no longer active.
+    EXPIRED ///< The order reached the end of its time in force and is no longer active.
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,132 @@
+#ifndef ORDER_TABLE_HPP
+#define ORDER_TABLE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "order.hpp"
+#include "utils.hpp"
+
+/**
+ * @typedef InstrumentID
+ * Number of an instrument on the exchange, in the order instruments were added.
+ */
+using InstrumentID = uint16_t;
+
+/**
+ * @class OrderTable
+ * The orders placed on one instrument, indexed by slot.
+ *
+ * The table hands out the IDs of its instrument's orders, and an ID says where its order is:
+ * the top 16 bits are the instrument, the next 16 a generation and the low 32 the slot. Finding
+ * an order is an index into the table and a comparison of IDs, with no hashing. A stored order
+ * gives its ID back when it closes, so the table only needs room for the orders open at once.
+ * A slot whose ID was given back goes to a later order with its generation raised, so the old ID
+ * no longer finds anything. Slots are reused oldest first, which keeps a closed order findable,
+ * for its status, for as long as the table can spare its slot. The first order of the first
+ * instrument is ID 0, and as long as no ID is given back an instrument's IDs count up from its first.
+ *
+ * Reserving and giving back IDs is thread safe. Storing and finding orders is left to the
+ * caller's locking, storing excluding every other use of the table.
+ */
+class OrderTable {
+public:
+    static constexpr unsigned SLOT_BITS = 32; ///< Bits of an ID holding the slot.
+    static constexpr unsigned GENERATION_BITS = 16; ///< Bits of an ID holding the generation of the slot.
+
+    /**
+     * Construct an empty table.
+     *
+     * @param instrument The instrument whose orders the table holds.
+     * @param capacity Orders to reserve room for up front.
+     */
+    explicit OrderTable(InstrumentID instrument, size_t capacity = 0);
+
+    /**
+     * Get the instrument an order ID handed out by a table belongs to.
+     *
+     * @param id The order ID.
+     * @return The instrument.
+     */
+    static InstrumentID GetInstrument(OrderID id) {
+        return static_cast<InstrumentID>(id >> (SLOT_BITS + GENERATION_BITS));
+    }
+
+    /**
+     * Hand out the ID of a new order.
+     *
+     * @return The ID.
+     * @throws std::runtime_error if every slot is taken.
+     */
+    OrderID Reserve();
+
+    /**
+     * Give back an ID that was reserved but never stored, or whose order has closed, so its slot
+     * can be reused. Stored orders give their IDs back themselves.
+     *
+     * @param id The ID.
+     */
+    void Release(OrderID id);
+
+    /**
+     * Store an order under the ID it was created with, to give the ID back once it closes.
+     *
+     * @param order The order, with an ID reserved from this table.
+     */
+    void Store(const std::shared_ptr<Order>& order);
+
+    /**
+     * Store an order under an ID handed out by another table of the same instrument, as a backup
+     * does with its primary's orders. Reservations carry on past its slot, which is not given back
+     * when the order closes: the primary hands out the slot's next generation itself.
+     *
+     * @param order The order.
+     * @throws std::invalid_argument if the ID belongs to another instrument.
+     */
+    void Restore(const std::shared_ptr<Order>& order);
+
+    /**
+     * Find an order by ID.
+     *
+     * @param id The order ID.
+     * @return The order, or nullptr if no order has the ID.
+     */
+    std::shared_ptr<Order> Find(OrderID id);
+
+    /**
+     * Get the bytes held by the slots and the free list, whether in use or not.
+     *
+     * @return The footprint of the table, not counting the orders themselves.
+     */
+    size_t GetFootprint();
+private:
+    /**
+     * @struct FreeSlot
+     * A slot given back, with the generation its next order gets.
+     */
+    struct FreeSlot {
+        uint32_t slot; ///< The slot.
+        uint16_t generation; ///< Generation of the slot's next ID.
+    };
+
+    /**
+     * Put an ID together from its parts.
+     */
+    OrderID MakeID(uint16_t generation, uint32_t slot);
+
+    /**
+     * Put an order in the slot of its ID.
+     */
+    void Put(const std::shared_ptr<Order>& order);
+
+    InstrumentID instrument_; ///< Instrument of the orders.
+    std::vector<std::shared_ptr<Order>> slots_; ///< Order in each slot, or nullptr.
+    std::mutex reserve_mutex_; ///< Guards the reservations below.
+    uint64_t next_slot_; ///< First slot never handed out.
+    std::deque<FreeSlot> free_; ///< Slots given back, reused first in first out.
+};
+
+#endif
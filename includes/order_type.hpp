@@ -8,7 +8,12 @@
 enum OrderType {
     GOOD_TIL_CANCELED, ///< Order remains active until explicitly canceled.
     FILL_OR_KILL, ///< Order must be filled immediately in its entirety or canceled.
-    IMMEDIATE_OR_CANCEL ///< Order must be filled immediately, partially or fully, with any unfilled portion canceled.
+    IMMEDIATE_OR_CANCEL, ///< Order must be filled immediately, partially or fully, with any unfilled portion canceled.
+    STOP, ///< Held until the last trade price reaches the stop price, then trades immediately at any price with any unfilled portion canceled.
+    STOP_LIMIT, ///< Held until the last trade price reaches the stop price, then becomes a good-til-canceled order at its limit price.
+    DAY, ///< Order remains active until canceled or the end of the trading session.
+    GOOD_TIL_DATE, ///< Order remains active until canceled or its expire time.
+    MARKET ///< Order trades immediately at any price, as deep into the book as it takes, with any unfilled portion canceled.
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef PAGE_SIZE_HPP
+#define PAGE_SIZE_HPP
+
+/**
+ * @enum PageSize
+ * Represents the size of the pages backing an arena.
+ */
+enum PageSize {
+    STANDARD_PAGES, ///< Regular pages, with transparent huge pages requested where the kernel offers them.
+    HUGE_2MB, ///< Explicit 2MB huge pages from the hugetlb pool.
+    HUGE_1GB ///< Explicit 1GB huge pages from the hugetlb pool.
+};
+
+#endif
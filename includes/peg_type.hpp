@@ -0,0 +1,15 @@
+#ifndef PEG_TYPE_HPP
+#define PEG_TYPE_HPP
+
+/**
+ * @enum PegType
+ * Represents the reference price a pegged order tracks.
+ */
+enum PegType {
+    NO_PEG, ///< Order rests at its own price.
+    PRIMARY_PEG, ///< Tracks the best price on the order's own side.
+    MARKET_PEG, ///< Tracks the best price on the opposite side.
+    MIDPOINT_PEG ///< Tracks the midpoint of the best bid and ask.
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef PRICE_LADDER_HPP
+#define PRICE_LADDER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "arena.hpp"
+#include "utils.hpp"
+
+/**
+ * @class PriceLadder
+ * Sorted set of the prices a side of the book has orders at, iterated best price first.
+ *
+ * The prices are kept in a flat array with the best price at the back, so the levels an
+ * aggressive order sweeps come off the end of the array in one truncation, without the node
+ * frees and rebalancing of a tree. Orders mostly arrive near the touch, so inserting moves the
+ * few prices better than the new one; a price far from the touch moves more of them. The
+ * ladder mirrors the part of the std::set interface the book uses.
+ *
+ * @tparam Compare Ordering of the prices, best first: std::less for asks, std::greater for bids.
+ */
+template <typename Compare>
+class PriceLadder {
+public:
+    using allocator_type = ArenaAllocator<OrderPrice>;
+    using iterator = typename std::vector<OrderPrice, allocator_type>::const_reverse_iterator;
+
+    /**
+     * Construct an empty ladder.
+     *
+     * @param allocator Allocator of the array of prices.
+     */
+    explicit PriceLadder(const allocator_type& allocator) : prices_(allocator) {}
+
+    /**
+     * Add a price, if it is not in the ladder yet.
+     *
+     * @param price The price.
+     */
+    void insert(OrderPrice price) {
+        auto it = Find(price);
+        if (it == prices_.end() || *it != price) prices_.insert(it, price);
+    }
+
+    /**
+     * Remove a price, if it is in the ladder.
+     *
+     * @param price The price.
+     */
+    void erase(OrderPrice price) {
+        auto it = Find(price);
+        if (it != prices_.end() && *it == price) prices_.erase(it);
+    }
+
+    /**
+     * Remove a run of prices.
+     *
+     * @param first The first price to remove.
+     * @param last The price after the last one to remove.
+     * @return The price that followed the run.
+     */
+    iterator erase(iterator first, iterator last) {
+        // a run starting at the best price is the tail of the array
+        return iterator(prices_.erase(last.base(), first.base()));
+    }
+
+    /**
+     * Remove a price.
+     *
+     * @param it The price to remove.
+     * @return The price that followed it.
+     */
+    iterator erase(iterator it) {
+        return erase(it, std::next(it));
+    }
+
+    /**
+     * Reserve room for a number of prices.
+     *
+     * @param count The number of prices.
+     */
+    void reserve(size_t count) {
+        prices_.reserve(count);
+    }
+
+    iterator begin() const {
+        return prices_.crbegin();
+    }
+
+    iterator end() const {
+        return prices_.crend();
+    }
+
+    bool empty() const {
+        return prices_.empty();
+    }
+
+    size_t size() const {
+        return prices_.size();
+    }
+private:
+    /**
+     * Find where a price is, or would go, in the array.
+     */
+    typename std::vector<OrderPrice, allocator_type>::iterator Find(OrderPrice price) {
+        // the array runs worst to best
+        return std::lower_bound(prices_.begin(), prices_.end(), price, [](OrderPrice a, OrderPrice b) { return Compare{}(b, a); });
+    }
+
+    std::vector<OrderPrice, allocator_type> prices_; ///< The prices, worst first.
+};
+
+#endif
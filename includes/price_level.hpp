@@ -6,22 +6,39 @@
 #include <memory>
 #include <stdexcept>
 
+#include "arena.hpp"
 #include "order.hpp"
+#include "trade.hpp"
 #include "utils.hpp"
 
+/**
+ * @typedef CancelHandler
+ * Callback invoked for every resting order cancelled by self-trade prevention.
+ */
+using CancelHandler = std::function<void(OrderID)>;
+
 /**
  * @class PriceLevel
  * Represents a single price level in an order book.
  *
  * This class manages orders at a specific price point, providing
  * methods for adding, removing, and filling orders.
+ * 
+ * Iceberg orders only trade their shown tranche. Once it is filled the next tranche is
+ * shown from the back of the queue, moved there in place without leaving the level.
+ * 
+ * Self-trade prevention is decided by the incoming order. Checking for it costs one owner
+ * comparison per resting order matched: an incoming order without prevention compares
+ * against an owner no order has.
  */
 class PriceLevel {
 public:
     /**
      * Construct a new PriceLevel object.
+     * 
+     * @param arena Arena to allocate the level's queue and index from, or nullptr to use the heap.
      */
-    PriceLevel();
+    explicit PriceLevel(std::shared_ptr<Arena> arena = nullptr);
 
     /**
      * Add an order to this price level.
@@ -58,19 +75,72 @@ public:
      * Fill an incoming order with orders from this price level.
      * 
      * @param order The incoming order to be filled.
+     * @param on_trade Optional callback invoked for every resulting trade.
+     * @param on_cancel Optional callback invoked for every resting order cancelled instead of trading with the incoming order.
+     */
+    void Fill(std::shared_ptr<Order> order, const TradeHandler& on_trade = nullptr, const CancelHandler& on_cancel = nullptr);
+
+    /**
+     * Get the order at the front of the queue.
+     * 
+     * @return The oldest order at this price level.
+     * @throw std::out_of_range if the level is empty.
      */
-    void Fill(std::shared_ptr<Order> order);
+    std::shared_ptr<Order> Front();
 
     /**
-     * Get the total quantity of all orders at this price level.
+     * Fill the order at the front of the queue, removing it once it is completely filled
+     * and re-queueing it once an iceberg tranche is used up.
+     * 
+     * @param amount The quantity to fill, at most the front order's visible quantity.
+     * @throw std::out_of_range if the level is empty.
+     */
+    void FillFront(OrderQuantity amount);
+
+    /**
+     * Get the total quantity of all orders at this price level, shown and hidden.
      * 
      * @return The total quantity.
      */
     Quantity GetTotalQuantity();
+
+    /**
+     * Get the quantity shown at this price level.
+     * 
+     * @return The displayed quantity.
+     */
+    Quantity GetDisplayedQuantity();
+
+    /**
+     * Get the iceberg reserve held back at this price level.
+     * 
+     * @return The hidden quantity.
+     */
+    Quantity GetHiddenQuantity();
 private:
-    std::list<std::shared_ptr<Order>> orders_; ///< List of orders at this price level, maintained in FIFO order.
-    std::unordered_map<OrderID, std::list<std::shared_ptr<Order>>::iterator> order_locations_; ///< Map for quick lookup of order locations in the orders list.
-    Quantity total_quantity_; ///< Running sum of the total quantity of all orders at this price level.
+    /**
+     * Drop the filled order at the front of the queue, without looking it up.
+     */
+    void PopFront();
+
+    /**
+     * Show the next tranche of the iceberg at the front and move it to the back of the queue.
+     */
+    void Requeue();
+
+    /**
+     * Apply the incoming order's self-trade prevention against the order at the front of the queue.
+     */
+    void PreventSelfTrade(std::shared_ptr<Order>& order, const CancelHandler& on_cancel);
+
+    using OrderQueue = std::list<std::shared_ptr<Order>, ArenaAllocator<std::shared_ptr<Order>>>;
+    using OrderLocations = std::unordered_map<OrderID, OrderQueue::iterator, std::hash<OrderID>, std::equal_to<OrderID>,
+        ArenaAllocator<std::pair<const OrderID, OrderQueue::iterator>>>;
+
+    OrderQueue orders_; ///< List of orders at this price level, maintained in FIFO order.
+    OrderLocations order_locations_; ///< Map for quick lookup of order locations in the orders list.
+    Quantity displayed_quantity_; ///< Running sum of the quantity shown by the orders at this price level.
+    Quantity hidden_quantity_; ///< Running sum of the iceberg reserves at this price level.
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,168 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "order_book.hpp"
+#include "utils.hpp"
+
+/**
+ * @enum ReplayAction
+ * Represents the kind of a recorded command.
+ */
+enum ReplayAction : uint8_t {
+    REPLAY_NEW = 'N', ///< Place a new order.
+    REPLAY_CANCEL = 'C' ///< Cancel a resting order.
+};
+
+/**
+ * @struct ReplayCommand
+ * A single recorded order entry command, laid out exactly as in the binary replay format.
+ */
+struct ReplayCommand {
+    uint8_t action; ///< A ReplayAction.
+    uint8_t side; ///< An OrderSide (new orders only).
+    uint8_t type; ///< An OrderType (new orders only).
+    uint8_t reserved; ///< Padding, always 0.
+    uint32_t instrument; ///< Index into the instrument table.
+    uint64_t order_id; ///< ID of the order to place or cancel.
+    uint32_t price; ///< Limit price (new orders only).
+    uint32_t quantity; ///< Quantity (new orders only).
+};
+
+static_assert(sizeof(ReplayCommand) == 24, "ReplayCommand must match the binary replay format");
+
+/**
+ * @struct ReplayStats
+ * Summary of a replay run.
+ */
+struct ReplayStats {
+    uint64_t commands = 0; ///< Number of commands processed.
+    uint64_t trades = 0; ///< Number of trades produced.
+    uint64_t traded_quantity = 0; ///< Total quantity traded.
+    uint64_t rested = 0; ///< Number of orders left resting in a book.
+    uint64_t cancelled = 0; ///< Number of orders cancelled.
+    uint64_t rejected = 0; ///< Number of commands rejected by the book.
+    double seconds = 0; ///< Wall clock time spent matching.
+};
+
+/**
+ * @class Replay
+ * Drives order books offline from a recorded command file.
+ *
+ * The input file is memory-mapped. Binary files (starting with MAGIC) are used in place;
+ * CSV files are parsed once up front. Commands then run straight through OrderBook with no
+ * networking or locking, either on one thread or with the instruments spread across threads,
+ * each of which owns its books outright.
+ *
+ * CSV input has one command per line:
+ *   N,<ticker>,<order id>,<B|S>,<GTC|FOK|IOC|MKT>,<price>,<quantity>
+ *   C,<ticker>,<order id>
+ * Blank lines and lines starting with '#' are ignored, as is the price of MKT orders.
+ *
+ * Emitted events are CSV lines:
+ *   T,<ticker>,<aggressor id>,<resting id>,<price>,<quantity>   trade
+ *   A,<ticker>,<order id>,<B|S>,<price>,<remaining>             order rested in the book
+ *   X,<ticker>,<order id>                                       order cancelled
+ *   R,<ticker>,<order id>                                       command rejected
+ */
+class Replay {
+public:
+    static constexpr char MAGIC[8] = {'S', 'X', 'R', 'E', 'P', 'L', 'A', 'Y'}; ///< First bytes of a binary replay file.
+    static constexpr size_t TICKER_SIZE = 16; ///< Bytes per ticker in the binary instrument table.
+
+    /**
+     * Map and load a recorded command file.
+     *
+     * @param path Path of a binary or CSV command file.
+     * @throws std::runtime_error if the file cannot be read.
+     * @throws std::invalid_argument if the file is malformed.
+     */
+    explicit Replay(const std::string& path);
+
+    /**
+     * Unmap the command file.
+     */
+    ~Replay();
+
+    Replay(const Replay&) = delete;
+    Replay& operator=(const Replay&) = delete;
+
+    /**
+     * Replay every command through fresh order books.
+     *
+     * @param threads Number of matching threads; instruments are assigned round-robin.
+     * @param output_path File to write events to (suffixed with the thread index when using
+     *                    several threads), or empty to only count them.
+     * @return Summary of the run.
+     * @throws std::runtime_error if an output file cannot be opened.
+     */
+    ReplayStats Run(unsigned threads = 1, const std::string& output_path = "");
+
+    /**
+     * Write the loaded commands in the binary replay format.
+     *
+     * @param path Path of the file to write.
+     * @throws std::runtime_error if the file cannot be written.
+     * @throws std::invalid_argument if a ticker is too long for the instrument table.
+     */
+    void SaveBinary(const std::string& path);
+
+    /**
+     * Write commands in the binary replay format, for commands that were not loaded from a file.
+     *
+     * @param path Path of the file to write.
+     * @param instruments Ticker of every instrument index the commands use.
+     * @param commands The commands.
+     * @param count Number of commands.
+     * @throws std::runtime_error if the file cannot be written.
+     * @throws std::invalid_argument if a ticker is too long for the instrument table.
+     */
+    static void WriteBinary(const std::string& path, const std::vector<std::string>& instruments,
+        const ReplayCommand* commands, size_t count);
+
+    // Getters
+    const std::vector<std::string>& GetInstruments();
+    size_t GetCommandCount();
+private:
+    /**
+     * Parse CSV commands into parsed_.
+     *
+     * @param begin Start of the CSV text.
+     * @param end End of the CSV text.
+     * @throws std::invalid_argument on a malformed line.
+     */
+    void ParseCsv(const char* begin, const char* end);
+
+    /**
+     * Load the instrument table of a binary file and point commands_ into the mapping.
+     *
+     * @param begin Start of the mapping.
+     * @param end End of the mapping.
+     * @throws std::invalid_argument if the file is malformed.
+     */
+    void LoadBinary(const char* begin, const char* end);
+
+    /**
+     * Run the commands of a set of instruments on the calling thread.
+     *
+     * @param instruments Instruments to replay.
+     * @param indices Command indices of every instrument, or empty to scan all commands.
+     * @param output_path File to write events to, or empty.
+     * @return Summary of the run.
+     */
+    ReplayStats RunInstruments(const std::vector<uint32_t>& instruments,
+        const std::vector<std::vector<uint32_t>>& indices, const std::string& output_path);
+
+    void* mapping_; ///< Start of the memory-mapped file.
+    size_t mapping_size_; ///< Size of the mapping.
+    const ReplayCommand* commands_; ///< Commands, either inside the mapping or in parsed_.
+    size_t command_count_; ///< Number of commands.
+    std::vector<ReplayCommand> parsed_; ///< Commands parsed from CSV input.
+    std::vector<std::string> instruments_; ///< Ticker of every instrument index.
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef REPLICATION_HPP
+#define REPLICATION_HPP
+
+#include <cstdint>
+
+/**
+ * @enum ReplicationMode
+ * Represents when the primary acknowledges a command to the client, relative to the backup.
+ */
+enum ReplicationMode {
+    REPLICATE_ASYNC, ///< Right away; the backup trails the primary by whatever is in flight.
+    REPLICATE_SYNC ///< Once the backup has applied the command, so failing over loses no acknowledged command.
+};
+
+/**
+ * @struct ReplicationStats
+ * Counters of the journal streamed from a primary to its backup.
+ */
+struct ReplicationStats {
+    uint64_t journaled = 0; ///< Commands journaled by the primary.
+    uint64_t acknowledged = 0; ///< Last command the backup acknowledged applying.
+    uint64_t applied = 0; ///< Commands applied, on a backup.
+    bool connected = false; ///< Whether the primary and backup are connected.
+};
+
+#endif
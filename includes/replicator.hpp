@@ -0,0 +1,103 @@
+#ifndef REPLICATOR_HPP
+#define REPLICATOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "journal.hpp"
+#include "replication.hpp"
+
+/**
+ * @class Replicator
+ * Streams the journal of a primary exchange to its backup over TCP.
+ *
+ * Commands are appended under the exchange mutex, so their sequence is the order they were
+ * applied to the books in. A sender thread writes whatever has accumulated since its last write
+ * in one send, so the cost of a syscall is shared by every command of a burst; the backup
+ * acknowledges the last command of every batch it applies. Should the backup go away, the primary
+ * carries on alone: commands are dropped and nothing waits on acknowledgements any more.
+ */
+class Replicator {
+public:
+    /**
+     * Connect to a backup and start streaming to it.
+     *
+     * @param host Address of the backup.
+     * @param port Replication port of the backup.
+     * @param mode When commands count as done, relative to the backup.
+     * @throws std::invalid_argument if the host is invalid.
+     * @throws std::runtime_error if the backup cannot be reached.
+     */
+    Replicator(const std::string& host, int port, ReplicationMode mode);
+
+    /**
+     * Stop streaming and disconnect from the backup.
+     */
+    ~Replicator();
+
+    Replicator(const Replicator&) = delete;
+    Replicator& operator=(const Replicator&) = delete;
+
+    /**
+     * Give a command the next sequence number and queue it for the backup.
+     *
+     * @param entry The command; its sequence is overwritten.
+     * @return The sequence number of the command.
+     */
+    uint64_t Append(JournalEntry entry);
+
+    /**
+     * Wait until the backup has applied a command, in REPLICATE_SYNC mode.
+     * Returns right away in REPLICATE_ASYNC mode, or once the backup is lost.
+     *
+     * @param sequence Sequence number of the command.
+     */
+    void WaitForAck(uint64_t sequence);
+
+    /**
+     * Get how far the backup is behind.
+     *
+     * @return The replication counters.
+     */
+    ReplicationStats GetStats();
+
+    // Getters
+    ReplicationMode GetMode();
+private:
+    /**
+     * Write appended commands to the backup until stopped or the backup is lost.
+     *
+     * @param stop Token of the sender thread.
+     */
+    void RunSender(std::stop_token stop);
+
+    /**
+     * Read acknowledgements from the backup until it disconnects.
+     */
+    void RunAcks();
+
+    /**
+     * Stop streaming and wake every waiter, once the backup is lost.
+     */
+    void Disconnect();
+
+    int sock_; ///< Socket connected to the backup.
+    ReplicationMode mode_; ///< When commands count as done.
+    std::mutex mutex_; ///< Guards the pending commands and the sequence.
+    std::condition_variable_any pending_cv_; ///< Wakes the sender when commands are appended.
+    std::condition_variable acked_cv_; ///< Wakes waiters when an acknowledgement arrives.
+    std::vector<JournalEntry> pending_; ///< Commands appended since the last send.
+    uint64_t sequence_; ///< Sequence number of the last appended command.
+    std::atomic<uint64_t> acknowledged_; ///< Last command the backup acknowledged.
+    std::atomic<bool> connected_; ///< Whether the backup is still there.
+    std::jthread sender_; ///< Writes commands to the backup.
+    std::jthread acks_; ///< Reads acknowledgements from the backup.
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef RISK_GATE_HPP
+#define RISK_GATE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "account_risk.hpp"
+#include "order.hpp"
+#include "utils.hpp"
+
+/**
+ * @struct RiskLimits
+ * Pre-trade limits applied to every order, each disabled when 0.
+ */
+struct RiskLimits {
+    OrderQuantity max_order_quantity = 0; ///< Largest quantity of a single order.
+    Price max_notional = 0; ///< Largest price times quantity of a single order.
+    uint32_t price_collar = 0; ///< Furthest a limit price may be from the last trade, in basis points of the last trade.
+    uint32_t max_open_orders = 0; ///< Most orders an account may have open at once.
+    Quantity max_position = 0; ///< Largest net position an account may reach if an order filled entirely.
+};
+
+/**
+ * @class RiskGate
+ * Pre-trade checks an order has to pass before it reaches its book.
+ *
+ * The gate holds no state of its own besides the limits: the exposure of an account lives in
+ * its AccountRisk, which the order is attached to once admitted and keeps up to date as it
+ * fills and closes. Checks therefore read a handful of atomics and take no lock.
+ */
+class RiskGate {
+public:
+    /**
+     * Construct a risk gate.
+     * 
+     * @param limits The limits to enforce; the default enforces none.
+     */
+    explicit RiskGate(const RiskLimits& limits = {});
+
+    /**
+     * Check an order against the limits and, if it passes, count it against its account.
+     * 
+     * Orders without a price of their own (stops without a limit, pegged orders) are valued at
+     * the last trade price and are not collared.
+     * 
+     * @param order The new order.
+     * @param account Exposure of the account placing the order.
+     * @param last_price Price of the last trade in the order's book, or 0 if it has not traded.
+     * @return An empty string if the order is admitted, otherwise the reason to reject it with.
+     */
+    std::string_view Admit(Order& order, const std::shared_ptr<AccountRisk>& account, OrderPrice last_price);
+
+    // Getters
+    const RiskLimits& GetLimits();
+private:
+    RiskLimits limits_; ///< The limits enforced.
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef SCENARIO_HPP
+#define SCENARIO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "utils.hpp"
+#include "work_stealing_pool.hpp"
+
+/**
+ * @struct ScenarioParams
+ * Parameters of one simulated market scenario.
+ */
+struct ScenarioParams {
+    uint64_t seed = 1; ///< Seed of the scenario's random numbers; equal parameters give equal results.
+    uint32_t instruments = 1; ///< Books the agents trade on.
+    uint32_t steps = 10000; ///< Agent actions, each by one agent on one instrument.
+    uint32_t market_makers = 4; ///< Agents quoting both sides around the reference price.
+    uint32_t takers = 4; ///< Agents sending immediate-or-cancel orders across the spread.
+    uint32_t noise_traders = 8; ///< Agents resting limit orders at random and cancelling them.
+    OrderPrice start_price = 10000; ///< Reference price every instrument starts at.
+    OrderPrice spread = 10; ///< Ticks between the quotes of a market maker.
+    OrderPrice volatility = 2; ///< Most ticks the reference price moves per step.
+    OrderQuantity max_quantity = 100; ///< Largest quantity of an order.
+    uint32_t cancel_percent = 30; ///< Chance in percent that a noise trader cancels instead of placing an order.
+};
+
+/**
+ * @struct ScenarioResult
+ * Outcome of one scenario.
+ */
+struct ScenarioResult {
+    uint64_t orders = 0; ///< Orders placed.
+    uint64_t trades = 0; ///< Trades made.
+    uint64_t traded_quantity = 0; ///< Total quantity traded.
+    uint64_t cancelled = 0; ///< Orders cancelled by their agents.
+    uint64_t rejected = 0; ///< Orders the books refused.
+    OrderPrice last_price = 0; ///< Last trade price of the first instrument, or 0 if it never traded.
+};
+
+/**
+ * @struct SweepStats
+ * Summary of a sweep over many scenarios.
+ */
+struct SweepStats {
+    uint64_t scenarios = 0; ///< Scenarios run.
+    uint64_t orders = 0; ///< Orders placed across the scenarios.
+    uint64_t trades = 0; ///< Trades made across the scenarios.
+    uint64_t traded_quantity = 0; ///< Quantity traded across the scenarios.
+    uint64_t cancelled = 0; ///< Orders cancelled across the scenarios.
+    uint64_t rejected = 0; ///< Orders refused across the scenarios.
+    uint64_t steals = 0; ///< Scenarios run by another worker than the one they were dealt to.
+    double seconds = 0; ///< Wall clock time of the sweep.
+};
+
+/**
+ * @class ScenarioSweep
+ * Runs many independent market scenarios in process, in parallel.
+ *
+ * Every scenario gets books of its own and drives them straight through OrderBook with no
+ * networking or locking, so scenarios share nothing and scale with the cores they are given.
+ * Scenarios are spread over a work-stealing pool, since their cost varies with their parameters.
+ *
+ * Each step of a scenario moves the reference price of a random instrument by up to the
+ * volatility and lets a random agent act on it:
+ *   - a market maker replaces its quotes on the instrument with a bid and an ask around the
+ *     reference price, the spread apart and pushed out by up to the volatility;
+ *   - a taker sends an immediate-or-cancel order on a random side, priced through the spread;
+ *   - a noise trader either cancels one of its resting orders or rests a limit order within a
+ *     few spreads of the reference price.
+ */
+class ScenarioSweep {
+public:
+    /**
+     * Construct a sweep.
+     *
+     * @param threads Number of workers, or 0 for one per hardware thread.
+     * @param pin Whether to pin the workers to CPUs.
+     */
+    explicit ScenarioSweep(unsigned threads = 0, bool pin = false);
+
+    /**
+     * Run every scenario.
+     *
+     * @param scenarios Parameters of the scenarios.
+     * @param results Receives the outcome of every scenario by index, if not nullptr.
+     * @return Summary of the sweep.
+     * @throws std::invalid_argument if a scenario has no instruments or no agents.
+     */
+    SweepStats Run(const std::vector<ScenarioParams>& scenarios, std::vector<ScenarioResult>* results = nullptr);
+
+    /**
+     * Run a single scenario on the calling thread.
+     *
+     * @param params Parameters of the scenario.
+     * @return Outcome of the scenario.
+     * @throws std::invalid_argument if the scenario has no instruments or no agents.
+     */
+    static ScenarioResult RunScenario(const ScenarioParams& params);
+
+    /**
+     * Get the number of workers.
+     *
+     * @return The worker count.
+     */
+    unsigned GetThreadCount();
+private:
+    WorkStealingPool pool_; ///< Workers running the scenarios.
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef SELF_TRADE_PREVENTION_HPP
+#define SELF_TRADE_PREVENTION_HPP
+
+/**
+ * @enum SelfTradePrevention
+ * Represents what happens when an incoming order would trade with a resting order of the same owner.
+ */
+enum SelfTradePrevention {
+    NO_STP, ///< The orders trade with each other.
+    CANCEL_RESTING, ///< The resting order is cancelled and the incoming order carries on matching.
+    CANCEL_AGGRESSOR, ///< The incoming order is cancelled and the resting order is left untouched.
+    CANCEL_BOTH, ///< Both orders are cancelled.
+    DECREMENT ///< Both orders are reduced by the smaller remaining quantity, cancelling whichever runs out.
+};
+
+#endif
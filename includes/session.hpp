@@ -0,0 +1,124 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <sys/types.h>
+
+#include "account_risk.hpp"
+#include "fix_encoder.hpp"
+#include "shm_channel.hpp"
+#include "throttle.hpp"
+#include "utils.hpp"
+
+class UringGateway;
+
+/**
+ * @class Session
+ * Represents a single client connection to the exchange.
+ *
+ * A session owns the socket of the connection and the encoder whose buffer
+ * every response to the client is rendered into. Co-located clients may move
+ * the session onto a shared memory channel after logon. Sessions served by the
+ * io_uring gateway hand their responses to it instead of sending them directly.
+ */
+class Session {
+public:
+    /**
+     * Construct a new Session object.
+     *
+     * @param sock The client socket descriptor.
+     */
+    explicit Session(int sock);
+
+    /**
+     * Send an encoded message to the client.
+     *
+     * @param message The message to send.
+     * @return true if the message was sent, false otherwise.
+     */
+    bool Send(std::string_view message);
+
+    /**
+     * Wait for the next message from the client. Only reading a message that has arrived is timed
+     * as the RECEIVE latency stage, not the wait for it.
+     *
+     * @param buffer Buffer to read the message into.
+     * @param size Size of the buffer.
+     * @return Length of the message, or 0 or less once the client has disconnected.
+     */
+    ssize_t Receive(char* buffer, size_t size);
+
+    /**
+     * Carry all further messages of the session over a shared memory channel.
+     *
+     * @param channel The channel opened from the client's logon.
+     */
+    void AttachChannel(std::unique_ptr<ShmChannel> channel);
+
+    /**
+     * Queue all responses of the session on an io_uring gateway.
+     *
+     * @param gateway The gateway serving the session's socket.
+     */
+    void AttachGateway(UringGateway* gateway);
+
+    /**
+     * Spin on non-blocking receives instead of sleeping in recv until data arrives.
+     *
+     * @param busy_poll Whether to busy-poll the socket.
+     */
+    void SetBusyPoll(bool busy_poll);
+
+    /**
+     * Limit the rate the client may send messages at from then on.
+     *
+     * @param limits The limits.
+     */
+    void SetThrottle(const ThrottleLimits& limits);
+
+    /**
+     * Get the number of send and receive syscalls made on the socket.
+     *
+     * @return The syscall count.
+     */
+    uint64_t GetSyscallCount();
+
+    /**
+     * Keep the owners of sessions created from then on above an owner seen elsewhere, such as
+     * on the primary a backup took over from, so their orders are never taken for that owner's.
+     *
+     * @param owner The owner.
+     */
+    static void ReserveOwners(OwnerID owner);
+
+    /**
+     * Open a listening socket on a port, for the exchange and gateways to accept sessions or peers on.
+     *
+     * @param port The port number.
+     * @param backlog Connections the kernel queues before they are accepted.
+     * @return The listening socket descriptor.
+     * @throws std::runtime_error if the socket cannot be set up.
+     */
+    static int Listen(int port, int backlog);
+
+    // Getters
+    int GetSocket();
+    OwnerID GetOwner();
+    const std::shared_ptr<AccountRisk>& GetAccount();
+    FixEncoder& GetEncoder();
+    Throttle& GetThrottle();
+private:
+    int sock_; ///< The client socket descriptor.
+    FixEncoder encoder_; ///< Encoder for responses to this client.
+    std::unique_ptr<ShmChannel> channel_; ///< Shared memory channel, or nullptr to use the socket.
+    UringGateway* gateway_; ///< Gateway queueing the responses, or nullptr to send them directly.
+    uint64_t syscalls_; ///< Send and receive syscalls made on the socket.
+    bool busy_poll_; ///< Whether Receive spins instead of blocking.
+    OwnerID owner_; ///< Owner of the orders placed through the session, unique among sessions.
+    std::shared_ptr<AccountRisk> account_; ///< Exposure of the session's orders, shared with those still in a book.
+    Throttle throttle_; ///< Rate limit on the client's messages.
+};
+
+#endif
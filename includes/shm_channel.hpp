@@ -0,0 +1,104 @@
+#ifndef SHM_CHANNEL_HPP
+#define SHM_CHANNEL_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+struct ShmRing;
+struct ShmRegion;
+
+/**
+ * @class ShmChannel
+ * A bidirectional message channel between a co-located client and the exchange.
+ *
+ * The channel lives in a POSIX shared memory region holding one single-producer,
+ * single-consumer ring per direction. Messages are copied straight into the peer's ring,
+ * so an exchange round trip costs no syscalls while both sides are busy. A receiver
+ * spins for a short while before sleeping on a futex, and a sender only makes the wake
+ * syscall when the receiver is actually asleep.
+ *
+ * The client creates the region and names it in its logon; the exchange opens it and
+ * unlinks the name. The TCP connection used for the logon is kept open to detect a peer
+ * that exits without closing the channel.
+ */
+class ShmChannel {
+public:
+    static constexpr size_t RING_SIZE = 1 << 16; ///< Bytes of message storage per direction.
+    static constexpr int LOGON_TAG = 5001; ///< User defined FIX tag naming the region in a client's logon.
+    static constexpr std::string_view NAME_PREFIX = "/sx-"; ///< Prefix of the name of every channel's region.
+
+    /**
+     * Create or open a shared memory channel.
+     *
+     * An opened region is only unlinked once its name and size show it is a channel's, so a peer
+     * cannot have the exchange open or unlink other shared memory objects.
+     *
+     * @param name Name of the shared memory object: NAME_PREFIX followed by letters, digits and dashes.
+     * @param peer_sock Socket connected to the peer, polled to detect that it went away.
+     * @param create true to create the region (client side), false to open one created by a client (exchange side).
+     * @throws std::runtime_error if the name is not a channel's, or the region cannot be created, opened or mapped
+     *         or is not the size of a channel.
+     */
+    ShmChannel(const std::string& name, int peer_sock, bool create);
+
+    /**
+     * Close the channel and unmap the region.
+     */
+    ~ShmChannel();
+
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+
+    /**
+     * Send a message to the peer, waiting for space if the ring is full.
+     *
+     * @param message The message to send.
+     * @return true if the message was sent, false if it is too large, the channel is closed or the
+     *         peer corrupted the ring, which closes the channel.
+     */
+    bool Send(std::string_view message);
+
+    /**
+     * Wait for the next message from the peer.
+     *
+     * @param buffer Buffer to copy the message into; longer messages are truncated.
+     * @param size Size of the buffer.
+     * @return Length of the message copied, or 0 once the channel is closed, the peer is gone or
+     *         the peer corrupted the ring, which closes the channel.
+     */
+    ssize_t Receive(char* buffer, size_t size);
+
+    /**
+     * Mark the channel closed and wake the peer.
+     */
+    void Close();
+
+    /**
+     * Check whether a name is one a channel's region can have.
+     *
+     * @param name The name.
+     * @return true if it is NAME_PREFIX followed by letters, digits and dashes.
+     */
+    static bool IsChannelName(const std::string& name);
+
+    // Getters
+    const std::string& GetName();
+private:
+    /**
+     * Check whether the peer's socket is still connected.
+     *
+     * @return true if the peer has not hung up.
+     */
+    bool IsPeerConnected();
+
+    std::string name_; ///< Name of the shared memory object.
+    int peer_sock_; ///< Socket connected to the peer.
+    bool owner_; ///< Whether this side created the region and unlinks its name.
+    ShmRegion* region_; ///< The mapped region.
+    ShmRing* inbound_; ///< Ring this side consumes from.
+    ShmRing* outbound_; ///< Ring this side produces into.
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef THREAD_PLACEMENT_HPP
+#define THREAD_PLACEMENT_HPP
+
+#include <vector>
+
+/**
+ * @struct ThreadPlacement
+ * Where the exchange runs its threads and how they wait for input.
+ *
+ * Orders are matched on the thread that received them, so the session cores are also the
+ * matching cores. With the io_uring backend a single thread accepts, receives and matches;
+ * it runs on the first session core, or on the acceptor core if no session cores are given.
+ */
+struct ThreadPlacement {
+    int acceptor_cpu = -1; ///< Core of the thread accepting connections, or -1 to leave it unpinned.
+    std::vector<int> session_cpus; ///< Cores handed round robin to session threads; empty leaves them unpinned.
+    bool busy_poll = false; ///< Spin on non-blocking receives instead of sleeping until data arrives.
+    bool numa_local = false; ///< Allocate books, and everything session threads allocate, on the NUMA node of the first session core.
+};
+
+/**
+ * @class CpuAffinity
+ * Thin wrappers around the scheduler and memory policy syscalls used for thread placement.
+ */
+class CpuAffinity {
+public:
+    /**
+     * Restrict the calling thread to one core.
+     *
+     * @param cpu The core.
+     * @throws std::runtime_error if the core does not exist or is not available to the process.
+     */
+    static void PinCurrentThread(int cpu);
+
+    /**
+     * Let the calling thread run on any core again, undoing a pin it inherited.
+     */
+    static void UnpinCurrentThread();
+
+    /**
+     * Check whether the process may run on a core.
+     *
+     * @param cpu The core.
+     * @return true if the core is in the affinity mask of the process.
+     */
+    static bool IsAvailable(int cpu);
+
+    /**
+     * Get the NUMA node a core belongs to.
+     *
+     * @param cpu The core.
+     * @return The node, or 0 on machines without NUMA information.
+     */
+    static int GetNode(int cpu);
+
+    /**
+     * Make the calling thread allocate new pages on a NUMA node while it has memory there.
+     *
+     * @param node The node, or -1 to go back to the default of allocating on the local node.
+     * @return true if the policy was applied (false on kernels without NUMA support).
+     */
+    static bool PreferNode(int node);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef THROTTLE_HPP
+#define THROTTLE_HPP
+
+#include <cstdint>
+
+#include "throttle_policy.hpp"
+#include "utils.hpp"
+
+/**
+ * @struct ThrottleLimits
+ * Rate a session may send messages at, and what happens to the messages beyond it.
+ */
+struct ThrottleLimits {
+    uint32_t messages_per_second = 0; ///< Sustained rate, or 0 for no limit.
+    uint32_t burst = 1; ///< Messages that may arrive back to back before the rate applies.
+    uint32_t queue_depth = 0; ///< Messages over the rate that may wait their turn under THROTTLE_QUEUE.
+    ThrottlePolicy policy = ThrottlePolicy::THROTTLE_REJECT; ///< What happens to messages over the rate.
+};
+
+/**
+ * @class Throttle
+ * Token bucket limiting the message rate of one session.
+ *
+ * The bucket is kept as a single timestamp, the time the next message would be due if the
+ * session sent at exactly its sustained rate (the generic cell rate algorithm). A message may
+ * run ahead of that schedule by the burst; queued messages run further ahead still and are
+ * held back until the burst allows them. Admitting a message is a compare and an add, with
+ * no refill timer.
+ */
+class Throttle {
+public:
+    static constexpr Timestamp REFUSED = UINT64_MAX; ///< Time returned for a message over the limit.
+
+    /**
+     * Construct a throttle.
+     *
+     * @param limits The limits; the default lets every message through.
+     * @throws std::invalid_argument if a rate is given with a burst of 0.
+     */
+    explicit Throttle(const ThrottleLimits& limits = {});
+
+    /**
+     * Take a message arriving at a time.
+     *
+     * @param now Time the message arrived.
+     * @return The time to handle the message at: now if within the limit, later if it has to
+     *         wait in the queue, or REFUSED if it exceeds the limit.
+     */
+    Timestamp Admit(Timestamp now);
+
+    /**
+     * Check if the throttle limits anything at all.
+     *
+     * @return true if a rate is set.
+     */
+    bool IsLimited();
+
+    // Getters
+    const ThrottleLimits& GetLimits();
+private:
+    ThrottleLimits limits_; ///< The limits.
+    Timestamp interval_; ///< Nanoseconds between messages at the sustained rate, or 0 for no limit.
+    Timestamp tolerance_; ///< How far ahead of the sustained rate the burst lets a session run.
+    Timestamp queue_; ///< How much further ahead than the burst queued messages may run.
+    Timestamp due_; ///< Time the next message is due at the sustained rate.
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef THROTTLE_POLICY_HPP
+#define THROTTLE_POLICY_HPP
+
+/**
+ * @enum ThrottlePolicy
+ * Represents what the exchange does with a message that exceeds its session's rate limit.
+ */
+enum ThrottlePolicy {
+    THROTTLE_REJECT, ///< Answer the message with a reject.
+    THROTTLE_QUEUE, ///< Hold the message until the rate allows it, up to the queue depth, and reject beyond it.
+    THROTTLE_DISCONNECT ///< Close the session.
+};
+
+#endif
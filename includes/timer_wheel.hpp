@@ -0,0 +1,119 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.hpp"
+#include "utils.hpp"
+
+/**
+ * @class TimerWheel
+ * Hierarchical timing wheel holding the expiry of resting orders.
+ *
+ * Time is counted in ticks. Each of the LEVELS wheels has SLOTS slots, a slot of level L
+ * spanning SLOTS^L ticks, and a timer sits in the lowest level whose span still reaches its
+ * expiry. Scheduling and cancelling a timer are O(1): timers are nodes of intrusive doubly
+ * linked lists, one list per slot, kept in a pool and found by order ID. As time advances a
+ * slot of level 0 fires in one piece, and a slot of a higher level is emptied into the levels
+ * below once the lower levels have turned round to it. Orders sharing an expiry, such as every
+ * DAY order of a book, share a slot and expire together in one pass over its list.
+ */
+class TimerWheel {
+public:
+    static constexpr unsigned SLOT_BITS = 6; ///< Log2 of the slots per level.
+    static constexpr unsigned SLOTS = 1 << SLOT_BITS; ///< Slots per level.
+    static constexpr unsigned LEVELS = 6; ///< Levels; with 1ms ticks the top level reaches past two years.
+    static constexpr Timestamp DEFAULT_TICK = 1 << 20; ///< Default tick, about a millisecond.
+    static constexpr Timestamp NEVER = UINT64_MAX; ///< Next due time of an empty wheel.
+
+    /**
+     * Construct an empty wheel.
+     * 
+     * @param now Current time, from which ticks are counted.
+     * @param tick Length of a tick in nanoseconds, the resolution of expiries.
+     * @param arena Arena to allocate the node pool and index from, counted as timers, or nullptr to use the heap.
+     * @throws std::invalid_argument if tick is 0.
+     */
+    explicit TimerWheel(Timestamp now, Timestamp tick = DEFAULT_TICK, std::shared_ptr<Arena> arena = nullptr);
+
+    /**
+     * Schedule a timer. A time already passed fires on the next advance.
+     * 
+     * @param id The order the timer belongs to.
+     * @param expiry Time the timer fires at.
+     * @throws std::invalid_argument if the order already has a timer.
+     */
+    void Schedule(OrderID id, Timestamp expiry);
+
+    /**
+     * Cancel a timer.
+     * 
+     * @param id The order the timer belongs to.
+     * @return true if the order had a timer.
+     */
+    bool Cancel(OrderID id);
+
+    /**
+     * Advance the wheel, collecting every timer that is due.
+     * 
+     * @param now Current time.
+     * @param expired Receives the orders whose timers fired, earliest expiry first across slots.
+     */
+    void Advance(Timestamp now, std::vector<OrderID>& expired);
+
+    /**
+     * Get a time before which no timer is due, so advancing the wheel can be skipped until then.
+     * It is the next expiry when that lies in the current turn of the lowest level, and otherwise
+     * the next time a higher level turns over and brings its timers closer.
+     * 
+     * @return The time, or NEVER if the wheel holds no timers.
+     */
+    Timestamp GetNextDue();
+
+    // Getters
+    size_t GetSize();
+private:
+    static constexpr uint32_t NIL = UINT32_MAX; ///< Index of no node.
+
+    /**
+     * @struct Node
+     * A timer, linked into the list of its slot.
+     */
+    struct Node {
+        OrderID id; ///< The order the timer belongs to.
+        uint64_t expiry; ///< Tick the timer fires at.
+        uint32_t prev; ///< Previous node in the slot, or NIL.
+        uint32_t next; ///< Next node in the slot, or the next free node.
+        uint32_t slot; ///< Index of the slot holding the node.
+    };
+
+    /**
+     * Link a node into the slot its expiry falls in, seen from the current tick.
+     */
+    void Insert(uint32_t index);
+
+    /**
+     * Take a node out of its slot.
+     */
+    void Unlink(uint32_t index);
+
+    /**
+     * Empty a slot of a higher level into the levels below it.
+     */
+    void Cascade(unsigned level);
+
+    Timestamp start_; ///< Time of tick 0.
+    Timestamp tick_; ///< Length of a tick in nanoseconds.
+    uint64_t current_; ///< Next tick to fire.
+    std::array<uint32_t, SLOTS * LEVELS> slots_; ///< First node of every slot, level by level, or NIL.
+    std::array<size_t, LEVELS> level_sizes_; ///< Timers held by each level.
+    std::vector<Node, ArenaAllocator<Node>> nodes_; ///< Pool of timer nodes.
+    uint32_t free_; ///< First free node of the pool, or NIL.
+    std::unordered_map<OrderID, uint32_t, std::hash<OrderID>, std::equal_to<OrderID>,
+        ArenaAllocator<std::pair<const OrderID, uint32_t>>> index_; ///< Node of every scheduled order.
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef TRADE_HPP
+#define TRADE_HPP
+
+#include <functional>
+
+#include "order_side.hpp"
+#include "utils.hpp"
+
+/**
+ * @struct Trade
+ * Represents a single execution between an incoming order and a resting order.
+ * Auction trades report the buy order as the incoming order.
+ */
+struct Trade {
+    OrderID aggressor_id; ///< ID of the incoming order.
+    OrderID resting_id; ///< ID of the order that was resting in the book.
+    OrderPrice price; ///< Execution price (the resting order's price, or the auction price).
+    OrderQuantity quantity; ///< Executed quantity.
+    OrderQuantity resting_remaining; ///< Quantity left on the resting order after the trade.
+    OrderSide aggressor_side; ///< Side of the incoming order.
+};
+
+/**
+ * @typedef TradeHandler
+ * Callback invoked for every trade produced by matching.
+ */
+using TradeHandler = std::function<void(const Trade&)>;
+
+#endif
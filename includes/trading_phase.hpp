@@ -0,0 +1,13 @@
+#ifndef TRADING_PHASE_HPP
+#define TRADING_PHASE_HPP
+
+/**
+ * @enum TradingPhase
+ * Represents the matching mode of an order book.
+ */
+enum TradingPhase {
+    CONTINUOUS, ///< Incoming orders are matched immediately against the book.
+    AUCTION ///< Orders accumulate without matching until the book is uncrossed.
+};
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef TRANSPORT_TYPE_HPP
+#define TRANSPORT_TYPE_HPP
+
+/**
+ * @enum TransportType
+ * Represents how a client exchanges order entry messages with the exchange.
+ */
+enum TransportType {
+    TCP, ///< Every message goes over the TCP connection.
+    SHARED_MEMORY ///< Messages after the logon go over a shared memory channel; the client must be on the exchange host.
+};
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef URING_GATEWAY_HPP
+#define URING_GATEWAY_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "hffix.hpp"
+#include "session.hpp"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * @class UringGateway
+ * Serves every client connection of the exchange from a single thread using io_uring.
+ *
+ * One multishot accept and one multishot recv per connection stay armed in the kernel.
+ * Received data lands in buffers provided to the kernel up front, so no buffer is tied up
+ * by an idle session; a buffer is handed back along with the next submission once its
+ * bytes are consumed. Responses produced while handling a batch of completions are appended per
+ * connection and sent with one send request each. All requests of a batch are submitted
+ * together with the wait for the next batch, in a single io_uring_enter call.
+ */
+class UringGateway {
+public:
+    static constexpr unsigned QUEUE_DEPTH = 4096; ///< Submission queue entries.
+    static constexpr unsigned RECV_BUFFER_COUNT = 1024; ///< Provided receive buffers, a power of two.
+    static constexpr unsigned RECV_BUFFER_SIZE = 4096; ///< Bytes per provided receive buffer.
+    static constexpr size_t MAX_PARTIAL_MESSAGE = 64 * 1024; ///< Largest incomplete message kept before dropping the client.
+
+    /**
+     * Handles one complete FIX message of a session.
+     *
+     * @param session The session the message arrived on; responses are sent through it.
+     * @param reader The message.
+     * @param logged_on Whether an earlier message of the session was accepted.
+     * @return true to keep the session open, false to close it.
+     */
+    using MessageHandler = std::function<bool(Session& session, hffix::message_reader& reader, bool logged_on)>;
+
+    /**
+     * Set up the ring and the provided receive buffers.
+     *
+     * @param listen_sock A listening socket to accept clients from.
+     * @throws std::runtime_error if io_uring cannot be set up.
+     */
+    explicit UringGateway(int listen_sock);
+
+    /**
+     * Close every client connection and tear down the ring.
+     */
+    ~UringGateway();
+
+    UringGateway(const UringGateway&) = delete;
+    UringGateway& operator=(const UringGateway&) = delete;
+
+    /**
+     * Check whether the kernel offers everything the gateway needs.
+     *
+     * @return true if io_uring with extended waits and completion skipping is available.
+     */
+    static bool IsSupported();
+
+    /**
+     * Spin on the completion queue instead of sleeping in io_uring_enter; the kernel is then
+     * only entered when there are requests to submit.
+     *
+     * @param busy_poll Whether to busy-poll the completion queue.
+     */
+    void SetBusyPoll(bool busy_poll);
+
+    /**
+     * Accept and serve clients until running is cleared.
+     *
+     * @param running Checked after every batch, and at least every 100ms.
+     * @param on_message Called for every complete message received.
+     * @param syscalls Incremented for every io_uring_enter call made to submit or wait.
+     */
+    void Run(const std::atomic<bool>& running, const MessageHandler& on_message, std::atomic<uint64_t>& syscalls);
+
+    /**
+     * Queue a response to a client, to be sent at the end of the current batch.
+     *
+     * @param sock The client socket.
+     * @param message The message; it is copied.
+     * @return true if the message was queued, false if the connection is closing.
+     */
+    bool QueueSend(int sock, std::string_view message);
+private:
+    /**
+     * @struct Connection
+     * State of one client connection.
+     */
+    struct Connection {
+        explicit Connection(int sock);
+
+        Session session; ///< Session the exchange handles messages with.
+        std::string input; ///< Start of a message split across receives.
+        std::string pending; ///< Responses queued during the current batch.
+        std::string in_flight; ///< Responses being sent.
+        size_t in_flight_offset = 0; ///< Bytes of in_flight already sent.
+        bool receiving = false; ///< Whether a recv request is armed.
+        bool sending = false; ///< Whether a send request is in flight.
+        bool logged_on = false; ///< Whether the logon was accepted.
+        bool closing = false; ///< Whether the connection is shutting down.
+    };
+
+    /**
+     * Get a free submission queue entry, submitting queued entries if the queue is full.
+     *
+     * @return A zeroed entry.
+     */
+    io_uring_sqe* GetSqe();
+
+    /**
+     * Submit queued entries and wait for at least one completion.
+     *
+     * @param wait Whether to wait for a completion (for up to 100ms).
+     * @return Number of entries submitted.
+     */
+    int Enter(bool wait);
+
+    /**
+     * Handle one completion.
+     *
+     * @param cqe The completion.
+     * @param on_message Handler for received messages.
+     */
+    void Complete(const io_uring_cqe& cqe, const MessageHandler& on_message);
+
+    /**
+     * Split received bytes into messages and hand them to the exchange.
+     *
+     * @param connection The connection the bytes arrived on.
+     * @param data The received bytes.
+     * @param length Number of bytes.
+     * @param on_message Handler for received messages.
+     */
+    void Deliver(Connection& connection, const char* data, size_t length, const MessageHandler& on_message);
+
+    void ArmAccept();
+    void ArmRecv(int sock);
+    void StartSend(int sock, Connection& connection);
+
+    /**
+     * Hand receive buffers to the kernel, with the next submission.
+     *
+     * @param first_id ID of the first buffer.
+     * @param count Number of consecutive buffers.
+     */
+    void ProvideBuffers(unsigned first_id, unsigned count);
+
+    /**
+     * Shut a connection down; it is released once no request refers to it.
+     */
+    void Close(int sock, Connection& connection);
+
+    /**
+     * Release a closed connection if no request refers to it any more.
+     */
+    void ReleaseIfIdle(int sock);
+
+    /**
+     * Close the ring and unmap everything mapped so far.
+     */
+    void Teardown();
+
+    int listen_sock_; ///< Socket clients are accepted from.
+    int ring_fd_; ///< The io_uring instance.
+    void* sq_mapping_; ///< Submission queue ring mapping.
+    size_t sq_mapping_size_; ///< Size of the submission queue ring mapping.
+    void* cq_mapping_; ///< Completion queue ring mapping (may alias sq_mapping_).
+    size_t cq_mapping_size_; ///< Size of the completion queue ring mapping.
+    io_uring_sqe* sqes_; ///< Submission queue entries.
+    size_t sqes_size_; ///< Size of the entries mapping.
+    unsigned* sq_head_; ///< Submission queue head, advanced by the kernel.
+    unsigned* sq_tail_; ///< Submission queue tail, advanced by us.
+    unsigned sq_mask_; ///< Submission queue index mask.
+    unsigned sq_entries_; ///< Submission queue size.
+    unsigned* cq_head_; ///< Completion queue head, advanced by us.
+    unsigned* cq_tail_; ///< Completion queue tail, advanced by the kernel.
+    unsigned cq_mask_; ///< Completion queue index mask.
+    io_uring_cqe* cqes_; ///< Completion queue entries.
+    unsigned to_submit_; ///< Entries queued since the last io_uring_enter.
+    std::unique_ptr<char[]> buffers_; ///< Storage behind the provided receive buffers.
+    bool multishot_recv_; ///< Whether the kernel supports multishot recv.
+    bool busy_poll_; ///< Whether Run spins on the completion queue.
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_; ///< Open connections by socket.
+    std::vector<int> dirty_; ///< Connections with responses queued in this batch.
+};
+
+#endif
@@ -1,7 +1,10 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
-#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "clock.hpp"
 
 /**
  * @typedef OrderID
@@ -27,6 +30,23 @@ using OrderPrice = uint32_t;
  */
 using Price = uint64_t;
 
+/**
+ * @typedef PriceOffset
+ * Signed distance between two prices.
+ */
+using PriceOffset = int32_t;
+
+/**
+ * @typedef OwnerID
+ * Compact identifier of the participant an order belongs to.
+ */
+using OwnerID = uint32_t;
+
+/**
+ * Owner of orders placed outside of any session.
+ */
+constexpr OwnerID NO_OWNER = 0;
+
 /**
  * @typedef OrderQuantity
  * Quantity of an order.
@@ -39,6 +59,10 @@ using OrderQuantity = uint32_t;
  */
 using Quantity = uint64_t;
 
+/**
+ * Constant for the maximum buffer size used in network operations.
+ */
+constexpr size_t BUFFER_SIZE = 1024;
 
 /**
  * Get the current time in nanoseconds since epoch.
@@ -46,9 +70,7 @@ using Quantity = uint64_t;
  * @return Current timestamp.
  */
 inline Timestamp CurrentTime() {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::high_resolution_clock::now().time_since_epoch()
-    ).count();
+    return Clock::Now();
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class WorkStealingPool
+ * Runs batches of independent tasks on a set of worker threads.
+ *
+ * A batch is dealt out to the workers' deques up front, each worker getting a contiguous block
+ * of tasks. A worker takes its own tasks from the back of its deque and, once it runs dry,
+ * steals from the front of the others', so workers that drew cheap tasks relieve the ones that
+ * drew expensive ones and every core stays busy until the batch is done. Deques are only
+ * contended while stealing, so each is guarded by a plain mutex.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * @typedef Task
+     * Callback running one task of a batch, given the task's index and the worker running it.
+     */
+    using Task = std::function<void(size_t task, unsigned worker)>;
+
+    /**
+     * Construct a pool.
+     *
+     * @param threads Number of workers, or 0 for one per hardware thread.
+     * @param pin Whether to pin worker N to CPU N, wrapping around the available CPUs.
+     */
+    explicit WorkStealingPool(unsigned threads = 0, bool pin = false);
+
+    /**
+     * Run a batch of tasks and wait for all of them.
+     * Every task runs exactly once, on one worker, unless a task throws.
+     *
+     * @param tasks Number of tasks, indexed from 0.
+     * @param task Callback running one task.
+     * @throws Whatever the first task to fail threw, once the workers have stopped.
+     */
+    void Run(size_t tasks, const Task& task);
+
+    /**
+     * Get the number of workers.
+     *
+     * @return The worker count.
+     */
+    unsigned GetThreadCount();
+
+    /**
+     * Get the number of tasks run by a worker other than the one they were dealt to, over every batch.
+     *
+     * @return The steal count.
+     */
+    uint64_t GetSteals();
+private:
+    /**
+     * @struct Queue
+     * Tasks dealt to one worker and not taken yet.
+     */
+    struct Queue {
+        std::mutex mutex; ///< Guards the tasks.
+        std::deque<size_t> tasks; ///< Indices of the tasks.
+    };
+
+    /**
+     * Work through a batch as one worker, until every deque is empty.
+     */
+    void Work(unsigned worker, const Task& task, std::atomic<bool>& failed);
+
+    /**
+     * Take a task from another worker's deque.
+     *
+     * @return true if a task was stolen, false if every deque is empty.
+     */
+    bool Steal(unsigned thief, size_t& task);
+
+    unsigned threads_; ///< Number of workers.
+    bool pin_; ///< Whether workers are pinned to CPUs.
+    std::vector<std::unique_ptr<Queue>> queues_; ///< Deque of every worker.
+    std::atomic<uint64_t> steals_; ///< Tasks stolen so far.
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "arena.hpp"
+
+#include <bit>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * Map a region backed by explicit huge pages, faulting it in straight away.
+ *
+ * @return The region, or nullptr if the hugetlb pool cannot supply it.
+ */
+char* MapHugePages(size_t size, int page_shift) {
+    void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE | (page_shift << MAP_HUGE_SHIFT), -1, 0);
+    return region == MAP_FAILED ? nullptr : static_cast<char*>(region);
+}
+
+size_t RoundUp(size_t size, size_t multiple) {
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+}
+
+Arena::Arena(size_t capacity, PageSize page_size)
+    : base_{nullptr}
+    , mapping_size_{0}
+    , offset_{0}
+    , free_lists_{}
+    , lock_{}
+    , category_bytes_{} {
+    if (capacity == 0) return;
+    if (page_size != PageSize::STANDARD_PAGES) {
+        int page_shift = page_size == PageSize::HUGE_1GB ? 30 : 21;
+        mapping_size_ = RoundUp(capacity, size_t{1} << page_shift);
+        base_ = MapHugePages(mapping_size_, page_shift);
+        if (base_) stats_.page_size = page_size;
+    }
+
+    if (!base_) {
+        size_t page = sysconf(_SC_PAGESIZE);
+        mapping_size_ = RoundUp(capacity, page);
+        void* region = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) throw std::runtime_error("Failed to map arena");
+        base_ = static_cast<char*>(region);
+        // ask for transparent huge pages before the first touch, then fault every page in now
+        madvise(base_, mapping_size_, MADV_HUGEPAGE);
+        for (size_t offset = 0; offset < mapping_size_; offset += page) base_[offset] = 0;
+    }
+    stats_.reserved_bytes = mapping_size_;
+}
+
+Arena::~Arena() {
+    if (base_) munmap(base_, mapping_size_);
+}
+
+void* Arena::Allocate(size_t size, size_t alignment, MemoryCategory category) {
+    if (alignment > SMALL_STEP) {
+        category_bytes_[category].fetch_add(size, std::memory_order_relaxed);
+        return ::operator new(size, std::align_val_t{alignment});
+    }
+    if (!base_ || size > mapping_size_) {
+        // an arena without a region is meant to use the heap, so that is no fallback
+        if (base_) {
+            Lock();
+            ++stats_.fallbacks;
+            Unlock();
+        }
+        category_bytes_[category].fetch_add(size, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+    size_t index = ClassIndex(size);
+    size_t block_size = ClassSize(index);
+
+    Lock();
+    void* block = free_lists_[index];
+    if (block) {
+        free_lists_[index] = *static_cast<void**>(block);
+    } else if (block_size <= mapping_size_ - offset_) {
+        block = base_ + offset_;
+        offset_ += block_size;
+        stats_.carved_bytes = offset_;
+    }
+    if (block) {
+        ++stats_.allocations;
+        stats_.live_bytes += block_size;
+    } else {
+        ++stats_.fallbacks;
+    }
+    Unlock();
+    category_bytes_[category].fetch_add(block ? block_size : size, std::memory_order_relaxed);
+    return block ? block : ::operator new(size);
+}
+
+void Arena::Deallocate(void* block, size_t size, size_t alignment, MemoryCategory category) {
+    char* address = static_cast<char*>(block);
+    if (alignment > SMALL_STEP || address < base_ || address >= base_ + mapping_size_) {
+        category_bytes_[category].fetch_sub(size, std::memory_order_relaxed);
+        if (alignment > SMALL_STEP) return ::operator delete(block, std::align_val_t{alignment});
+        return ::operator delete(block);
+    }
+    size_t index = ClassIndex(size);
+    category_bytes_[category].fetch_sub(ClassSize(index), std::memory_order_relaxed);
+
+    Lock();
+    *static_cast<void**>(block) = free_lists_[index];
+    free_lists_[index] = block;
+    stats_.live_bytes -= ClassSize(index);
+    Unlock();
+}
+
+ArenaStats Arena::GetStats() {
+    Lock();
+    ArenaStats stats = stats_;
+    Unlock();
+    for (size_t category = 0; category < NUM_MEMORY_CATEGORIES; ++category) {
+        stats.category_bytes[category] = category_bytes_[category].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+size_t Arena::ClassIndex(size_t size) {
+    if (size <= SMALL_LIMIT) return size ? (size - 1) / SMALL_STEP : 0;
+    // (256, 512] is the first power of two class
+    return SMALL_LIMIT / SMALL_STEP + std::bit_width(size - 1) - std::bit_width(SMALL_LIMIT);
+}
+
+size_t Arena::ClassSize(size_t index) {
+    if (index < SMALL_LIMIT / SMALL_STEP) return (index + 1) * SMALL_STEP;
+    return SMALL_LIMIT << (index - SMALL_LIMIT / SMALL_STEP + 1);
+}
+
+void Arena::Lock() {
+    while (lock_.test_and_set(std::memory_order_acquire)) {
+        while (lock_.test(std::memory_order_relaxed)) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+    }
+}
+
+void Arena::Unlock() {
+    lock_.clear(std::memory_order_release);
+}
@@ -0,0 +1,101 @@
+#include "book_view.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+BookViewPublisher::BookViewPublisher(size_t depth)
+    : depth_{depth}, current_{nullptr}, epoch_{1}, version_{0}, allocated_{0} {
+    if (!depth || depth > BookView::MAX_DEPTH) throw std::invalid_argument("Book view depth out of range");
+}
+
+BookViewPublisher::~BookViewPublisher() {
+    delete current_.load();
+    for (auto& [epoch, view] : retired_) delete view;
+    for (BookView* view : spares_) delete view;
+}
+
+void BookViewPublisher::Publish(OrderBook& book) {
+    BookView* view = Acquire();
+    view->version = ++version_;
+    view->published_at = CurrentTime();
+    view->last_price = book.GetLastPrice();
+    view->phase = book.GetPhase();
+    view->bid_count = book.GetLevels(OrderSide::BID, view->bids.data(), depth_);
+    view->ask_count = book.GetLevels(OrderSide::ASK, view->asks.data(), depth_);
+
+    // readers that announce an epoch after the advance are sure to find the new view
+    BookView* replaced = current_.exchange(view);
+    if (replaced) retired_.emplace_back(epoch_.fetch_add(1), replaced);
+}
+
+size_t BookViewPublisher::GetDepth() const {
+    return depth_;
+}
+
+size_t BookViewPublisher::GetAllocatedViews() const {
+    return allocated_.load(std::memory_order_relaxed);
+}
+
+BookView* BookViewPublisher::Acquire() {
+    // the readers are only scanned once enough views are waiting, so most publishes skip it
+    if (spares_.empty() && retired_.size() >= RECLAIM_BATCH) Reclaim();
+    if (spares_.empty()) {
+        allocated_.fetch_add(1, std::memory_order_relaxed);
+        return new BookView();
+    }
+    BookView* view = spares_.back();
+    spares_.pop_back();
+    return view;
+}
+
+void BookViewPublisher::Reclaim() {
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (ReaderSlot& reader : readers_) {
+        uint64_t epoch = reader.epoch.load();
+        if (epoch != IDLE) oldest = std::min(oldest, epoch);
+    }
+    // a reader in epoch e may hold the view replaced in e, but nothing replaced before it
+    auto held = std::find_if(retired_.begin(), retired_.end(),
+        [oldest](const std::pair<uint64_t, BookView*>& retired) { return retired.first >= oldest; });
+    for (auto it = retired_.begin(); it != held; ++it) spares_.push_back(it->second);
+    retired_.erase(retired_.begin(), held);
+}
+
+BookViewReader::BookViewReader(std::shared_ptr<BookViewPublisher> publisher) : publisher_{std::move(publisher)}, slot_{nullptr} {
+    for (BookViewPublisher::ReaderSlot& slot : publisher_->readers_) {
+        bool claimed = false;
+        if (slot.claimed.compare_exchange_strong(claimed, true)) {
+            slot_ = &slot;
+            return;
+        }
+    }
+    throw std::runtime_error("Book has too many view readers");
+}
+
+BookViewReader::~BookViewReader() {
+    if (slot_) slot_->claimed.store(false, std::memory_order_release);
+}
+
+BookViewReader::BookViewReader(BookViewReader&& other) noexcept
+    : publisher_{std::move(other.publisher_)}, slot_{other.slot_} {
+    other.slot_ = nullptr;
+}
+
+bool BookViewReader::Read(BookView& view) {
+    // sequentially consistent, so either the writer sees the epoch or the reader sees the newer view
+    slot_->epoch.store(publisher_->epoch_.load());
+    const BookView* current = publisher_->current_.load();
+    if (current) {
+        view.version = current->version;
+        view.published_at = current->published_at;
+        view.last_price = current->last_price;
+        view.phase = current->phase;
+        view.bid_count = current->bid_count;
+        view.ask_count = current->ask_count;
+        std::copy_n(current->bids.begin(), current->bid_count, view.bids.begin());
+        std::copy_n(current->asks.begin(), current->ask_count, view.asks.begin());
+    }
+    slot_->epoch.store(BookViewPublisher::IDLE, std::memory_order_release);
+    return current;
+}
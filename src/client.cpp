@@ -5,14 +5,15 @@
 #include <unistd.h>
 #include <stdexcept>
 #include <cstring>
+#include <atomic>
     
-Client::Client() : client_sock_{-1} {}
+Client::Client() : client_sock_{-1}, last_order_id_{0} {}
 
 Client::~Client() {
     Stop();
 }
 
-void Client::Start(std::string exchange_host, int exchange_port) {
+void Client::Start(std::string exchange_host, int exchange_port, TransportType transport) {
     // Create a socket
     client_sock_ = socket(AF_INET, SOCK_STREAM, 0);
     if (client_sock_ == -1) throw std::runtime_error("Socket creation failed");
@@ -32,11 +33,24 @@ void Client::Start(std::string exchange_host, int exchange_port) {
         throw std::runtime_error("Failed to connect to exchange");
     }
 
+    // Create the shared memory channel to name in the logon
+    if (transport == TransportType::SHARED_MEMORY) {
+        static std::atomic<int> next_channel{0};
+        std::string name = std::string(ShmChannel::NAME_PREFIX) + std::to_string(getpid()) + "-" + std::to_string(next_channel++);
+        try {
+            channel_ = std::make_unique<ShmChannel>(name, client_sock_, true);
+        } catch (const std::runtime_error&) {
+            Stop();
+            throw;
+        }
+    }
+
     // Perform logon
     Logon();
 }
 
 void Client::Stop() {
+    channel_.reset();
     if (client_sock_ != -1) {
         close(client_sock_);
         client_sock_ = -1;
@@ -53,6 +67,7 @@ void Client::Logon() {
     writer.push_back_string(hffix::tag::SenderCompID, "CLIENT");
     writer.push_back_string(hffix::tag::TargetCompID, "SERVER");
     writer.push_back_int(hffix::tag::EncryptMethod, 0);
+    if (channel_) writer.push_back_string(ShmChannel::LOGON_TAG, channel_->GetName());
     writer.push_back_trailer();
 
     // Send logon message
@@ -80,7 +95,8 @@ void Client::Logon() {
     throw std::runtime_error("Incorrect logon response received");
 }
 
-bool Client::PlaceOrder(std::string ticker, OrderSide side, OrderType type, OrderPrice price, OrderQuantity quantity) {
+bool Client::PlaceOrder(std::string ticker, OrderSide side, OrderType type, OrderPrice price, OrderQuantity quantity, OrderPrice stop_price, OrderQuantity display_quantity,
+    PegType peg_type, PriceOffset peg_offset, Timestamp expire_time) {
     char message[BUFFER_SIZE];
 
     // Construct new order message
@@ -96,19 +112,35 @@ bool Client::PlaceOrder(std::string ticker, OrderSide side, OrderType type, Orde
     if (type == OrderType::FILL_OR_KILL) order_type = '3';
     else if (type == OrderType::GOOD_TIL_CANCELED) order_type = '1';
     else if (type == OrderType::IMMEDIATE_OR_CANCEL) order_type = '4';
+    else if (type == OrderType::DAY) order_type = '0';
+    else if (type == OrderType::GOOD_TIL_DATE) order_type = '6';
+    // told apart from GTC by carrying no price
+    else if (type == OrderType::MARKET) order_type = '1';
+    // stops are sent as the order they become once triggered, plus the stop price
+    else if (type == OrderType::STOP_LIMIT) order_type = '1';
+    else if (type == OrderType::STOP) order_type = '4';
     else return false; // can never reach here
+    if ((type == OrderType::STOP || type == OrderType::STOP_LIMIT) != (stop_price != 0)) return false;
+    if ((type == OrderType::GOOD_TIL_DATE) != (expire_time != 0)) return false;
     writer.push_back_char(hffix::tag::OrdType, order_type);
 
-    writer.push_back_int(hffix::tag::Price, price);
+    if (type != OrderType::MARKET) writer.push_back_int(hffix::tag::Price, price);
     writer.push_back_int(hffix::tag::OrderQty, quantity);
+    if (stop_price) writer.push_back_int(hffix::tag::StopPx, stop_price);
+    if (display_quantity) writer.push_back_int(hffix::tag::MaxFloor, display_quantity);
+    if (peg_type != PegType::NO_PEG) {
+        writer.push_back_char(hffix::tag::ExecInst, peg_type == PegType::PRIMARY_PEG ? 'R' : peg_type == PegType::MARKET_PEG ? 'P' : 'M');
+        writer.push_back_int(hffix::tag::PegOffsetValue, peg_offset);
+    }
+    if (expire_time) writer.push_back_int(hffix::tag::ExpireTime, expire_time);
     writer.push_back_trailer();
 
     // Send new order message
-    if (send(client_sock_, message, writer.message_end() - message, 0) == -1) return false;
+    if (!SendMessage(message, writer.message_end() - message)) return false;
 
     // Receive order acknowledgment
     char response[BUFFER_SIZE] = {0};
-    ssize_t len = recv(client_sock_, response, BUFFER_SIZE, 0);
+    ssize_t len = ReceiveMessage(response, BUFFER_SIZE);
     if (len <= 0) return false;
 
     // Validate order acknowledgment
@@ -128,6 +160,7 @@ bool Client::PlaceOrder(std::string ticker, OrderSide side, OrderType type, Orde
     }
 
     orders_.insert(id);
+    last_order_id_ = id;
     return true;
 }
 
@@ -147,11 +180,11 @@ bool Client::CancelOrder(OrderID id) {
     writer.push_back_trailer();
 
     // Send cancel order message
-    if (send(client_sock_, message, writer.message_end() - message, 0) == -1) return false;
+    if (!SendMessage(message, writer.message_end() - message)) return false;
 
     // Receive cancel acknowledgment
     char response[BUFFER_SIZE] = {0};
-    ssize_t len = recv(client_sock_, response, BUFFER_SIZE, 0);
+    ssize_t len = ReceiveMessage(response, BUFFER_SIZE);
     if (len <= 0) return false;
 
     // Validate cancel acknowledgment
@@ -185,11 +218,11 @@ std::optional<Order> Client::GetOrderStatus(OrderID id) {
     writer.push_back_trailer();
 
     // Send order status request
-    if (send(client_sock_, message, writer.message_end() - message, 0) == -1) return std::nullopt;
+    if (!SendMessage(message, writer.message_end() - message)) return std::nullopt;
 
     // Receive order status
     char response[BUFFER_SIZE] = {0};
-    ssize_t len = recv(client_sock_, response, BUFFER_SIZE, 0);
+    ssize_t len = ReceiveMessage(response, BUFFER_SIZE);
     if (len <= 0) return std::nullopt;
 
     // Parse order status
@@ -197,9 +230,11 @@ std::optional<Order> Client::GetOrderStatus(OrderID id) {
     std::string ticker;
     OrderSide side;
     OrderType type;
-    OrderPrice price;
+    OrderPrice price = 0;
+    bool has_price = false;
     OrderQuantity quantity;
     OrderQuantity filled;
+    Timestamp expire_time = 0;
     OrderStatus status = OrderStatus::OPEN;
     
     for (const auto& field : reader) {
@@ -213,6 +248,7 @@ std::optional<Order> Client::GetOrderStatus(OrderID id) {
             else if (field.value().as_char() == '1') status = OrderStatus::OPEN;
             else if (field.value().as_char() == '2') status = OrderStatus::CLOSED;
             else if (field.value().as_char() == '4') status = OrderStatus::CANCELLED;
+            else if (field.value().as_char() == 'C') status = OrderStatus::EXPIRED;
             else return std::nullopt;
         }
         if (field.tag() == hffix::tag::Symbol) ticker = field.value().as_string();
@@ -221,16 +257,38 @@ std::optional<Order> Client::GetOrderStatus(OrderID id) {
             if (field.value().as_char() == '1') type = OrderType::GOOD_TIL_CANCELED;
             else if (field.value().as_char() == '3') type = OrderType::FILL_OR_KILL;
             else if (field.value().as_char() == '4') type = OrderType::IMMEDIATE_OR_CANCEL;
+            else if (field.value().as_char() == '0') type = OrderType::DAY;
+            else if (field.value().as_char() == '6') type = OrderType::GOOD_TIL_DATE;
             else return std::nullopt;
         }
         if (field.tag() == hffix::tag::OrderQty) quantity = field.value().as_int<OrderQuantity>();
         if (field.tag() == hffix::tag::CumQty) filled = field.value().as_int<OrderQuantity>();
-        if (field.tag() == hffix::tag::Price) price = field.value().as_int<OrderPrice>();
+        if (field.tag() == hffix::tag::Price) {
+            price = field.value().as_int<OrderPrice>();
+            has_price = true;
+        }
+        if (field.tag() == hffix::tag::ExpireTime) expire_time = field.value().as_int<Timestamp>();
 
     }
     
-    Order order(id, ticker, price, quantity, side, type);
+    if (type == OrderType::GOOD_TIL_CANCELED && !has_price) type = OrderType::MARKET;
+    Order order(id, ticker, price, quantity, side, type, 0, 0, PegType::NO_PEG, 0, expire_time);
     order.Fill(filled);
-    if (status != OrderStatus::OPEN) order.SetStatus(status);
+    // filling it all has already closed the order
+    if (status != OrderStatus::OPEN && order.GetStatus() == OrderStatus::OPEN) order.SetStatus(status);
     return order;
+}
+
+OrderID Client::GetLastOrderID() {
+    return last_order_id_;
+}
+
+bool Client::SendMessage(const char* message, size_t length) {
+    if (channel_) return channel_->Send(std::string_view(message, length));
+    return send(client_sock_, message, length, 0) == static_cast<ssize_t>(length);
+}
+
+ssize_t Client::ReceiveMessage(char* buffer, size_t size) {
+    if (channel_) return channel_->Receive(buffer, size);
+    return recv(client_sock_, buffer, size, 0);
 }
\ No newline at end of file
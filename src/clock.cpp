@@ -0,0 +1,147 @@
+#include "clock.hpp"
+
+#include <ctime>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+/**
+ * A tick count paired with the clock reading taken at the same moment.
+ */
+struct Anchor {
+    uint64_t ticks; ///< Tick count at the reading.
+    uint64_t nanos; ///< Clock reading in nanoseconds.
+};
+
+constexpr uint64_t INITIAL_CALIBRATION_NANOS = 5'000'000; ///< How long to measure the TSC rate for at startup.
+constexpr uint64_t RECALIBRATION_INTERVAL_NANOS = 1'000'000'000; ///< How often to re-anchor the clock.
+constexpr uint64_t MAX_BACKWARDS_CORRECTION_NANOS = 1'000'000; ///< Largest re-anchoring step absorbed instead of going back in time.
+constexpr int ANCHOR_SAMPLES = 5; ///< Readings taken per anchor, keeping the tightest.
+
+std::once_flag initialized; ///< Guards the initial calibration.
+std::atomic_flag recalibrating = ATOMIC_FLAG_INIT; ///< Held by the thread currently re-anchoring.
+Anchor steady_origin; ///< First monotonic anchor, the start of the rate measurement window.
+bool tsc_usable = false; ///< Whether the TSC is invariant and timestamps come from it.
+
+uint64_t RealtimeNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+/**
+ * Pair a clock reading with the tick count, bracketing the reading between two tick reads and
+ * keeping the narrowest bracket so that preemption does not skew the anchor.
+ */
+Anchor Sample(uint64_t (*read)()) {
+    Anchor best{0, 0};
+    uint64_t best_width = UINT64_MAX;
+    for (int i = 0; i < ANCHOR_SAMPLES; ++i) {
+        uint64_t before = Clock::ReadTicks();
+        uint64_t nanos = read();
+        uint64_t after = Clock::ReadTicks();
+        if (after - before < best_width) {
+            best_width = after - before;
+            best = {before + (after - before) / 2, nanos};
+        }
+    }
+    return best;
+}
+
+bool HasInvariantTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) return false;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return edx & (1 << 8);
+#else
+    return true;
+#endif
+}
+
+/**
+ * Compute nanoseconds per tick in 32.32 fixed point over the window since the steady origin.
+ */
+uint64_t MeasureMultiplier(const Anchor& steady) {
+    __extension__ using uint128 = unsigned __int128;
+    uint64_t ticks = steady.ticks - steady_origin.ticks;
+    if (ticks == 0) return 1ULL << 32;
+    return static_cast<uint64_t>((static_cast<uint128>(steady.nanos - steady_origin.nanos) << 32) / ticks);
+}
+
+}
+
+uint64_t Clock::TicksToNanos(uint64_t ticks) {
+    if (sequence_.load(std::memory_order_acquire) == 0) SlowNow();
+    return Scale(ticks, multiplier_.load(std::memory_order_relaxed));
+}
+
+double Clock::NanosPerTick() {
+    if (sequence_.load(std::memory_order_acquire) == 0) SlowNow();
+    return static_cast<double>(multiplier_.load(std::memory_order_relaxed)) / (1ULL << 32);
+}
+
+bool Clock::UsesTsc() {
+    if (sequence_.load(std::memory_order_acquire) == 0) SlowNow();
+    return sequence_.load(std::memory_order_acquire) != 0;
+}
+
+void Clock::Recalibrate() {
+    if (!tsc_usable || recalibrating.test_and_set(std::memory_order_acquire)) return;
+
+    Anchor steady = Sample(SteadyNanos);
+    Anchor real = Sample(RealtimeNanos);
+    uint64_t multiplier = MeasureMultiplier(steady);
+
+    // this thread is the only writer, so the current calibration can be read directly
+    uint64_t base_ticks = base_ticks_.load(std::memory_order_relaxed);
+    uint64_t extrapolated = base_nanos_.load(std::memory_order_relaxed)
+        + Scale(real.ticks - base_ticks, multiplier_.load(std::memory_order_relaxed));
+    if (real.nanos < extrapolated && extrapolated - real.nanos < MAX_BACKWARDS_CORRECTION_NANOS) {
+        real.nanos = extrapolated;
+    }
+
+    uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    base_ticks_.store(real.ticks, std::memory_order_relaxed);
+    base_nanos_.store(real.nanos, std::memory_order_relaxed);
+    multiplier_.store(multiplier, std::memory_order_relaxed);
+    recalibration_ticks_.store((RECALIBRATION_INTERVAL_NANOS << 32) / multiplier, std::memory_order_relaxed);
+    sequence_.store(sequence + 2, std::memory_order_release);
+
+    recalibrating.clear(std::memory_order_release);
+}
+
+uint64_t Clock::SlowNow() {
+    std::call_once(initialized, []() {
+        steady_origin = Sample(SteadyNanos);
+        while (SteadyNanos() - steady_origin.nanos < INITIAL_CALIBRATION_NANOS);
+        Anchor steady = Sample(SteadyNanos);
+        Anchor real = Sample(RealtimeNanos);
+        uint64_t multiplier = MeasureMultiplier(steady);
+
+        // the rate is kept even without an invariant TSC so that tick durations stay usable
+        multiplier_.store(multiplier, std::memory_order_relaxed);
+        if (!HasInvariantTsc()) return;
+
+        tsc_usable = true;
+        base_ticks_.store(real.ticks, std::memory_order_relaxed);
+        base_nanos_.store(real.nanos, std::memory_order_relaxed);
+        recalibration_ticks_.store((RECALIBRATION_INTERVAL_NANOS << 32) / multiplier, std::memory_order_relaxed);
+        sequence_.store(2, std::memory_order_release);
+    });
+
+    if (sequence_.load(std::memory_order_acquire) != 0) return Now();
+    return RealtimeNanos();
+}
+
+uint64_t Clock::SteadyNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
@@ -1,289 +1,866 @@
 #include "exchange.hpp"
+#include "uring_gateway.hpp"
 
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <climits>
+#include <limits>
 #include <iostream>
 #include <unistd.h>
 #include <thread>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/**
+ * Start a journal entry for a command on an instrument.
+ */
+JournalEntry MakeEntry(JournalAction action, const std::string& ticker, OrderID order_id = 0) {
+    JournalEntry entry{};
+    entry.action = action;
+    entry.order_id = order_id;
+    memcpy(entry.ticker, ticker.data(), std::min(ticker.size(), JournalEntry::TICKER_SIZE));
+    return entry;
+}
+
+/**
+ * Journal entry placing an order exactly as the primary received it.
+ */
+JournalEntry MakeNewOrderEntry(Order& order) {
+    JournalEntry entry = MakeEntry(JournalAction::JOURNAL_NEW, order.GetTicker(), order.GetID());
+    entry.expire_time = order.GetExpireTime();
+    entry.price = order.GetPrice();
+    entry.quantity = order.GetQuantity();
+    entry.stop_price = order.GetStopPrice();
+    entry.display_quantity = order.GetDisplayQuantity();
+    entry.peg_offset = order.GetPegOffset();
+    entry.owner = order.GetOwner();
+    entry.side = order.GetSide();
+    entry.type = order.GetType();
+    entry.peg_type = order.GetPegType();
+    entry.self_trade_prevention = order.GetSelfTradePrevention();
+    return entry;
+}
 
-Exchange::Exchange() : running_{false}, next_order_id_{0} {}
+}
+
+Exchange::Exchange() : running_{false}, server_sock_{-1}, messages_received_{0}, network_syscalls_{0}, throttled_{0}, queued_{0},
+    disconnects_{0}, shed_{0}, max_pending_orders_{0}, pending_orders_{0}, next_session_cpu_{0},
+    self_trade_prevention_{SelfTradePrevention::NO_STP}, session_end_{0}, memory_report_{nullptr},
+    memory_report_interval_{std::chrono::seconds(10)}, book_view_depth_{0}, following_{false}, replication_sock_{-1},
+    primary_sock_{-1}, applied_{0}, next_gateway_{0} {}
 
 Exchange::~Exchange() {
     Stop();
 }
 
-void Exchange::Start(int port) {
-    int server_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_sock == -1) throw std::runtime_error("Socket creation failed");
-
-    sockaddr_in server_addr;
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(port);
+void Exchange::Start(int port, GatewayBackend backend) {
+    if (following_) throw std::runtime_error("Cannot serve clients while following a primary");
+    int server_sock = Session::Listen(port, 5);
 
-    if (bind(server_sock, (struct sockaddr*) &server_addr, sizeof(server_addr))  == -1) {
-        close(server_sock);
-        throw std::runtime_error("Socket binding failed");
+    std::cout << "Exchange started on port " << port << std::endl;
+    server_sock_ = server_sock;
+    running_ = true;
+    // joined when Start returns, however it returns
+    std::jthread expiry([this](std::stop_token stop) { RunExpiry(stop); });
+
+    if (backend == GatewayBackend::IO_URING) {
+        if (UringGateway::IsSupported()) {
+            // this thread matches every order, so it takes the place of a session thread
+            if (!placement_.session_cpus.empty()) PlaceSessionThread();
+            else if (placement_.acceptor_cpu >= 0) CpuAffinity::PinCurrentThread(placement_.acceptor_cpu);
+            RunUringGateway(server_sock);
+            server_sock_ = -1;
+            close(server_sock);
+            return;
+        }
+        std::cerr << "io_uring is unavailable, falling back to sockets" << std::endl;
     }
 
-    if (listen(server_sock, 5)  == -1) {
-        close(server_sock);
-        throw std::runtime_error("Socket listening failed");
+    if (placement_.acceptor_cpu >= 0) CpuAffinity::PinCurrentThread(placement_.acceptor_cpu);
+
+    while (running_) {
+        int client_sock = accept(server_sock, (struct sockaddr*)nullptr, nullptr);
+        if (client_sock != -1) std::thread(&Exchange::HandleClient, this, client_sock).detach();
     }
 
-    std::cout << "Exchange started on port " << port << std::endl;
+    server_sock_ = -1;
+    close(server_sock);
+}
+
+void Exchange::ServeGateways(int port) {
+    if (following_) throw std::runtime_error("Cannot serve gateways while following a primary");
+    int server_sock = Session::Listen(port, 5);
+
+    std::cout << "Matching engine started on port " << port << std::endl;
+    server_sock_ = server_sock;
     running_ = true;
+    // joined when ServeGateways returns, however it returns
+    std::jthread expiry([this](std::stop_token stop) { RunExpiry(stop); });
+    if (placement_.acceptor_cpu >= 0) CpuAffinity::PinCurrentThread(placement_.acceptor_cpu);
 
     while (running_) {
-        int client_sock = accept(server_sock, (struct sockaddr*)nullptr, nullptr);
-        if (client_sock != -1) std::thread(&Exchange::HandleClient, this, client_sock).detach();
+        int gateway_sock = accept(server_sock, (struct sockaddr*)nullptr, nullptr);
+        if (gateway_sock != -1) std::thread(&Exchange::HandleGateway, this, gateway_sock).detach();
     }
 
+    server_sock_ = -1;
     close(server_sock);
 }
 
 void Exchange::Stop() {
     running_ = false;
+    // wakes the acceptor, which otherwise only sees the flag once another connection arrives
+    int sock = server_sock_;
+    if (sock != -1) shutdown(sock, SHUT_RDWR);
+    Promote();
+}
+
+void Exchange::SetThreadPlacement(const ThreadPlacement& placement) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (running_) throw std::runtime_error("Cannot place threads while the exchange is running");
+    if (placement.acceptor_cpu != -1 && !CpuAffinity::IsAvailable(placement.acceptor_cpu)) {
+        throw std::invalid_argument("Acceptor CPU is not available");
+    }
+    for (int cpu : placement.session_cpus) {
+        if (!CpuAffinity::IsAvailable(cpu)) throw std::invalid_argument("Session CPU is not available");
+    }
+    placement_ = placement;
+}
+
+void Exchange::SetSelfTradePrevention(SelfTradePrevention self_trade_prevention) {
+    self_trade_prevention_.store(self_trade_prevention, std::memory_order_relaxed);
+}
+
+void Exchange::SetRiskLimits(const RiskLimits& limits) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (running_) throw std::runtime_error("Cannot change risk limits while the exchange is running");
+    risk_gate_ = RiskGate(limits);
+}
+
+void Exchange::SetThrottleLimits(const ThrottleLimits& limits) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (running_) throw std::runtime_error("Cannot change throttle limits while the exchange is running");
+    // fails here rather than as sessions log on
+    Throttle throttle(limits);
+    throttle_limits_ = limits;
+}
+
+void Exchange::SetOverloadLimit(uint32_t max_pending_orders) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (running_) throw std::runtime_error("Cannot change the overload limit while the exchange is running");
+    max_pending_orders_ = max_pending_orders;
+}
+
+void Exchange::SetSessionEnd(Timestamp session_end) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    session_end_ = session_end;
+    for (auto& shard : shards_) {
+        if (shard) shard->book->SetSessionEnd(session_end);
+    }
+}
+
+void Exchange::SetExecutionReportHandler(ExecutionReportHandler handler) {
+    std::lock_guard<std::mutex> expiry_lock(expiry_mutex_);
+    if (running_) throw std::runtime_error("Cannot change the execution report handler while the exchange is running");
+    execution_report_handler_ = std::move(handler);
+}
+
+size_t Exchange::ExpireOrders(Timestamp now) {
+    std::lock_guard<std::mutex> expiry_lock(expiry_mutex_);
+    // this runs every millisecond, so matching is only stalled when some book has orders due
+    std::shared_lock<std::shared_mutex> read_lock(mutex_);
+    bool due = std::any_of(shards_.begin(), shards_.end(),
+        [now](const std::unique_ptr<Shard>& shard) { return shard && shard->book->GetNextExpiry() <= now; });
+    read_lock.unlock();
+    if (!due) return 0;
+
+    std::vector<std::shared_ptr<Order>> expired;
+    uint64_t sequence = 0;
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (auto& shard : shards_) {
+        if (!shard) continue;
+        expired_.clear();
+        shard->book->ExpireOrders(now, expired_);
+        if (shard->views && !expired_.empty()) shard->views->Publish(*shard->book);
+        for (OrderID id : expired_) {
+            std::shared_ptr<Order> order = shard->orders.Find(id);
+            order->SetStatus(OrderStatus::EXPIRED);
+            expired.push_back(order);
+            if (replicator_) sequence = replicator_->Append(MakeEntry(JournalAction::JOURNAL_EXPIRE, shard->ticker, id));
+        }
+    }
+    lock.unlock();
+    AwaitReplication(sequence);
+
+    if (execution_report_handler_) {
+        for (std::shared_ptr<Order>& order : expired) {
+            execution_report_handler_(order->GetOwner(), expiry_encoder_.EncodeExpiry(*order));
+        }
+    }
+    return expired.size();
+}
+
+void Exchange::ReplicateTo(const std::string& host, int port, ReplicationMode mode) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (running_) throw std::runtime_error("Cannot start replicating while the exchange is running");
+    for (auto& [ticker, instrument] : instruments_) {
+        if (ticker.size() > JournalEntry::TICKER_SIZE) throw std::invalid_argument("Ticker is too long to journal");
+    }
+    replicator_ = std::make_unique<Replicator>(host, port, mode);
+}
+
+void Exchange::ServeReplication(int port) {
+    if (running_) throw std::runtime_error("Cannot follow a primary while the exchange is running");
+    int server_sock = Session::Listen(port, 1);
+
+    following_ = true;
+    replication_sock_ = server_sock;
+    int primary_sock = -1;
+    // promoting shuts the listening socket down, which fails the accept
+    while (following_ && primary_sock == -1) primary_sock = accept(server_sock, (struct sockaddr*)nullptr, nullptr);
+    primary_sock_ = primary_sock;
+
+    // entries may arrive split across receives, so a partial one is kept for the next
+    std::vector<char> buffer(REPLICATION_BATCH * sizeof(JournalEntry));
+    size_t held = 0;
+    std::string error;
+    while (following_ && primary_sock != -1) {
+        ssize_t len = recv(primary_sock, buffer.data() + held, buffer.size() - held, 0);
+        if (len <= 0) break;
+        held += len;
+        size_t count = held / sizeof(JournalEntry);
+        if (!count) continue;
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        try {
+            for (size_t i = 0; i < count; ++i) {
+                JournalEntry entry;
+                memcpy(&entry, buffer.data() + i * sizeof(JournalEntry), sizeof(JournalEntry));
+                if (entry.sequence != applied_ + 1) throw std::runtime_error("Journal out of sequence");
+                ApplyJournalEntry(entry);
+                applied_.store(entry.sequence, std::memory_order_relaxed);
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+            break;
+        }
+        lock.unlock();
+        held -= count * sizeof(JournalEntry);
+        memmove(buffer.data(), buffer.data() + count * sizeof(JournalEntry), held);
+
+        uint64_t acknowledged = applied_.load(std::memory_order_relaxed);
+        if (send(primary_sock, &acknowledged, sizeof(acknowledged), MSG_NOSIGNAL) != sizeof(acknowledged)) break;
+    }
+
+    following_ = false;
+    primary_sock_ = -1;
+    replication_sock_ = -1;
+    if (primary_sock != -1) close(primary_sock);
+    close(server_sock);
+    if (!error.empty()) throw std::runtime_error(error);
+}
+
+void Exchange::Promote() {
+    following_ = false;
+    // wakes the follower from whichever of accept and recv it is blocked in
+    int sock = primary_sock_;
+    if (sock != -1) shutdown(sock, SHUT_RDWR);
+    sock = replication_sock_;
+    if (sock != -1) shutdown(sock, SHUT_RDWR);
 }
 
-void Exchange::AddInstrument(std::string ticker) {
+bool Exchange::IsFollowing() {
+    return following_;
+}
+
+ReplicationStats Exchange::GetReplicationStats() {
+    if (replicator_) return replicator_->GetStats();
+    return {0, 0, applied_.load(std::memory_order_relaxed), primary_sock_ != -1};
+}
+
+void Exchange::AddInstrument(std::string ticker, const BookCapacity& capacity) {
     std::unique_lock<std::shared_mutex> lock(mutex_);
     if (running_) throw std::runtime_error("Cannot add an instrument while the exchange is running");
-    if (order_books_.count(ticker)) throw std::invalid_argument("Book with ticker already exists on exchange");
-    order_books_.emplace(ticker, std::make_unique<OrderBook>());
+    if (instruments_.count(ticker)) throw std::invalid_argument("Book with ticker already exists on exchange");
+    if (replicator_ && ticker.size() > JournalEntry::TICKER_SIZE) throw std::invalid_argument("Ticker is too long to journal");
+    // removed instruments keep their numbers, so the IDs of their orders never lead to another book
+    if (shards_.size() > std::numeric_limits<InstrumentID>::max()) throw std::runtime_error("Exchange has run out of instrument numbers");
+    InstrumentID instrument = static_cast<InstrumentID>(shards_.size());
+    bool numa_local = placement_.numa_local && !placement_.session_cpus.empty();
+    if (numa_local) CpuAffinity::PreferNode(CpuAffinity::GetNode(placement_.session_cpus.front()));
+    auto book = std::make_unique<OrderBook>(capacity);
+    book->SetSessionEnd(session_end_);
+    shards_.push_back(std::unique_ptr<Shard>(new Shard{ticker, std::move(book), OrderTable(instrument, capacity.orders), nullptr}));
+    if (book_view_depth_) {
+        shards_.back()->views = std::make_shared<BookViewPublisher>(book_view_depth_);
+        shards_.back()->views->Publish(*shards_.back()->book);
+    }
+    if (numa_local) CpuAffinity::PreferNode(-1);
+    instruments_.emplace(ticker, instrument);
 }
 
 void Exchange::RemoveInstrument(std::string ticker) {
     std::unique_lock<std::shared_mutex> lock(mutex_);
     if (running_) throw std::runtime_error("Cannot remove an instrument while the exchange is running");
-    if (!order_books_.count(ticker)) throw std::invalid_argument("Book with ticker does not exist on exchange");
-    order_books_.erase(ticker);
+    auto instrument = instruments_.find(ticker);
+    if (instrument == instruments_.end()) throw std::invalid_argument("Book with ticker does not exist on exchange");
+    shards_[instrument->second].reset();
+    instruments_.erase(instrument);
+}
+
+void Exchange::StartAuction(std::string ticker) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    Shard* shard = FindShard(ticker);
+    if (!shard) throw std::invalid_argument("Book with ticker does not exist on exchange");
+    shard->book->StartAuction();
+    if (shard->views) shard->views->Publish(*shard->book);
+    uint64_t sequence = replicator_ ? replicator_->Append(MakeEntry(JournalAction::JOURNAL_AUCTION, ticker)) : 0;
+    lock.unlock();
+    AwaitReplication(sequence);
+}
+
+AuctionResult Exchange::Uncross(std::string ticker, OrderPrice reference_price) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    Shard* shard = FindShard(ticker);
+    if (!shard) throw std::invalid_argument("Book with ticker does not exist on exchange");
+    AuctionResult result = shard->book->Uncross(reference_price);
+    if (shard->views) shard->views->Publish(*shard->book);
+    uint64_t sequence = 0;
+    if (replicator_) {
+        JournalEntry entry = MakeEntry(JournalAction::JOURNAL_UNCROSS, ticker);
+        entry.price = reference_price;
+        sequence = replicator_->Append(entry);
+    }
+    lock.unlock();
+    AwaitReplication(sequence);
+    return result;
+}
+
+ArenaStats Exchange::GetArenaStats(std::string ticker) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    Shard* shard = FindShard(ticker);
+    if (!shard) throw std::invalid_argument("Book with ticker does not exist on exchange");
+    return shard->book->GetArenaStats();
+}
+
+MemoryUsage Exchange::GetMemoryUsage(std::string ticker) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    Shard* shard = FindShard(ticker);
+    if (!shard) throw std::invalid_argument("Book with ticker does not exist on exchange");
+    MemoryUsage usage = shard->book->GetMemoryUsage();
+    usage.bytes[MemoryCategory::MEMORY_ORDER_TABLE] += shard->orders.GetFootprint();
+    SummarizeMemoryUsage(usage);
+    return usage;
+}
+
+void Exchange::DumpMemoryUsage(std::ostream& out) {
+    std::vector<std::string> tickers;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        for (auto& shard : shards_) {
+            if (shard) tickers.push_back(shard->ticker);
+        }
+    }
+
+    MemoryUsage total;
+    for (const auto& ticker : tickers) {
+        MemoryUsage usage;
+        try {
+            usage = GetMemoryUsage(ticker);
+        } catch (const std::invalid_argument&) {
+            continue; // removed meanwhile
+        }
+        out << ticker << ": " << usage.total_bytes << " bytes, " << usage.resting_orders << " orders at "
+            << static_cast<uint64_t>(usage.bytes_per_order) << " bytes, " << usage.price_levels << " levels at "
+            << static_cast<uint64_t>(usage.bytes_per_level) << " bytes (";
+        for (size_t category = 0; category < NUM_MEMORY_CATEGORIES; ++category) {
+            out << (category ? " " : "") << GetMemoryCategoryName(static_cast<MemoryCategory>(category)) << "="
+                << usage.bytes[category];
+            total.bytes[category] += usage.bytes[category];
+        }
+        out << ")\n";
+        total.resting_orders += usage.resting_orders;
+        total.price_levels += usage.price_levels;
+    }
+    SummarizeMemoryUsage(total);
+    out << "Total: " << total.total_bytes << " bytes, " << total.resting_orders << " orders at "
+        << static_cast<uint64_t>(total.bytes_per_order) << " bytes, " << total.price_levels << " levels at "
+        << static_cast<uint64_t>(total.bytes_per_level) << " bytes" << std::endl;
+}
+
+void Exchange::SetMemoryReport(std::ostream* out, std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> expiry_lock(expiry_mutex_);
+    if (running_) throw std::runtime_error("Cannot change the memory report while the exchange is running");
+    memory_report_ = out;
+    memory_report_interval_ = interval;
+}
+
+void Exchange::SetBookViewDepth(size_t depth) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (running_) throw std::runtime_error("Cannot change book views while the exchange is running");
+    if (depth > BookView::MAX_DEPTH) throw std::invalid_argument("Book view depth out of range");
+    book_view_depth_ = depth;
+    for (auto& shard : shards_) {
+        if (!shard) continue;
+        // readers already open keep the publisher they were given
+        shard->views = depth ? std::make_shared<BookViewPublisher>(depth) : nullptr;
+        if (shard->views) shard->views->Publish(*shard->book);
+    }
+}
+
+BookViewReader Exchange::OpenBookView(std::string ticker) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    Shard* shard = FindShard(ticker);
+    if (!shard) throw std::invalid_argument("Book with ticker does not exist on exchange");
+    if (!shard->views) throw std::runtime_error("Book views are not published");
+    return BookViewReader(shard->views);
+}
+
+LatencyReport Exchange::GetLatencyReport() {
+    return LatencyRecorder::Snapshot();
+}
+
+GatewayStats Exchange::GetGatewayStats() {
+    return {messages_received_.load(std::memory_order_relaxed), network_syscalls_.load(std::memory_order_relaxed),
+        throttled_.load(std::memory_order_relaxed), queued_.load(std::memory_order_relaxed),
+        disconnects_.load(std::memory_order_relaxed), shed_.load(std::memory_order_relaxed)};
+}
+
+void Exchange::RunExpiry(std::stop_token stop) {
+    auto next_report = std::chrono::steady_clock::now() + memory_report_interval_;
+    while (running_ && !stop.stop_requested()) {
+        std::this_thread::sleep_for(EXPIRY_INTERVAL);
+        ExpireOrders(CurrentTime());
+        auto now = std::chrono::steady_clock::now();
+        if (memory_report_ && now >= next_report) {
+            DumpMemoryUsage(*memory_report_);
+            next_report = now + memory_report_interval_;
+        }
+    }
+}
+
+void Exchange::RunUringGateway(int server_sock) {
+    UringGateway gateway(server_sock);
+    gateway.SetBusyPoll(placement_.busy_poll);
+    gateway.Run(running_, [this](Session& session, hffix::message_reader& reader, bool logged_on) {
+        messages_received_.fetch_add(1, std::memory_order_relaxed);
+        if (logged_on) return ProcessMessage(reader, session);
+        // shared memory sessions need a thread of their own, so they are only offered on the socket backend
+        std::string channel_name;
+        if (!FixDecoder::DecodeLogon(reader, channel_name) || !channel_name.empty()) return false;
+        SendLogonResponse(session);
+        // a session waiting its turn would hold up every session on this thread
+        ThrottleLimits limits = throttle_limits_;
+        limits.queue_depth = 0;
+        session.SetThrottle(limits);
+        return true;
+    }, network_syscalls_);
+}
+
+void Exchange::PlaceSessionThread() {
+    if (placement_.session_cpus.empty()) {
+        // threads inherit the affinity of the acceptor that spawned them
+        if (placement_.acceptor_cpu >= 0) CpuAffinity::UnpinCurrentThread();
+        return;
+    }
+    size_t index = next_session_cpu_.fetch_add(1, std::memory_order_relaxed) % placement_.session_cpus.size();
+    CpuAffinity::PinCurrentThread(placement_.session_cpus[index]);
+    // orders and price levels are allocated by the matching thread, so its policy decides where the books grow
+    if (placement_.numa_local) CpuAffinity::PreferNode(CpuAffinity::GetNode(placement_.session_cpus.front()));
 }
 
 int Exchange::HandleClient(int client_sock) {
+    PlaceSessionThread();
+    Session session(client_sock);
+    session.SetBusyPoll(placement_.busy_poll);
     char buffer[BUFFER_SIZE] = {0};
 
-    ssize_t len = recv(client_sock, buffer, BUFFER_SIZE, 0);
+    ssize_t len = session.Receive(buffer, BUFFER_SIZE);
     if (len <= 0) return close(client_sock);
+    messages_received_.fetch_add(1, std::memory_order_relaxed);
 
     hffix::message_reader reader(buffer, buffer + len);
+    std::string channel_name;
     // respond with error before closing?
-    if (!ProcessLogon(reader)) return close(client_sock);
-    SendLogonResponse(client_sock);
+    if (!FixDecoder::DecodeLogon(reader, channel_name)) return close(client_sock);
+    std::unique_ptr<ShmChannel> channel;
+    if (!channel_name.empty()) {
+        try {
+            channel = std::make_unique<ShmChannel>(channel_name, client_sock, false);
+        } catch (const std::runtime_error&) {
+            return close(client_sock);
+        }
+    }
+    SendLogonResponse(session);
+    // the logon response still goes over the socket, which the client waits on
+    if (channel) session.AttachChannel(std::move(channel));
+    session.SetThrottle(throttle_limits_);
 
     while (running_) {
         memset(buffer, 0, BUFFER_SIZE);
-        len = recv(client_sock, buffer, BUFFER_SIZE, 0);
+        len = session.Receive(buffer, BUFFER_SIZE);
         if (len <= 0) break;
+        messages_received_.fetch_add(1, std::memory_order_relaxed);
 
         reader = hffix::message_reader(buffer, buffer + len);
-        ProcessMessage(reader, client_sock);
+        if (!ProcessMessage(reader, session)) break;
     }
 
+    network_syscalls_.fetch_add(session.GetSyscallCount(), std::memory_order_relaxed);
     return close(client_sock);
 }
 
-bool Exchange::ProcessLogon(hffix::message_reader& reader) {
-    for (const auto& field : reader) {
-        if (field.tag() == hffix::tag::MsgType && field.value() != "A") return false;
-        if (field.tag() == hffix::tag::SenderCompID && field.value() != "CLIENT") return false;
-        if (field.tag() == hffix::tag::TargetCompID && field.value() != "SERVER") return false;
-        if (field.tag() == hffix::tag::EncryptMethod && field.value().as_int<int>() != 0) return false;
+int Exchange::HandleGateway(int gateway_sock) {
+    PlaceSessionThread();
+    // the gateway names the shared memory region it created, NUL terminated
+    char name[NAME_MAX + 1];
+    size_t length = 0;
+    while (length == 0 || name[length - 1] != '\0') {
+        if (length == sizeof(name)) return close(gateway_sock);
+        ssize_t len = recv(gateway_sock, name + length, sizeof(name) - length, 0);
+        if (len <= 0) return close(gateway_sock);
+        length += len;
+    }
+    // the name comes from the gateway, so only a channel's region is ever opened and unlinked
+    if (!ShmChannel::IsChannelName(name)) return close(gateway_sock);
+    std::unique_ptr<ShmChannel> channel;
+    try {
+        channel = std::make_unique<ShmChannel>(name, gateway_sock, false);
+    } catch (const std::runtime_error&) {
+        return close(gateway_sock);
     }
-    return true;
-}
 
-void Exchange::SendLogonResponse(int client_sock) {
-    char response[BUFFER_SIZE];
-    hffix::message_writer writer(response, response + BUFFER_SIZE);
-    writer.push_back_header("FIX.4.2");
-    writer.push_back_string(hffix::tag::MsgType, "A");
-    writer.push_back_string(hffix::tag::SenderCompID, "SERVER");
-    writer.push_back_string(hffix::tag::TargetCompID, "CLIENT");
-    writer.push_back_int(hffix::tag::EncryptMethod, 0);
-    writer.push_back_trailer();
+    // owners are only unique within their gateway, so every gateway gets a range of its own
+    OwnerID owner_base = (next_gateway_.fetch_add(1, std::memory_order_relaxed) + 1) << GATEWAY_OWNER_SHIFT;
+    std::unordered_map<OwnerID, std::shared_ptr<AccountRisk>> accounts;
+    EngineMessage message;
+    while (running_) {
+        ssize_t len = channel->Receive(reinterpret_cast<char*>(&message), sizeof(message));
+        if (len != sizeof(message)) break;
+        messages_received_.fetch_add(1, std::memory_order_relaxed);
+
+        ProcessEngineRequest(message, owner_base, accounts);
+        LATENCY_PROBE(send_start);
+        if (!channel->Send(std::string_view(reinterpret_cast<char*>(&message), sizeof(message)))) break;
+        LATENCY_RECORD(LatencyStage::SEND, send_start);
+    }
 
-    send(client_sock, response, writer.message_end() - response, 0);
+    channel.reset();
+    return close(gateway_sock);
 }
 
-void Exchange::ProcessMessage(hffix::message_reader& reader, int client_sock) {
-    for (const auto& field : reader) {
-        if (field.tag() == hffix::tag::MsgType) {
-            if (field.value() == "D") ProcessNewOrder(reader, client_sock);
-            else if (field.value() == "F") ProcessCancelOrder(reader, client_sock);
-            else if (field.value() == "H") ProcessGetOrderStatus(reader, client_sock);
-            return;
+void Exchange::ProcessEngineRequest(EngineMessage& message, OwnerID owner_base,
+    std::unordered_map<OwnerID, std::shared_ptr<AccountRisk>>& accounts) {
+    std::string_view rejection;
+    std::shared_ptr<Order> order;
+    if (message.type == EngineMessageType::ENGINE_NEW_ORDER) {
+        // the gateway is another process, so its requests are checked as a client's would be
+        if (message.side > OrderSide::ASK || message.order_type > OrderType::MARKET || message.peg_type > PegType::MIDPOINT_PEG) {
+            rejection = "Invalid order type";
+        } else {
+            OrderRequest request;
+            request.ticker.assign(message.ticker, strnlen(message.ticker, EngineMessage::TICKER_SIZE));
+            request.side = static_cast<OrderSide>(message.side);
+            request.type = static_cast<OrderType>(message.order_type);
+            request.price = message.price;
+            request.quantity = message.quantity;
+            request.stop_price = message.stop_price;
+            request.display_quantity = message.display_quantity;
+            request.peg_type = static_cast<PegType>(message.peg_type);
+            request.peg_offset = message.peg_offset;
+            request.expire_time = message.expire_time;
+            rejection = FixDecoder::ValidateNewOrder(request);
+            if (rejection.empty()) {
+                OwnerID owner = owner_base | (message.owner & ((OwnerID{1} << GATEWAY_OWNER_SHIFT) - 1));
+                std::shared_ptr<AccountRisk>& account = accounts[owner];
+                if (!account) account = std::make_shared<AccountRisk>();
+                // an exception escaping the session thread would take the whole engine down
+                try {
+                    rejection = PlaceOrder(request, owner, account, order);
+                } catch (const std::invalid_argument&) {
+                    rejection = "Invalid order";
+                }
+            }
         }
+        message.type = EngineMessageType::ENGINE_ACCEPTED;
+    } else if (message.type == EngineMessageType::ENGINE_CANCEL_ORDER) {
+        rejection = CancelOrder(message.order_id);
+        message.type = EngineMessageType::ENGINE_CANCELLED;
+    } else if (message.type == EngineMessageType::ENGINE_ORDER_STATUS) {
+        order = FindOrder(message.order_id);
+        if (!order) rejection = "Invalid order ID";
+        message.type = EngineMessageType::ENGINE_STATUS;
+    } else {
+        rejection = "Invalid request";
     }
+
+    if (!rejection.empty()) {
+        message.type = EngineMessageType::ENGINE_REJECTED;
+        memset(message.reason, 0, EngineMessage::REASON_SIZE);
+        memcpy(message.reason, rejection.data(), std::min(rejection.size(), EngineMessage::REASON_SIZE));
+        return;
+    }
+    if (!order) return;
+
+    // the order as it stands now, read under the lock as when encoding a status
+    std::shared_lock<std::shared_mutex> read_lock(mutex_);
+    message.order_id = order->GetID();
+    message.expire_time = order->GetExpireTime();
+    message.price = order->GetPrice();
+    message.quantity = order->GetQuantity();
+    message.filled = order->GetFilled();
+    message.stop_price = order->GetStopPrice();
+    message.side = order->GetSide();
+    message.order_type = order->GetType();
+    message.status = order->GetStatus();
+    memset(message.ticker, 0, EngineMessage::TICKER_SIZE);
+    memcpy(message.ticker, order->GetTicker().data(), std::min(order->GetTicker().size(), EngineMessage::TICKER_SIZE));
 }
 
-void Exchange::ProcessNewOrder(hffix::message_reader& reader, int client_sock) {
-    std::string ticker;
-    OrderSide side;
-    OrderType type;
-    OrderPrice price;
-    OrderQuantity quantity;
+void Exchange::SendLogonResponse(Session& session) {
+    session.Send(session.GetEncoder().EncodeLogonResponse());
+}
 
-    for (const auto& field : reader) {
-        if (field.tag() == hffix::tag::Symbol) ticker = field.value().as_string();
-        if (field.tag() == hffix::tag::Side) {
-            if (field.value().as_char() == '1') side = OrderSide::BID;
-            else if (field.value().as_char() == '2') side = OrderSide::ASK;
-            else return SendRejection(client_sock, "Invalid order type");
+bool Exchange::ProcessMessage(hffix::message_reader& reader, Session& session) {
+    Throttle& throttle = session.GetThrottle();
+    if (throttle.IsLimited()) {
+        Timestamp now = CurrentTime();
+        Timestamp due = throttle.Admit(now);
+        if (due == Throttle::REFUSED) {
+            throttled_.fetch_add(1, std::memory_order_relaxed);
+            if (throttle.GetLimits().policy == ThrottlePolicy::THROTTLE_DISCONNECT) {
+                disconnects_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            SendRejection(session, "Throttled");
+            return true;
         }
-         if (field.tag() == hffix::tag::OrdType) {
-            if (field.value().as_char() == '1') type = OrderType::GOOD_TIL_CANCELED;
-            else if (field.value().as_char() == '3') type = OrderType::FILL_OR_KILL;
-            else if (field.value().as_char() == '4') type = OrderType::IMMEDIATE_OR_CANCEL;
-            else return SendRejection(client_sock, "Invalid order type");
+        if (due > now) {
+            // not reading from the client meanwhile pushes back on it through the socket buffers
+            queued_.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
         }
-        if (field.tag() == hffix::tag::Price) price = field.value().as_int<OrderPrice>();
-        if (field.tag() == hffix::tag::OrderQty) quantity = field.value().as_int<OrderQuantity>();
     }
 
-    std::shared_lock<std::shared_mutex> read_lock(mutex_);
-    bool exists = order_books_.count(ticker);
-    read_lock.unlock();
-    if (!exists) return SendRejection(client_sock, "Invalid symbol");
+    for (const auto& field : reader) {
+        if (field.tag() == hffix::tag::MsgType) {
+            if (field.value() == "D") ProcessNewOrder(reader, session);
+            else if (field.value() == "F") ProcessCancelOrder(reader, session);
+            else if (field.value() == "H") ProcessGetOrderStatus(reader, session);
+            return true;
+        }
+    }
+    return true;
+}
 
-    std::shared_ptr<Order> order = std::make_shared<Order>(next_order_id_++, ticker, price, quantity, side, type);
-    std::unique_lock<std::shared_mutex> lock(mutex_);
-    orders_[order->GetID()] = order;
-    bool success = order_books_[ticker]->PlaceOrder(order);
-    lock.unlock();
-    if (success) SendNewOrderAck(client_sock, order);
-    else SendRejection(client_sock, "Order placement failed");
+void Exchange::ProcessNewOrder(hffix::message_reader& reader, Session& session) {
+    OrderRequest request;
+    LATENCY_PROBE(decode_start);
+    std::string_view rejection = FixDecoder::DecodeNewOrder(reader, request);
+    LATENCY_RECORD(LatencyStage::DECODE, decode_start);
+    if (!rejection.empty()) return SendRejection(session, rejection);
+
+    std::shared_ptr<Order> order;
+    rejection = PlaceOrder(request, session.GetOwner(), session.GetAccount(), order);
+    if (!rejection.empty()) return SendRejection(session, rejection);
+    SendNewOrderAck(session, order);
 }
 
+void Exchange::SendNewOrderAck(Session& session, std::shared_ptr<Order>& order) {
+    LATENCY_PROBE(encode_start);
+    std::string_view response = session.GetEncoder().EncodeNewOrderAck(*order);
+    LATENCY_RECORD(LatencyStage::ENCODE, encode_start);
 
-void Exchange::SendNewOrderAck(int client_sock, std::shared_ptr<Order>& order) {
-    char response[BUFFER_SIZE];
-    hffix::message_writer writer(response, response + BUFFER_SIZE);
-    writer.push_back_header("FIX.4.2");
-    writer.push_back_string(hffix::tag::MsgType, "8");
-    writer.push_back_string(hffix::tag::SenderCompID, "SERVER");
-    writer.push_back_string(hffix::tag::TargetCompID, "CLIENT");
-    writer.push_back_int(hffix::tag::OrderID, order->GetID());
-    writer.push_back_string(hffix::tag::ExecType, "0");
-    writer.push_back_string(hffix::tag::OrdStatus, "0");
-    writer.push_back_string(hffix::tag::Symbol, order->GetTicker());
-    writer.push_back_char(hffix::tag::Side, order->GetSide() == OrderSide::BID ? '1' : '2');
+    session.Send(response);
+}
 
-    char order_type;
-    if (order->GetType() == OrderType::FILL_OR_KILL) order_type = '3';
-    else if (order->GetType()  == OrderType::GOOD_TIL_CANCELED) order_type = '1';
-    else if (order->GetType()  == OrderType::IMMEDIATE_OR_CANCEL) order_type = '4';
-    else return; // can never reach here
-    writer.push_back_char(hffix::tag::OrdType, order_type);
+void Exchange::ProcessCancelOrder(hffix::message_reader& reader, Session& session) {
+    OrderID id;
+    LATENCY_PROBE(decode_start);
+    bool has_id = FixDecoder::DecodeOrderID(reader, id);
+    LATENCY_RECORD(LatencyStage::DECODE, decode_start);
+    if (!has_id) return SendRejection(session, "Invalid order ID");
+
+    std::string_view rejection = CancelOrder(id);
+    if (!rejection.empty()) return SendRejection(session, rejection);
+    SendCancelOrderAck(session, id);
+}
 
-    writer.push_back_char(hffix::tag::OrdType, order_type);
-    writer.push_back_int(hffix::tag::OrderQty, order->GetQuantity());
-    writer.push_back_int(hffix::tag::Price, order->GetPrice());
-    writer.push_back_trailer();
+void Exchange::SendCancelOrderAck(Session& session, OrderID order_id) {
+    LATENCY_PROBE(encode_start);
+    std::string_view response = session.GetEncoder().EncodeCancelOrderAck(order_id);
+    LATENCY_RECORD(LatencyStage::ENCODE, encode_start);
 
-    send(client_sock, response, writer.message_end() - response, 0);
+    session.Send(response);
 }
 
-void Exchange::ProcessCancelOrder(hffix::message_reader& reader, int client_sock) {
+void Exchange::ProcessGetOrderStatus(hffix::message_reader& reader, Session& session) {
     OrderID id;
+    LATENCY_PROBE(decode_start);
+    bool has_id = FixDecoder::DecodeOrderID(reader, id);
+    LATENCY_RECORD(LatencyStage::DECODE, decode_start);
 
-    for (const auto& field : reader) {
-        if (field.tag() == hffix::tag::OrderID) id = field.value().as_int<OrderID>();
-    }
+    std::shared_ptr<Order> order = has_id ? FindOrder(id) : nullptr;
+    if (!order) return SendRejection(session, "Invalid order ID");
+    SendOrderStatus(session, order);
+}
 
+void Exchange::SendOrderStatus(Session& session, std::shared_ptr<Order>& order) {
+    LATENCY_PROBE(encode_start);
+    // ideally no locking in send functions, even if not used for io
     std::shared_lock<std::shared_mutex> read_lock(mutex_);
-    bool exists = orders_.count(id);
+    std::string_view response = session.GetEncoder().EncodeOrderStatus(*order);
     read_lock.unlock();
-    if (!exists) return SendRejection(client_sock, "Invalid order ID");
+    LATENCY_RECORD(LatencyStage::ENCODE, encode_start);
 
-    std::unique_lock<std::shared_mutex> lock(mutex_);
-    // validate that order is cancelable right before cancelling
-    bool success = order_books_[orders_[id]->GetTicker()]->CancelOrder(id);
-    if (success) orders_[id]->SetStatus(OrderStatus::CANCELLED);
-    lock.unlock();
-    if (success) SendCancelOrderAck(client_sock, id);
-    else SendRejection(client_sock, "Order cancellation failed");
+    session.Send(response);
 }
 
-void Exchange::SendCancelOrderAck(int client_sock, OrderID order_id) {
-    char response[BUFFER_SIZE];
-    hffix::message_writer writer(response, response + BUFFER_SIZE);
-    writer.push_back_header("FIX.4.2");
-    writer.push_back_string(hffix::tag::MsgType, "8");
-    writer.push_back_string(hffix::tag::SenderCompID, "SERVER");
-    writer.push_back_string(hffix::tag::TargetCompID, "CLIENT");
-    writer.push_back_int(hffix::tag::OrderID, order_id);
-    writer.push_back_string(hffix::tag::ExecType, "4");
-    writer.push_back_string(hffix::tag::OrdStatus, "4");
-    writer.push_back_trailer();
+std::string_view Exchange::PlaceOrder(const OrderRequest& request, OwnerID owner, const std::shared_ptr<AccountRisk>& account,
+    std::shared_ptr<Order>& order) {
+    // with too many orders queued on the books, taking more only makes every one of them wait longer
+    if (max_pending_orders_ && pending_orders_.load(std::memory_order_relaxed) >= max_pending_orders_) {
+        shed_.fetch_add(1, std::memory_order_relaxed);
+        return "Exchange overloaded";
+    }
 
-    send(client_sock, response, writer.message_end() - response, 0);
-}
+    std::shared_lock<std::shared_mutex> read_lock(mutex_);
+    // shards are only removed while the exchange is stopped
+    Shard* shard = FindShard(request.ticker);
+    read_lock.unlock();
+    if (!shard) return "Invalid symbol";
+    OrderBook* order_book = shard->book.get();
 
-void Exchange::ProcessGetOrderStatus(hffix::message_reader& reader, int client_sock) {
     OrderID id;
+    try {
+        id = shard->orders.Reserve();
+    } catch (const std::runtime_error&) {
+        return "Order table is full";
+    }
+    try {
+        // orders live in their book's arena, when it has one
+        order = std::allocate_shared<Order>(ArenaAllocator<Order>(order_book->GetArena(), MemoryCategory::MEMORY_ORDERS), id, request.ticker,
+            request.price, request.quantity, request.side, request.type, request.stop_price, request.display_quantity,
+            request.peg_type, request.peg_offset, request.expire_time);
+        order->SetOwner(owner, self_trade_prevention_.load(std::memory_order_relaxed));
+    } catch (const std::invalid_argument&) {
+        // the ID was never given out, so its slot goes straight back
+        shard->orders.Release(id);
+        order.reset();
+        return "Invalid order";
+    }
+    LATENCY_PROBE(risk_start);
+    std::string_view risk_rejection = risk_gate_.Admit(*order, account, order_book->GetLastPrice());
+    LATENCY_RECORD(LatencyStage::RISK_CHECK, risk_start);
+    if (!risk_rejection.empty()) {
+        // nobody learns the ID of a rejected order, so its slot is given back straight away
+        shard->orders.Release(order->GetID());
+        return risk_rejection;
+    }
+    if (max_pending_orders_) pending_orders_.fetch_add(1, std::memory_order_relaxed);
+    LATENCY_PROBE(lock_start);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    LATENCY_RECORD(LatencyStage::LOCK_WAIT, lock_start);
+    shard->orders.Store(order);
+    uint64_t sequence = replicator_ ? replicator_->Append(MakeNewOrderEntry(*order)) : 0;
+    LATENCY_PROBE(place_start);
+    bool success = order_book->PlaceOrder(order);
+    LATENCY_RECORD(LatencyStage::PLACE_ORDER, place_start);
+    if (shard->views) shard->views->Publish(*order_book);
+    lock.unlock();
+    if (max_pending_orders_) pending_orders_.fetch_sub(1, std::memory_order_relaxed);
+    AwaitReplication(sequence);
+    return success ? std::string_view() : "Order placement failed";
+}
 
-    for (const auto& field : reader) {
-        if (field.tag() == hffix::tag::OrderID) id = field.value().as_int<OrderID>();
+std::string_view Exchange::CancelOrder(OrderID id) {
+    LATENCY_PROBE(lock_start);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    LATENCY_RECORD(LatencyStage::LOCK_WAIT, lock_start);
+    // the ID leads straight to the order, so it is looked up right before cancelling
+    Shard* shard = FindShard(id);
+    std::shared_ptr<Order> order = shard ? shard->orders.Find(id) : nullptr;
+    if (!order) return "Invalid order ID";
+    // a filled or cancelled order has left the book
+    bool success = order->GetStatus() == OrderStatus::OPEN && shard->book->CancelOrder(id);
+    if (success) {
+        order->SetStatus(OrderStatus::CANCELLED);
+        if (shard->views) shard->views->Publish(*shard->book);
     }
+    uint64_t sequence = replicator_ && success ? replicator_->Append(MakeEntry(JournalAction::JOURNAL_CANCEL, shard->ticker, id)) : 0;
+    lock.unlock();
+    AwaitReplication(sequence);
+    return success ? std::string_view() : "Order cancellation failed";
+}
 
+std::shared_ptr<Order> Exchange::FindOrder(OrderID id) {
     std::shared_lock<std::shared_mutex> read_lock(mutex_);
-    bool exists = orders_.count(id);
-    std::shared_ptr<Order> order = orders_[id];
-    read_lock.unlock();
-    if (!exists) return SendRejection(client_sock, "Invalid order ID");
-    
-    SendOrderStatus(client_sock, order);
+    Shard* shard = FindShard(id);
+    return shard ? shard->orders.Find(id) : nullptr;
 }
 
-void Exchange::SendOrderStatus(int client_sock, std::shared_ptr<Order>& order) {
-    char response[BUFFER_SIZE];
-    hffix::message_writer writer(response, response + BUFFER_SIZE);
-    // ideally no locking in send functions, even if not used for io
-    std::shared_lock<std::shared_mutex> read_lock(mutex_);
-    writer.push_back_header("FIX.4.2");
-    writer.push_back_string(hffix::tag::MsgType, "8");
-    writer.push_back_string(hffix::tag::SenderCompID, "SERVER");
-    writer.push_back_string(hffix::tag::TargetCompID, "CLIENT");
-    writer.push_back_int(hffix::tag::OrderID, order->GetID());
-    writer.push_back_string(hffix::tag::ExecType, "I");
-
-    std::string order_status;
-    if (order->GetStatus() == OrderStatus::CLOSED) order_status = "2";
-    else if (order->GetStatus() == OrderStatus::CANCELLED) order_status = "4";
-    else order_status = order->IsFilled() ? "2" : (order->GetFilled() == 0 ? "0" : "1");
-    writer.push_back_string(hffix::tag::OrdStatus, order_status);
-
-    writer.push_back_string(hffix::tag::Symbol, order->GetTicker());
-    writer.push_back_char(hffix::tag::Side, order->GetSide() == OrderSide::BID ? '1' : '2');
-
-    char order_type;
-    if (order->GetType() == OrderType::FILL_OR_KILL) order_type = '3';
-    else if (order->GetType()  == OrderType::GOOD_TIL_CANCELED) order_type = '1';
-    else if (order->GetType()  == OrderType::IMMEDIATE_OR_CANCEL) order_type = '4';
-    else return; // can never reach here
-    writer.push_back_char(hffix::tag::OrdType, order_type);
-    
-    writer.push_back_int(hffix::tag::OrderQty, order->GetQuantity());
-    writer.push_back_int(hffix::tag::CumQty, order->GetFilled());
-    writer.push_back_int(hffix::tag::LeavesQty, order->GetRemaining());
-    writer.push_back_int(hffix::tag::Price, order->GetPrice());
-    writer.push_back_trailer();
-    read_lock.unlock();
+Exchange::Shard* Exchange::FindShard(const std::string& ticker) {
+    auto instrument = instruments_.find(ticker);
+    return instrument != instruments_.end() ? shards_[instrument->second].get() : nullptr;
+}
 
-    send(client_sock, response, writer.message_end() - response, 0);
+Exchange::Shard* Exchange::FindShard(OrderID id) {
+    InstrumentID instrument = OrderTable::GetInstrument(id);
+    return instrument < shards_.size() ? shards_[instrument].get() : nullptr;
 }
 
+void Exchange::AwaitReplication(uint64_t sequence) {
+    if (!sequence) return;
+    LATENCY_PROBE(replicate_start);
+    replicator_->WaitForAck(sequence);
+    LATENCY_RECORD(LatencyStage::REPLICATE, replicate_start);
+}
+
+void Exchange::ApplyJournalEntry(const JournalEntry& entry) {
+    std::string ticker(entry.ticker, strnlen(entry.ticker, JournalEntry::TICKER_SIZE));
+    Shard* shard = FindShard(ticker);
+    if (!shard) throw std::runtime_error("Journaled instrument " + ticker + " does not exist on the backup");
+    OrderBook& order_book = *shard->book;
+
+    switch (entry.action) {
+        case JournalAction::JOURNAL_NEW: {
+            std::shared_ptr<Order> order = std::allocate_shared<Order>(ArenaAllocator<Order>(order_book.GetArena(), MemoryCategory::MEMORY_ORDERS), entry.order_id,
+                ticker, entry.price, entry.quantity, static_cast<OrderSide>(entry.side), static_cast<OrderType>(entry.type),
+                entry.stop_price, entry.display_quantity, static_cast<PegType>(entry.peg_type), entry.peg_offset, entry.expire_time);
+            order->SetOwner(entry.owner, static_cast<SelfTradePrevention>(entry.self_trade_prevention));
+            // the IDs of the primary's orders have to lead to the same books here
+            if (FindShard(entry.order_id) != shard) throw std::runtime_error("Journaled instrument " + ticker + " is numbered differently on the backup");
+            // orders and sessions after a failover carry on from those of the primary
+            shard->orders.Restore(order);
+            order_book.PlaceOrder(order);
+            Session::ReserveOwners(entry.owner);
+            break;
+        }
+        case JournalAction::JOURNAL_CANCEL:
+            if (order_book.CancelOrder(entry.order_id)) shard->orders.Find(entry.order_id)->SetStatus(OrderStatus::CANCELLED);
+            break;
+        case JournalAction::JOURNAL_EXPIRE:
+            if (order_book.CancelOrder(entry.order_id)) shard->orders.Find(entry.order_id)->SetStatus(OrderStatus::EXPIRED);
+            break;
+        case JournalAction::JOURNAL_AUCTION:
+            order_book.StartAuction();
+            break;
+        case JournalAction::JOURNAL_UNCROSS:
+            order_book.Uncross(entry.price);
+            break;
+        default:
+            throw std::runtime_error("Unknown journal action");
+    }
+    if (shard->views) shard->views->Publish(order_book);
+}
 
-void Exchange::SendRejection(int client_sock, std::string reason) {
-    char response[BUFFER_SIZE];
-    hffix::message_writer writer(response, response + BUFFER_SIZE);
-    writer.push_back_header("FIX.4.2");
-    writer.push_back_string(hffix::tag::MsgType, "3");
-    writer.push_back_string(hffix::tag::SenderCompID, "SERVER");
-    writer.push_back_string(hffix::tag::TargetCompID, "CLIENT");
-    writer.push_back_string(hffix::tag::Text, reason);
-    writer.push_back_trailer();
+void Exchange::SendRejection(Session& session, std::string_view reason) {
+    LATENCY_PROBE(encode_start);
+    std::string_view response = session.GetEncoder().EncodeRejection(reason);
+    LATENCY_RECORD(LatencyStage::ENCODE, encode_start);
 
-    send(client_sock, response, writer.message_end() - response, 0);
+    session.Send(response);
 }
\ No newline at end of file
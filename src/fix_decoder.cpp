@@ -0,0 +1,91 @@
+#include "fix_decoder.hpp"
+
+#include "shm_channel.hpp"
+
+bool FixDecoder::DecodeLogon(hffix::message_reader& reader, std::string& channel_name) {
+    for (const auto& field : reader) {
+        if (field.tag() == ShmChannel::LOGON_TAG) channel_name = field.value().as_string();
+        if (field.tag() == hffix::tag::MsgType && field.value() != "A") return false;
+        if (field.tag() == hffix::tag::SenderCompID && field.value() != "CLIENT") return false;
+        if (field.tag() == hffix::tag::TargetCompID && field.value() != "SERVER") return false;
+        if (field.tag() == hffix::tag::EncryptMethod && field.value().as_int<int>() != 0) return false;
+    }
+    return true;
+}
+
+std::string_view FixDecoder::DecodeNewOrder(hffix::message_reader& reader, OrderRequest& request) {
+    bool has_side = false;
+    bool has_type = false;
+    bool has_price = false;
+
+    for (const auto& field : reader) {
+        if (field.tag() == hffix::tag::Symbol) request.ticker = field.value().as_string();
+        if (field.tag() == hffix::tag::Side) {
+            if (field.value().as_char() == '1') request.side = OrderSide::BID;
+            else if (field.value().as_char() == '2') request.side = OrderSide::ASK;
+            else return "Invalid order type";
+            has_side = true;
+        }
+        if (field.tag() == hffix::tag::OrdType) {
+            if (field.value().as_char() == '1') request.type = OrderType::GOOD_TIL_CANCELED;
+            else if (field.value().as_char() == '3') request.type = OrderType::FILL_OR_KILL;
+            else if (field.value().as_char() == '4') request.type = OrderType::IMMEDIATE_OR_CANCEL;
+            else if (field.value().as_char() == '0') request.type = OrderType::DAY;
+            else if (field.value().as_char() == '6') request.type = OrderType::GOOD_TIL_DATE;
+            else return "Invalid order type";
+            has_type = true;
+        }
+        if (field.tag() == hffix::tag::Price) {
+            request.price = field.value().as_int<OrderPrice>();
+            has_price = true;
+        }
+        if (field.tag() == hffix::tag::OrderQty) request.quantity = field.value().as_int<OrderQuantity>();
+        if (field.tag() == hffix::tag::StopPx) request.stop_price = field.value().as_int<OrderPrice>();
+        if (field.tag() == hffix::tag::MaxFloor) request.display_quantity = field.value().as_int<OrderQuantity>();
+        if (field.tag() == hffix::tag::ExecInst) {
+            if (field.value().as_char() == 'R') request.peg_type = PegType::PRIMARY_PEG;
+            else if (field.value().as_char() == 'P') request.peg_type = PegType::MARKET_PEG;
+            else if (field.value().as_char() == 'M') request.peg_type = PegType::MIDPOINT_PEG;
+            else return "Invalid peg type";
+        }
+        if (field.tag() == hffix::tag::PegOffsetValue) request.peg_offset = field.value().as_int<PriceOffset>();
+        if (field.tag() == hffix::tag::ExpireTime) request.expire_time = field.value().as_int<Timestamp>();
+    }
+    if (!has_side || !has_type) return "Missing required field";
+    // as in FIX, a market order is an OrdType 1 without a price
+    if (request.type == OrderType::GOOD_TIL_CANCELED && !has_price) request.type = OrderType::MARKET;
+    // a stop price holds the order back until triggered: a GTC then rests at its limit, an IOC or market order sweeps the book
+    if (request.stop_price) {
+        if (request.type == OrderType::GOOD_TIL_CANCELED) request.type = OrderType::STOP_LIMIT;
+        else if (request.type == OrderType::IMMEDIATE_OR_CANCEL || request.type == OrderType::MARKET) request.type = OrderType::STOP;
+        else return "Invalid order type";
+    }
+    return ValidateNewOrder(request);
+}
+
+std::string_view FixDecoder::ValidateNewOrder(const OrderRequest& request) {
+    OrderType type = request.type;
+    if (request.side > OrderSide::ASK || type > OrderType::MARKET || request.peg_type > PegType::MIDPOINT_PEG) return "Invalid order type";
+    if (!request.quantity) return "Missing required field";
+    // only orders that sweep the book or track a reference price may leave the limit out
+    bool pegged = request.peg_type != PegType::NO_PEG;
+    if (!request.price && type != OrderType::MARKET && type != OrderType::STOP && !pegged) return "Missing required field";
+    if (!request.stop_price && (type == OrderType::STOP || type == OrderType::STOP_LIMIT)) return "Missing required field";
+    bool rests = type == OrderType::GOOD_TIL_CANCELED || type == OrderType::DAY || type == OrderType::GOOD_TIL_DATE;
+    if (request.display_quantity > request.quantity || (request.display_quantity && !rests && type != OrderType::STOP_LIMIT)) {
+        return "Invalid display quantity";
+    }
+    if (pegged && !rests) return "Invalid peg type";
+    if (type == OrderType::GOOD_TIL_DATE && request.expire_time <= CurrentTime()) return "Invalid expire time";
+    return {};
+}
+
+bool FixDecoder::DecodeOrderID(hffix::message_reader& reader, OrderID& id) {
+    for (const auto& field : reader) {
+        if (field.tag() == hffix::tag::OrderID) {
+            id = field.value().as_int<OrderID>();
+            return true;
+        }
+    }
+    return false;
+}
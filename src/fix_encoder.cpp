@@ -0,0 +1,249 @@
+#include "fix_encoder.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "hffix.hpp"
+
+namespace {
+
+constexpr char SOH = '\x01';
+constexpr std::string_view BEGIN_STRING = "8=FIX.4.2\x01" "9=";
+constexpr unsigned BEGIN_STRING_SUM = []() {
+    unsigned sum = 0;
+    for (char c : BEGIN_STRING) sum += static_cast<unsigned char>(c);
+    return sum;
+}();
+
+/**
+ * Two digit lookup table so integers are formatted two digits per division.
+ */
+constexpr char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/**
+ * Render "tag=value<SOH>" for a template.
+ */
+std::string Field(int tag, std::string_view value) {
+    return std::to_string(tag) + "=" + std::string(value) + SOH;
+}
+
+/**
+ * Get the FIX OrdType character of an order type. Market orders share GTC's character and are
+ * told apart by carrying no Price.
+ */
+char OrdTypeChar(OrderType type) {
+    if (type == OrderType::FILL_OR_KILL) return '3';
+    if (type == OrderType::DAY) return '0';
+    if (type == OrderType::GOOD_TIL_DATE) return '6';
+    if (type == OrderType::IMMEDIATE_OR_CANCEL || type == OrderType::STOP) return '4';
+    return '1';
+}
+
+}
+
+FixEncoder::FixEncoder(std::string_view sender_comp_id, std::string_view target_comp_id)
+    : cursor_{buffer_ + HEADER_RESERVE}
+    , sum_{0} {
+    std::string header = Field(hffix::tag::SenderCompID, sender_comp_id) + Field(hffix::tag::TargetCompID, target_comp_id);
+    logon_ = MakeFragment(Field(hffix::tag::MsgType, "A") + header + Field(hffix::tag::EncryptMethod, "0"));
+    new_order_ack_ = MakeFragment(Field(hffix::tag::MsgType, "8") + header
+        + Field(hffix::tag::ExecType, "0") + Field(hffix::tag::OrdStatus, "0"));
+    cancel_order_ack_ = MakeFragment(Field(hffix::tag::MsgType, "8") + header
+        + Field(hffix::tag::ExecType, "4") + Field(hffix::tag::OrdStatus, "4"));
+    order_status_ = MakeFragment(Field(hffix::tag::MsgType, "8") + header + Field(hffix::tag::ExecType, "I"));
+    expiry_ = MakeFragment(Field(hffix::tag::MsgType, "8") + header
+        + Field(hffix::tag::ExecType, "C") + Field(hffix::tag::OrdStatus, "C"));
+    rejection_ = MakeFragment(Field(hffix::tag::MsgType, "3") + header);
+}
+
+std::string_view FixEncoder::EncodeLogonResponse() {
+    Begin(logon_);
+    return Finish();
+}
+
+std::string_view FixEncoder::EncodeNewOrderAck(Order& order) {
+    static constexpr Tag ORDER_ID = MakeTag(hffix::tag::OrderID);
+    static constexpr Tag SYMBOL = MakeTag(hffix::tag::Symbol);
+    static constexpr Tag SIDE = MakeTag(hffix::tag::Side);
+    static constexpr Tag ORD_TYPE = MakeTag(hffix::tag::OrdType);
+    static constexpr Tag ORDER_QTY = MakeTag(hffix::tag::OrderQty);
+    static constexpr Tag PRICE = MakeTag(hffix::tag::Price);
+
+    Begin(new_order_ack_);
+    PutInt(ORDER_ID, order.GetID());
+    PutString(SYMBOL, order.GetTicker());
+    PutChar(SIDE, order.GetSide() == OrderSide::BID ? '1' : '2');
+    PutChar(ORD_TYPE, OrdTypeChar(order.GetType()));
+    PutInt(ORDER_QTY, order.GetQuantity());
+    if (order.GetType() != OrderType::MARKET) PutInt(PRICE, order.GetPrice());
+    return Finish();
+}
+
+std::string_view FixEncoder::EncodeCancelOrderAck(OrderID order_id) {
+    static constexpr Tag ORDER_ID = MakeTag(hffix::tag::OrderID);
+
+    Begin(cancel_order_ack_);
+    PutInt(ORDER_ID, order_id);
+    return Finish();
+}
+
+std::string_view FixEncoder::EncodeOrderStatus(Order& order) {
+    static constexpr Tag ORDER_ID = MakeTag(hffix::tag::OrderID);
+    static constexpr Tag ORD_STATUS = MakeTag(hffix::tag::OrdStatus);
+    static constexpr Tag SYMBOL = MakeTag(hffix::tag::Symbol);
+    static constexpr Tag SIDE = MakeTag(hffix::tag::Side);
+    static constexpr Tag ORD_TYPE = MakeTag(hffix::tag::OrdType);
+    static constexpr Tag ORDER_QTY = MakeTag(hffix::tag::OrderQty);
+    static constexpr Tag CUM_QTY = MakeTag(hffix::tag::CumQty);
+    static constexpr Tag LEAVES_QTY = MakeTag(hffix::tag::LeavesQty);
+    static constexpr Tag PRICE = MakeTag(hffix::tag::Price);
+    static constexpr Tag EXPIRE_TIME = MakeTag(hffix::tag::ExpireTime);
+
+    char order_status;
+    if (order.GetStatus() == OrderStatus::CLOSED) order_status = '2';
+    else if (order.GetStatus() == OrderStatus::CANCELLED) order_status = '4';
+    else if (order.GetStatus() == OrderStatus::EXPIRED) order_status = 'C';
+    else order_status = order.IsFilled() ? '2' : (order.GetFilled() == 0 ? '0' : '1');
+
+    Begin(order_status_);
+    PutInt(ORDER_ID, order.GetID());
+    PutChar(ORD_STATUS, order_status);
+    PutString(SYMBOL, order.GetTicker());
+    PutChar(SIDE, order.GetSide() == OrderSide::BID ? '1' : '2');
+    PutChar(ORD_TYPE, OrdTypeChar(order.GetType()));
+    PutInt(ORDER_QTY, order.GetQuantity());
+    PutInt(CUM_QTY, order.GetFilled());
+    PutInt(LEAVES_QTY, order.GetRemaining());
+    if (order.GetType() != OrderType::MARKET) PutInt(PRICE, order.GetPrice());
+    if (order.GetExpireTime()) PutInt(EXPIRE_TIME, order.GetExpireTime());
+    return Finish();
+}
+
+std::string_view FixEncoder::EncodeExpiry(Order& order) {
+    static constexpr Tag ORDER_ID = MakeTag(hffix::tag::OrderID);
+    static constexpr Tag SYMBOL = MakeTag(hffix::tag::Symbol);
+    static constexpr Tag SIDE = MakeTag(hffix::tag::Side);
+    static constexpr Tag ORD_TYPE = MakeTag(hffix::tag::OrdType);
+    static constexpr Tag ORDER_QTY = MakeTag(hffix::tag::OrderQty);
+    static constexpr Tag CUM_QTY = MakeTag(hffix::tag::CumQty);
+    static constexpr Tag LEAVES_QTY = MakeTag(hffix::tag::LeavesQty);
+
+    Begin(expiry_);
+    PutInt(ORDER_ID, order.GetID());
+    PutString(SYMBOL, order.GetTicker());
+    PutChar(SIDE, order.GetSide() == OrderSide::BID ? '1' : '2');
+    PutChar(ORD_TYPE, OrdTypeChar(order.GetType()));
+    PutInt(ORDER_QTY, order.GetQuantity());
+    PutInt(CUM_QTY, order.GetFilled());
+    // nothing is left working once an order expires
+    PutInt(LEAVES_QTY, 0);
+    return Finish();
+}
+
+std::string_view FixEncoder::EncodeRejection(std::string_view reason) {
+    static constexpr Tag TEXT = MakeTag(hffix::tag::Text);
+
+    Begin(rejection_);
+    PutString(TEXT, reason);
+    return Finish();
+}
+
+FixEncoder::Fragment FixEncoder::MakeFragment(const std::string& fields) {
+    Fragment fragment{};
+    if (fields.size() > sizeof(fragment.text)) throw std::length_error("FIX template does not fit a fragment");
+    memcpy(fragment.text, fields.data(), fields.size());
+    fragment.length = fields.size();
+    for (char c : fields) fragment.sum += static_cast<unsigned char>(c);
+    return fragment;
+}
+
+void FixEncoder::Begin(const Fragment& fragment) {
+    cursor_ = buffer_ + HEADER_RESERVE;
+    memcpy(cursor_, fragment.text, fragment.length);
+    cursor_ += fragment.length;
+    sum_ = fragment.sum;
+}
+
+void FixEncoder::PutInt(const Tag& tag, uint64_t value) {
+    memcpy(cursor_, tag.text, tag.length);
+    cursor_ += tag.length;
+    sum_ += tag.sum;
+
+    // format backwards into a scratch buffer two digits at a time
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* begin = end;
+    while (value >= 100) {
+        size_t pair = (value % 100) * 2;
+        value /= 100;
+        *--begin = DIGIT_PAIRS[pair + 1];
+        *--begin = DIGIT_PAIRS[pair];
+    }
+    if (value >= 10) {
+        *--begin = DIGIT_PAIRS[value * 2 + 1];
+        *--begin = DIGIT_PAIRS[value * 2];
+    } else {
+        *--begin = '0' + value;
+    }
+
+    for (char* it = begin; it != end; ++it) {
+        sum_ += static_cast<unsigned char>(*it);
+        *cursor_++ = *it;
+    }
+    *cursor_++ = SOH;
+    sum_ += SOH;
+}
+
+void FixEncoder::PutChar(const Tag& tag, char value) {
+    memcpy(cursor_, tag.text, tag.length);
+    cursor_ += tag.length;
+    *cursor_++ = value;
+    *cursor_++ = SOH;
+    sum_ += tag.sum + static_cast<unsigned char>(value) + SOH;
+}
+
+void FixEncoder::PutString(const Tag& tag, std::string_view value) {
+    size_t available = buffer_ + BUFFER_SIZE - TAIL_RESERVE - cursor_ - tag.length - 1;
+    if (value.size() > available) value = value.substr(0, available);
+
+    memcpy(cursor_, tag.text, tag.length);
+    cursor_ += tag.length;
+    sum_ += tag.sum;
+    for (char c : value) {
+        sum_ += static_cast<unsigned char>(c);
+        *cursor_++ = c;
+    }
+    *cursor_++ = SOH;
+    sum_ += SOH;
+}
+
+std::string_view FixEncoder::Finish() {
+    char* body = buffer_ + HEADER_RESERVE;
+    size_t body_length = cursor_ - body;
+
+    // write "8=FIX.4.2<SOH>9=<length><SOH>" right-aligned against the body
+    char* begin = body;
+    *--begin = SOH;
+    unsigned sum = sum_ + BEGIN_STRING_SUM + SOH;
+    do {
+        char digit = '0' + body_length % 10;
+        *--begin = digit;
+        sum += static_cast<unsigned char>(digit);
+        body_length /= 10;
+    } while (body_length);
+    begin -= BEGIN_STRING.size();
+    memcpy(begin, BEGIN_STRING.data(), BEGIN_STRING.size());
+
+    unsigned checksum = sum % 256;
+    *cursor_++ = '1';
+    *cursor_++ = '0';
+    *cursor_++ = '=';
+    *cursor_++ = '0' + checksum / 100;
+    *cursor_++ = '0' + checksum / 10 % 10;
+    *cursor_++ = '0' + checksum % 10;
+    *cursor_++ = SOH;
+    return std::string_view(begin, cursor_ - begin);
+}
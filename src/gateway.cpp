@@ -0,0 +1,224 @@
+#include "gateway.hpp"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "fix_decoder.hpp"
+
+namespace {
+
+/**
+ * Rebuild an order from the engine's report of it, for the encoder.
+ */
+Order MakeOrder(const EngineMessage& message) {
+    std::string ticker(message.ticker, strnlen(message.ticker, EngineMessage::TICKER_SIZE));
+    Order order(message.order_id, ticker, message.price, message.quantity, static_cast<OrderSide>(message.side),
+        static_cast<OrderType>(message.order_type), message.stop_price, 0, PegType::NO_PEG, 0, message.expire_time);
+    if (message.filled) order.Fill(message.filled);
+    // a complete fill already closed it
+    if (message.status != OrderStatus::OPEN && order.GetStatus() == OrderStatus::OPEN) {
+        order.SetStatus(static_cast<OrderStatus>(message.status));
+    }
+    return order;
+}
+
+}
+
+Gateway::Gateway()
+    : running_{false}, server_sock_{-1}, engine_sock_{-1}, next_correlation_{0}, connected_{false}, messages_received_{0}, network_syscalls_{0} {}
+
+Gateway::~Gateway() {
+    Stop();
+    if (engine_) engine_->Close();
+    if (responses_.joinable()) responses_.join();
+    engine_.reset();
+    if (engine_sock_ != -1) close(engine_sock_);
+}
+
+void Gateway::Connect(const std::string& engine_host, int engine_port) {
+    if (engine_) throw std::runtime_error("Gateway is already attached to an engine");
+    sockaddr_in engine_addr;
+    engine_addr.sin_family = AF_INET;
+    engine_addr.sin_port = htons(engine_port);
+    if (!inet_aton(engine_host.c_str(), &engine_addr.sin_addr)) throw std::invalid_argument("Engine host is invalid");
+
+    engine_sock_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (engine_sock_ == -1) throw std::runtime_error("Socket creation failed");
+    if (connect(engine_sock_, (struct sockaddr*) &engine_addr, sizeof(engine_addr)) == -1) {
+        close(engine_sock_);
+        engine_sock_ = -1;
+        throw std::runtime_error("Failed to connect to engine");
+    }
+
+    // the engine opens the region by the name sent over the control connection, as with co-located clients
+    static std::atomic<int> next_channel{0};
+    std::string name = std::string(ShmChannel::NAME_PREFIX) + "gw-" + std::to_string(getpid()) + "-" + std::to_string(next_channel++);
+    try {
+        engine_ = std::make_unique<ShmChannel>(name, engine_sock_, true);
+    } catch (const std::runtime_error&) {
+        close(engine_sock_);
+        engine_sock_ = -1;
+        throw;
+    }
+    if (send(engine_sock_, name.c_str(), name.size() + 1, MSG_NOSIGNAL) != static_cast<ssize_t>(name.size() + 1)) {
+        engine_.reset();
+        close(engine_sock_);
+        engine_sock_ = -1;
+        throw std::runtime_error("Failed to attach to engine");
+    }
+
+    connected_ = true;
+    responses_ = std::jthread([this]() { RunResponses(); });
+}
+
+void Gateway::Start(int port) {
+    if (!engine_) throw std::runtime_error("Gateway is not attached to an engine");
+    int server_sock = Session::Listen(port, 5);
+
+    std::cout << "Gateway started on port " << port << std::endl;
+    server_sock_ = server_sock;
+    running_ = true;
+    while (running_) {
+        int client_sock = accept(server_sock, (struct sockaddr*)nullptr, nullptr);
+        if (client_sock != -1) std::thread(&Gateway::HandleClient, this, client_sock).detach();
+    }
+
+    server_sock_ = -1;
+    close(server_sock);
+}
+
+void Gateway::Stop() {
+    running_ = false;
+    // wakes the acceptor, which otherwise only sees the flag once another connection arrives
+    int sock = server_sock_;
+    if (sock != -1) shutdown(sock, SHUT_RDWR);
+}
+
+GatewayStats Gateway::GetGatewayStats() {
+    return {messages_received_.load(std::memory_order_relaxed), network_syscalls_.load(std::memory_order_relaxed)};
+}
+
+int Gateway::HandleClient(int client_sock) {
+    Session session(client_sock);
+    char buffer[BUFFER_SIZE] = {0};
+
+    ssize_t len = session.Receive(buffer, BUFFER_SIZE);
+    if (len <= 0) return close(client_sock);
+    messages_received_.fetch_add(1, std::memory_order_relaxed);
+
+    hffix::message_reader reader(buffer, buffer + len);
+    std::string channel_name;
+    // co-located clients are better off attaching to an exchange directly, so shared memory sessions are not offered
+    if (!FixDecoder::DecodeLogon(reader, channel_name) || !channel_name.empty()) return close(client_sock);
+    session.Send(session.GetEncoder().EncodeLogonResponse());
+
+    while (running_) {
+        memset(buffer, 0, BUFFER_SIZE);
+        len = session.Receive(buffer, BUFFER_SIZE);
+        if (len <= 0) break;
+        messages_received_.fetch_add(1, std::memory_order_relaxed);
+
+        reader = hffix::message_reader(buffer, buffer + len);
+        ProcessMessage(reader, session);
+    }
+
+    network_syscalls_.fetch_add(session.GetSyscallCount(), std::memory_order_relaxed);
+    return close(client_sock);
+}
+
+void Gateway::ProcessMessage(hffix::message_reader& reader, Session& session) {
+    EngineMessage message{};
+    for (const auto& field : reader) {
+        if (field.tag() == hffix::tag::MsgType) {
+            if (field.value() == "D") message.type = EngineMessageType::ENGINE_NEW_ORDER;
+            else if (field.value() == "F") message.type = EngineMessageType::ENGINE_CANCEL_ORDER;
+            else if (field.value() == "H") message.type = EngineMessageType::ENGINE_ORDER_STATUS;
+            break;
+        }
+    }
+    if (!message.type) return;
+
+    if (message.type == EngineMessageType::ENGINE_NEW_ORDER) {
+        OrderRequest request;
+        std::string_view rejection = FixDecoder::DecodeNewOrder(reader, request);
+        if (!rejection.empty()) return SendRejection(session, rejection);
+        if (request.ticker.size() > EngineMessage::TICKER_SIZE) return SendRejection(session, "Invalid symbol");
+        message.expire_time = request.expire_time;
+        message.owner = session.GetOwner();
+        message.price = request.price;
+        message.quantity = request.quantity;
+        message.stop_price = request.stop_price;
+        message.display_quantity = request.display_quantity;
+        message.peg_offset = request.peg_offset;
+        message.side = request.side;
+        message.order_type = request.type;
+        message.peg_type = request.peg_type;
+        memcpy(message.ticker, request.ticker.data(), request.ticker.size());
+    } else if (!FixDecoder::DecodeOrderID(reader, message.order_id)) {
+        return SendRejection(session, "Invalid order ID");
+    }
+
+    if (!Call(message)) return SendRejection(session, "Matching engine unavailable");
+    FixEncoder& encoder = session.GetEncoder();
+    if (message.type == EngineMessageType::ENGINE_REJECTED) {
+        SendRejection(session, std::string_view(message.reason, strnlen(message.reason, EngineMessage::REASON_SIZE)));
+    } else if (message.type == EngineMessageType::ENGINE_CANCELLED) {
+        session.Send(encoder.EncodeCancelOrderAck(message.order_id));
+    } else {
+        Order order = MakeOrder(message);
+        session.Send(message.type == EngineMessageType::ENGINE_ACCEPTED ? encoder.EncodeNewOrderAck(order) : encoder.EncodeOrderStatus(order));
+    }
+}
+
+void Gateway::SendRejection(Session& session, std::string_view reason) {
+    session.Send(session.GetEncoder().EncodeRejection(reason));
+}
+
+bool Gateway::Call(EngineMessage& message) {
+    std::future<EngineMessage> response;
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        if (!connected_) return false;
+        message.correlation = next_correlation_++;
+        response = calls_[message.correlation].get_future();
+    }
+    bool sent;
+    {
+        // the ring has a single producer, which the lock makes of every session
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        sent = engine_->Send(std::string_view(reinterpret_cast<char*>(&message), sizeof(message)));
+    }
+    if (!sent) {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        calls_.erase(message.correlation);
+        return false;
+    }
+    message = response.get();
+    return message.correlation != FAILED_CALL;
+}
+
+void Gateway::RunResponses() {
+    EngineMessage message;
+    while (engine_->Receive(reinterpret_cast<char*>(&message), sizeof(message)) == sizeof(message)) {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        auto call = calls_.find(message.correlation);
+        if (call == calls_.end()) continue;
+        call->second.set_value(message);
+        calls_.erase(call);
+    }
+
+    // the engine is gone: fail every call still waiting, and every call from then on
+    std::lock_guard<std::mutex> lock(calls_mutex_);
+    connected_ = false;
+    EngineMessage failed{};
+    failed.correlation = FAILED_CALL;
+    for (auto& [correlation, call] : calls_) call.set_value(failed);
+    calls_.clear();
+    if (running_) std::cerr << "Lost the matching engine" << std::endl;
+}
@@ -0,0 +1,258 @@
+#include "latency.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+LatencyHistogram::LatencyHistogram() {
+    Reset();
+}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other) {
+    *this = other;
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts_[i].store(other.counts_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    count_.store(other.count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sum_.store(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    min_.store(other.min_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    max_.store(other.max_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    Record(value, 1);
+}
+
+void LatencyHistogram::Record(uint64_t value, uint64_t count) {
+    // single writer, so plain load/store pairs are enough and avoid locked instructions
+    std::atomic<uint64_t>& bucket = counts_[BucketIndex(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    count_.store(count_.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + value * count, std::memory_order_relaxed);
+    if (value < min_.load(std::memory_order_relaxed)) min_.store(value, std::memory_order_relaxed);
+    if (value > max_.load(std::memory_order_relaxed)) max_.store(value, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        uint64_t count = other.counts_[i].load(std::memory_order_relaxed);
+        if (count) counts_[i].store(counts_[i].load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+    count_.store(GetCount() + other.GetCount(), std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    min_.store(std::min(min_.load(std::memory_order_relaxed), other.min_.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    max_.store(std::max(max_.load(std::memory_order_relaxed), other.max_.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& count : counts_) count.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetMin() const {
+    return GetCount() ? min_.load(std::memory_order_relaxed) : 0;
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::GetMean() const {
+    uint64_t count = GetCount();
+    return count ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / count : 0;
+}
+
+uint64_t LatencyHistogram::GetValueAtPercentile(double percentile) const {
+    uint64_t count = GetCount();
+    if (!count) return 0;
+
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100 * count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= target) return std::min(BucketValue(i), GetMax());
+    }
+    return GetMax();
+}
+
+LatencyHistogram LatencyHistogram::Scaled(double factor) const {
+    LatencyHistogram scaled;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        uint64_t count = counts_[i].load(std::memory_order_relaxed);
+        if (count) scaled.Record(static_cast<uint64_t>(BucketValue(i) * factor), count);
+    }
+    if (GetCount()) {
+        scaled.min_.store(static_cast<uint64_t>(GetMin() * factor), std::memory_order_relaxed);
+        scaled.max_.store(static_cast<uint64_t>(GetMax() * factor), std::memory_order_relaxed);
+        scaled.sum_.store(static_cast<uint64_t>(sum_.load(std::memory_order_relaxed) * factor), std::memory_order_relaxed);
+    }
+    return scaled;
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) return value;
+    int shift = (63 - __builtin_clzll(value)) - (SUB_BUCKET_BITS - 1);
+    if (shift > MAX_SHIFT) return BUCKET_COUNT - 1;
+    return SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF + ((value >> shift) - SUB_BUCKET_HALF);
+}
+
+uint64_t LatencyHistogram::BucketValue(size_t index) {
+    if (index < SUB_BUCKET_COUNT) return index;
+    int shift = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_HALF + 1;
+    uint64_t sub_bucket = (index - SUB_BUCKET_COUNT) % SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+namespace {
+
+/**
+ * Global registry of the histograms owned by every recording thread.
+ */
+struct LatencyRegistry {
+    std::mutex mutex; ///< Guards the live list and the retired histograms.
+    std::vector<LatencyReport*> live; ///< Histograms of threads that are still running.
+    LatencyReport retired; ///< Samples of threads that have exited.
+};
+
+LatencyRegistry& GetRegistry() {
+    // intentionally leaked so that threads exiting during static destruction can still retire
+    static LatencyRegistry* registry = new LatencyRegistry();
+    return *registry;
+}
+
+/**
+ * Owner of a thread's histograms, registering them for the lifetime of the thread.
+ */
+class ThreadHistograms {
+public:
+    ThreadHistograms() : report_{std::make_unique<LatencyReport>()} {
+        LatencyRegistry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.live.push_back(report_.get());
+    }
+
+    ~ThreadHistograms() {
+        LatencyRegistry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (int stage = 0; stage < NUM_LATENCY_STAGES; ++stage) registry.retired[stage].Merge((*report_)[stage]);
+        registry.live.erase(std::find(registry.live.begin(), registry.live.end(), report_.get()));
+    }
+
+    LatencyReport& Get() {
+        return *report_;
+    }
+private:
+    std::unique_ptr<LatencyReport> report_;
+};
+
+thread_local ThreadHistograms thread_histograms;
+
+std::atomic<bool> dump_requested{false};
+
+void RequestDump(int) {
+    dump_requested.store(true, std::memory_order_relaxed);
+}
+
+}
+
+void LatencyRecorder::Record(LatencyStage stage, uint64_t ticks) {
+    thread_histograms.Get()[stage].Record(ticks);
+}
+
+LatencyReport LatencyRecorder::Snapshot() {
+    LatencyRegistry& registry = GetRegistry();
+    LatencyReport merged;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        merged = registry.retired;
+        for (LatencyReport* report : registry.live) {
+            for (int stage = 0; stage < NUM_LATENCY_STAGES; ++stage) merged[stage].Merge((*report)[stage]);
+        }
+    }
+
+    double nanos_per_tick = Clock::NanosPerTick();
+    for (auto& histogram : merged) histogram = histogram.Scaled(nanos_per_tick);
+    return merged;
+}
+
+void LatencyRecorder::Reset() {
+    LatencyRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    // best effort: a sample being recorded concurrently may survive the reset
+    for (auto& histogram : registry.retired) histogram.Reset();
+    for (LatencyReport* report : registry.live) {
+        for (auto& histogram : *report) histogram.Reset();
+    }
+}
+
+void LatencyRecorder::Dump(std::ostream& out) {
+    LatencyReport report = Snapshot();
+    out << std::left << std::setw(12) << "stage" << std::right
+        << std::setw(12) << "count" << std::setw(12) << "mean"
+        << std::setw(12) << "p50" << std::setw(12) << "p99"
+        << std::setw(12) << "p99.9" << std::setw(12) << "max" << " (ns)\n";
+    for (int stage = 0; stage < NUM_LATENCY_STAGES; ++stage) {
+        const LatencyHistogram& histogram = report[stage];
+        out << std::left << std::setw(12) << GetStageName(static_cast<LatencyStage>(stage)) << std::right
+            << std::setw(12) << histogram.GetCount()
+            << std::setw(12) << static_cast<uint64_t>(histogram.GetMean())
+            << std::setw(12) << histogram.GetValueAtPercentile(50)
+            << std::setw(12) << histogram.GetValueAtPercentile(99)
+            << std::setw(12) << histogram.GetValueAtPercentile(99.9)
+            << std::setw(12) << histogram.GetMax() << "\n";
+    }
+    out.flush();
+}
+
+void LatencyRecorder::DumpOnSignal(int signum) {
+    struct sigaction action = {};
+    action.sa_handler = RequestDump;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(signum, &action, nullptr) == -1) throw std::runtime_error("Failed to install latency dump handler");
+
+    // merging and printing are not async-signal-safe, so the handler only raises a flag
+    static std::once_flag watcher_started;
+    std::call_once(watcher_started, []() {
+        std::thread([]() {
+            while (true) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if (dump_requested.exchange(false, std::memory_order_relaxed)) Dump(std::cerr);
+            }
+        }).detach();
+    });
+}
+
+const char* LatencyRecorder::GetStageName(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::RECEIVE: return "receive";
+        case LatencyStage::DECODE: return "decode";
+        case LatencyStage::RISK_CHECK: return "risk_check";
+        case LatencyStage::LOCK_WAIT: return "lock_wait";
+        case LatencyStage::PLACE_ORDER: return "place_order";
+        case LatencyStage::REPLICATE: return "replicate";
+        case LatencyStage::ENCODE: return "encode";
+        case LatencyStage::SEND: return "send";
+        default: return "unknown";
+    }
+}
@@ -1,16 +1,51 @@
 #include "order.hpp"
+#include "order_table.hpp"
 
-Order::Order(OrderID order_id, std::string ticker, OrderPrice order_price, OrderQuantity order_quantity, OrderSide order_side, OrderType order_type)
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+/**
+ * Get the limit price of an order that takes any price: the whole opposite side crosses it.
+ */
+OrderPrice NoLimit(OrderSide side) {
+    return side == OrderSide::BID ? std::numeric_limits<OrderPrice>::max() : 0;
+}
+
+}
+
+Order::Order(OrderID order_id, std::string ticker, OrderPrice order_price, OrderQuantity order_quantity, OrderSide order_side, OrderType order_type, OrderPrice stop_price, OrderQuantity display_quantity, PegType peg_type, PriceOffset peg_offset, Timestamp expire_time)
     : created_at_{CurrentTime()}
     , id_{order_id}
     , ticker_{ticker}
-    , price_{order_price}
+    , price_{order_type != OrderType::MARKET ? order_price : NoLimit(order_side)}
     , quantity_{order_quantity}
     , filled_{0}
     , side_{order_side}
     , type_{order_type}
-    , status_{OrderStatus::OPEN} {
+    , status_{OrderStatus::OPEN}
+    , stop_price_{IsStop() ? stop_price : 0}
+    // showing all of it is no iceberg at all
+    , display_quantity_{display_quantity < order_quantity ? display_quantity : 0}
+    , visible_{display_quantity_}
+    , peg_type_{peg_type}
+    , peg_offset_{peg_type != PegType::NO_PEG ? peg_offset : 0}
+    , expire_time_{order_type == OrderType::GOOD_TIL_DATE ? expire_time : 0}
+    , owner_{NO_OWNER}
+    , self_trade_prevention_{SelfTradePrevention::NO_STP}
+    , table_{nullptr} {
     if (order_quantity == 0) throw std::invalid_argument("Attempting to create an order with no quantity");
+    if (IsStop() && stop_price == 0) throw std::invalid_argument("Attempting to create a stop order with no stop price");
+    if (order_type == OrderType::GOOD_TIL_DATE && expire_time == 0) {
+        throw std::invalid_argument("Attempting to create a good til date order with no expire time");
+    }
+    if (display_quantity && !CanRest() && order_type != OrderType::STOP_LIMIT) {
+        throw std::invalid_argument("Attempting to create an iceberg order that never rests");
+    }
+    if (IsPegged() && !CanRest()) {
+        throw std::invalid_argument("Attempting to create a pegged order that never rests");
+    }
 }
 
 OrderQuantity Order::GetRemaining() {
@@ -20,13 +55,69 @@ OrderQuantity Order::GetRemaining() {
 void Order::Fill(OrderQuantity amount) {
     if (amount > GetRemaining()) throw std::invalid_argument("Attempting to fill order more than capacity");
     filled_ += amount;
+    visible_ -= std::min(amount, visible_);
+    if (account_) {
+        int64_t signed_amount = side_ == OrderSide::BID ? static_cast<int64_t>(amount) : -static_cast<int64_t>(amount);
+        account_->position.fetch_add(signed_amount, std::memory_order_relaxed);
+    }
     if (IsFilled()) SetStatus(OrderStatus::CLOSED);
 }
 
+void Order::Reduce(OrderQuantity amount) {
+    if (amount > GetRemaining()) throw std::invalid_argument("Attempting to reduce order more than remaining");
+    quantity_ -= amount;
+    // an iceberg gives up its reserve before its shown tranche
+    visible_ = std::min(visible_, GetRemaining());
+    if (IsFilled()) SetStatus(OrderStatus::CANCELLED);
+}
+
 bool Order::IsFilled() {
     return GetRemaining() == 0;
 }
 
+bool Order::CanRest() {
+    return type_ == OrderType::GOOD_TIL_CANCELED || CanExpire();
+}
+
+bool Order::CanExpire() {
+    return type_ == OrderType::DAY || type_ == OrderType::GOOD_TIL_DATE;
+}
+
+bool Order::IsStop() {
+    return type_ == OrderType::STOP || type_ == OrderType::STOP_LIMIT;
+}
+
+void Order::Trigger() {
+    if (!IsStop()) throw std::invalid_argument("Attempting to trigger an order that is not a stop");
+    if (type_ == OrderType::STOP) {
+        // no limit: sweep the opposite side as deep as it takes
+        price_ = NoLimit(side_);
+        type_ = OrderType::IMMEDIATE_OR_CANCEL;
+    } else {
+        type_ = OrderType::GOOD_TIL_CANCELED;
+    }
+}
+
+bool Order::IsIceberg() {
+    return display_quantity_ != 0;
+}
+
+void Order::Replenish() {
+    if (IsIceberg()) visible_ = std::min(display_quantity_, GetRemaining());
+}
+
+OrderQuantity Order::GetVisible() {
+    return IsIceberg() ? visible_ : GetRemaining();
+}
+
+OrderQuantity Order::GetHidden() {
+    return GetRemaining() - GetVisible();
+}
+
+bool Order::IsPegged() {
+    return peg_type_ != PegType::NO_PEG;
+}
+
 Timestamp Order::GetCreatedAt() {
     return created_at_;
 }
@@ -63,9 +154,58 @@ OrderStatus Order::GetStatus() {
     return status_;
 }
 
+OrderPrice Order::GetStopPrice() {
+    return stop_price_;
+}
+
+OrderQuantity Order::GetDisplayQuantity() {
+    return display_quantity_;
+}
+
+PegType Order::GetPegType() {
+    return peg_type_;
+}
+
+PriceOffset Order::GetPegOffset() {
+    return peg_offset_;
+}
+
+Timestamp Order::GetExpireTime() {
+    return expire_time_;
+}
+
+OwnerID Order::GetOwner() {
+    return owner_;
+}
+
+SelfTradePrevention Order::GetSelfTradePrevention() {
+    return self_trade_prevention_;
+}
+
 void Order::SetStatus(OrderStatus status) {
     if (status == OrderStatus::OPEN) throw std::invalid_argument("Cannot reopen an order");
     if (status == OrderStatus::CLOSED && status_ != OrderStatus::OPEN) throw std::invalid_argument("Cannot close an order that is not open");
     if (status == OrderStatus::CANCELLED && status_ != OrderStatus::OPEN) throw std::invalid_argument("Cannot cancel an order that is not open");
+    if (status == OrderStatus::EXPIRED && status_ != OrderStatus::OPEN) throw std::invalid_argument("Cannot expire an order that is not open");
+    // however it closed, the order stops counting against its account
+    if (account_) account_->open_orders.fetch_sub(1, std::memory_order_relaxed);
     status_ = status;
+    // the order has left the book, and its slot only outlives it until another order needs it
+    if (table_) table_->Release(id_);
+}
+
+void Order::SetOwner(OwnerID owner, SelfTradePrevention self_trade_prevention) {
+    if (owner == NO_OWNER && self_trade_prevention != SelfTradePrevention::NO_STP) {
+        throw std::invalid_argument("Cannot prevent self-trades of an order without an owner");
+    }
+    owner_ = owner;
+    self_trade_prevention_ = self_trade_prevention;
+}
+
+void Order::SetAccount(std::shared_ptr<AccountRisk> account) {
+    account_ = std::move(account);
+}
+
+void Order::SetTable(OrderTable* table) {
+    table_ = table;
 }
\ No newline at end of file
@@ -1,104 +1,576 @@
 #include "order_book.hpp"
 
-bool OrderBook::PlaceOrder(std::shared_ptr<Order> order) {
-    // maybe return false instead?
-    if (orders_.count(order->GetID())) throw std::invalid_argument("Order with ID already exists in the book");
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+namespace {
+
+constexpr Timestamp NANOS_PER_DAY = 86'400'000'000'000;
+
+/**
+ * Get the side an incoming order on a side trades against.
+ */
+constexpr OrderSide Opposite(OrderSide side) {
+    return side == OrderSide::ASK ? OrderSide::BID : OrderSide::ASK;
+}
+
+/**
+ * Check whether one price is strictly better than another for orders resting on a side.
+ */
+template <OrderSide Side>
+constexpr bool Improves(OrderPrice a, OrderPrice b) {
+    if constexpr (Side == OrderSide::ASK) return a < b;
+    else return a > b;
+}
+
+/**
+ * Check whether an order resting on a side at a price trades with an incoming order's limit.
+ */
+template <OrderSide Side>
+constexpr bool Crosses(OrderPrice resting, OrderPrice limit) {
+    return !Improves<Side>(limit, resting);
+}
+
+}
+
+OrderBook::OrderBook(const BookCapacity& capacity)
+    : arena_{std::make_shared<Arena>(capacity.orders * BYTES_PER_ORDER + capacity.price_levels * BYTES_PER_LEVEL, capacity.page_size)}
+    , asks_(LevelMap::allocator_type(arena_, MemoryCategory::MEMORY_LEVELS))
+    , bids_(LevelMap::allocator_type(arena_, MemoryCategory::MEMORY_LEVELS))
+    , orders_(OrderIndex::allocator_type(arena_, MemoryCategory::MEMORY_INDEXES))
+    , best_asks_(decltype(best_asks_)::allocator_type(arena_, MemoryCategory::MEMORY_SETS))
+    , best_bids_(decltype(best_bids_)::allocator_type(arena_, MemoryCategory::MEMORY_SETS))
+    , buy_stops_(decltype(buy_stops_)::allocator_type(arena_, MemoryCategory::MEMORY_SETS))
+    , sell_stops_(decltype(sell_stops_)::allocator_type(arena_, MemoryCategory::MEMORY_SETS))
+    , stops_(OrderIndex::allocator_type(arena_, MemoryCategory::MEMORY_INDEXES))
+    , ask_pegs_(PegMap::allocator_type(arena_, MemoryCategory::MEMORY_LEVELS))
+    , bid_pegs_(PegMap::allocator_type(arena_, MemoryCategory::MEMORY_LEVELS))
+    , pegs_(PegIndex::allocator_type(arena_, MemoryCategory::MEMORY_INDEXES))
+    , timers_(CurrentTime(), TimerWheel::DEFAULT_TICK, arena_) {
+    // sized up front so the bucket arrays come out of the arena instead of growing on the hot path
+    orders_.reserve(capacity.orders);
+    asks_.reserve(capacity.price_levels);
+    bids_.reserve(capacity.price_levels);
+    best_asks_.reserve(capacity.price_levels);
+    best_bids_.reserve(capacity.price_levels);
+}
+
+template <OrderSide Side>
+OrderBook::LevelMap& OrderBook::Levels() {
+    if constexpr (Side == OrderSide::ASK) return asks_;
+    else return bids_;
+}
+
+template <OrderSide Side>
+auto& OrderBook::Best() {
+    if constexpr (Side == OrderSide::ASK) return best_asks_;
+    else return best_bids_;
+}
+
+template <OrderSide Side>
+OrderBook::PegMap& OrderBook::Pegs() {
+    if constexpr (Side == OrderSide::ASK) return ask_pegs_;
+    else return bid_pegs_;
+}
+
+template <OrderSide Side>
+bool OrderBook::CanFill(Order& order) {
+    constexpr OrderSide resting = Opposite(Side);
+    LevelMap& levels = Levels<resting>();
+    auto& ladder = Best<resting>();
+    OrderPrice limit = order.GetPrice();
+    Quantity needed = order.GetRemaining();
+
+    Quantity available = 0;
+    for (auto it = ladder.begin(); it != ladder.end() && Crosses<resting>(*it, limit); ++it) {
+        available += levels.find(*it)->second.GetTotalQuantity();
+        if (available >= needed) return true;
+    }
+    for (const ResolvedPeg& peg : ResolvePegs(resting)) {
+        if (Crosses<resting>(peg.price, limit)) available += peg.group->second.GetTotalQuantity();
+    }
+    return available >= needed;
+}
+
+template <OrderSide Side>
+void OrderBook::Fill(std::shared_ptr<Order>& order) {
+    constexpr OrderSide resting = Opposite(Side);
+    LevelMap& levels = Levels<resting>();
+    auto& ladder = Best<resting>();
+
+    // Forget resting orders as they are filled so they can no longer be cancelled
+    TradeHandler on_trade = [this](const Trade& trade) {
+        if (trade.resting_remaining == 0) {
+            orders_.erase(trade.resting_id);
+            timers_.Cancel(trade.resting_id);
+        }
+        last_price_.store(trade.price, std::memory_order_relaxed);
+        if (trade_handler_) trade_handler_(trade);
+    };
+    CancelHandler on_cancel = [this](OrderID id) {
+        orders_.erase(id);
+        timers_.Cancel(id);
+    };
+
+    // Pegs are priced once, against the book as the order found it
+    std::vector<ResolvedPeg> pegs = ResolvePegs(resting);
+    auto peg = pegs.begin();
+
+    OrderPrice limit = order->GetPrice();
+    auto it = ladder.begin();
+    while (order->GetStatus() == OrderStatus::OPEN) {
+        bool priced = it != ladder.end() && Crosses<resting>(*it, limit);
+        bool pegged = peg != pegs.end() && Crosses<resting>(peg->price, limit);
+        if (!priced && !pegged) break;
+        // limit orders go first at a price
+        if (!priced || (pegged && Improves<resting>(peg->price, *it))) {
+            FillPeg(Pegs<resting>(), *peg++, order);
+            continue;
+        }
+        PriceLevel& level = levels.find(*it)->second;
+        level.Fill(order, on_trade, on_cancel);
+        // a level left standing has stopped the order
+        if (level.IsEmpty()) ++it;
+    }
+    EraseLevels(levels, ladder, it);
+}
+
+template <OrderSide Side>
+void OrderBook::Rest(std::shared_ptr<Order>& order) {
+    GetLevel(Levels<Side>(), order->GetPrice()).Add(order);
+    orders_[order->GetID()] = {Side, order->GetPrice()};
+    Best<Side>().insert(order->GetPrice());
+    ScheduleExpiry(*order);
+}
 
+template <OrderSide Side, typename Policy>
+bool OrderBook::Match(std::shared_ptr<Order>& order) {
     // Fail if not possible to fill FoK
-    if (order->GetType() == OrderType::FILL_OR_KILL && !CanFill(order)) return false; 
+    if constexpr (Policy::ALL_OR_NONE) {
+        if (!CanFill<Side>(*order)) {
+            order->SetStatus(OrderStatus::CANCELLED);
+            return false;
+        }
+    }
     // Fill as much as we can
-    Fill(order);
-    // Kill FoK/IoC, don't add to book
-    if (order->GetType() == OrderType::FILL_OR_KILL || order->GetType() == OrderType::IMMEDIATE_OR_CANCEL) return true;
-    // Order is already filled, don't add to book
-    if (order->IsFilled()) return true;
-
-    // Add to book
-    std::unordered_map<OrderPrice, PriceLevel>& book = (order->GetSide() == OrderSide::ASK) ? asks_ : bids_;
-    book[order->GetPrice()].Add(order);
-    orders_[order->GetID()] = {order->GetSide(), order->GetPrice()};
-    
-    // these are both currently O(logn) operations, need to optimize
-    if (order->GetSide() == OrderSide::ASK) best_asks_.insert(order->GetPrice());
-    else best_bids_.insert(order->GetPrice());
+    Fill<Side>(order);
+    if constexpr (!Policy::RESTS) {
+        // Kill FoK/IoC/market, don't add to book
+        if (order->GetStatus() == OrderStatus::OPEN) order->SetStatus(OrderStatus::CANCELLED);
+    } else if (order->GetStatus() == OrderStatus::OPEN) {
+        // Not already filled, or cancelled by self-trade prevention
+        Rest<Side>(order);
+    }
     return true;
 }
 
-bool OrderBook::CancelOrder(OrderID id) {
+bool OrderBook::PlaceOrder(std::shared_ptr<Order> order) {
     // maybe return false instead?
-    if (!orders_.count(id)) throw std::invalid_argument("Order with ID does not exist in the book");
-
-    const auto& [side, price] = orders_[id];
-    std::unordered_map<OrderPrice, PriceLevel>& book = (side == OrderSide::ASK) ? asks_ : bids_;
-    book[price].Remove(id);
-    if (book[price].IsEmpty()) {
-        book.erase(price);
-        // these are both currently O(logn) operations, need to optimize
+    if (HasOrder(order->GetID())) throw std::invalid_argument("Order with ID already exists in the book");
+
+    bool placed = true;
+    if (order->IsStop()) {
+        if (order->GetSide() == OrderSide::BID) buy_stops_.emplace(order->GetStopPrice(), order);
+        else sell_stops_.emplace(order->GetStopPrice(), order);
+        stops_[order->GetID()] = {order->GetSide(), order->GetStopPrice()};
+    } else {
+        placed = Execute(order);
+    }
+    TriggerStops();
+    return placed;
+}
+
+bool OrderBook::Execute(std::shared_ptr<Order> order) {
+    // pegs never take liquidity, they only rest until an incoming order trades with them
+    if (order->IsPegged()) {
+        PegKey key{order->GetPegType(), order->GetPegOffset()};
+        PegMap& pegs = (order->GetSide() == OrderSide::ASK) ? ask_pegs_ : bid_pegs_;
+        pegs.try_emplace(key, arena_).first->second.Add(order);
+        pegs_[order->GetID()] = {order->GetSide(), key};
+        ScheduleExpiry(*order);
+        return true;
+    }
+
+    if (phase_ == TradingPhase::AUCTION) {
+        // Orders only rest until the uncross, so there is nothing for FoK/IoC to match against
+        if (!order->CanRest()) {
+            order->SetStatus(OrderStatus::CANCELLED);
+            return false;
+        }
+        if (order->GetSide() == OrderSide::ASK) Rest<OrderSide::ASK>(order);
+        else Rest<OrderSide::BID>(order);
+        return true;
+    }
+
+    // One kernel per side and order type, so the books, comparisons and policy are fixed at compile
+    // time. Stops are placed as the type they trigger into and never get here as stops.
+    static constexpr Kernel KERNELS[2][OrderType::MARKET + 1] = {
+        {
+            &OrderBook::Match<OrderSide::BID, RestPolicy>, // GOOD_TIL_CANCELED
+            &OrderBook::Match<OrderSide::BID, AllOrNonePolicy>, // FILL_OR_KILL
+            &OrderBook::Match<OrderSide::BID, ImmediatePolicy>, // IMMEDIATE_OR_CANCEL
+            &OrderBook::Match<OrderSide::BID, ImmediatePolicy>, // STOP
+            &OrderBook::Match<OrderSide::BID, RestPolicy>, // STOP_LIMIT
+            &OrderBook::Match<OrderSide::BID, RestPolicy>, // DAY
+            &OrderBook::Match<OrderSide::BID, RestPolicy>, // GOOD_TIL_DATE
+            &OrderBook::Match<OrderSide::BID, ImmediatePolicy>, // MARKET
+        },
+        {
+            &OrderBook::Match<OrderSide::ASK, RestPolicy>,
+            &OrderBook::Match<OrderSide::ASK, AllOrNonePolicy>,
+            &OrderBook::Match<OrderSide::ASK, ImmediatePolicy>,
+            &OrderBook::Match<OrderSide::ASK, ImmediatePolicy>,
+            &OrderBook::Match<OrderSide::ASK, RestPolicy>,
+            &OrderBook::Match<OrderSide::ASK, RestPolicy>,
+            &OrderBook::Match<OrderSide::ASK, RestPolicy>,
+            &OrderBook::Match<OrderSide::ASK, ImmediatePolicy>,
+        },
+    };
+    return (this->*KERNELS[order->GetSide()][order->GetType()])(order);
+}
+
+bool OrderBook::CancelOrder(OrderID id) {
+    // resting limit orders are the common case, so they are looked for first and only once
+    auto resting = orders_.find(id);
+    if (resting == orders_.end()) {
+        if (CancelStop(id)) return true;
+        timers_.Cancel(id);
+        if (CancelPeg(id)) return true;
+        // maybe return false instead?
+        throw std::invalid_argument("Order with ID does not exist in the book");
+    }
+    timers_.Cancel(id);
+
+    auto [side, price] = resting->second;
+    orders_.erase(resting);
+    LevelMap& book = (side == OrderSide::ASK) ? asks_ : bids_;
+    auto level = book.find(price);
+    level->second.Remove(id);
+    if (level->second.IsEmpty()) {
+        book.erase(level);
         if (side == OrderSide::ASK) best_asks_.erase(price);
         else best_bids_.erase(price);
     }
     // currently setting order cancel status in exchange, maybe set here?
-    orders_.erase(id);
     return true;
 }
 
 bool OrderBook::CanFill(std::shared_ptr<Order> order) {
-    Quantity available = 0;
-    if (order->GetSide() == OrderSide::ASK) {
-        for (
-            auto it = best_bids_.begin(); 
-            it != best_bids_.end() && *it >= order->GetPrice(); 
-            ++it
-        ) {
-            available += bids_[*it].GetTotalQuantity();
-            if (available >= order->GetRemaining()) return true;
-        }
+    return order->GetSide() == OrderSide::ASK ? CanFill<OrderSide::ASK>(*order) : CanFill<OrderSide::BID>(*order);
+}
+
+void OrderBook::Fill(std::shared_ptr<Order> order) {
+    if (order->GetSide() == OrderSide::ASK) Fill<OrderSide::ASK>(order);
+    else Fill<OrderSide::BID>(order);
+}
+
+bool OrderBook::HasOrder(OrderID order_id) {
+    return orders_.count(order_id) || stops_.count(order_id) || pegs_.count(order_id);
+}
+
+void OrderBook::SetTradeHandler(TradeHandler handler) {
+    trade_handler_ = std::move(handler);
+}
+
+void OrderBook::StartAuction() {
+    phase_ = TradingPhase::AUCTION;
+}
+
+void OrderBook::SetSessionEnd(Timestamp session_end) {
+    session_end_ = session_end;
+}
+
+void OrderBook::ExpireOrders(Timestamp now, std::vector<OrderID>& expired) {
+    size_t first = expired.size();
+    timers_.Advance(now, expired);
+    // timers leave with their orders, so every order due is still in the book
+    for (size_t i = first; i < expired.size(); ++i) CancelOrder(expired[i]);
+}
+
+Timestamp OrderBook::GetNextExpiry() {
+    return timers_.GetNextDue();
+}
+
+AuctionResult OrderBook::GetEquilibrium(OrderPrice reference_price) {
+    if (best_bids_.empty() || best_asks_.empty() || *best_bids_.begin() < *best_asks_.begin()) return {};
+    OrderPrice lowest = *best_asks_.begin();
+    OrderPrice highest = *best_bids_.begin();
+
+    // Crossing bid levels from lowest to highest price, with the demand at the lowest price
+    std::vector<std::pair<OrderPrice, Quantity>> bid_depth;
+    Quantity demand = 0;
+    for (auto it = best_bids_.begin(); it != best_bids_.end() && *it >= lowest; ++it) {
+        bid_depth.emplace_back(*it, bids_[*it].GetTotalQuantity());
+        demand += bid_depth.back().second;
+    }
+    std::reverse(bid_depth.begin(), bid_depth.end());
+
+    // Single ascending pass over every price in the crossed range: supply at a price is all asks
+    // at or below it and demand is all bids at or above it
+    struct Candidate {
+        OrderPrice price;
+        Quantity volume;
+        int64_t surplus; ///< Demand minus supply.
+    };
+    std::vector<Candidate> candidates;
+    Quantity supply = 0;
+    auto bid = bid_depth.begin();
+    auto ask = best_asks_.begin();
+    while (bid != bid_depth.end() || (ask != best_asks_.end() && *ask <= highest)) {
+        OrderPrice price = bid != bid_depth.end() ? bid->first : highest;
+        if (ask != best_asks_.end() && *ask <= highest) price = std::min(price, *ask);
+
+        if (ask != best_asks_.end() && *ask == price) supply += asks_[*ask++].GetTotalQuantity();
+        candidates.push_back({price, std::min(demand, supply), static_cast<int64_t>(demand) - static_cast<int64_t>(supply)});
+        if (bid != bid_depth.end() && bid->first == price) demand -= (bid++)->second;
+    }
+
+    // Maximum volume, then minimum surplus
+    Quantity volume = 0;
+    for (const auto& candidate : candidates) volume = std::max(volume, candidate.volume);
+    uint64_t surplus = UINT64_MAX;
+    for (const auto& candidate : candidates) {
+        if (candidate.volume == volume) surplus = std::min<uint64_t>(surplus, std::abs(candidate.surplus));
+    }
+    std::vector<Candidate> tied;
+    for (const auto& candidate : candidates) {
+        if (candidate.volume == volume && static_cast<uint64_t>(std::abs(candidate.surplus)) == surplus) tied.push_back(candidate);
+    }
+
+    // Market pressure, then proximity to the reference price
+    const Candidate* chosen;
+    if (std::all_of(tied.begin(), tied.end(), [](const Candidate& c) { return c.surplus > 0; })) {
+        chosen = &tied.back();
+    } else if (std::all_of(tied.begin(), tied.end(), [](const Candidate& c) { return c.surplus < 0; })) {
+        chosen = &tied.front();
     } else {
-        for (
-            auto it = best_asks_.begin(); 
-            it != best_asks_.end() && *it <= order->GetPrice(); 
-            ++it
-        ) {
-            available += asks_[*it].GetTotalQuantity();
-            if (available >= order->GetRemaining()) return true;
+        if (!reference_price) reference_price = tied.front().price + (tied.back().price - tied.front().price) / 2;
+        chosen = &*std::min_element(tied.begin(), tied.end(), [reference_price](const Candidate& a, const Candidate& b) {
+            return std::abs(static_cast<int64_t>(a.price) - reference_price) < std::abs(static_cast<int64_t>(b.price) - reference_price);
+        });
+    }
+    return {chosen->price, chosen->volume, static_cast<Quantity>(std::abs(chosen->surplus)), chosen->surplus < 0 ? OrderSide::ASK : OrderSide::BID};
+}
+
+AuctionResult OrderBook::Uncross(OrderPrice reference_price) {
+    AuctionResult result = GetEquilibrium(reference_price);
+    phase_ = TradingPhase::CONTINUOUS;
+
+    // Pair orders off in price-time priority on both sides; the equilibrium guarantees that
+    // enough quantity sits at or through the price on each side to execute the whole volume
+    Quantity remaining = result.volume;
+    auto bid_it = best_bids_.begin();
+    auto ask_it = best_asks_.begin();
+    while (remaining) {
+        PriceLevel& bid_level = bids_[*bid_it];
+        PriceLevel& ask_level = asks_[*ask_it];
+        std::shared_ptr<Order> bid = bid_level.Front();
+        std::shared_ptr<Order> ask = ask_level.Front();
+        // icebergs trade tranche by tranche, re-queueing behind their level in between
+        OrderQuantity fill_amount = std::min<Quantity>({bid->GetVisible(), ask->GetVisible(), remaining});
+        bid_level.FillFront(fill_amount);
+        ask_level.FillFront(fill_amount);
+        remaining -= fill_amount;
+        if (trade_handler_) trade_handler_({bid->GetID(), ask->GetID(), result.price, fill_amount, ask->GetRemaining(), OrderSide::BID});
+
+        for (const std::shared_ptr<Order>& order : {bid, ask}) {
+            if (!order->IsFilled()) continue;
+            orders_.erase(order->GetID());
+            timers_.Cancel(order->GetID());
+        }
+        if (bid_level.IsEmpty()) {
+            bids_.erase(*bid_it);
+            bid_it = best_bids_.erase(bid_it);
+        }
+        if (ask_level.IsEmpty()) {
+            asks_.erase(*ask_it);
+            ask_it = best_asks_.erase(ask_it);
         }
     }
-    return available >= order->GetRemaining();
+
+    if (result.volume) {
+        last_price_.store(result.price, std::memory_order_relaxed);
+        TriggerStops();
+    }
+    return result;
 }
 
-void OrderBook::Fill(std::shared_ptr<Order> order) {
-    // Maybe combine with CanFill to avoid repeated code
-    if (order->GetSide() == OrderSide::ASK) {
-        auto it = best_bids_.begin(); 
-        while (
-            it != best_bids_.end() && 
-            *it >= order->GetPrice() && 
-            !order->IsFilled()
-        ) {
-            bids_[*it].Fill(order);
-            if (bids_[*it].IsEmpty()) {
-                bids_.erase(*it);
-                // O(logn) operation, need to optimize
-                it = best_bids_.erase(it);
-            } else {
-                ++it;
-            }
+TradingPhase OrderBook::GetPhase() {
+    return phase_;
+}
+
+OrderPrice OrderBook::GetPegPrice(OrderID order_id) {
+    auto peg = pegs_.find(order_id);
+    if (peg == pegs_.end()) throw std::invalid_argument("Pegged order with ID does not exist in the book");
+    const auto& [side, key] = peg->second;
+    return ResolvePeg(side, key);
+}
+
+size_t OrderBook::GetLevels(OrderSide side, BookLevel* levels, size_t depth) {
+    return side == OrderSide::ASK ? CopyLevels(asks_, best_asks_, levels, depth) : CopyLevels(bids_, best_bids_, levels, depth);
+}
+
+OrderPrice OrderBook::GetLastPrice() {
+    return last_price_.load(std::memory_order_relaxed);
+}
+
+const std::shared_ptr<Arena>& OrderBook::GetArena() {
+    return arena_;
+}
+
+ArenaStats OrderBook::GetArenaStats() {
+    return arena_->GetStats();
+}
+
+MemoryUsage OrderBook::GetMemoryUsage() {
+    MemoryUsage usage;
+    usage.bytes = arena_->GetStats().category_bytes;
+    usage.resting_orders = orders_.size() + stops_.size() + pegs_.size();
+    usage.price_levels = asks_.size() + bids_.size() + ask_pegs_.size() + bid_pegs_.size();
+    SummarizeMemoryUsage(usage);
+    return usage;
+}
+
+PriceLevel& OrderBook::GetLevel(LevelMap& book, OrderPrice price) {
+    return book.try_emplace(price, arena_).first->second;
+}
+
+template <typename Ladder>
+void OrderBook::EraseLevels(LevelMap& book, Ladder& best, typename Ladder::iterator end) {
+    for (auto it = best.begin(); it != end; ++it) book.erase(*it);
+    best.erase(best.begin(), end);
+}
+
+template <typename Ladder>
+size_t OrderBook::CopyLevels(LevelMap& book, const Ladder& best, BookLevel* levels, size_t depth) {
+    size_t count = 0;
+    for (auto it = best.begin(); it != best.end() && count < depth; ++it, ++count) {
+        PriceLevel& level = book.find(*it)->second;
+        levels[count] = {*it, level.GetTotalQuantity(), level.GetDisplayedQuantity()};
+    }
+    return count;
+}
+
+void OrderBook::ScheduleExpiry(Order& order) {
+    if (!order.CanExpire()) return;
+    Timestamp expiry = order.GetExpireTime();
+    if (order.GetType() == OrderType::DAY) {
+        expiry = session_end_ ? session_end_ : (order.GetCreatedAt() / NANOS_PER_DAY + 1) * NANOS_PER_DAY;
+    }
+    timers_.Schedule(order.GetID(), expiry);
+}
+
+void OrderBook::TriggerStops() {
+    std::vector<std::shared_ptr<Order>> triggered;
+    // stops only rest during an auction; the uncross triggers whatever it crossed
+    OrderPrice last_price;
+    while (phase_ == TradingPhase::CONTINUOUS && (last_price = GetLastPrice())) {
+        // buy stops at or below the last price, and sell stops at or above it, are each a prefix of their index
+        auto buys_end = buy_stops_.upper_bound(last_price);
+        auto sells_end = sell_stops_.upper_bound(last_price);
+        if (buys_end == buy_stops_.begin() && sells_end == sell_stops_.begin()) return;
+
+        for (auto it = buy_stops_.begin(); it != buys_end; ++it) triggered.push_back(it->second);
+        for (auto it = sell_stops_.begin(); it != sells_end; ++it) triggered.push_back(it->second);
+        buy_stops_.erase(buy_stops_.begin(), buys_end);
+        sell_stops_.erase(sell_stops_.begin(), sells_end);
+
+        for (std::shared_ptr<Order>& order : triggered) {
+            stops_.erase(order->GetID());
+            order->Trigger();
+            Execute(order);
         }
-    } else {
-        auto it = best_asks_.begin(); 
-        while (
-            it != best_asks_.end() && 
-            *it <= order->GetPrice() && 
-            !order->IsFilled()
-        ) {
-            asks_[*it].Fill(order);
-            if (asks_[*it].IsEmpty()) {
-                asks_.erase(*it);
-                // O(logn) operation, need to optimize
-                it = best_asks_.erase(it);
-            } else {
-                ++it;
+        triggered.clear();
+    }
+}
+
+bool OrderBook::CancelStop(OrderID id) {
+    auto stop = stops_.find(id);
+    if (stop == stops_.end()) return false;
+    const auto& [side, stop_price] = stop->second;
+
+    // stops sharing a stop price are few next to the whole index
+    auto erase = [id](auto& index, OrderPrice price) {
+        auto [begin, end] = index.equal_range(price);
+        for (auto it = begin; it != end; ++it) {
+            if (it->second->GetID() == id) {
+                index.erase(it);
+                return;
             }
         }
+    };
+    if (side == OrderSide::BID) erase(buy_stops_, stop_price);
+    else erase(sell_stops_, stop_price);
+    stops_.erase(stop);
+    return true;
+}
+
+OrderPrice OrderBook::ResolvePeg(OrderSide side, const PegKey& key) {
+    const auto& [type, offset] = key;
+    OrderPrice best_bid = best_bids_.empty() ? 0 : *best_bids_.begin();
+    OrderPrice best_ask = best_asks_.empty() ? 0 : *best_asks_.begin();
+
+    OrderPrice reference = 0;
+    if (type == PegType::PRIMARY_PEG) reference = side == OrderSide::BID ? best_bid : best_ask;
+    else if (type == PegType::MARKET_PEG) reference = side == OrderSide::BID ? best_ask : best_bid;
+    else if (best_bid && best_ask) {
+        // an odd spread rounds away from the opposite side
+        OrderPrice half_spread = (best_ask - best_bid) / 2;
+        reference = side == OrderSide::BID ? best_bid + half_spread : best_ask - half_spread;
+    }
+    if (!reference) return 0;
+
+    int64_t price = static_cast<int64_t>(reference) + offset;
+    if (side == OrderSide::BID && best_ask) price = std::min<int64_t>(price, best_ask - 1);
+    if (side == OrderSide::ASK && best_bid) price = std::max<int64_t>(price, best_bid + 1);
+    if (price <= 0 || price > std::numeric_limits<OrderPrice>::max()) return 0;
+    return static_cast<OrderPrice>(price);
+}
+
+std::vector<OrderBook::ResolvedPeg> OrderBook::ResolvePegs(OrderSide side) {
+    PegMap& pegs = (side == OrderSide::ASK) ? ask_pegs_ : bid_pegs_;
+    std::vector<ResolvedPeg> resolved;
+    // one price per group, however many orders it holds
+    for (auto it = pegs.begin(); it != pegs.end(); ++it) {
+        OrderPrice price = ResolvePeg(side, it->first);
+        if (price) resolved.push_back({price, it});
     }
-}
\ No newline at end of file
+    std::stable_sort(resolved.begin(), resolved.end(), [side](const ResolvedPeg& a, const ResolvedPeg& b) {
+        return side == OrderSide::ASK ? a.price < b.price : a.price > b.price;
+    });
+    return resolved;
+}
+
+void OrderBook::FillPeg(PegMap& pegs, const ResolvedPeg& peg, std::shared_ptr<Order>& order) {
+    TradeHandler on_trade = [this, &peg](const Trade& trade) {
+        if (trade.resting_remaining == 0) {
+            pegs_.erase(trade.resting_id);
+            timers_.Cancel(trade.resting_id);
+        }
+        // resting orders report their own price, which a pegged order does not trade at
+        Trade priced = trade;
+        priced.price = peg.price;
+        last_price_.store(priced.price, std::memory_order_relaxed);
+        if (trade_handler_) trade_handler_(priced);
+    };
+    peg.group->second.Fill(order, on_trade, [this](OrderID id) {
+        pegs_.erase(id);
+        timers_.Cancel(id);
+    });
+    if (peg.group->second.IsEmpty()) pegs.erase(peg.group);
+}
+
+bool OrderBook::CancelPeg(OrderID id) {
+    auto peg = pegs_.find(id);
+    if (peg == pegs_.end()) return false;
+    const auto& [side, key] = peg->second;
+
+    PegMap& pegs = (side == OrderSide::ASK) ? ask_pegs_ : bid_pegs_;
+    auto group = pegs.find(key);
+    group->second.Remove(id);
+    if (group->second.IsEmpty()) pegs.erase(group);
+    pegs_.erase(peg);
+    return true;
+}
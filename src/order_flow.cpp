@@ -0,0 +1,208 @@
+#include "order_flow.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include "work_stealing_pool.hpp"
+
+OrderFlow::OrderFlow(const FlowParams& params, uint32_t stream)
+    : params_{params}, random_{params.seed ^ (0x9E3779B97F4A7C15ULL * (stream + 1))}, time_{0}, excitation_{0},
+      next_id_{(static_cast<OrderID>(stream) << STREAM_SHIFT) | 1},
+      floor_{params.spread + params.depth + params.volatility + 1},
+      reference_(params.instruments, std::max(params.start_price, floor_)), resting_(params.instruments),
+      quotes_(2 * static_cast<size_t>(params.market_makers) * params.instruments, 0) {
+    if (!params.instruments) throw std::invalid_argument("Order flow needs instruments");
+    if (!params.max_quantity) throw std::invalid_argument("Order flow needs a maximum quantity");
+    if (!(params.rate > 0)) throw std::invalid_argument("Order flow needs a positive rate");
+    if (!(params.maker_share >= 0 && params.maker_share <= 1) || !(params.cancel_ratio >= 0 && params.cancel_ratio <= 1)
+        || !(params.market_ratio >= 0 && params.market_ratio <= 1)) {
+        throw std::invalid_argument("Order flow shares must be between 0 and 1");
+    }
+    if (params.maker_share > 0 && !params.market_makers) throw std::invalid_argument("Order flow gives events to no market makers");
+    if (params.arrival == ArrivalProcess::ARRIVAL_HAWKES && (!(params.excitation >= 0 && params.excitation < 1) || !(params.decay > 0))) {
+        // a branching ratio of 1 or more makes the process explode
+        throw std::invalid_argument("Hawkes order flow needs an excitation in [0, 1) and a positive decay");
+    }
+    if (stream >> (64 - STREAM_SHIFT)) throw std::invalid_argument("Order flow stream out of range");
+}
+
+FlowEvent OrderFlow::Next() {
+    if (pending_.empty()) {
+        Arrive();
+        uint32_t instrument = random_() % params_.instruments;
+        int64_t move = static_cast<int64_t>(random_() % (2 * static_cast<uint64_t>(params_.volatility) + 1)) - params_.volatility;
+        OrderPrice price = reference_[instrument] = std::max<int64_t>(floor_, reference_[instrument] + move);
+        OrderPrice half = params_.spread / 2;
+
+        if (Uniform() < params_.maker_share) {
+            OrderID* quote = &quotes_[2 * (static_cast<size_t>(random_() % params_.market_makers) * params_.instruments + instrument)];
+            if (quote[0]) Cancel(instrument, quote[0]);
+            if (quote[1]) Cancel(instrument, quote[1]);
+            quote[0] = next_id_;
+            Place(instrument, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, price - half);
+            quote[1] = next_id_;
+            Place(instrument, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, price + (params_.spread - half));
+        } else if (!resting_[instrument].empty() && Uniform() < params_.cancel_ratio) {
+            std::vector<OrderID>& orders = resting_[instrument];
+            size_t pick = random_() % orders.size();
+            Cancel(instrument, orders[pick]);
+            orders[pick] = orders.back();
+            orders.pop_back();
+        } else {
+            bool buy = random_() & 1;
+            if (Uniform() < params_.market_ratio) {
+                OrderPrice through = params_.spread + params_.depth;
+                Place(instrument, buy ? OrderSide::BID : OrderSide::ASK, OrderType::IMMEDIATE_OR_CANCEL,
+                    buy ? price + through : price - through);
+            } else {
+                OrderPrice distance;
+                if (params_.price_distribution == PriceDistribution::PRICE_UNIFORM) {
+                    distance = random_() % (static_cast<uint64_t>(params_.depth) + 1);
+                } else {
+                    // redrawing past the depth keeps the shape, which clamping would pile up at the depth
+                    double mean = std::max(params_.depth / 4.0, 0.5);
+                    double draw;
+                    do draw = -mean * std::log1p(-Uniform());
+                    while (draw >= params_.depth + 1.0);
+                    distance = static_cast<OrderPrice>(draw);
+                }
+                resting_[instrument].push_back(next_id_);
+                Place(instrument, buy ? OrderSide::BID : OrderSide::ASK, OrderType::GOOD_TIL_CANCELED,
+                    buy ? price - half - distance : price + (params_.spread - half) + distance);
+            }
+        }
+        std::reverse(pending_.begin(), pending_.end());
+    }
+
+    FlowEvent event{static_cast<Timestamp>(time_ * 1e9), pending_.back()};
+    pending_.pop_back();
+    return event;
+}
+
+void OrderFlow::Follow(uint32_t instrument, OrderPrice price) {
+    if (price && instrument < reference_.size()) reference_[instrument] = std::max(price, floor_);
+}
+
+std::vector<std::vector<FlowEvent>> OrderFlow::Generate(const FlowParams& params, uint32_t streams, size_t events,
+    unsigned threads) {
+    // validate once up front rather than in whichever worker gets there first
+    OrderFlow check(params, streams ? streams - 1 : 0);
+    std::vector<std::vector<FlowEvent>> flows(streams);
+    WorkStealingPool pool(threads);
+    pool.Run(streams, [&params, &flows, events](size_t stream, unsigned) {
+        OrderFlow flow(params, static_cast<uint32_t>(stream));
+        std::vector<FlowEvent>& out = flows[stream];
+        out.resize(events);
+        for (auto& event : out) event = flow.Next();
+    });
+    return flows;
+}
+
+FlowStats OrderFlow::RunBooks(OrderFlow& flow, std::vector<std::unique_ptr<OrderBook>>& books, size_t events) {
+    if (books.size() < flow.params_.instruments) throw std::invalid_argument("Order flow needs a book per instrument");
+    std::vector<std::string> tickers;
+    for (uint32_t instrument = 0; instrument < flow.params_.instruments; ++instrument) tickers.push_back(GetTicker(instrument));
+
+    FlowStats stats;
+    uint64_t start = CurrentTime();
+    for (size_t i = 0; i < events; ++i) {
+        const ReplayCommand command = flow.Next().command;
+        OrderBook& book = *books[command.instrument];
+        if (command.action == ReplayAction::REPLAY_NEW) {
+            ++stats.orders;
+            auto order = std::make_shared<Order>(command.order_id, tickers[command.instrument], command.price, command.quantity,
+                static_cast<OrderSide>(command.side), static_cast<OrderType>(command.type));
+            if (!book.PlaceOrder(order)) ++stats.rejected;
+        } else {
+            ++stats.cancels;
+            // the book throws on orders it does not hold, which filled ones no longer are
+            if (book.HasOrder(command.order_id)) book.CancelOrder(command.order_id);
+            else ++stats.rejected;
+        }
+        flow.Follow(command.instrument, book.GetLastPrice());
+    }
+    stats.events = events;
+    stats.seconds = (CurrentTime() - start) / 1e9;
+    return stats;
+}
+
+FlowStats OrderFlow::RunClient(OrderFlow& flow, Client& client, const std::vector<std::string>& tickers, size_t events,
+    bool paced, LatencyHistogram* latencies) {
+    if (tickers.size() < flow.params_.instruments) throw std::invalid_argument("Order flow needs a ticker per instrument");
+
+    // the exchange numbers orders itself, so resting orders are cancelled by the ID it acked
+    std::unordered_map<OrderID, OrderID> exchange_ids;
+    FlowStats stats;
+    uint64_t start = CurrentTime();
+    for (size_t i = 0; i < events; ++i) {
+        FlowEvent event = flow.Next();
+        const ReplayCommand& command = event.command;
+        if (paced) {
+            Timestamp due = start + event.time;
+            for (Timestamp now = CurrentTime(); now < due; now = CurrentTime()) {
+                // sleeping overshoots by tens of microseconds, so only the last stretch is spun
+                if (due - now > 100000) std::this_thread::sleep_for(std::chrono::nanoseconds(due - now - 100000));
+            }
+        }
+
+        uint64_t sent = CurrentTime();
+        if (command.action == ReplayAction::REPLAY_NEW) {
+            ++stats.orders;
+            OrderType type = static_cast<OrderType>(command.type);
+            if (!client.PlaceOrder(tickers[command.instrument], static_cast<OrderSide>(command.side), type, command.price,
+                command.quantity)) {
+                ++stats.rejected;
+            } else if (type == OrderType::GOOD_TIL_CANCELED) {
+                exchange_ids.emplace(command.order_id, client.GetLastOrderID());
+            }
+        } else {
+            ++stats.cancels;
+            auto it = exchange_ids.find(command.order_id);
+            if (it == exchange_ids.end() || !client.CancelOrder(it->second)) ++stats.rejected;
+            if (it != exchange_ids.end()) exchange_ids.erase(it);
+        }
+        if (latencies) latencies->Record(CurrentTime() - sent);
+    }
+    stats.events = events;
+    stats.seconds = (CurrentTime() - start) / 1e9;
+    return stats;
+}
+
+std::string OrderFlow::GetTicker(uint32_t instrument) {
+    return "F" + std::to_string(instrument);
+}
+
+void OrderFlow::Arrive() {
+    if (params_.arrival == ArrivalProcess::ARRIVAL_POISSON) {
+        time_ -= std::log1p(-Uniform()) / params_.rate;
+        return;
+    }
+    // Ogata thinning: the intensity only decays between events, so its current value bounds it
+    // until the next candidate, which is kept with the ratio of the true intensity to the bound
+    for (;;) {
+        double bound = params_.rate + excitation_;
+        double wait = -std::log1p(-Uniform()) / bound;
+        time_ += wait;
+        excitation_ *= std::exp(-params_.decay * wait);
+        if (Uniform() * bound <= params_.rate + excitation_) break;
+    }
+    excitation_ += params_.excitation * params_.decay;
+}
+
+double OrderFlow::Uniform() {
+    return (random_() >> 11) * 0x1.0p-53;
+}
+
+void OrderFlow::Place(uint32_t instrument, OrderSide side, OrderType type, OrderPrice price) {
+    OrderQuantity quantity = 1 + random_() % params_.max_quantity;
+    pending_.push_back({ReplayAction::REPLAY_NEW, static_cast<uint8_t>(side), static_cast<uint8_t>(type), 0, instrument,
+        next_id_++, price, quantity});
+}
+
+void OrderFlow::Cancel(uint32_t instrument, OrderID id) {
+    pending_.push_back({ReplayAction::REPLAY_CANCEL, 0, 0, 0, instrument, id, 0, 0});
+}
@@ -0,0 +1,61 @@
+#include "order_table.hpp"
+
+#include <stdexcept>
+
+OrderTable::OrderTable(InstrumentID instrument, size_t capacity) : instrument_{instrument}, next_slot_{0} {
+    slots_.reserve(capacity);
+}
+
+OrderID OrderTable::Reserve() {
+    std::lock_guard<std::mutex> lock(reserve_mutex_);
+    if (!free_.empty()) {
+        FreeSlot free = free_.front();
+        free_.pop_front();
+        return MakeID(free.generation, free.slot);
+    }
+    if (next_slot_ >> SLOT_BITS) throw std::runtime_error("Order table is full");
+    return MakeID(0, next_slot_++);
+}
+
+void OrderTable::Release(OrderID id) {
+    std::lock_guard<std::mutex> lock(reserve_mutex_);
+    // the generation wraps, by which time the old ID is long forgotten
+    free_.push_back({static_cast<uint32_t>(id), static_cast<uint16_t>((id >> SLOT_BITS) + 1)});
+}
+
+void OrderTable::Store(const std::shared_ptr<Order>& order) {
+    Put(order);
+    order->SetTable(this);
+}
+
+void OrderTable::Restore(const std::shared_ptr<Order>& order) {
+    if (GetInstrument(order->GetID()) != instrument_) throw std::invalid_argument("Order ID belongs to another instrument");
+    Put(order);
+    std::lock_guard<std::mutex> lock(reserve_mutex_);
+    uint32_t slot = static_cast<uint32_t>(order->GetID());
+    if (slot >= next_slot_) next_slot_ = static_cast<uint64_t>(slot) + 1;
+}
+
+std::shared_ptr<Order> OrderTable::Find(OrderID id) {
+    uint32_t slot = static_cast<uint32_t>(id);
+    if (GetInstrument(id) != instrument_ || slot >= slots_.size()) return nullptr;
+    const std::shared_ptr<Order>& order = slots_[slot];
+    // an older or newer generation of the slot is another order
+    return order && order->GetID() == id ? order : nullptr;
+}
+
+size_t OrderTable::GetFootprint() {
+    std::lock_guard<std::mutex> lock(reserve_mutex_);
+    return slots_.capacity() * sizeof(std::shared_ptr<Order>) + free_.size() * sizeof(FreeSlot);
+}
+
+OrderID OrderTable::MakeID(uint16_t generation, uint32_t slot) {
+    return static_cast<OrderID>(instrument_) << (SLOT_BITS + GENERATION_BITS) | static_cast<OrderID>(generation) << SLOT_BITS | slot;
+}
+
+void OrderTable::Put(const std::shared_ptr<Order>& order) {
+    uint32_t slot = static_cast<uint32_t>(order->GetID());
+    // reservations complete out of order, so slots are filled in as they come
+    if (slot >= slots_.size()) slots_.resize(slot + 1);
+    slots_[slot] = order;
+}
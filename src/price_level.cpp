@@ -1,21 +1,43 @@
 #include "price_level.hpp"
 
-PriceLevel::PriceLevel(): total_quantity_{0} {}
+#include <limits>
+
+namespace {
+
+/**
+ * Owner an incoming order without self-trade prevention looks for; owners are handed out far below it.
+ */
+constexpr OwnerID NOBODY = std::numeric_limits<OwnerID>::max();
+
+}
+
+PriceLevel::PriceLevel(std::shared_ptr<Arena> arena)
+    : orders_(OrderQueue::allocator_type(arena, MemoryCategory::MEMORY_QUEUES))
+    , order_locations_(OrderLocations::allocator_type(arena, MemoryCategory::MEMORY_INDEXES))
+    , displayed_quantity_{0}
+    , hidden_quantity_{0} {}
 
 void PriceLevel::Add(std::shared_ptr<Order> order) {
-    if (order_locations_.count(order->GetID())) throw std::invalid_argument("Order with ID already exists in the level");
+    auto [location, added] = order_locations_.try_emplace(order->GetID());
+    if (!added) throw std::invalid_argument("Order with ID already exists in the level");
 
+    // an iceberg joins with a full tranche, whatever it traded on the way in
+    order->Replenish();
     orders_.push_back(order);
-    order_locations_[order->GetID()] = std::prev(orders_.end());
-    total_quantity_ += order->GetRemaining();
+    location->second = std::prev(orders_.end());
+    displayed_quantity_ += order->GetVisible();
+    hidden_quantity_ += order->GetHidden();
 }
 
 void PriceLevel::Remove(OrderID id) {
-    if (!order_locations_.count(id)) throw std::invalid_argument("Order with ID does not exist in the level");
+    auto location = order_locations_.find(id);
+    if (location == order_locations_.end()) throw std::invalid_argument("Order with ID does not exist in the level");
 
-    total_quantity_ -= (*order_locations_[id])->GetRemaining();
-    orders_.erase(order_locations_[id]);
-    order_locations_.erase(id);
+    std::shared_ptr<Order>& order = *location->second;
+    displayed_quantity_ -= order->GetVisible();
+    hidden_quantity_ -= order->GetHidden();
+    orders_.erase(location->second);
+    order_locations_.erase(location);
 }
 
 bool PriceLevel::IsEmpty() {
@@ -23,20 +45,96 @@ bool PriceLevel::IsEmpty() {
 }
 
 bool PriceLevel::CanFill(OrderQuantity amount) {
-    return amount <= total_quantity_;
+    // reserves replenish as they trade, so they count
+    return amount <= GetTotalQuantity();
 }
 
-void PriceLevel::Fill(std::shared_ptr<Order> order) {
-    while (!order->IsFilled() && !IsEmpty()) {
-        std::shared_ptr<Order> top = orders_.front();
-        OrderQuantity fill_amount = std::min(order->GetRemaining(), top->GetRemaining());
-        top->Fill(fill_amount);
+void PriceLevel::Fill(std::shared_ptr<Order> order, const TradeHandler& on_trade, const CancelHandler& on_cancel) {
+    OwnerID owner = order->GetSelfTradePrevention() == SelfTradePrevention::NO_STP ? NOBODY : order->GetOwner();
+    while (order->GetStatus() == OrderStatus::OPEN && !IsEmpty()) {
+        // the queue keeps the order alive until it is popped
+        Order& top = *orders_.front();
+        if (top.GetOwner() == owner) {
+            PreventSelfTrade(order, on_cancel);
+            continue;
+        }
+        OrderQuantity fill_amount = std::min(order->GetRemaining(), top.GetVisible());
+        top.Fill(fill_amount);
         order->Fill(fill_amount);
-        total_quantity_ -= fill_amount;
-        if (top->IsFilled()) Remove(top->GetID());
+        displayed_quantity_ -= fill_amount;
+        if (on_trade) on_trade({order->GetID(), top.GetID(), top.GetPrice(), fill_amount, top.GetRemaining(), order->GetSide()});
+        if (top.IsFilled()) PopFront();
+        else if (top.GetVisible() == 0) Requeue();
+    }
+}
+
+std::shared_ptr<Order> PriceLevel::Front() {
+    if (IsEmpty()) throw std::out_of_range("Price level has no orders");
+    return orders_.front();
+}
+
+void PriceLevel::FillFront(OrderQuantity amount) {
+    std::shared_ptr<Order> top = Front();
+    top->Fill(amount);
+    displayed_quantity_ -= amount;
+    if (top->IsFilled()) {
+        PopFront();
+    } else if (top->GetVisible() == 0) {
+        Requeue();
     }
 }
 
 Quantity PriceLevel::GetTotalQuantity() {
-    return total_quantity_;
+    return displayed_quantity_ + hidden_quantity_;
+}
+
+Quantity PriceLevel::GetDisplayedQuantity() {
+    return displayed_quantity_;
+}
+
+Quantity PriceLevel::GetHiddenQuantity() {
+    return hidden_quantity_;
+}
+
+void PriceLevel::PopFront() {
+    // a filled order shows and hides nothing, so the totals already leave it out
+    order_locations_.erase(orders_.front()->GetID());
+    orders_.pop_front();
+}
+
+void PriceLevel::Requeue() {
+    std::shared_ptr<Order>& top = orders_.front();
+    top->Replenish();
+    displayed_quantity_ += top->GetVisible();
+    hidden_quantity_ -= top->GetVisible();
+    // splicing keeps the order's iterator, so its entry in order_locations_ stays valid
+    orders_.splice(orders_.end(), orders_, orders_.begin());
+}
+
+void PriceLevel::PreventSelfTrade(std::shared_ptr<Order>& order, const CancelHandler& on_cancel) {
+    std::shared_ptr<Order> top = orders_.front();
+    SelfTradePrevention mode = order->GetSelfTradePrevention();
+    bool cancel_resting = mode == SelfTradePrevention::CANCEL_RESTING || mode == SelfTradePrevention::CANCEL_BOTH;
+
+    if (mode == SelfTradePrevention::DECREMENT) {
+        OrderQuantity amount = std::min(order->GetRemaining(), top->GetRemaining());
+        order->Reduce(amount);
+        displayed_quantity_ -= top->GetVisible();
+        hidden_quantity_ -= top->GetHidden();
+        top->Reduce(amount);
+        displayed_quantity_ += top->GetVisible();
+        hidden_quantity_ += top->GetHidden();
+        // reducing cancels whichever order ran out
+        cancel_resting = top->GetStatus() != OrderStatus::OPEN;
+    } else if (cancel_resting) {
+        top->SetStatus(OrderStatus::CANCELLED);
+    }
+    if (mode == SelfTradePrevention::CANCEL_AGGRESSOR || mode == SelfTradePrevention::CANCEL_BOTH) {
+        order->SetStatus(OrderStatus::CANCELLED);
+    }
+
+    if (cancel_resting) {
+        Remove(top->GetID());
+        if (on_cancel) on_cancel(top->GetID());
+    }
 }
\ No newline at end of file
@@ -0,0 +1,401 @@
+#include "replay.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+/**
+ * Buffers emitted events and writes them out in large blocks.
+ */
+class EventWriter {
+public:
+    explicit EventWriter(const std::string& path) : file_{nullptr}, used_{0} {
+        if (path.empty()) return;
+        file_ = fopen(path.c_str(), "w");
+        if (!file_) throw std::runtime_error("Failed to open replay output " + path);
+    }
+
+    ~EventWriter() {
+        if (!file_) return;
+        Flush();
+        fclose(file_);
+    }
+
+    bool IsEnabled() {
+        return file_ != nullptr;
+    }
+
+    void Trade(const std::string& ticker, const ::Trade& trade) {
+        Begin('T', ticker);
+        Int(trade.aggressor_id);
+        Int(trade.resting_id);
+        Int(trade.price);
+        Int(trade.quantity);
+        End();
+    }
+
+    void Rested(const std::string& ticker, Order& order) {
+        Begin('A', ticker);
+        Int(order.GetID());
+        Char(order.GetSide() == OrderSide::BID ? 'B' : 'S');
+        Int(order.GetPrice());
+        Int(order.GetRemaining());
+        End();
+    }
+
+    void Cancelled(const std::string& ticker, OrderID id) {
+        Begin('X', ticker);
+        Int(id);
+        End();
+    }
+
+    void Rejected(const std::string& ticker, OrderID id) {
+        Begin('R', ticker);
+        Int(id);
+        End();
+    }
+private:
+    static constexpr size_t CAPACITY = 1 << 20;
+    static constexpr size_t MAX_LINE = 128;
+
+    void Begin(char event, const std::string& ticker) {
+        if (used_ + MAX_LINE + ticker.size() > CAPACITY) Flush();
+        buffer_[used_++] = event;
+        buffer_[used_++] = ',';
+        memcpy(buffer_ + used_, ticker.data(), ticker.size());
+        used_ += ticker.size();
+    }
+
+    void Int(uint64_t value) {
+        buffer_[used_++] = ',';
+        used_ = std::to_chars(buffer_ + used_, buffer_ + CAPACITY, value).ptr - buffer_;
+    }
+
+    void Char(char value) {
+        buffer_[used_++] = ',';
+        buffer_[used_++] = value;
+    }
+
+    void End() {
+        buffer_[used_++] = '\n';
+    }
+
+    void Flush() {
+        fwrite(buffer_, 1, used_, file_);
+        used_ = 0;
+    }
+
+    FILE* file_;
+    size_t used_;
+    char buffer_[CAPACITY];
+};
+
+/**
+ * Split the next comma separated field off a line.
+ */
+std::string_view NextField(std::string_view& line) {
+    size_t comma = line.find(',');
+    std::string_view field = line.substr(0, comma);
+    line = comma == std::string_view::npos ? std::string_view() : line.substr(comma + 1);
+    return field;
+}
+
+template <typename T>
+T ParseNumber(std::string_view field, size_t line_number) {
+    T value;
+    auto [ptr, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    if (error != std::errc() || ptr != field.data() + field.size()) {
+        throw std::invalid_argument("Invalid number on replay line " + std::to_string(line_number));
+    }
+    return value;
+}
+
+}
+
+Replay::Replay(const std::string& path)
+    : mapping_{nullptr}
+    , mapping_size_{0}
+    , commands_{nullptr}
+    , command_count_{0} {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) throw std::runtime_error("Failed to open replay file " + path);
+
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        close(fd);
+        throw std::runtime_error("Failed to stat replay file " + path);
+    }
+    mapping_size_ = info.st_size;
+    if (mapping_size_ == 0) {
+        close(fd);
+        return;
+    }
+
+    mapping_ = mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        throw std::runtime_error("Failed to map replay file " + path);
+    }
+    madvise(mapping_, mapping_size_, MADV_SEQUENTIAL);
+
+    const char* begin = static_cast<const char*>(mapping_);
+    const char* end = begin + mapping_size_;
+    try {
+        if (mapping_size_ >= sizeof(MAGIC) && !memcmp(begin, MAGIC, sizeof(MAGIC))) LoadBinary(begin, end);
+        else ParseCsv(begin, end);
+    } catch (...) {
+        munmap(mapping_, mapping_size_);
+        throw;
+    }
+}
+
+Replay::~Replay() {
+    if (mapping_) munmap(mapping_, mapping_size_);
+}
+
+ReplayStats Replay::Run(unsigned threads, const std::string& output_path) {
+    if (threads == 0) threads = 1;
+    if (threads > instruments_.size()) threads = std::max<size_t>(1, instruments_.size());
+
+    std::vector<std::vector<uint32_t>> assigned(threads);
+    for (uint32_t instrument = 0; instrument < instruments_.size(); ++instrument) {
+        assigned[instrument % threads].push_back(instrument);
+    }
+    if (threads == 1) return RunInstruments(assigned[0], {}, output_path);
+
+    // bucket command indices by instrument so every thread only touches its own commands
+    std::vector<std::vector<uint32_t>> indices(instruments_.size());
+    for (size_t i = 0; i < command_count_; ++i) indices[commands_[i].instrument].push_back(i);
+
+    std::vector<ReplayStats> results(threads);
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers;
+    uint64_t start = CurrentTime();
+    for (unsigned t = 0; t < threads; ++t) {
+        std::string path = output_path.empty() ? "" : output_path + "." + std::to_string(t);
+        workers.emplace_back([this, &results, &errors, &assigned, &indices, t, path]() {
+            // an exception escaping a thread would terminate the process
+            try {
+                results[t] = RunInstruments(assigned[t], indices, path);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+
+    ReplayStats total;
+    for (const auto& result : results) {
+        total.commands += result.commands;
+        total.trades += result.trades;
+        total.traded_quantity += result.traded_quantity;
+        total.rested += result.rested;
+        total.cancelled += result.cancelled;
+        total.rejected += result.rejected;
+    }
+    total.seconds = (CurrentTime() - start) / 1e9;
+    return total;
+}
+
+ReplayStats Replay::RunInstruments(const std::vector<uint32_t>& instruments,
+    const std::vector<std::vector<uint32_t>>& indices, const std::string& output_path) {
+    ReplayStats stats;
+    std::unique_ptr<EventWriter> writer = std::make_unique<EventWriter>(output_path);
+    bool emit = writer->IsEnabled();
+
+    std::vector<std::unique_ptr<OrderBook>> books(instruments_.size());
+    for (uint32_t instrument : instruments) {
+        books[instrument] = std::make_unique<OrderBook>();
+        const std::string& ticker = instruments_[instrument];
+        books[instrument]->SetTradeHandler([&stats, &writer, &ticker, emit](const Trade& trade) {
+            ++stats.trades;
+            stats.traded_quantity += trade.quantity;
+            if (emit) writer->Trade(ticker, trade);
+        });
+    }
+
+    auto execute = [&](const ReplayCommand& command) {
+        OrderBook& book = *books[command.instrument];
+        const std::string& ticker = instruments_[command.instrument];
+        ++stats.commands;
+
+        if (command.action == ReplayAction::REPLAY_CANCEL) {
+            if (!book.HasOrder(command.order_id)) {
+                ++stats.rejected;
+                if (emit) writer->Rejected(ticker, command.order_id);
+                return;
+            }
+            book.CancelOrder(command.order_id);
+            ++stats.cancelled;
+            if (emit) writer->Cancelled(ticker, command.order_id);
+            return;
+        }
+
+        if (book.HasOrder(command.order_id)) {
+            ++stats.rejected;
+            if (emit) writer->Rejected(ticker, command.order_id);
+            return;
+        }
+        auto order = std::make_shared<Order>(command.order_id, ticker, command.price, command.quantity,
+            static_cast<OrderSide>(command.side), static_cast<OrderType>(command.type));
+        if (!book.PlaceOrder(order)) {
+            ++stats.rejected;
+            if (emit) writer->Rejected(ticker, command.order_id);
+        } else if (book.HasOrder(command.order_id)) {
+            ++stats.rested;
+            if (emit) writer->Rested(ticker, *order);
+        }
+    };
+
+    uint64_t start = CurrentTime();
+    if (indices.empty()) {
+        for (size_t i = 0; i < command_count_; ++i) execute(commands_[i]);
+    } else {
+        for (uint32_t instrument : instruments) {
+            for (uint32_t i : indices[instrument]) execute(commands_[i]);
+        }
+    }
+    stats.seconds = (CurrentTime() - start) / 1e9;
+    return stats;
+}
+
+void Replay::SaveBinary(const std::string& path) {
+    WriteBinary(path, instruments_, commands_, command_count_);
+}
+
+void Replay::WriteBinary(const std::string& path, const std::vector<std::string>& instruments,
+    const ReplayCommand* commands, size_t count) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) throw std::runtime_error("Failed to open " + path);
+
+    uint32_t header[2] = {static_cast<uint32_t>(instruments.size()), 0};
+    bool ok = fwrite(MAGIC, sizeof(MAGIC), 1, file) == 1 && fwrite(header, sizeof(header), 1, file) == 1;
+    for (const auto& ticker : instruments) {
+        char name[TICKER_SIZE] = {0};
+        if (ticker.size() > TICKER_SIZE) {
+            fclose(file);
+            throw std::invalid_argument("Ticker too long for binary replay format: " + ticker);
+        }
+        memcpy(name, ticker.data(), ticker.size());
+        ok = ok && fwrite(name, sizeof(name), 1, file) == 1;
+    }
+    ok = ok && fwrite(commands, sizeof(ReplayCommand), count, file) == count;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) throw std::runtime_error("Failed to write " + path);
+}
+
+const std::vector<std::string>& Replay::GetInstruments() {
+    return instruments_;
+}
+
+size_t Replay::GetCommandCount() {
+    return command_count_;
+}
+
+void Replay::ParseCsv(const char* begin, const char* end) {
+    std::unordered_map<std::string, uint32_t> instrument_indices;
+    auto instrument_index = [&](std::string_view ticker) {
+        auto [it, inserted] = instrument_indices.try_emplace(std::string(ticker), instruments_.size());
+        if (inserted) instruments_.emplace_back(ticker);
+        return it->second;
+    };
+
+    size_t line_number = 0;
+    const char* cursor = begin;
+    while (cursor < end) {
+        const char* newline = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+        if (!newline) newline = end;
+        std::string_view line(cursor, newline - cursor);
+        cursor = newline + 1;
+        ++line_number;
+
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty() || line[0] == '#') continue;
+
+        ReplayCommand command = {};
+        std::string_view action = NextField(line);
+        std::string_view ticker = NextField(line);
+        if (ticker.empty()) throw std::invalid_argument("Missing ticker on replay line " + std::to_string(line_number));
+        command.instrument = instrument_index(ticker);
+        command.order_id = ParseNumber<uint64_t>(NextField(line), line_number);
+
+        if (action == "C") {
+            command.action = ReplayAction::REPLAY_CANCEL;
+        } else if (action == "N") {
+            command.action = ReplayAction::REPLAY_NEW;
+            std::string_view side = NextField(line);
+            if (side == "B") command.side = OrderSide::BID;
+            else if (side == "S") command.side = OrderSide::ASK;
+            else throw std::invalid_argument("Invalid side on replay line " + std::to_string(line_number));
+
+            std::string_view type = NextField(line);
+            if (type == "GTC") command.type = OrderType::GOOD_TIL_CANCELED;
+            else if (type == "FOK") command.type = OrderType::FILL_OR_KILL;
+            else if (type == "IOC") command.type = OrderType::IMMEDIATE_OR_CANCEL;
+            else if (type == "MKT") command.type = OrderType::MARKET;
+            else throw std::invalid_argument("Invalid order type on replay line " + std::to_string(line_number));
+
+            command.price = ParseNumber<uint32_t>(NextField(line), line_number);
+            command.quantity = ParseNumber<uint32_t>(NextField(line), line_number);
+            if (command.quantity == 0) throw std::invalid_argument("Zero quantity on replay line " + std::to_string(line_number));
+        } else {
+            throw std::invalid_argument("Invalid action on replay line " + std::to_string(line_number));
+        }
+        parsed_.push_back(command);
+    }
+
+    commands_ = parsed_.data();
+    command_count_ = parsed_.size();
+}
+
+void Replay::LoadBinary(const char* begin, const char* end) {
+    const char* cursor = begin + sizeof(MAGIC);
+    uint32_t header[2];
+    if (end - cursor < static_cast<ptrdiff_t>(sizeof(header))) throw std::invalid_argument("Truncated binary replay header");
+    memcpy(header, cursor, sizeof(header));
+    cursor += sizeof(header);
+
+    uint32_t instrument_count = header[0];
+    if (static_cast<size_t>(end - cursor) < static_cast<size_t>(instrument_count) * TICKER_SIZE) {
+        throw std::invalid_argument("Truncated binary replay instrument table");
+    }
+    for (uint32_t i = 0; i < instrument_count; ++i) {
+        instruments_.emplace_back(cursor, strnlen(cursor, TICKER_SIZE));
+        cursor += TICKER_SIZE;
+    }
+
+    if ((end - cursor) % sizeof(ReplayCommand)) throw std::invalid_argument("Truncated binary replay command");
+    commands_ = reinterpret_cast<const ReplayCommand*>(cursor);
+    command_count_ = (end - cursor) / sizeof(ReplayCommand);
+    for (size_t i = 0; i < command_count_; ++i) {
+        if (commands_[i].instrument >= instrument_count) throw std::invalid_argument("Invalid instrument in binary replay command");
+        if (commands_[i].action != ReplayAction::REPLAY_NEW && commands_[i].action != ReplayAction::REPLAY_CANCEL) {
+            throw std::invalid_argument("Invalid action in binary replay command");
+        }
+        if (commands_[i].action == ReplayAction::REPLAY_NEW && (commands_[i].quantity == 0 || commands_[i].side > OrderSide::ASK)) {
+            throw std::invalid_argument("Invalid new order in binary replay command");
+        }
+        // only the types the text format has: the others need fields a command does not carry
+        uint8_t type = commands_[i].type;
+        if (commands_[i].action == ReplayAction::REPLAY_NEW && type != OrderType::GOOD_TIL_CANCELED && type != OrderType::FILL_OR_KILL
+            && type != OrderType::IMMEDIATE_OR_CANCEL && type != OrderType::MARKET) {
+            throw std::invalid_argument("Invalid order type in binary replay command");
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#include "replicator.hpp"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <iostream>
+#include <stdexcept>
+
+Replicator::Replicator(const std::string& host, int port, ReplicationMode mode)
+    : sock_{-1}, mode_{mode}, sequence_{0}, acknowledged_{0}, connected_{false} {
+    sockaddr_in backup_addr;
+    backup_addr.sin_family = AF_INET;
+    backup_addr.sin_port = htons(port);
+    if (!inet_aton(host.c_str(), &backup_addr.sin_addr)) throw std::invalid_argument("Backup host is invalid");
+
+    sock_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock_ == -1) throw std::runtime_error("Socket creation failed");
+    if (connect(sock_, (struct sockaddr*) &backup_addr, sizeof(backup_addr)) == -1) {
+        close(sock_);
+        throw std::runtime_error("Failed to connect to backup");
+    }
+    // batches are already as large as they get by the time they are sent
+    int no_delay = 1;
+    setsockopt(sock_, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    connected_ = true;
+    sender_ = std::jthread([this](std::stop_token stop) { RunSender(stop); });
+    acks_ = std::jthread([this]() { RunAcks(); });
+}
+
+Replicator::~Replicator() {
+    // the sender flushes what was appended before it stops
+    sender_.request_stop();
+    sender_.join();
+    connected_ = false;
+    shutdown(sock_, SHUT_RDWR);
+    acks_.join();
+    close(sock_);
+}
+
+uint64_t Replicator::Append(JournalEntry entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entry.sequence = ++sequence_;
+    if (!connected_.load(std::memory_order_relaxed)) return entry.sequence;
+    bool was_empty = pending_.empty();
+    pending_.push_back(entry);
+    // the sender is only waiting when nothing was pending
+    if (was_empty) pending_cv_.notify_one();
+    return entry.sequence;
+}
+
+void Replicator::WaitForAck(uint64_t sequence) {
+    if (mode_ != ReplicationMode::REPLICATE_SYNC) return;
+    if (acknowledged_.load(std::memory_order_acquire) >= sequence) return;
+    std::unique_lock<std::mutex> lock(mutex_);
+    acked_cv_.wait(lock, [this, sequence]() {
+        return acknowledged_.load(std::memory_order_acquire) >= sequence || !connected_.load(std::memory_order_relaxed);
+    });
+}
+
+ReplicationStats Replicator::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {sequence_, acknowledged_.load(std::memory_order_relaxed), 0, connected_.load(std::memory_order_relaxed)};
+}
+
+ReplicationMode Replicator::GetMode() {
+    return mode_;
+}
+
+void Replicator::RunSender(std::stop_token stop) {
+    std::vector<JournalEntry> batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        bool stopping = !pending_cv_.wait(lock, stop, [this]() {
+            return !pending_.empty() || !connected_.load(std::memory_order_relaxed);
+        });
+        if (!connected_.load(std::memory_order_relaxed)) return;
+        batch.swap(pending_);
+        lock.unlock();
+
+        const char* data = reinterpret_cast<const char*>(batch.data());
+        size_t left = batch.size() * sizeof(JournalEntry);
+        while (left) {
+            ssize_t sent = send(sock_, data, left, MSG_NOSIGNAL);
+            if (sent <= 0) return Disconnect();
+            data += sent;
+            left -= sent;
+        }
+        batch.clear();
+        if (stopping) return;
+        lock.lock();
+    }
+}
+
+void Replicator::RunAcks() {
+    uint64_t sequence;
+    size_t received = 0;
+    while (true) {
+        ssize_t len = recv(sock_, reinterpret_cast<char*>(&sequence) + received, sizeof(sequence) - received, 0);
+        if (len <= 0) return Disconnect();
+        received += len;
+        if (received < sizeof(sequence)) continue;
+        received = 0;
+        acknowledged_.store(sequence, std::memory_order_release);
+        // a waiter between checking the sequence and sleeping would miss the notification
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        acked_cv_.notify_all();
+    }
+}
+
+void Replicator::Disconnect() {
+    if (connected_.exchange(false)) {
+        std::cerr << "Lost the backup, continuing without replication" << std::endl;
+        shutdown(sock_, SHUT_RDWR);
+    }
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    pending_cv_.notify_all();
+    acked_cv_.notify_all();
+}
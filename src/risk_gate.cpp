@@ -0,0 +1,37 @@
+#include "risk_gate.hpp"
+
+#include <cstdlib>
+
+RiskGate::RiskGate(const RiskLimits& limits) : limits_{limits} {}
+
+std::string_view RiskGate::Admit(Order& order, const std::shared_ptr<AccountRisk>& account, OrderPrice last_price) {
+    if (limits_.max_order_quantity && order.GetQuantity() > limits_.max_order_quantity) return "Order quantity over limit";
+
+    bool has_limit = order.GetType() != OrderType::STOP && order.GetType() != OrderType::MARKET && !order.IsPegged();
+    OrderPrice price = has_limit ? order.GetPrice() : last_price;
+    if (limits_.max_notional && static_cast<Price>(price) * order.GetQuantity() > limits_.max_notional) {
+        return "Order notional over limit";
+    }
+    if (limits_.price_collar && has_limit && last_price) {
+        // basis points, kept in integers: |price - last| / last > collar / 10000
+        Price distance = std::abs(static_cast<int64_t>(price) - static_cast<int64_t>(last_price));
+        if (distance * 10000 > static_cast<Price>(last_price) * limits_.price_collar) return "Order price outside collar";
+    }
+
+    if (limits_.max_open_orders && account->open_orders.load(std::memory_order_relaxed) >= limits_.max_open_orders) {
+        return "Open order limit reached";
+    }
+    if (limits_.max_position) {
+        int64_t quantity = order.GetQuantity();
+        int64_t position = account->position.load(std::memory_order_relaxed) + (order.GetSide() == OrderSide::BID ? quantity : -quantity);
+        if (static_cast<Quantity>(std::abs(position)) > limits_.max_position) return "Position limit reached";
+    }
+
+    account->open_orders.fetch_add(1, std::memory_order_relaxed);
+    order.SetAccount(account);
+    return {};
+}
+
+const RiskLimits& RiskGate::GetLimits() {
+    return limits_;
+}
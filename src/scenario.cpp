@@ -0,0 +1,131 @@
+#include "scenario.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "order_book.hpp"
+
+namespace {
+
+/**
+ * An order a noise trader rests, with the instrument it rests on.
+ */
+struct RestingOrder {
+    uint32_t instrument; ///< Instrument of the order.
+    std::shared_ptr<Order> order; ///< The order.
+};
+
+}
+
+ScenarioSweep::ScenarioSweep(unsigned threads, bool pin) : pool_(threads, pin) {}
+
+SweepStats ScenarioSweep::Run(const std::vector<ScenarioParams>& scenarios, std::vector<ScenarioResult>* results) {
+    std::vector<ScenarioResult> outcomes(scenarios.size());
+    uint64_t steals = pool_.GetSteals();
+    uint64_t start = CurrentTime();
+    pool_.Run(scenarios.size(), [&scenarios, &outcomes](size_t scenario, unsigned) {
+        outcomes[scenario] = RunScenario(scenarios[scenario]);
+    });
+
+    SweepStats stats;
+    stats.seconds = (CurrentTime() - start) / 1e9;
+    stats.scenarios = scenarios.size();
+    stats.steals = pool_.GetSteals() - steals;
+    for (const auto& outcome : outcomes) {
+        stats.orders += outcome.orders;
+        stats.trades += outcome.trades;
+        stats.traded_quantity += outcome.traded_quantity;
+        stats.cancelled += outcome.cancelled;
+        stats.rejected += outcome.rejected;
+    }
+    if (results) *results = std::move(outcomes);
+    return stats;
+}
+
+ScenarioResult ScenarioSweep::RunScenario(const ScenarioParams& params) {
+    uint32_t agents = params.market_makers + params.takers + params.noise_traders;
+    if (!params.instruments || !agents) throw std::invalid_argument("Scenario needs instruments and agents");
+    if (!params.max_quantity) throw std::invalid_argument("Scenario needs a maximum quantity");
+
+    ScenarioResult result;
+    std::vector<std::string> tickers;
+    std::vector<std::unique_ptr<OrderBook>> books;
+    for (uint32_t instrument = 0; instrument < params.instruments; ++instrument) {
+        tickers.push_back("S" + std::to_string(instrument));
+        books.push_back(std::make_unique<OrderBook>());
+        books.back()->SetTradeHandler([&result](const Trade& trade) {
+            ++result.trades;
+            result.traded_quantity += trade.quantity;
+        });
+    }
+    std::vector<OrderPrice> reference(params.instruments, params.start_price);
+    // a bid and an ask per market maker and instrument
+    std::vector<std::shared_ptr<Order>> quotes(2 * static_cast<size_t>(params.market_makers) * params.instruments);
+    std::vector<std::vector<RestingOrder>> resting(params.noise_traders);
+    std::mt19937_64 random(params.seed);
+    OrderID next_id = 0;
+    // noise traders price furthest from the reference, which stays far enough above 0 for all of them
+    int64_t floor = 4 * static_cast<int64_t>(params.spread) + params.volatility + 1;
+
+    auto place = [&](uint32_t instrument, OrderSide side, OrderType type, OrderPrice price) {
+        OrderQuantity quantity = 1 + random() % params.max_quantity;
+        auto order = std::make_shared<Order>(next_id++, tickers[instrument], price, quantity, side, type);
+        ++result.orders;
+        if (!books[instrument]->PlaceOrder(order)) ++result.rejected;
+        return order;
+    };
+    auto cancel = [&](uint32_t instrument, std::shared_ptr<Order>& order) {
+        // filled orders have left the book already
+        if (order && order->GetStatus() == OrderStatus::OPEN) {
+            books[instrument]->CancelOrder(order->GetID());
+            order->SetStatus(OrderStatus::CANCELLED);
+            ++result.cancelled;
+        }
+        order.reset();
+    };
+
+    for (uint32_t step = 0; step < params.steps; ++step) {
+        uint32_t instrument = random() % params.instruments;
+        int64_t move = static_cast<int64_t>(random() % (2 * params.volatility + 1)) - params.volatility;
+        OrderPrice price = reference[instrument] = std::max(floor, reference[instrument] + move);
+        uint32_t agent = random() % agents;
+
+        if (agent < params.market_makers) {
+            std::shared_ptr<Order>* quote = &quotes[2 * (static_cast<size_t>(agent) * params.instruments + instrument)];
+            cancel(instrument, quote[0]);
+            cancel(instrument, quote[1]);
+            OrderPrice half = params.spread / 2;
+            quote[0] = place(instrument, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, price - half - random() % (params.volatility + 1));
+            quote[1] = place(instrument, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED,
+                price + (params.spread - half) + random() % (params.volatility + 1));
+        } else if (agent < params.market_makers + params.takers) {
+            bool buy = random() & 1;
+            OrderPrice through = params.spread + params.volatility;
+            place(instrument, buy ? OrderSide::BID : OrderSide::ASK, OrderType::IMMEDIATE_OR_CANCEL, buy ? price + through : price - through);
+        } else {
+            std::vector<RestingOrder>& orders = resting[agent - params.market_makers - params.takers];
+            if (!orders.empty() && random() % 100 < params.cancel_percent) {
+                size_t pick = random() % orders.size();
+                cancel(orders[pick].instrument, orders[pick].order);
+                orders[pick] = std::move(orders.back());
+                orders.pop_back();
+            } else {
+                bool buy = random() & 1;
+                OrderPrice distance = random() % (4 * params.spread + 1);
+                auto order = place(instrument, buy ? OrderSide::BID : OrderSide::ASK, OrderType::GOOD_TIL_CANCELED,
+                    buy ? price - distance : price + distance);
+                if (order->GetStatus() == OrderStatus::OPEN) orders.push_back({instrument, order});
+            }
+        }
+    }
+
+    result.last_price = books.front()->GetLastPrice();
+    return result;
+}
+
+unsigned ScenarioSweep::GetThreadCount() {
+    return pool_.GetThreadCount();
+}
@@ -0,0 +1,132 @@
+#include "session.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "latency.hpp"
+#include "uring_gateway.hpp"
+
+namespace {
+
+std::atomic<OwnerID> next_owner{NO_OWNER + 1}; ///< Owner of the next session.
+
+}
+
+Session::Session(int sock)
+    : sock_{sock}
+    , gateway_{nullptr}
+    , syscalls_{0}
+    , busy_poll_{false}
+    , owner_{next_owner.fetch_add(1, std::memory_order_relaxed)}
+    , account_{std::make_shared<AccountRisk>()} {}
+
+void Session::ReserveOwners(OwnerID owner) {
+    OwnerID next = next_owner.load(std::memory_order_relaxed);
+    while (next <= owner && !next_owner.compare_exchange_weak(next, owner + 1, std::memory_order_relaxed)) {}
+}
+
+int Session::Listen(int port, int backlog) {
+    int server_sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_sock == -1) throw std::runtime_error("Socket creation failed");
+    // a restarted server must not wait out the previous one's connections in TIME_WAIT
+    int reuse = 1;
+    if (setsockopt(server_sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == -1) {
+        close(server_sock);
+        throw std::runtime_error("Socket creation failed");
+    }
+
+    sockaddr_in server_addr;
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(port);
+
+    if (bind(server_sock, (struct sockaddr*) &server_addr, sizeof(server_addr)) == -1) {
+        close(server_sock);
+        throw std::runtime_error("Socket binding failed");
+    }
+
+    if (listen(server_sock, backlog) == -1) {
+        close(server_sock);
+        throw std::runtime_error("Socket listening failed");
+    }
+    return server_sock;
+}
+
+bool Session::Send(std::string_view message) {
+    LATENCY_PROBE(send_start);
+    if (gateway_) return gateway_->QueueSend(sock_, message);
+    if (channel_) {
+        bool sent = channel_->Send(message);
+        LATENCY_RECORD(LatencyStage::SEND, send_start);
+        return sent;
+    }
+    ssize_t sent = send(sock_, message.data(), message.size(), 0);
+    ++syscalls_;
+    LATENCY_RECORD(LatencyStage::SEND, send_start);
+    return sent == static_cast<ssize_t>(message.size());
+}
+
+ssize_t Session::Receive(char* buffer, size_t size) {
+    if (channel_) return channel_->Receive(buffer, size);
+    while (true) {
+        // only a read that finds data is timed, the wait for the client to send is not part of RECEIVE
+        LATENCY_PROBE(receive_start);
+        ++syscalls_;
+        ssize_t len = recv(sock_, buffer, size, MSG_DONTWAIT);
+        if (len > 0) {
+            LATENCY_RECORD(LatencyStage::RECEIVE, receive_start);
+            return len;
+        }
+        if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) return len;
+        if (busy_poll_) continue;
+
+        pollfd readable{sock_, POLLIN, 0};
+        ++syscalls_;
+        if (poll(&readable, 1, -1) < 0 && errno != EINTR) return -1;
+    }
+}
+
+void Session::AttachChannel(std::unique_ptr<ShmChannel> channel) {
+    channel_ = std::move(channel);
+}
+
+void Session::AttachGateway(UringGateway* gateway) {
+    gateway_ = gateway;
+}
+
+void Session::SetBusyPoll(bool busy_poll) {
+    busy_poll_ = busy_poll;
+}
+
+void Session::SetThrottle(const ThrottleLimits& limits) {
+    throttle_ = Throttle(limits);
+}
+
+uint64_t Session::GetSyscallCount() {
+    return syscalls_;
+}
+
+int Session::GetSocket() {
+    return sock_;
+}
+
+OwnerID Session::GetOwner() {
+    return owner_;
+}
+
+const std::shared_ptr<AccountRisk>& Session::GetAccount() {
+    return account_;
+}
+
+FixEncoder& Session::GetEncoder() {
+    return encoder_;
+}
+
+Throttle& Session::GetThrottle() {
+    return throttle_;
+}
@@ -0,0 +1,250 @@
+#include "shm_channel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "latency.hpp"
+
+/**
+ * A single-producer, single-consumer ring of length-prefixed messages.
+ *
+ * Positions are byte counts that only ever grow; a record is a 4 byte length, 4 bytes of
+ * padding and the message, rounded up to 8 bytes. A record never wraps: when one does not
+ * fit before the end of the ring, the producer writes a PADDING marker and starts over at 0.
+ */
+struct ShmRing {
+    alignas(64) std::atomic<uint64_t> tail; ///< Bytes published by the producer.
+    std::atomic<uint32_t> waiting; ///< Set while the consumer is asleep.
+    std::atomic<uint32_t> wakeups; ///< Futex word, bumped to wake the consumer.
+    alignas(64) std::atomic<uint64_t> head; ///< Bytes released by the consumer.
+    alignas(64) char data[ShmChannel::RING_SIZE]; ///< Message records.
+};
+
+/**
+ * Layout of the shared memory region behind a channel.
+ */
+struct ShmRegion {
+    ShmRing to_exchange; ///< Messages from the client.
+    ShmRing to_client; ///< Messages from the exchange.
+    alignas(64) std::atomic<uint32_t> closed; ///< Set once either side closes the channel.
+};
+
+namespace {
+
+constexpr uint32_t PADDING = UINT32_MAX; ///< Record length marking the unused end of the ring.
+constexpr size_t RECORD_HEADER = 8; ///< Bytes before the message in a record.
+constexpr int SPIN_ITERATIONS = 20000; ///< Polls of an empty ring before sleeping, given a spare core.
+constexpr long WAIT_TIMEOUT_NANOS = 100'000'000; ///< Longest sleep between checks on the peer.
+constexpr ssize_t CORRUPT = -2; ///< Pop result for a ring the peer has scribbled over.
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory rings need address-free atomics");
+
+uint64_t RecordSize(size_t length) {
+    return RECORD_HEADER + ((length + 7) & ~size_t{7});
+}
+
+void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+void Wake(ShmRing& ring) {
+    ring.wakeups.fetch_add(1, std::memory_order_release);
+    // not FUTEX_WAKE_PRIVATE: the word is shared between processes
+    syscall(SYS_futex, &ring.wakeups, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+/**
+ * Copy a message into the ring.
+ *
+ * @param corrupt Set if the peer knocked the tail off the record grid, where records would overrun the ring.
+ * @return false if there is not enough free space or the ring is corrupt.
+ */
+bool Push(ShmRing& ring, std::string_view message, bool& corrupt) {
+    uint64_t size = RecordSize(message.size());
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    uint64_t offset = tail % ShmChannel::RING_SIZE;
+    corrupt = offset % RECORD_HEADER;
+    if (corrupt) return false;
+    uint64_t padding = offset + size > ShmChannel::RING_SIZE ? ShmChannel::RING_SIZE - offset : 0;
+    if (tail + padding + size - ring.head.load(std::memory_order_acquire) > ShmChannel::RING_SIZE) return false;
+
+    if (padding) {
+        std::memcpy(ring.data + offset, &PADDING, sizeof(PADDING));
+        tail += padding;
+        offset = 0;
+    }
+    uint32_t length = message.size();
+    std::memcpy(ring.data + offset, &length, sizeof(length));
+    std::memcpy(ring.data + offset + RECORD_HEADER, message.data(), message.size());
+
+    // seq_cst store then load pairs with the consumer announcing itself, so a wakeup is never lost
+    ring.tail.store(tail + size, std::memory_order_seq_cst);
+    if (ring.waiting.load(std::memory_order_seq_cst)) Wake(ring);
+    return true;
+}
+
+/**
+ * Copy the next message out of the ring.
+ *
+ * The peer can write anything into the region, so every position and length it publishes is
+ * checked against the ring before it is used.
+ *
+ * @return Length copied, -1 if the ring is empty, or CORRUPT if a record does not fit the ring.
+ */
+ssize_t Pop(ShmRing& ring, char* buffer, size_t size) {
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head == ring.tail.load(std::memory_order_acquire)) return -1;
+
+    uint64_t offset = head % ShmChannel::RING_SIZE;
+    if (offset % RECORD_HEADER) return CORRUPT;
+    uint32_t length;
+    std::memcpy(&length, ring.data + offset, sizeof(length));
+    if (length == PADDING) {
+        head += ShmChannel::RING_SIZE - offset;
+        offset = 0;
+        std::memcpy(&length, ring.data, sizeof(length));
+    }
+    if (length > ShmChannel::RING_SIZE - offset - RECORD_HEADER) return CORRUPT;
+    size_t copied = std::min<size_t>(length, size);
+    std::memcpy(buffer, ring.data + offset + RECORD_HEADER, copied);
+    ring.head.store(head + RecordSize(length), std::memory_order_release);
+    return copied;
+}
+
+}
+
+ShmChannel::ShmChannel(const std::string& name, int peer_sock, bool create)
+    : name_{name}
+    , peer_sock_{peer_sock}
+    , owner_{create}
+    , region_{nullptr} {
+    // the name comes from the peer, which must not get to open or unlink anything but a channel
+    if (!IsChannelName(name)) throw std::runtime_error("Invalid shared memory channel name");
+    int fd = create ? shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600) : shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1) throw std::runtime_error("Failed to open shared memory region");
+    if (create && ftruncate(fd, sizeof(ShmRegion)) == -1) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Failed to size shared memory region");
+    }
+    // mapping past the end of a smaller object would fault on first touch
+    struct stat status;
+    if (!create && (fstat(fd, &status) == -1 || static_cast<size_t>(status.st_size) != sizeof(ShmRegion))) {
+        close(fd);
+        throw std::runtime_error("Shared memory region has the wrong size");
+    }
+
+    void* mapping = mmap(nullptr, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        if (create) shm_unlink(name.c_str());
+        throw std::runtime_error("Failed to map shared memory region");
+    }
+
+    if (create) {
+        region_ = new (mapping) ShmRegion();
+        inbound_ = &region_->to_client;
+        outbound_ = &region_->to_exchange;
+    } else {
+        // both sides have it mapped now, so the name is no longer needed
+        shm_unlink(name.c_str());
+        region_ = static_cast<ShmRegion*>(mapping);
+        inbound_ = &region_->to_exchange;
+        outbound_ = &region_->to_client;
+    }
+}
+
+ShmChannel::~ShmChannel() {
+    Close();
+    munmap(region_, sizeof(ShmRegion));
+    // in case the exchange never opened it
+    if (owner_) shm_unlink(name_.c_str());
+}
+
+bool ShmChannel::IsChannelName(const std::string& name) {
+    if (name.size() <= NAME_PREFIX.size() || name.size() > NAME_MAX || name.compare(0, NAME_PREFIX.size(), NAME_PREFIX)) return false;
+    return std::all_of(name.begin() + NAME_PREFIX.size(), name.end(), [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '-'; });
+}
+
+bool ShmChannel::Send(std::string_view message) {
+    if (RecordSize(message.size()) > RING_SIZE / 2 || region_->closed.load(std::memory_order_acquire)) return false;
+    bool corrupt;
+    while (!Push(*outbound_, message, corrupt)) {
+        if (corrupt) {
+            Close();
+            return false;
+        }
+        if (region_->closed.load(std::memory_order_acquire)) return false;
+        CpuRelax();
+    }
+    return true;
+}
+
+ssize_t ShmChannel::Receive(char* buffer, size_t size) {
+    // spinning on the only core just delays the peer we are waiting for
+    static const int spin_iterations = std::thread::hardware_concurrency() > 1 ? SPIN_ITERATIONS : 1;
+    while (true) {
+        for (int i = 0; i < spin_iterations; ++i) {
+            // only a pop that finds a message is timed, the wait for the peer is not part of RECEIVE
+            LATENCY_PROBE(receive_start);
+            ssize_t length = Pop(*inbound_, buffer, size);
+            if (length >= 0) {
+                LATENCY_RECORD(LatencyStage::RECEIVE, receive_start);
+                return length;
+            }
+            if (length == CORRUPT) {
+                Close();
+                return 0;
+            }
+            if (region_->closed.load(std::memory_order_acquire)) return 0;
+            CpuRelax();
+        }
+
+        // announce the sleep before re-checking the ring, see Push
+        uint32_t wakeups = inbound_->wakeups.load(std::memory_order_acquire);
+        inbound_->waiting.store(1, std::memory_order_seq_cst);
+        bool timed_out = false;
+        if (inbound_->tail.load(std::memory_order_seq_cst) == inbound_->head.load(std::memory_order_relaxed)
+            && !region_->closed.load(std::memory_order_acquire)) {
+            timespec timeout{0, WAIT_TIMEOUT_NANOS};
+            timed_out = syscall(SYS_futex, &inbound_->wakeups, FUTEX_WAIT, wakeups, &timeout, nullptr, 0) == -1
+                && errno == ETIMEDOUT;
+        }
+        inbound_->waiting.store(0, std::memory_order_relaxed);
+        if (timed_out && !IsPeerConnected()) return 0;
+    }
+}
+
+void ShmChannel::Close() {
+    if (region_->closed.exchange(1, std::memory_order_acq_rel)) return;
+    Wake(region_->to_exchange);
+    Wake(region_->to_client);
+}
+
+bool ShmChannel::IsPeerConnected() {
+    char byte;
+    ssize_t len = recv(peer_sock_, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return len > 0 || (len == -1 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+const std::string& ShmChannel::GetName() {
+    return name_;
+}
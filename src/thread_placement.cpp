@@ -0,0 +1,53 @@
+#include "thread_placement.hpp"
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+void CpuAffinity::PinCurrentThread(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) throw std::runtime_error("Invalid CPU " + std::to_string(cpu));
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // pid 0 is the calling thread, not the whole process
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) throw std::runtime_error("Failed to pin thread to CPU " + std::to_string(cpu));
+}
+
+void CpuAffinity::UnpinCurrentThread() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) CPU_SET(cpu, &set);
+    // the kernel narrows the mask down to the cores the process's cpuset allows
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+bool CpuAffinity::IsAvailable(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(getpid(), sizeof(set), &set) != 0) return false;
+    return CPU_ISSET(cpu, &set);
+}
+
+int CpuAffinity::GetNode(int cpu) {
+    std::error_code error;
+    std::filesystem::directory_iterator it("/sys/devices/system/cpu/cpu" + std::to_string(cpu), error);
+    if (error) return 0;
+    for (const auto& entry : it) {
+        std::string name = entry.path().filename().string();
+        // the core's directory links to its node as nodeN
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0) return std::stoi(name.substr(4));
+    }
+    return 0;
+}
+
+bool CpuAffinity::PreferNode(int node) {
+    if (node < 0) return syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0) == 0;
+    if (node >= static_cast<int>(sizeof(unsigned long) * 8)) return false;
+    unsigned long mask = 1UL << node;
+    return syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, sizeof(mask) * 8) == 0;
+}
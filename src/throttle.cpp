@@ -0,0 +1,37 @@
+#include "throttle.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr Timestamp NANOS_PER_SECOND = 1'000'000'000;
+
+}
+
+Throttle::Throttle(const ThrottleLimits& limits)
+    : limits_{limits}
+    , interval_{limits.messages_per_second ? NANOS_PER_SECOND / limits.messages_per_second : 0}
+    , tolerance_{limits.burst ? (limits.burst - 1) * interval_ : 0}
+    , queue_{limits.policy == ThrottlePolicy::THROTTLE_QUEUE ? limits.queue_depth * interval_ : 0}
+    , due_{0} {
+    if (limits.messages_per_second && !limits.burst) throw std::invalid_argument("Throttle burst must be at least 1");
+}
+
+Timestamp Throttle::Admit(Timestamp now) {
+    if (!interval_) return now;
+    // a session that went quiet only earns back its burst, not unlimited credit
+    Timestamp due = std::max(due_, now);
+    Timestamp ahead = due - now;
+    if (ahead > tolerance_ + queue_) return REFUSED;
+    due_ = due + interval_;
+    return ahead > tolerance_ ? now + (ahead - tolerance_) : now;
+}
+
+bool Throttle::IsLimited() {
+    return interval_ != 0;
+}
+
+const ThrottleLimits& Throttle::GetLimits() {
+    return limits_;
+}
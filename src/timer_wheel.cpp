@@ -0,0 +1,147 @@
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+TimerWheel::TimerWheel(Timestamp now, Timestamp tick, std::shared_ptr<Arena> arena)
+    : start_{now}
+    , tick_{tick}
+    , current_{0}
+    , level_sizes_{}
+    , nodes_(ArenaAllocator<Node>(arena, MemoryCategory::MEMORY_TIMERS))
+    , free_{NIL}
+    , index_(decltype(index_)::allocator_type(arena, MemoryCategory::MEMORY_TIMERS)) {
+    if (tick == 0) throw std::invalid_argument("Timer wheel tick must be positive");
+    slots_.fill(NIL);
+}
+
+void TimerWheel::Schedule(OrderID id, Timestamp expiry) {
+    if (index_.count(id)) throw std::invalid_argument("Order already has a timer");
+    uint32_t index;
+    if (free_ != NIL) {
+        index = free_;
+        free_ = nodes_[index].next;
+    } else {
+        index = nodes_.size();
+        nodes_.push_back({});
+    }
+    // round up so a timer never fires before its expiry
+    uint64_t ticks = expiry > start_ ? (expiry - start_ + tick_ - 1) / tick_ : 0;
+    nodes_[index] = {id, std::max(ticks, current_), NIL, NIL, 0};
+    Insert(index);
+    index_[id] = index;
+}
+
+bool TimerWheel::Cancel(OrderID id) {
+    // books without DAY or GOOD_TIL_DATE orders skip hashing the ID
+    if (index_.empty()) return false;
+    auto it = index_.find(id);
+    if (it == index_.end()) return false;
+    Unlink(it->second);
+    nodes_[it->second].next = free_;
+    free_ = it->second;
+    index_.erase(it);
+    return true;
+}
+
+void TimerWheel::Advance(Timestamp now, std::vector<OrderID>& expired) {
+    uint64_t target = now > start_ ? (now - start_) / tick_ : 0;
+    while (current_ <= target) {
+        if (index_.empty()) {
+            current_ = target + 1;
+            return;
+        }
+        // a level turning round takes the next slot of the level above down with it
+        if ((current_ & (SLOTS - 1)) == 0) {
+            for (unsigned level = 1; level < LEVELS; ++level) {
+                Cascade(level);
+                if ((current_ >> (SLOT_BITS * level)) & (SLOTS - 1)) break;
+            }
+        }
+
+        // with the lower levels empty, nothing is due before the lowest held level turns over
+        unsigned lowest = 0;
+        while (level_sizes_[lowest] == 0) ++lowest;
+        if (lowest > 0) {
+            uint64_t next_turn = (current_ | ((uint64_t{1} << (SLOT_BITS * lowest)) - 1)) + 1;
+            current_ = std::min(next_turn, target + 1);
+            continue;
+        }
+        uint32_t& head = slots_[current_ & (SLOTS - 1)];
+        uint32_t index = head;
+        head = NIL;
+        while (index != NIL) {
+            Node& node = nodes_[index];
+            uint32_t next = node.next;
+            expired.push_back(node.id);
+            index_.erase(node.id);
+            --level_sizes_[0];
+            node.next = free_;
+            free_ = index;
+            index = next;
+        }
+        ++current_;
+    }
+}
+
+Timestamp TimerWheel::GetNextDue() {
+    if (index_.empty()) return NEVER;
+    // at a turn the slots above that come down with it have yet to cascade, which Advance does
+    if ((current_ & (SLOTS - 1)) == 0) {
+        for (unsigned level = 1; level < LEVELS; ++level) {
+            if (slots_[level * SLOTS + ((current_ >> (SLOT_BITS * level)) & (SLOTS - 1))] != NIL) return start_ + current_ * tick_;
+            if ((current_ >> (SLOT_BITS * level)) & (SLOTS - 1)) break;
+        }
+    }
+    uint64_t due = current_;
+    if (level_sizes_[0]) {
+        // a timer of the lowest level expires in its current turn
+        while (slots_[due & (SLOTS - 1)] == NIL && ((due + 1) & (SLOTS - 1))) ++due;
+    } else {
+        // as in Advance, nothing is due before the lowest held level turns over
+        unsigned lowest = 1;
+        while (level_sizes_[lowest] == 0) ++lowest;
+        due = (current_ | ((uint64_t{1} << (SLOT_BITS * lowest)) - 1)) + 1;
+    }
+    return start_ + due * tick_;
+}
+
+size_t TimerWheel::GetSize() {
+    return index_.size();
+}
+
+void TimerWheel::Insert(uint32_t index) {
+    Node& node = nodes_[index];
+    // the highest digit the expiry differs from the current tick in picks the level, so its
+    // slot lies ahead of the level's current slot and turns before the expiry comes round;
+    // past the top level the slot turns every lap, and the timer looks again each time
+    uint64_t difference = node.expiry ^ current_;
+    unsigned level = 0;
+    while (level + 1 < LEVELS && difference >> (SLOT_BITS * (level + 1))) ++level;
+    node.slot = level * SLOTS + ((node.expiry >> (SLOT_BITS * level)) & (SLOTS - 1));
+    node.prev = NIL;
+    node.next = slots_[node.slot];
+    if (node.next != NIL) nodes_[node.next].prev = index;
+    slots_[node.slot] = index;
+    ++level_sizes_[level];
+}
+
+void TimerWheel::Unlink(uint32_t index) {
+    Node& node = nodes_[index];
+    if (node.prev != NIL) nodes_[node.prev].next = node.next;
+    else slots_[node.slot] = node.next;
+    if (node.next != NIL) nodes_[node.next].prev = node.prev;
+    --level_sizes_[node.slot / SLOTS];
+}
+
+void TimerWheel::Cascade(unsigned level) {
+    uint32_t& head = slots_[level * SLOTS + ((current_ >> (SLOT_BITS * level)) & (SLOTS - 1))];
+    uint32_t index = head;
+    head = NIL;
+    while (index != NIL) {
+        uint32_t next = nodes_[index].next;
+        --level_sizes_[level];
+        Insert(index);
+        index = next;
+    }
+}
@@ -0,0 +1,332 @@
+#include "uring_gateway.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * Kind of request a completion belongs to, kept in the upper half of its user data.
+ */
+enum RequestKind : uint64_t {
+    ACCEPT = 1,
+    RECV = 2,
+    SEND = 3,
+    PROVIDE = 4
+};
+
+constexpr uint16_t BUFFER_GROUP = 0; ///< Group ID of the provided receive buffers.
+constexpr long WAIT_TIMEOUT_NANOS = 100'000'000; ///< Longest wait before checking whether to stop.
+
+uint64_t MakeUserData(RequestKind kind, int sock) {
+    return (static_cast<uint64_t>(kind) << 32) | static_cast<uint32_t>(sock);
+}
+
+int Setup(unsigned entries, io_uring_params& params) {
+    return syscall(__NR_io_uring_setup, entries, &params);
+}
+
+unsigned LoadAcquire(unsigned* value) {
+    return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+}
+
+void StoreRelease(unsigned* value, unsigned desired) {
+    std::atomic_ref<unsigned>(*value).store(desired, std::memory_order_release);
+}
+
+}
+
+UringGateway::Connection::Connection(int sock) : session{sock} {}
+
+UringGateway::UringGateway(int listen_sock)
+    : listen_sock_{listen_sock}
+    , sq_mapping_{MAP_FAILED}
+    , cq_mapping_{MAP_FAILED}
+    , sqes_{nullptr}
+    , to_submit_{0}
+    , multishot_recv_{true}
+    , busy_poll_{false} {
+    io_uring_params params{};
+    ring_fd_ = Setup(QUEUE_DEPTH, params);
+    if (ring_fd_ < 0) throw std::runtime_error("Failed to set up io_uring");
+
+    // map the rings, which share one mapping on kernels with IORING_FEAT_SINGLE_MMAP
+    sq_mapping_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_mapping_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) sq_mapping_size_ = cq_mapping_size_ = std::max(sq_mapping_size_, cq_mapping_size_);
+    sq_mapping_ = mmap(nullptr, sq_mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    cq_mapping_ = single_mmap ? sq_mapping_
+        : mmap(nullptr, cq_mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sq_mapping_ == MAP_FAILED || cq_mapping_ == MAP_FAILED || sqes == MAP_FAILED) {
+        if (sqes != MAP_FAILED) munmap(sqes, sqes_size_);
+        Teardown();
+        throw std::runtime_error("Failed to map io_uring queues");
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sq_mapping_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    // submission slots map one to one onto entries, so the indirection array is filled once
+    unsigned* sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries_; ++i) sq_array[i] = i;
+
+    char* cq = static_cast<char*>(cq_mapping_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // handed to the kernel with the first submission
+    buffers_ = std::make_unique<char[]>(static_cast<size_t>(RECV_BUFFER_COUNT) * RECV_BUFFER_SIZE);
+    ProvideBuffers(0, RECV_BUFFER_COUNT);
+}
+
+UringGateway::~UringGateway() {
+    for (auto& [sock, connection] : connections_) close(sock);
+    Teardown();
+}
+
+void UringGateway::Teardown() {
+    // closing the ring cancels every outstanding request
+    if (ring_fd_ >= 0) close(ring_fd_);
+    if (sqes_) munmap(sqes_, sqes_size_);
+    if (cq_mapping_ != MAP_FAILED && cq_mapping_ != sq_mapping_) munmap(cq_mapping_, cq_mapping_size_);
+    if (sq_mapping_ != MAP_FAILED) munmap(sq_mapping_, sq_mapping_size_);
+    ring_fd_ = -1;
+    sqes_ = nullptr;
+    sq_mapping_ = cq_mapping_ = MAP_FAILED;
+}
+
+bool UringGateway::IsSupported() {
+    io_uring_params params{};
+    int ring_fd = Setup(4, params);
+    if (ring_fd < 0) return false;
+
+    close(ring_fd);
+    unsigned required = IORING_FEAT_EXT_ARG | IORING_FEAT_NODROP | IORING_FEAT_CQE_SKIP;
+    return (params.features & required) == required;
+}
+
+void UringGateway::Run(const std::atomic<bool>& running, const MessageHandler& on_message, std::atomic<uint64_t>& syscalls) {
+    ArmAccept();
+    while (running) {
+        if (!busy_poll_) {
+            Enter(true);
+            syscalls.fetch_add(1, std::memory_order_relaxed);
+        } else if (to_submit_) {
+            Enter(false);
+            syscalls.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        unsigned head = *cq_head_;
+        unsigned tail = LoadAcquire(cq_tail_);
+        for (; head != tail; ++head) Complete(cqes_[head & cq_mask_], on_message);
+        StoreRelease(cq_head_, head);
+
+        // one send per connection for everything produced by this batch
+        for (int sock : dirty_) {
+            auto it = connections_.find(sock);
+            if (it != connections_.end() && !it->second->sending) StartSend(sock, *it->second);
+        }
+        dirty_.clear();
+    }
+}
+
+void UringGateway::SetBusyPoll(bool busy_poll) {
+    busy_poll_ = busy_poll;
+}
+
+bool UringGateway::QueueSend(int sock, std::string_view message) {
+    auto it = connections_.find(sock);
+    if (it == connections_.end() || it->second->closing) return false;
+    Connection& connection = *it->second;
+    if (connection.pending.empty()) dirty_.push_back(sock);
+    connection.pending.append(message);
+    return true;
+}
+
+io_uring_sqe* UringGateway::GetSqe() {
+    unsigned tail = *sq_tail_;
+    if (tail - LoadAcquire(sq_head_) == sq_entries_) {
+        Enter(false);
+        tail = *sq_tail_;
+    }
+    io_uring_sqe* sqe = &sqes_[tail & sq_mask_];
+    std::memset(sqe, 0, sizeof(*sqe));
+    // without SQPOLL the kernel only reads entries inside io_uring_enter, so the caller can fill it in after
+    StoreRelease(sq_tail_, tail + 1);
+    ++to_submit_;
+    return sqe;
+}
+
+int UringGateway::Enter(bool wait) {
+    io_uring_getevents_arg arg{};
+    __kernel_timespec timeout{0, WAIT_TIMEOUT_NANOS};
+    arg.ts = reinterpret_cast<uint64_t>(&timeout);
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0;
+    int submitted = syscall(__NR_io_uring_enter, ring_fd_, to_submit_, wait ? 1 : 0, flags, wait ? &arg : nullptr, sizeof(arg));
+    if (submitted > 0) to_submit_ -= submitted;
+    return submitted;
+}
+
+void UringGateway::Complete(const io_uring_cqe& cqe, const MessageHandler& on_message) {
+    RequestKind kind = static_cast<RequestKind>(cqe.user_data >> 32);
+    int sock = static_cast<int>(cqe.user_data & 0xFFFFFFFF);
+    bool more = cqe.flags & IORING_CQE_F_MORE;
+
+    if (kind == RequestKind::PROVIDE) {
+        // only failures are reported, and the buffer is lost for good
+        return;
+    }
+    if (kind == RequestKind::ACCEPT) {
+        if (cqe.res >= 0) {
+            auto connection = std::make_unique<Connection>(cqe.res);
+            connection->session.AttachGateway(this);
+            connections_[cqe.res] = std::move(connection);
+            ArmRecv(cqe.res);
+        }
+        if (!more) ArmAccept();
+        return;
+    }
+
+    auto it = connections_.find(sock);
+    if (it == connections_.end()) return;
+    Connection& connection = *it->second;
+
+    if (kind == RequestKind::RECV) {
+        if (cqe.flags & IORING_CQE_F_BUFFER) {
+            unsigned buffer_id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+            // the bytes are consumed or copied before returning, so the buffer goes straight back
+            if (cqe.res > 0 && !connection.closing) {
+                Deliver(connection, &buffers_[static_cast<size_t>(buffer_id) * RECV_BUFFER_SIZE], cqe.res, on_message);
+            }
+            ProvideBuffers(buffer_id, 1);
+        }
+        if (more) return;
+        connection.receiving = false;
+
+        if (cqe.res == -EINVAL && multishot_recv_) {
+            // kernels before 6.0 reject multishot recv; fall back to re-arming after every receive
+            multishot_recv_ = false;
+            ArmRecv(sock);
+        } else if (cqe.res > 0 || cqe.res == -ENOBUFS) {
+            if (!connection.closing) ArmRecv(sock);
+        } else {
+            Close(sock, connection);
+        }
+    } else if (kind == RequestKind::SEND) {
+        connection.sending = false;
+        if (cqe.res < 0) {
+            Close(sock, connection);
+        } else {
+            connection.in_flight_offset += cqe.res;
+            if (connection.in_flight_offset < connection.in_flight.size() || !connection.pending.empty()) StartSend(sock, connection);
+        }
+    }
+    ReleaseIfIdle(sock);
+}
+
+void UringGateway::Deliver(Connection& connection, const char* data, size_t length, const MessageHandler& on_message) {
+    // parse straight out of the receive buffer unless part of a message was carried over
+    if (!connection.input.empty()) {
+        connection.input.append(data, length);
+        data = connection.input.data();
+        length = connection.input.size();
+    }
+    const char* end = data + length;
+    const char* consumed = data;
+
+    hffix::message_reader reader(data, end);
+    while (reader.is_complete()) {
+        if (!reader.is_valid() || !on_message(connection.session, reader, connection.logged_on)) {
+            int sock = connection.session.GetSocket();
+            return Close(sock, connection);
+        }
+        connection.logged_on = true;
+        consumed = reader.message_end();
+        reader = reader.next_message_reader();
+    }
+
+    size_t remaining = end - consumed;
+    if (remaining > MAX_PARTIAL_MESSAGE) return Close(connection.session.GetSocket(), connection);
+    if (connection.input.empty()) connection.input.assign(consumed, remaining);
+    else connection.input.erase(0, consumed - connection.input.data());
+}
+
+void UringGateway::ArmAccept() {
+    io_uring_sqe* sqe = GetSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_sock_;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = MakeUserData(RequestKind::ACCEPT, listen_sock_);
+}
+
+void UringGateway::ArmRecv(int sock) {
+    io_uring_sqe* sqe = GetSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = sock;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->ioprio = multishot_recv_ ? IORING_RECV_MULTISHOT : 0;
+    sqe->user_data = MakeUserData(RequestKind::RECV, sock);
+    connections_[sock]->receiving = true;
+}
+
+void UringGateway::StartSend(int sock, Connection& connection) {
+    if (connection.in_flight_offset >= connection.in_flight.size()) {
+        if (connection.pending.empty()) return;
+        std::swap(connection.in_flight, connection.pending);
+        connection.pending.clear();
+        connection.in_flight_offset = 0;
+    }
+    io_uring_sqe* sqe = GetSqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = sock;
+    sqe->addr = reinterpret_cast<uint64_t>(connection.in_flight.data() + connection.in_flight_offset);
+    sqe->len = connection.in_flight.size() - connection.in_flight_offset;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = MakeUserData(RequestKind::SEND, sock);
+    connection.sending = true;
+}
+
+void UringGateway::ProvideBuffers(unsigned first_id, unsigned count) {
+    io_uring_sqe* sqe = GetSqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = count;
+    sqe->addr = reinterpret_cast<uint64_t>(&buffers_[static_cast<size_t>(first_id) * RECV_BUFFER_SIZE]);
+    sqe->len = RECV_BUFFER_SIZE;
+    sqe->off = first_id;
+    sqe->buf_group = BUFFER_GROUP;
+    // rides along with the next submission and only produces a completion on failure
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->user_data = MakeUserData(RequestKind::PROVIDE, 0);
+}
+
+void UringGateway::Close(int sock, Connection& connection) {
+    if (connection.closing) return;
+    connection.closing = true;
+    // completes the armed recv, after which the connection is released
+    shutdown(sock, SHUT_RDWR);
+}
+
+void UringGateway::ReleaseIfIdle(int sock) {
+    auto it = connections_.find(sock);
+    if (it == connections_.end() || !it->second->closing || it->second->receiving || it->second->sending) return;
+    connections_.erase(it);
+    close(sock);
+}
@@ -0,0 +1,90 @@
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <sched.h>
+#include <thread>
+
+#include "thread_placement.hpp"
+
+WorkStealingPool::WorkStealingPool(unsigned threads, bool pin)
+    : threads_{threads ? threads : std::max(1u, std::thread::hardware_concurrency())}, pin_{pin}, steals_{0} {
+    for (unsigned worker = 0; worker < threads_; ++worker) queues_.push_back(std::make_unique<Queue>());
+}
+
+void WorkStealingPool::Run(size_t tasks, const Task& task) {
+    // contiguous blocks keep neighbouring tasks, which tend to cost alike, on one worker
+    for (unsigned worker = 0; worker < threads_; ++worker) {
+        size_t begin = tasks * worker / threads_;
+        size_t end = tasks * (worker + 1) / threads_;
+        for (size_t i = begin; i < end; ++i) queues_[worker]->tasks.push_back(i);
+    }
+
+    std::vector<int> cpus;
+    if (pin_) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CpuAffinity::IsAvailable(cpu)) cpus.push_back(cpu);
+        }
+    }
+
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::vector<std::thread> workers;
+    for (unsigned worker = 0; worker < threads_; ++worker) {
+        workers.emplace_back([this, worker, &task, &failed, &error, &error_mutex, &cpus]() {
+            try {
+                if (!cpus.empty()) CpuAffinity::PinCurrentThread(cpus[worker % cpus.size()]);
+                Work(worker, task, failed);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    // a failed batch leaves tasks behind, which must not leak into the next one
+    for (auto& queue : queues_) queue->tasks.clear();
+    if (error) std::rethrow_exception(error);
+}
+
+unsigned WorkStealingPool::GetThreadCount() {
+    return threads_;
+}
+
+uint64_t WorkStealingPool::GetSteals() {
+    return steals_.load(std::memory_order_relaxed);
+}
+
+void WorkStealingPool::Work(unsigned worker, const Task& task, std::atomic<bool>& failed) {
+    Queue& own = *queues_[worker];
+    while (!failed.load(std::memory_order_relaxed)) {
+        size_t next;
+        std::unique_lock<std::mutex> lock(own.mutex);
+        bool found = !own.tasks.empty();
+        if (found) {
+            next = own.tasks.back();
+            own.tasks.pop_back();
+        }
+        // stealing with the own deque locked could deadlock two workers stealing from each other
+        lock.unlock();
+        if (!found && !Steal(worker, next)) return;
+        task(next, worker);
+    }
+}
+
+bool WorkStealingPool::Steal(unsigned thief, size_t& task) {
+    // tasks are never added during a batch, so once every deque was seen empty the batch is done
+    for (unsigned offset = 1; offset < threads_; ++offset) {
+        Queue& victim = *queues_[(thief + offset) % threads_];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) continue;
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+        steals_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
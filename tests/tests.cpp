@@ -4,6 +4,23 @@
 #include "order.hpp"
 #include "exchange.hpp"
 #include "client.hpp"
+#include "latency.hpp"
+#include "fix_encoder.hpp"
+#include "fix_decoder.hpp"
+#include "replay.hpp"
+#include "shm_channel.hpp"
+#include "uring_gateway.hpp"
+#include "thread_placement.hpp"
+#include "arena.hpp"
+#include "risk_gate.hpp"
+#include "timer_wheel.hpp"
+#include "order_table.hpp"
+#include "scenario.hpp"
+#include "order_flow.hpp"
+#include "throttle.hpp"
+#include "replicator.hpp"
+#include "gateway.hpp"
+#include "book_view.hpp"
 
 #include <memory>
 #include <chrono>
@@ -19,6 +36,53 @@
 #include <unistd.h>
 #include <map>
 #include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+///
+/// Clock tests
+///
+
+TEST_CASE("Clock timestamps", "[Clock]") {
+    SECTION("Tracks the system clock") {
+        Clock::Now(); // Calibrate before comparing
+        int64_t system_now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+        int64_t clock_now = Clock::Now();
+        REQUIRE(std::abs(clock_now - system_now) < 1000000); // Within 1 millisecond
+    }
+
+    SECTION("Never goes backwards") {
+        Timestamp previous = CurrentTime();
+        for (int i = 0; i < 100000; ++i) {
+            Timestamp now = CurrentTime();
+            REQUIRE(now >= previous);
+            previous = now;
+        }
+    }
+
+    SECTION("Survives recalibration") {
+        Timestamp before = Clock::Now();
+        Clock::Recalibrate();
+        Timestamp after = Clock::Now();
+        REQUIRE(after >= before);
+        REQUIRE(after - before < 1000000);
+    }
+
+    SECTION("Converts tick durations") {
+        uint64_t start_ticks = Clock::ReadTicks();
+        Timestamp start = Clock::Now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t elapsed = Clock::TicksToNanos(Clock::ReadTicks() - start_ticks);
+        uint64_t expected = Clock::Now() - start;
+        REQUIRE(elapsed == Approx(expected).epsilon(0.01));
+    }
+}
 
 ///
 /// Order tests
@@ -298,6 +362,61 @@ TEST_CASE("PriceLevel order precedence", "[PriceLevel]") {
     }
 }
 
+///
+/// Arena tests
+///
+
+TEST_CASE("Arena allocation", "[Arena]") {
+    SECTION("Freed blocks are reused by their size class") {
+        Arena arena(4096);
+        void* first = arena.Allocate(40, 8);
+        void* second = arena.Allocate(48, 8);
+        REQUIRE(first != second);
+        REQUIRE(reinterpret_cast<uintptr_t>(first) % Arena::SMALL_STEP == 0);
+        arena.Deallocate(first, 40, 8);
+        REQUIRE(arena.Allocate(33, 8) == first);
+
+        ArenaStats stats = arena.GetStats();
+        REQUIRE(stats.reserved_bytes >= 4096);
+        REQUIRE(stats.carved_bytes == 96);
+        REQUIRE(stats.live_bytes == 96);
+        REQUIRE(stats.allocations == 3);
+        REQUIRE(stats.fallbacks == 0);
+    }
+
+    SECTION("Exhaustion falls back to the heap") {
+        Arena arena(4096);
+        size_t reserved = arena.GetStats().reserved_bytes;
+        std::vector<void*> blocks;
+        for (size_t i = 0; i < reserved / 256; ++i) blocks.push_back(arena.Allocate(256, 16));
+        void* overflow = arena.Allocate(256, 16);
+        void* large = arena.Allocate(reserved * 2, 16);
+        REQUIRE(arena.GetStats().fallbacks == 2);
+        arena.Deallocate(overflow, 256, 16);
+        arena.Deallocate(large, reserved * 2, 16);
+        for (void* block : blocks) arena.Deallocate(block, 256, 16);
+        REQUIRE(arena.GetStats().live_bytes == 0);
+    }
+
+    SECTION("Huge pages fall back to standard pages") {
+        Arena arena(1 << 20, PageSize::HUGE_2MB);
+        ArenaStats stats = arena.GetStats();
+        if (stats.page_size == PageSize::HUGE_2MB) REQUIRE(stats.reserved_bytes == 2 << 20);
+        else REQUIRE(stats.reserved_bytes == 1 << 20);
+        REQUIRE(arena.Allocate(64, 8) != nullptr);
+    }
+
+    SECTION("Allocator shares the arena with containers") {
+        auto arena = std::make_shared<Arena>(1 << 16);
+        std::vector<int, ArenaAllocator<int>> values{ArenaAllocator<int>(arena)};
+        for (int i = 0; i < 100; ++i) values.push_back(i);
+        REQUIRE(arena.use_count() == 2);
+        REQUIRE(arena->GetStats().live_bytes >= 100 * sizeof(int));
+        values = std::vector<int, ArenaAllocator<int>>{ArenaAllocator<int>(arena)};
+        REQUIRE(arena->GetStats().live_bytes == 0);
+    }
+}
+
 ///
 /// OrderBook tests
 ///
@@ -511,6 +630,1412 @@ TEST_CASE("OrderBook stress test", "[OrderBook]") {
     }
 }
 
+TEST_CASE("OrderBook call auction", "[OrderBook]") {
+    OrderBook book;
+    std::vector<Trade> trades;
+    book.SetTradeHandler([&trades](const Trade& trade) { trades.push_back(trade); });
+    book.StartAuction();
+    REQUIRE(book.GetPhase() == TradingPhase::AUCTION);
+
+    SECTION("Orders accumulate without matching") {
+        REQUIRE(book.PlaceOrder(createOrder(1, "AAPL", 15100, 100, OrderSide::BID, OrderType::GOOD_TIL_CANCELED)));
+        REQUIRE(book.PlaceOrder(createOrder(2, "AAPL", 14900, 100, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED)));
+        REQUIRE_FALSE(book.PlaceOrder(createOrder(3, "AAPL", 14900, 100, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL)));
+        REQUIRE(trades.empty());
+        REQUIRE(book.CancelOrder(2));
+        REQUIRE(book.Uncross().volume == 0);
+        REQUIRE(book.GetPhase() == TradingPhase::CONTINUOUS);
+    }
+
+    SECTION("Uncross at the volume maximizing price") {
+        book.PlaceOrder(createOrder(1, "AAPL", 102, 100, OrderSide::BID, OrderType::GOOD_TIL_CANCELED));
+        book.PlaceOrder(createOrder(2, "AAPL", 101, 100, OrderSide::BID, OrderType::GOOD_TIL_CANCELED));
+        book.PlaceOrder(createOrder(3, "AAPL", 99, 50, OrderSide::BID, OrderType::GOOD_TIL_CANCELED));
+        book.PlaceOrder(createOrder(4, "AAPL", 98, 80, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED));
+        book.PlaceOrder(createOrder(5, "AAPL", 100, 100, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED));
+        book.PlaceOrder(createOrder(6, "AAPL", 103, 50, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED));
+
+        // 180 executes at both 100 and 101 with 20 bought in surplus, so buy pressure picks 101
+        AuctionResult result = book.Uncross();
+        REQUIRE(result.price == 101);
+        REQUIRE(result.volume == 180);
+        REQUIRE(result.surplus == 20);
+        REQUIRE(result.surplus_side == OrderSide::BID);
+
+        REQUIRE(trades.size() == 3);
+        for (const auto& trade : trades) REQUIRE(trade.price == 101);
+        REQUIRE_FALSE(book.HasOrder(1));
+        REQUIRE(book.HasOrder(2));
+        REQUIRE_FALSE(book.HasOrder(5));
+        REQUIRE(book.GetEquilibrium().volume == 0);
+    }
+
+    SECTION("Balanced ties go to the reference price") {
+        book.PlaceOrder(createOrder(1, "AAPL", 101, 100, OrderSide::BID, OrderType::GOOD_TIL_CANCELED));
+        book.PlaceOrder(createOrder(2, "AAPL", 99, 100, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED));
+        REQUIRE(book.GetEquilibrium(105).price == 101);
+        REQUIRE(book.GetEquilibrium(90).price == 99);
+        REQUIRE(book.Uncross(100).volume == 100);
+        REQUIRE_FALSE(book.HasOrder(1));
+        REQUIRE_FALSE(book.HasOrder(2));
+    }
+}
+
+TEST_CASE("OrderBook with reserved capacity", "[OrderBook]") {
+    OrderBook book({1000, 100});
+    auto allocator = ArenaAllocator<Order>(book.GetArena());
+    REQUIRE(book.GetArena() != nullptr);
+    REQUIRE(book.GetArenaStats().reserved_bytes >= 1000 * OrderBook::BYTES_PER_ORDER);
+
+    for (OrderID id = 1; id <= 1000; ++id) {
+        OrderSide side = id % 2 ? OrderSide::BID : OrderSide::ASK;
+        OrderPrice price = side == OrderSide::BID ? 9900 + id % 50 : 10000 + id % 50;
+        REQUIRE(book.PlaceOrder(std::allocate_shared<Order>(allocator, id, "AAPL", price, 10, side, OrderType::GOOD_TIL_CANCELED)));
+    }
+    REQUIRE(book.PlaceOrder(std::allocate_shared<Order>(allocator, 1001, "AAPL", 10049, 1000, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL)));
+    for (OrderID id = 1; id <= 1000; id += 2) REQUIRE(book.CancelOrder(id));
+
+    ArenaStats stats = book.GetArenaStats();
+    REQUIRE(stats.allocations > 2000);
+    REQUIRE(stats.fallbacks == 0);
+    REQUIRE(OrderBook().GetArenaStats().reserved_bytes == 0);
+}
+
+TEST_CASE("OrderBook memory footprint", "[OrderBook]") {
+    for (size_t capacity : {0, 1000}) {
+        OrderBook book({capacity, capacity / 10});
+        auto allocator = ArenaAllocator<Order>(book.GetArena(), MemoryCategory::MEMORY_ORDERS);
+        for (OrderID id = 1; id <= 1000; ++id) {
+            OrderSide side = id % 2 ? OrderSide::BID : OrderSide::ASK;
+            OrderPrice price = side == OrderSide::BID ? 9900 + id % 50 : 10000 + id % 50;
+            REQUIRE(book.PlaceOrder(std::allocate_shared<Order>(allocator, id, "AAPL", price, 10, side, OrderType::GOOD_TIL_CANCELED)));
+        }
+        REQUIRE(book.PlaceOrder(std::allocate_shared<Order>(allocator, 1001, "AAPL", 9000, 10, OrderSide::BID, OrderType::DAY)));
+
+        MemoryUsage usage = book.GetMemoryUsage();
+        REQUIRE(usage.resting_orders == 1001);
+        REQUIRE(usage.price_levels == 51);
+        REQUIRE(usage.bytes[MemoryCategory::MEMORY_ORDERS] >= 1001 * sizeof(Order));
+        for (MemoryCategory category : {MemoryCategory::MEMORY_LEVELS, MemoryCategory::MEMORY_QUEUES,
+            MemoryCategory::MEMORY_INDEXES, MemoryCategory::MEMORY_SETS, MemoryCategory::MEMORY_TIMERS}) {
+            REQUIRE(usage.bytes[category] > 0);
+        }
+        REQUIRE(usage.bytes[MemoryCategory::MEMORY_OTHER] == 0);
+        REQUIRE(usage.bytes_per_order > sizeof(Order));
+        REQUIRE(usage.bytes_per_level > 0);
+
+        // orders and their queue entries go with them, bucket arrays stay
+        for (OrderID id = 1; id <= 1001; ++id) REQUIRE(book.CancelOrder(id));
+        usage = book.GetMemoryUsage();
+        REQUIRE(usage.resting_orders == 0);
+        REQUIRE(usage.bytes[MemoryCategory::MEMORY_ORDERS] == 0);
+        REQUIRE(usage.bytes[MemoryCategory::MEMORY_QUEUES] == 0);
+        REQUIRE(usage.bytes_per_order == 0);
+    }
+
+    Exchange exchange;
+    exchange.AddInstrument("AAPL");
+    exchange.AddInstrument("MSFT", {1000, 100});
+    REQUIRE(exchange.GetMemoryUsage("MSFT").bytes[MemoryCategory::MEMORY_INDEXES] > 0);
+    std::ostringstream dump;
+    exchange.DumpMemoryUsage(dump);
+    REQUIRE(dump.str().find("AAPL: ") != std::string::npos);
+    REQUIRE(dump.str().find("MSFT: ") != std::string::npos);
+    REQUIRE(dump.str().find("Total: ") != std::string::npos);
+    REQUIRE_THROWS_AS(exchange.GetMemoryUsage("GOOG"), std::invalid_argument);
+}
+
+TEST_CASE("OrderBook stop orders", "[OrderBook]") {
+    OrderBook book;
+    std::vector<Trade> trades;
+    book.SetTradeHandler([&trades](const Trade& trade) { trades.push_back(trade); });
+    auto stop = [](OrderID id, OrderSide side, OrderType type, OrderPrice price, OrderQuantity quantity, OrderPrice stop_price) {
+        return std::make_shared<Order>(id, "AAPL", price, quantity, side, type, stop_price);
+    };
+
+    SECTION("Stops need a stop price and only stops trigger") {
+        REQUIRE_THROWS_AS(stop(1, OrderSide::BID, OrderType::STOP, 0, 10, 0), std::invalid_argument);
+        REQUIRE_THROWS_AS(createOrder(1, "AAPL", 100, 10, OrderSide::BID, OrderType::GOOD_TIL_CANCELED)->Trigger(), std::invalid_argument);
+    }
+
+    SECTION("Stops wait outside the book until the last price reaches them") {
+        REQUIRE(book.PlaceOrder(stop(1, OrderSide::BID, OrderType::STOP_LIMIT, 105, 10, 102)));
+        REQUIRE(book.HasOrder(1));
+        // a stop is invisible, so this ask does not trade with it
+        REQUIRE(book.PlaceOrder(createOrder(2, "AAPL", 101, 10, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED)));
+        REQUIRE(trades.empty());
+
+        REQUIRE(book.PlaceOrder(createOrder(3, "AAPL", 101, 5, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL)));
+        REQUIRE(book.GetLastPrice() == 101);
+        REQUIRE(book.HasOrder(1));
+
+        REQUIRE(book.PlaceOrder(createOrder(4, "AAPL", 102, 5, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED)));
+        REQUIRE(book.PlaceOrder(createOrder(5, "AAPL", 102, 5, OrderSide::BID, OrderType::GOOD_TIL_CANCELED)));
+        // the fill at 101 leaves the last price short of the stop, the one at 102 triggers it
+        REQUIRE(book.GetLastPrice() == 101);
+        REQUIRE(book.PlaceOrder(createOrder(6, "AAPL", 102, 1, OrderSide::BID, OrderType::GOOD_TIL_CANCELED)));
+        REQUIRE(book.GetLastPrice() == 102);
+        REQUIRE(trades.back().aggressor_id == 1);
+        REQUIRE(trades.back().quantity == 4);
+        REQUIRE(book.HasOrder(1));
+        REQUIRE_FALSE(book.HasOrder(4));
+    }
+
+    SECTION("Triggered stops cascade in stop price order") {
+        for (OrderID id = 1; id <= 6; ++id) {
+            REQUIRE(book.PlaceOrder(createOrder(id, "AAPL", 100 + id, 10, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED)));
+        }
+        REQUIRE(book.PlaceOrder(stop(11, OrderSide::BID, OrderType::STOP, 0, 10, 103)));
+        REQUIRE(book.PlaceOrder(stop(10, OrderSide::BID, OrderType::STOP, 0, 10, 102)));
+        REQUIRE(book.PlaceOrder(stop(12, OrderSide::BID, OrderType::STOP, 0, 10, 104)));
+        REQUIRE(book.PlaceOrder(stop(13, OrderSide::BID, OrderType::STOP, 0, 50, 200)));
+        REQUIRE(book.PlaceOrder(createOrder(20, "AAPL", 103, 30, OrderSide::BID, OrderType::GOOD_TIL_CANCELED)));
+
+        // 102 and 103 are crossed together and go lowest first; their trades then cross 104
+        REQUIRE(trades.size() == 6);
+        REQUIRE(trades[3].aggressor_id == 10);
+        REQUIRE(trades[3].price == 104);
+        REQUIRE(trades[4].aggressor_id == 11);
+        REQUIRE(trades[5].aggressor_id == 12);
+        REQUIRE(book.GetLastPrice() == 106);
+        REQUIRE(book.HasOrder(13));
+        REQUIRE_FALSE(book.HasOrder(12));
+    }
+
+    SECTION("Sell stops trigger on a falling price and sweep the book") {
+        REQUIRE(book.PlaceOrder(createOrder(1, "AAPL", 100, 10, OrderSide::BID, OrderType::GOOD_TIL_CANCELED)));
+        REQUIRE(book.PlaceOrder(createOrder(2, "AAPL", 90, 10, OrderSide::BID, OrderType::GOOD_TIL_CANCELED)));
+        REQUIRE(book.PlaceOrder(stop(3, OrderSide::ASK, OrderType::STOP, 0, 30, 100)));
+        REQUIRE(book.PlaceOrder(createOrder(4, "AAPL", 100, 5, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED)));
+
+        // the stop takes the rest of both bids and its unfilled remainder is dropped
+        REQUIRE(trades.size() == 3);
+        REQUIRE(trades[2].aggressor_id == 3);
+        REQUIRE(trades[2].price == 90);
+        REQUIRE(book.GetLastPrice() == 90);
+        REQUIRE_FALSE(book.HasOrder(3));
+    }
+
+    SECTION("Waiting stops can be cancelled") {
+        REQUIRE(book.PlaceOrder(stop(1, OrderSide::ASK, OrderType::STOP_LIMIT, 95, 10, 99)));
+        REQUIRE(book.PlaceOrder(stop(2, OrderSide::ASK, OrderType::STOP_LIMIT, 95, 10, 99)));
+        REQUIRE(book.CancelOrder(2));
+        REQUIRE_FALSE(book.HasOrder(2));
+        REQUIRE(book.HasOrder(1));
+        REQUIRE_THROWS_AS(book.CancelOrder(2), std::invalid_argument);
+    }
+}
+
+TEST_CASE("OrderBook iceberg orders", "[OrderBook]") {
+    OrderBook book;
+    std::vector<Trade> trades;
+    book.SetTradeHandler([&trades](const Trade& trade) { trades.push_back(trade); });
+    auto iceberg = [](OrderID id, OrderSide side, OrderPrice price, OrderQuantity quantity, OrderQuantity display_quantity) {
+        return std::make_shared<Order>(id, "AAPL", price, quantity, side, OrderType::GOOD_TIL_CANCELED, 0, display_quantity);
+    };
+
+    SECTION("Icebergs must be able to rest") {
+        REQUIRE_THROWS_AS(std::make_shared<Order>(1, "AAPL", 100, 50, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL, 0, 10),
+            std::invalid_argument);
+        // showing everything is an ordinary order
+        REQUIRE_FALSE(iceberg(1, OrderSide::BID, 100, 50, 50)->IsIceberg());
+    }
+
+    SECTION("A level shows only the tranche") {
+        PriceLevel level;
+        level.Add(iceberg(1, OrderSide::ASK, 100, 50, 10));
+        level.Add(createOrder(2, 100, 5, OrderSide::ASK));
+        REQUIRE(level.GetDisplayedQuantity() == 15);
+        REQUIRE(level.GetHiddenQuantity() == 40);
+        REQUIRE(level.GetTotalQuantity() == 55);
+
+        level.Remove(1);
+        REQUIRE(level.GetDisplayedQuantity() == 5);
+        REQUIRE(level.GetHiddenQuantity() == 0);
+    }
+
+    SECTION("A filled tranche replenishes behind the orders already queued") {
+        REQUIRE(book.PlaceOrder(iceberg(1, OrderSide::ASK, 100, 25, 10)));
+        REQUIRE(book.PlaceOrder(createOrder(2, "AAPL", 100, 5, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED)));
+        REQUIRE(book.PlaceOrder(createOrder(3, "AAPL", 100, 12, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL)));
+
+        // 10 from the tranche, which goes to the back, then 2 from the order behind it
+        REQUIRE(trades.size() == 2);
+        REQUIRE(trades[0].resting_id == 1);
+        REQUIRE(trades[0].quantity == 10);
+        REQUIRE(trades[0].resting_remaining == 15);
+        REQUIRE(trades[1].resting_id == 2);
+        REQUIRE(trades[1].quantity == 2);
+
+        REQUIRE(book.PlaceOrder(createOrder(4, "AAPL", 100, 20, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL)));
+        REQUIRE(trades.size() == 5);
+        REQUIRE(trades[2].resting_id == 2);
+        REQUIRE(trades[3].resting_id == 1);
+        REQUIRE(trades[3].quantity == 10);
+        REQUIRE(trades[4].resting_id == 1);
+        REQUIRE(trades[4].quantity == 5);
+        REQUIRE_FALSE(book.HasOrder(1));
+    }
+
+    SECTION("Fill or kill counts the reserve") {
+        REQUIRE(book.PlaceOrder(iceberg(1, OrderSide::BID, 100, 40, 5)));
+        REQUIRE(book.PlaceOrder(createOrder(2, "AAPL", 100, 40, OrderSide::ASK, OrderType::FILL_OR_KILL)));
+        REQUIRE(trades.size() == 8);
+        REQUIRE_FALSE(book.HasOrder(1));
+    }
+
+    SECTION("Icebergs can be cancelled after trading") {
+        REQUIRE(book.PlaceOrder(iceberg(1, OrderSide::BID, 100, 40, 5)));
+        REQUIRE(book.PlaceOrder(createOrder(2, "AAPL", 100, 7, OrderSide::ASK, OrderType::IMMEDIATE_OR_CANCEL)));
+        REQUIRE(book.CancelOrder(1));
+        REQUIRE_FALSE(book.HasOrder(1));
+        REQUIRE(book.PlaceOrder(createOrder(3, "AAPL", 100, 1, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED)));
+        REQUIRE(trades.size() == 2);
+    }
+}
+
+TEST_CASE("OrderBook pegged orders", "[OrderBook]") {
+    OrderBook book;
+    std::vector<Trade> trades;
+    book.SetTradeHandler([&trades](const Trade& trade) { trades.push_back(trade); });
+    auto pegged = [](OrderID id, OrderSide side, OrderQuantity quantity, PegType peg_type, PriceOffset peg_offset) {
+        return std::make_shared<Order>(id, "AAPL", 0, quantity, side, OrderType::GOOD_TIL_CANCELED, 0, 0, peg_type, peg_offset);
+    };
+    auto limit = [](OrderID id, OrderSide side, OrderPrice price, OrderQuantity quantity) {
+        return createOrder(id, "AAPL", price, quantity, side, OrderType::GOOD_TIL_CANCELED);
+    };
+
+    SECTION("Pegs must be able to rest") {
+        REQUIRE_THROWS_AS(std::make_shared<Order>(1, "AAPL", 0, 10, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL, 0, 0,
+            PegType::PRIMARY_PEG, 0), std::invalid_argument);
+        REQUIRE_THROWS_AS(book.GetPegPrice(1), std::invalid_argument);
+    }
+
+    SECTION("Pegs track the best prices without being touched") {
+        REQUIRE(book.PlaceOrder(pegged(1, OrderSide::BID, 10, PegType::PRIMARY_PEG, -1)));
+        REQUIRE(book.PlaceOrder(pegged(2, OrderSide::BID, 10, PegType::MARKET_PEG, -2)));
+        REQUIRE(book.PlaceOrder(pegged(3, OrderSide::ASK, 10, PegType::MIDPOINT_PEG, 0)));
+        REQUIRE(book.HasOrder(1));
+        REQUIRE(book.GetPegPrice(1) == 0);
+
+        REQUIRE(book.PlaceOrder(limit(10, OrderSide::BID, 100, 5)));
+        REQUIRE(book.PlaceOrder(limit(11, OrderSide::ASK, 111, 5)));
+        REQUIRE(book.GetPegPrice(1) == 99);
+        REQUIRE(book.GetPegPrice(2) == 109);
+        // an odd spread rounds away from the bid for a sell
+        REQUIRE(book.GetPegPrice(3) == 106);
+
+        REQUIRE(book.PlaceOrder(limit(12, OrderSide::BID, 104, 5)));
+        REQUIRE(book.GetPegPrice(1) == 103);
+        REQUIRE(book.GetPegPrice(3) == 108);
+        REQUIRE(trades.empty());
+    }
+
+    SECTION("Pegs stay a tick inside the opposite side") {
+        REQUIRE(book.PlaceOrder(limit(10, OrderSide::BID, 100, 5)));
+        REQUIRE(book.PlaceOrder(limit(11, OrderSide::ASK, 102, 5)));
+        REQUIRE(book.PlaceOrder(pegged(1, OrderSide::BID, 10, PegType::MARKET_PEG, 0)));
+        REQUIRE(book.PlaceOrder(pegged(2, OrderSide::ASK, 10, PegType::PRIMARY_PEG, -5)));
+        REQUIRE(book.GetPegPrice(1) == 101);
+        REQUIRE(book.GetPegPrice(2) == 101);
+        REQUIRE(trades.empty());
+    }
+
+    SECTION("Incoming orders trade with pegs at their resolved price, behind limit orders") {
+        REQUIRE(book.PlaceOrder(limit(10, OrderSide::BID, 100, 5)));
+        REQUIRE(book.PlaceOrder(limit(11, OrderSide::ASK, 110, 5)));
+        REQUIRE(book.PlaceOrder(pegged(1, OrderSide::BID, 10, PegType::PRIMARY_PEG, 0)));
+        REQUIRE(book.PlaceOrder(pegged(2, OrderSide::BID, 10, PegType::MIDPOINT_PEG, 0)));
+
+        REQUIRE(book.PlaceOrder(createOrder(20, "AAPL", 100, 22, OrderSide::ASK, OrderType::IMMEDIATE_OR_CANCEL)));
+        REQUIRE(trades.size() == 3);
+        REQUIRE(trades[0].resting_id == 2);
+        REQUIRE(trades[0].price == 105);
+        REQUIRE(trades[1].resting_id == 10);
+        REQUIRE(trades[1].price == 100);
+        REQUIRE(trades[2].resting_id == 1);
+        REQUIRE(trades[2].price == 100);
+        REQUIRE(trades[2].quantity == 7);
+        REQUIRE_FALSE(book.HasOrder(2));
+        REQUIRE(book.GetLastPrice() == 100);
+    }
+
+    SECTION("Fill or kill counts pegs and cancelled pegs are gone") {
+        REQUIRE(book.PlaceOrder(limit(10, OrderSide::ASK, 110, 5)));
+        REQUIRE(book.PlaceOrder(pegged(1, OrderSide::ASK, 10, PegType::PRIMARY_PEG, 0)));
+        REQUIRE(book.PlaceOrder(pegged(2, OrderSide::ASK, 10, PegType::PRIMARY_PEG, 0)));
+        REQUIRE_FALSE(book.PlaceOrder(createOrder(20, "AAPL", 110, 30, OrderSide::BID, OrderType::FILL_OR_KILL)));
+        REQUIRE(book.CancelOrder(2));
+        REQUIRE_FALSE(book.HasOrder(2));
+        REQUIRE(book.PlaceOrder(createOrder(21, "AAPL", 110, 15, OrderSide::BID, OrderType::FILL_OR_KILL)));
+        REQUIRE(trades.size() == 2);
+        REQUIRE_FALSE(book.HasOrder(1));
+    }
+}
+
+TEST_CASE("OrderBook self-trade prevention", "[OrderBook]") {
+    OrderBook book;
+    std::vector<Trade> trades;
+    book.SetTradeHandler([&trades](const Trade& trade) { trades.push_back(trade); });
+    auto owned = [](OrderID id, OrderSide side, OrderType type, OrderQuantity quantity, OwnerID owner,
+        SelfTradePrevention self_trade_prevention = SelfTradePrevention::NO_STP) {
+        auto order = createOrder(id, "AAPL", 100, quantity, side, type);
+        order->SetOwner(owner, self_trade_prevention);
+        return order;
+    };
+    // owner 1 rests 10 and then 20 ahead of owner 2's 5
+    auto rest = [&]() {
+        REQUIRE(book.PlaceOrder(owned(1, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, 10, 1)));
+        REQUIRE(book.PlaceOrder(owned(2, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, 20, 1)));
+        REQUIRE(book.PlaceOrder(owned(3, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, 5, 2)));
+    };
+
+    SECTION("Prevention needs an owner") {
+        REQUIRE_THROWS_AS(createOrder(1, 100, 10, OrderSide::BID)->SetOwner(NO_OWNER, SelfTradePrevention::CANCEL_BOTH),
+            std::invalid_argument);
+    }
+
+    SECTION("Without prevention owners trade with themselves") {
+        rest();
+        REQUIRE(book.PlaceOrder(owned(10, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL, 15, 1)));
+        REQUIRE(trades.size() == 2);
+        REQUIRE(trades[0].resting_id == 1);
+    }
+
+    SECTION("Cancel resting skips past the owner's orders") {
+        rest();
+        auto bid = owned(10, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 15, 1, SelfTradePrevention::CANCEL_RESTING);
+        REQUIRE(book.PlaceOrder(bid));
+        REQUIRE(trades.size() == 1);
+        REQUIRE(trades[0].resting_id == 3);
+        REQUIRE_FALSE(book.HasOrder(1));
+        REQUIRE_FALSE(book.HasOrder(2));
+        // the rest of the bid is free to rest at the price it cleared
+        REQUIRE(book.HasOrder(10));
+        REQUIRE(bid->GetRemaining() == 10);
+    }
+
+    SECTION("Cancel aggressor leaves the resting orders alone") {
+        rest();
+        auto bid = owned(10, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 15, 1, SelfTradePrevention::CANCEL_AGGRESSOR);
+        REQUIRE(book.PlaceOrder(bid));
+        REQUIRE(trades.empty());
+        REQUIRE(bid->GetStatus() == OrderStatus::CANCELLED);
+        REQUIRE_FALSE(book.HasOrder(10));
+        REQUIRE(book.HasOrder(1));
+    }
+
+    SECTION("Cancel both") {
+        rest();
+        auto bid = owned(10, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 15, 1, SelfTradePrevention::CANCEL_BOTH);
+        REQUIRE(book.PlaceOrder(bid));
+        REQUIRE(trades.empty());
+        REQUIRE(bid->GetStatus() == OrderStatus::CANCELLED);
+        REQUIRE_FALSE(book.HasOrder(1));
+        REQUIRE(book.HasOrder(2));
+    }
+
+    SECTION("Decrement reduces both orders by the smaller quantity") {
+        rest();
+        auto bid = owned(10, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 15, 1, SelfTradePrevention::DECREMENT);
+        REQUIRE(book.PlaceOrder(bid));
+        REQUIRE(trades.empty());
+        REQUIRE_FALSE(book.HasOrder(1));
+        REQUIRE(bid->GetStatus() == OrderStatus::CANCELLED);
+        REQUIRE(bid->GetQuantity() == 0);
+        REQUIRE(book.HasOrder(2));
+        // 5 of the 20 went against the rest of the bid
+        REQUIRE(book.PlaceOrder(createOrder(11, "AAPL", 100, 25, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL)));
+        REQUIRE(trades.size() == 2);
+        REQUIRE(trades[0].quantity == 15);
+        REQUIRE(trades[1].resting_id == 3);
+    }
+}
+
+TEST_CASE("OrderBook order expiry", "[OrderBook]") {
+    OrderBook book;
+    Timestamp now = CurrentTime();
+    constexpr Timestamp SECOND = 1'000'000'000;
+    std::vector<OrderID> expired;
+    auto gtd = [now](OrderID id, OrderSide side, OrderPrice price, OrderQuantity quantity, Timestamp expire_in) {
+        return std::make_shared<Order>(id, "AAPL", price, quantity, side, OrderType::GOOD_TIL_DATE, 0, 0, PegType::NO_PEG, 0, now + expire_in);
+    };
+
+    SECTION("Good til date orders need an expire time") {
+        REQUIRE_THROWS_AS(createOrder(1, "AAPL", 100, 10, OrderSide::BID, OrderType::GOOD_TIL_DATE), std::invalid_argument);
+    }
+
+    SECTION("Orders expire at their time in force") {
+        book.SetSessionEnd(now + 2 * SECOND);
+        REQUIRE(book.GetNextExpiry() == TimerWheel::NEVER);
+        REQUIRE(book.PlaceOrder(gtd(1, OrderSide::BID, 100, 10, SECOND)));
+        REQUIRE(book.GetNextExpiry() <= now + SECOND);
+        REQUIRE(book.PlaceOrder(createOrder(2, "AAPL", 99, 10, OrderSide::BID, OrderType::DAY)));
+        REQUIRE(book.PlaceOrder(createOrder(3, "AAPL", 98, 10, OrderSide::BID, OrderType::GOOD_TIL_CANCELED)));
+
+        book.ExpireOrders(now + SECOND / 2, expired);
+        REQUIRE(expired.empty());
+        book.ExpireOrders(now + SECOND + SECOND / 2, expired);
+        REQUIRE(expired == std::vector<OrderID>{1});
+        REQUIRE_FALSE(book.HasOrder(1));
+        book.ExpireOrders(now + 3 * SECOND, expired);
+        REQUIRE(expired == std::vector<OrderID>{1, 2});
+        REQUIRE(book.HasOrder(3));
+
+        // the expired levels are gone for incoming orders too
+        REQUIRE(book.PlaceOrder(createOrder(4, "AAPL", 98, 10, OrderSide::ASK, OrderType::IMMEDIATE_OR_CANCEL)));
+        REQUIRE_FALSE(book.HasOrder(3));
+    }
+
+    SECTION("Orders leaving the book early take their timers with them") {
+        REQUIRE(book.PlaceOrder(gtd(1, OrderSide::BID, 100, 10, SECOND)));
+        REQUIRE(book.PlaceOrder(gtd(2, OrderSide::BID, 100, 10, SECOND)));
+        REQUIRE(book.PlaceOrder(gtd(3, OrderSide::BID, 100, 10, SECOND)));
+        REQUIRE(book.CancelOrder(1));
+        REQUIRE(book.PlaceOrder(createOrder(4, "AAPL", 100, 10, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED)));
+        // an ID can come back once its order has left
+        REQUIRE(book.PlaceOrder(gtd(1, OrderSide::BID, 100, 10, 5 * SECOND)));
+
+        book.ExpireOrders(now + 2 * SECOND, expired);
+        REQUIRE(expired == std::vector<OrderID>{3});
+        REQUIRE(book.HasOrder(1));
+    }
+
+    SECTION("Pegged and auction orders expire too") {
+        auto pegged = std::make_shared<Order>(1, "AAPL", 0, 10, OrderSide::BID, OrderType::DAY, 0, 0, PegType::PRIMARY_PEG, 0);
+        book.SetSessionEnd(now + SECOND);
+        REQUIRE(book.PlaceOrder(pegged));
+        book.StartAuction();
+        REQUIRE(book.PlaceOrder(gtd(2, OrderSide::ASK, 100, 10, SECOND)));
+        book.ExpireOrders(now + 2 * SECOND, expired);
+        REQUIRE(expired.size() == 2);
+        REQUIRE_FALSE(book.HasOrder(1));
+        REQUIRE_FALSE(book.HasOrder(2));
+        REQUIRE(book.Uncross().volume == 0);
+    }
+}
+
+TEST_CASE("OrderBook market orders", "[OrderBook]") {
+    OrderBook book;
+    std::vector<Trade> trades;
+    book.SetTradeHandler([&trades](const Trade& trade) { trades.push_back(trade); });
+    OrderID id = 1;
+    for (OrderPrice price = 100; price < 110; ++price) {
+        REQUIRE(book.PlaceOrder(createOrder(id++, "AAPL", price, 10, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED)));
+        REQUIRE(book.PlaceOrder(createOrder(id++, "AAPL", 199 - price, 10, OrderSide::BID, OrderType::GOOD_TIL_CANCELED)));
+    }
+
+    SECTION("Market orders sweep at any price and never rest") {
+        auto market = createOrder(100, "AAPL", 0, 35, OrderSide::BID, OrderType::MARKET);
+        REQUIRE(book.PlaceOrder(market));
+        REQUIRE(trades.size() == 4);
+        REQUIRE(trades[0].price == 100);
+        REQUIRE(trades[3].price == 103);
+        REQUIRE(trades[3].quantity == 5);
+        REQUIRE(market->GetStatus() == OrderStatus::CLOSED);
+        // the partly filled level is the new touch
+        REQUIRE(book.GetEquilibrium().volume == 0);
+        REQUIRE(book.PlaceOrder(createOrder(101, "AAPL", 103, 5, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL)));
+        REQUIRE(trades.back().resting_id == 7);
+
+        auto unfilled = createOrder(102, "AAPL", 0, 500, OrderSide::ASK, OrderType::MARKET);
+        REQUIRE(book.PlaceOrder(unfilled));
+        REQUIRE(unfilled->GetFilled() == 100);
+        REQUIRE(unfilled->GetStatus() == OrderStatus::CANCELLED);
+        REQUIRE_FALSE(book.HasOrder(102));
+        REQUIRE_FALSE(book.HasOrder(20));
+    }
+
+    SECTION("Marketable limits rest behind the levels they swept") {
+        auto limit = createOrder(100, "AAPL", 105, 100, OrderSide::BID, OrderType::GOOD_TIL_CANCELED);
+        REQUIRE(book.PlaceOrder(limit));
+        REQUIRE(trades.size() == 6);
+        REQUIRE(book.HasOrder(100));
+        REQUIRE(book.PlaceOrder(createOrder(101, "AAPL", 99, 45, OrderSide::ASK, OrderType::IMMEDIATE_OR_CANCEL)));
+        REQUIRE(trades[6].resting_id == 100);
+        REQUIRE(trades[6].quantity == 40);
+        REQUIRE(trades[7].price == 99);
+        // swept prices come back as new levels
+        REQUIRE(book.PlaceOrder(createOrder(102, "AAPL", 102, 10, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED)));
+        REQUIRE(book.PlaceOrder(createOrder(103, "AAPL", 0, 15, OrderSide::BID, OrderType::MARKET)));
+        REQUIRE(trades[8].resting_id == 102);
+        REQUIRE(trades[9].price == 106);
+    }
+
+    SECTION("Market orders cannot wait for an auction") {
+        book.StartAuction();
+        auto market = createOrder(100, "AAPL", 0, 10, OrderSide::BID, OrderType::MARKET);
+        REQUIRE_FALSE(book.PlaceOrder(market));
+        REQUIRE(market->GetStatus() == OrderStatus::CANCELLED);
+        REQUIRE_THROWS_AS(std::make_shared<Order>(101, "AAPL", 0, 10, OrderSide::BID, OrderType::MARKET, 0, 5), std::invalid_argument);
+    }
+}
+
+TEST_CASE("OrderBook matching kernels", "[OrderBook]") {
+    // every side and type has a kernel of its own, so each combination is checked on a mirrored book
+    for (OrderSide side : {OrderSide::BID, OrderSide::ASK}) {
+        OrderSide resting = side == OrderSide::BID ? OrderSide::ASK : OrderSide::BID;
+        OrderPrice near = side == OrderSide::BID ? 100 : 99;
+        OrderPrice far = side == OrderSide::BID ? 101 : 98;
+        for (OrderType type : {OrderType::GOOD_TIL_CANCELED, OrderType::DAY, OrderType::IMMEDIATE_OR_CANCEL,
+            OrderType::FILL_OR_KILL, OrderType::MARKET}) {
+            OrderBook book;
+            std::vector<Trade> trades;
+            book.SetTradeHandler([&trades](const Trade& trade) { trades.push_back(trade); });
+            REQUIRE(book.PlaceOrder(createOrder(1, "AAPL", far, 5, resting, OrderType::GOOD_TIL_CANCELED)));
+            REQUIRE(book.PlaceOrder(createOrder(2, "AAPL", near, 5, resting, OrderType::GOOD_TIL_CANCELED)));
+
+            auto order = createOrder(3, "AAPL", far, 15, side, type);
+            if (type == OrderType::FILL_OR_KILL) {
+                REQUIRE_FALSE(book.PlaceOrder(order));
+                REQUIRE(trades.empty());
+                REQUIRE(book.HasOrder(1));
+                continue;
+            }
+            REQUIRE(book.PlaceOrder(order));
+            REQUIRE(trades.size() == 2);
+            REQUIRE(trades[0].resting_id == 2);
+            REQUIRE(trades[1].price == far);
+            REQUIRE(order->GetFilled() == 10);
+            bool rests = type == OrderType::GOOD_TIL_CANCELED || type == OrderType::DAY;
+            REQUIRE(book.HasOrder(3) == rests);
+            REQUIRE(order->GetStatus() == (rests ? OrderStatus::OPEN : OrderStatus::CANCELLED));
+        }
+    }
+}
+
+///
+/// BookView tests
+///
+
+TEST_CASE("Book views for readers", "[BookView]") {
+    OrderBook book;
+    for (OrderID id = 1; id <= 20; ++id) {
+        OrderSide side = id % 2 ? OrderSide::BID : OrderSide::ASK;
+        OrderPrice price = side == OrderSide::BID ? 100 - id : 100 + id;
+        REQUIRE(book.PlaceOrder(createOrder(id, "AAPL", price, 10, side, OrderType::GOOD_TIL_CANCELED)));
+    }
+    REQUIRE(book.PlaceOrder(std::make_shared<Order>(21, "AAPL", 99, 30, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 0, 5)));
+    auto publisher = std::make_shared<BookViewPublisher>(4);
+    BookViewReader reader(publisher);
+    BookView view;
+
+    SECTION("Views hold the best levels of each side") {
+        REQUIRE_FALSE(reader.Read(view));
+        publisher->Publish(book);
+        REQUIRE(reader.Read(view));
+        REQUIRE(view.version == 1);
+        REQUIRE(view.bid_count == 4);
+        REQUIRE(view.ask_count == 4);
+        REQUIRE(view.bids[0].price == 99);
+        REQUIRE(view.bids[0].quantity == 40);
+        REQUIRE(view.bids[0].displayed == 15);
+        REQUIRE(view.bids[3].price == 93);
+        REQUIRE(view.asks[0].price == 102);
+        REQUIRE(view.asks[3].price == 108);
+
+        // readers keep the view they copied, whatever the writer does next
+        REQUIRE(book.PlaceOrder(createOrder(22, "AAPL", 99, 40, OrderSide::ASK, OrderType::IMMEDIATE_OR_CANCEL)));
+        REQUIRE(view.bids[0].price == 99);
+        publisher->Publish(book);
+        REQUIRE(reader.Read(view));
+        REQUIRE(view.version == 2);
+        REQUIRE(view.bids[0].price == 97);
+        REQUIRE(view.last_price == 99);
+    }
+
+    SECTION("Replaced views are recycled without waiting for readers") {
+        for (int i = 0; i < 1000; ++i) {
+            publisher->Publish(book);
+            if (i % 3 == 0) REQUIRE(reader.Read(view));
+        }
+        REQUIRE(view.version == 1000);
+        REQUIRE(publisher->GetAllocatedViews() < 40);
+        REQUIRE_THROWS_AS(BookViewPublisher(BookView::MAX_DEPTH + 1), std::invalid_argument);
+
+        std::vector<BookViewReader> readers;
+        while (readers.size() < BookViewPublisher::MAX_READERS - 1) readers.emplace_back(publisher);
+        REQUIRE_THROWS_AS(BookViewReader(publisher), std::runtime_error);
+        readers.pop_back();
+        REQUIRE_NOTHROW(BookViewReader(publisher));
+    }
+
+    SECTION("Readers on other threads only ever see whole views") {
+        std::atomic<bool> done{false};
+        std::atomic<uint64_t> torn{0};
+        std::atomic<uint64_t> reads{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 2; ++i) {
+            threads.emplace_back([&]() {
+                BookViewReader thread_reader(publisher);
+                BookView seen;
+                uint64_t version = 0;
+                while (!done.load()) {
+                    if (!thread_reader.Read(seen)) continue;
+                    // every view the writer publishes has its bids at one price and its asks one tick above
+                    bool whole = seen.bid_count == 1 && seen.ask_count == 1 && seen.asks[0].price == seen.bids[0].price + 1
+                        && seen.bids[0].quantity == seen.version && seen.version >= version;
+                    if (!whole) torn.fetch_add(1);
+                    version = seen.version;
+                    reads.fetch_add(1);
+                }
+            });
+        }
+        for (uint64_t i = 1; i <= 20000; ++i) {
+            OrderBook moving;
+            REQUIRE(moving.PlaceOrder(createOrder(1, "AAPL", 1000 + i % 50, i, OrderSide::BID, OrderType::GOOD_TIL_CANCELED)));
+            REQUIRE(moving.PlaceOrder(createOrder(2, "AAPL", 1001 + i % 50, i, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED)));
+            publisher->Publish(moving);
+            if (i % 1000 == 0) std::this_thread::yield();
+        }
+        done.store(true);
+        for (auto& thread : threads) thread.join();
+        REQUIRE(torn.load() == 0);
+        REQUIRE(reads.load() > 0);
+    }
+}
+
+TEST_CASE("Book views of an exchange", "[BookView]") {
+    Exchange exchange;
+    exchange.AddInstrument("AAPL");
+    REQUIRE_THROWS_AS(exchange.OpenBookView("AAPL"), std::runtime_error);
+    REQUIRE_THROWS_AS(exchange.SetBookViewDepth(BookView::MAX_DEPTH + 1), std::invalid_argument);
+    exchange.SetBookViewDepth(5);
+    exchange.AddInstrument("MSFT");
+    REQUIRE_THROWS_AS(exchange.OpenBookView("GOOG"), std::invalid_argument);
+
+    BookViewReader reader = exchange.OpenBookView("AAPL");
+    BookViewReader other = exchange.OpenBookView("MSFT");
+    BookView view;
+    REQUIRE(reader.Read(view));
+    REQUIRE(view.bid_count == 0);
+    REQUIRE(view.phase == TradingPhase::CONTINUOUS);
+    REQUIRE(other.Read(view));
+
+    exchange.StartAuction("AAPL");
+    REQUIRE(reader.Read(view));
+    REQUIRE(view.version == 2);
+    REQUIRE(view.phase == TradingPhase::AUCTION);
+    // a removed instrument leaves its readers the last view
+    exchange.RemoveInstrument("AAPL");
+    REQUIRE(reader.Read(view));
+    REQUIRE(view.phase == TradingPhase::AUCTION);
+}
+
+///
+/// TimerWheel tests
+///
+
+TEST_CASE("TimerWheel", "[TimerWheel]") {
+    constexpr Timestamp TICK = 1000;
+    TimerWheel wheel(0, TICK);
+    std::vector<OrderID> expired;
+
+    SECTION("Timers fire once their tick has passed") {
+        wheel.Schedule(1, 5 * TICK);
+        wheel.Schedule(2, 5 * TICK - 1);
+        wheel.Schedule(3, 6 * TICK + 1);
+        wheel.Advance(5 * TICK - 1, expired);
+        REQUIRE(expired.empty());
+        wheel.Advance(5 * TICK, expired);
+        REQUIRE(expired.size() == 2);
+        wheel.Advance(7 * TICK, expired);
+        REQUIRE(expired.back() == 3);
+        REQUIRE(wheel.GetSize() == 0);
+    }
+
+    SECTION("Cancelled timers never fire") {
+        wheel.Schedule(1, 10 * TICK);
+        wheel.Schedule(2, 10 * TICK);
+        REQUIRE_THROWS_AS(wheel.Schedule(2, 20 * TICK), std::invalid_argument);
+        REQUIRE(wheel.Cancel(1));
+        REQUIRE_FALSE(wheel.Cancel(1));
+        wheel.Advance(10 * TICK, expired);
+        REQUIRE(expired == std::vector<OrderID>{2});
+    }
+
+    SECTION("Far timers cascade down to fire on time") {
+        // one in each of the first four levels, and one past the top
+        std::vector<Timestamp> expiries = {40, 3000, 200000, 15000000, uint64_t{1} << 40};
+        for (size_t i = 0; i < expiries.size(); ++i) wheel.Schedule(i, expiries[i] * TICK);
+        for (size_t i = 0; i < expiries.size(); ++i) {
+            wheel.Advance(expiries[i] * TICK - 1, expired);
+            REQUIRE(expired.size() == i);
+            wheel.Advance(expiries[i] * TICK, expired);
+            REQUIRE(expired.size() == i + 1);
+            REQUIRE(expired.back() == i);
+        }
+    }
+
+    SECTION("Timers due together fire in one advance") {
+        for (OrderID id = 0; id < 1000; ++id) wheel.Schedule(id, 86400 * TICK);
+        wheel.Schedule(1000, 100 * TICK);
+        wheel.Advance(86400 * TICK, expired);
+        REQUIRE(expired.size() == 1001);
+        REQUIRE(expired.front() == 1000);
+    }
+
+    SECTION("Advancing can wait for the next due time") {
+        REQUIRE(wheel.GetNextDue() == TimerWheel::NEVER);
+        wheel.Schedule(1, 10 * TICK);
+        wheel.Schedule(2, 5000 * TICK);
+        REQUIRE(wheel.GetNextDue() == 10 * TICK);
+        wheel.Advance(10 * TICK, expired);
+        REQUIRE(expired == std::vector<OrderID>{1});
+        // advancing only at the times reported still fires the far timer, and never early
+        size_t advances = 0;
+        while (expired.size() == 1) {
+            Timestamp due = wheel.GetNextDue();
+            REQUIRE(due <= 5000 * TICK);
+            wheel.Advance(due, expired);
+            ++advances;
+        }
+        REQUIRE(expired.back() == 2);
+        // rather than one per tick
+        REQUIRE(advances < 50);
+        REQUIRE(wheel.GetNextDue() == TimerWheel::NEVER);
+    }
+}
+
+///
+/// OrderTable tests
+///
+
+TEST_CASE("OrderTable routing", "[OrderTable]") {
+    auto makeOrder = [](OrderID id) {
+        return std::make_shared<Order>(id, "AAPL", 100, 10, OrderSide::BID, OrderType::GOOD_TIL_CANCELED);
+    };
+
+    SECTION("IDs count up and lead to their orders") {
+        OrderTable table(0);
+        REQUIRE(table.Reserve() == 0);
+        OrderID second = table.Reserve();
+        REQUIRE(second == 1);
+        table.Store(makeOrder(second));
+        REQUIRE(table.Find(second)->GetID() == second);
+        REQUIRE(table.Find(0) == nullptr);
+        REQUIRE(table.Find(2) == nullptr);
+    }
+
+    SECTION("IDs carry their instrument") {
+        OrderTable table(3);
+        OrderID id = table.Reserve();
+        REQUIRE(OrderTable::GetInstrument(id) == 3);
+        table.Store(makeOrder(id));
+        REQUIRE(table.Find(id) != nullptr);
+        // the same slot of another instrument
+        REQUIRE(table.Find(static_cast<uint32_t>(id)) == nullptr);
+    }
+
+    SECTION("A released slot comes back in a new generation") {
+        OrderTable table(0);
+        OrderID released = table.Reserve();
+        table.Release(released);
+        OrderID reused = table.Reserve();
+        REQUIRE(reused != released);
+        REQUIRE(static_cast<uint32_t>(reused) == static_cast<uint32_t>(released));
+        table.Store(makeOrder(reused));
+        REQUIRE(table.Find(released) == nullptr);
+        REQUIRE(table.Find(reused) != nullptr);
+    }
+
+    SECTION("A closed order gives its slot back") {
+        OrderTable table(0);
+        OrderID filled = table.Reserve();
+        table.Store(makeOrder(filled));
+        OrderID cancelled = table.Reserve();
+        table.Store(makeOrder(cancelled));
+        OrderID open = table.Reserve();
+        table.Store(makeOrder(open));
+        table.Find(cancelled)->SetStatus(OrderStatus::CANCELLED);
+        table.Find(filled)->Fill(10);
+        // still found until its slot is taken, oldest first
+        REQUIRE(table.Find(cancelled)->GetStatus() == OrderStatus::CANCELLED);
+        OrderID reused = table.Reserve();
+        REQUIRE(static_cast<uint32_t>(reused) == static_cast<uint32_t>(cancelled));
+        table.Store(makeOrder(reused));
+        REQUIRE(table.Find(cancelled) == nullptr);
+        REQUIRE(table.Find(filled)->GetStatus() == OrderStatus::CLOSED);
+        REQUIRE(static_cast<uint32_t>(table.Reserve()) == static_cast<uint32_t>(filled));
+        // the open order keeps its slot
+        REQUIRE(table.Reserve() == 3);
+        REQUIRE(table.Find(open) != nullptr);
+    }
+
+    SECTION("Restoring moves reservations past the order") {
+        OrderTable table(0);
+        auto restored = makeOrder(5);
+        table.Restore(restored);
+        REQUIRE(table.Find(5) != nullptr);
+        // the primary gives the slot out again, not the backup
+        restored->SetStatus(OrderStatus::CANCELLED);
+        REQUIRE(table.Reserve() == 6);
+        REQUIRE_THROWS_AS(table.Restore(makeOrder(OrderID{1} << 48)), std::invalid_argument);
+    }
+}
+
+///
+/// RiskGate tests
+///
+
+TEST_CASE("RiskGate limits", "[RiskGate]") {
+    auto account = std::make_shared<AccountRisk>();
+    auto order = [](OrderID id, OrderSide side, OrderType type, OrderPrice price, OrderQuantity quantity) {
+        return createOrder(id, "AAPL", price, quantity, side, type);
+    };
+
+    SECTION("Order size, notional and collar") {
+        RiskGate gate({100, 50000, 500, 0, 0});
+        REQUIRE(gate.Admit(*order(1, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 100, 101), account, 0) == "Order quantity over limit");
+        REQUIRE(gate.Admit(*order(2, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 600, 100), account, 0) == "Order notional over limit");
+        // 5% either side of the last trade
+        REQUIRE(gate.Admit(*order(3, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 106, 10), account, 100) == "Order price outside collar");
+        REQUIRE(gate.Admit(*order(4, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, 94, 10), account, 100) == "Order price outside collar");
+        REQUIRE(gate.Admit(*order(5, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 105, 10), account, 100).empty());
+        // the collar waits for a first trade
+        REQUIRE(gate.Admit(*order(6, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 400, 10), account, 0).empty());
+        // a zero limit is still a limit
+        REQUIRE(gate.Admit(*order(7, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, 0, 10), account, 100) == "Order price outside collar");
+        REQUIRE(account->open_orders == 2);
+    }
+
+    SECTION("Open orders are released however the order closes") {
+        OrderBook book;
+        RiskGate gate({0, 0, 0, 2, 0});
+        auto resting = order(1, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, 100, 10);
+        REQUIRE(gate.Admit(*resting, account, 0).empty());
+        REQUIRE(book.PlaceOrder(resting));
+        auto cancelled = order(2, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, 101, 10);
+        REQUIRE(gate.Admit(*cancelled, account, 0).empty());
+        REQUIRE(book.PlaceOrder(cancelled));
+        REQUIRE(gate.Admit(*order(3, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, 102, 10), account, 0) == "Open order limit reached");
+
+        REQUIRE(book.CancelOrder(2));
+        cancelled->SetStatus(OrderStatus::CANCELLED);
+        REQUIRE(account->open_orders == 1);
+        // killed remainders close too
+        auto killed = order(4, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL, 99, 10);
+        REQUIRE(gate.Admit(*killed, account, 0).empty());
+        REQUIRE(book.PlaceOrder(killed));
+        REQUIRE(account->open_orders == 1);
+        REQUIRE(book.PlaceOrder(order(5, OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL, 100, 10)));
+        REQUIRE(account->open_orders == 0);
+    }
+
+    SECTION("Positions follow fills on both sides") {
+        OrderBook book;
+        auto other = std::make_shared<AccountRisk>();
+        RiskGate gate({0, 0, 0, 0, 15});
+        auto ask = order(1, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, 100, 10);
+        REQUIRE(gate.Admit(*ask, other, 0).empty());
+        REQUIRE(book.PlaceOrder(ask));
+        auto bid = order(2, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 100, 12);
+        REQUIRE(gate.Admit(*bid, account, 0).empty());
+        REQUIRE(book.PlaceOrder(bid));
+        REQUIRE(account->position == 10);
+        REQUIRE(other->position == -10);
+
+        REQUIRE(gate.Admit(*order(3, OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 100, 6), account, 100) == "Position limit reached");
+        REQUIRE(gate.Admit(*order(4, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, 100, 25), account, 100).empty());
+    }
+}
+
+///
+/// Throttle tests
+///
+
+TEST_CASE("Throttle admission", "[Throttle]") {
+    constexpr Timestamp INTERVAL = 1'000'000; // 1000 messages per second
+
+    SECTION("Unlimited by default") {
+        Throttle throttle;
+        REQUIRE_FALSE(throttle.IsLimited());
+        for (int i = 0; i < 1000; ++i) REQUIRE(throttle.Admit(5) == 5);
+    }
+
+    SECTION("Burst then steady rate") {
+        Throttle throttle({1000, 3, 0, ThrottlePolicy::THROTTLE_REJECT});
+        REQUIRE(throttle.IsLimited());
+        for (int i = 0; i < 3; ++i) REQUIRE(throttle.Admit(0) == 0);
+        REQUIRE(throttle.Admit(0) == Throttle::REFUSED);
+        REQUIRE(throttle.Admit(INTERVAL / 2) == Throttle::REFUSED);
+        REQUIRE(throttle.Admit(INTERVAL) == INTERVAL);
+        REQUIRE(throttle.Admit(INTERVAL) == Throttle::REFUSED);
+
+        // a quiet session earns back its burst and no more
+        Timestamp later = 100 * INTERVAL;
+        for (int i = 0; i < 3; ++i) REQUIRE(throttle.Admit(later) == later);
+        REQUIRE(throttle.Admit(later) == Throttle::REFUSED);
+    }
+
+    SECTION("Queueing delays messages up to the queue depth") {
+        Throttle throttle({1000, 1, 2, ThrottlePolicy::THROTTLE_QUEUE});
+        REQUIRE(throttle.Admit(0) == 0);
+        REQUIRE(throttle.Admit(0) == INTERVAL);
+        REQUIRE(throttle.Admit(0) == 2 * INTERVAL);
+        REQUIRE(throttle.Admit(0) == Throttle::REFUSED);
+        REQUIRE(throttle.Admit(INTERVAL) == 3 * INTERVAL);
+    }
+
+    SECTION("Queue depth only applies to the queue policy") {
+        Throttle throttle({1000, 1, 2, ThrottlePolicy::THROTTLE_DISCONNECT});
+        REQUIRE(throttle.Admit(0) == 0);
+        REQUIRE(throttle.Admit(0) == Throttle::REFUSED);
+    }
+
+    SECTION("Invalid limits") {
+        REQUIRE_THROWS_AS(Throttle({1000, 0, 0, ThrottlePolicy::THROTTLE_REJECT}), std::invalid_argument);
+        Exchange exchange;
+        REQUIRE_THROWS_AS(exchange.SetThrottleLimits({1000, 0, 0, ThrottlePolicy::THROTTLE_REJECT}), std::invalid_argument);
+    }
+}
+
+///
+/// Replication tests
+///
+
+namespace {
+
+// Check whether a server accepts connections on a local port
+bool Accepts(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in server_addr{};
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool accepted = connect(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) == 0;
+    close(sock);
+    return accepted;
+}
+
+// Runs a server on its own thread, and stops and joins it however the test ends, so a server
+// that fails to start fails its test rather than the whole run
+template <typename Server>
+class ServerThread {
+public:
+    template <typename Serve>
+    ServerThread(Server& server, Serve serve) : server_(server), thread_(std::async(std::launch::async, serve)) {}
+
+    ~ServerThread() {
+        server_.Stop();
+        if (thread_.valid()) thread_.wait();
+    }
+
+    // Wait for the server to come up; false if it returned first or took more than a few seconds
+    template <typename Up>
+    bool WaitUntil(Up up) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!up()) {
+            if (Returned(std::chrono::milliseconds(1)) || std::chrono::steady_clock::now() > deadline) return false;
+        }
+        return true;
+    }
+
+    bool Returned(std::chrono::milliseconds timeout) {
+        return thread_.wait_for(timeout) == std::future_status::ready;
+    }
+
+    // Rethrows whatever the server threw
+    void Join() {
+        thread_.get();
+    }
+
+private:
+    Server& server_;
+    std::future<void> thread_;
+};
+
+JournalEntry NewOrderEntry(OrderID id, OrderSide side, OrderPrice price, OrderQuantity quantity, const char* ticker = "AAPL") {
+    JournalEntry entry{};
+    entry.action = JournalAction::JOURNAL_NEW;
+    entry.order_id = id;
+    entry.price = price;
+    entry.quantity = quantity;
+    entry.owner = 1;
+    entry.side = side;
+    entry.type = OrderType::GOOD_TIL_CANCELED;
+    strncpy(entry.ticker, ticker, JournalEntry::TICKER_SIZE);
+    return entry;
+}
+
+}
+
+TEST_CASE("Replication to a backup", "[Replication]") {
+    SECTION("Backup applies the journal and takes over") {
+        // the backup outlives the test: its client sessions are detached threads
+        Exchange* backup = new Exchange();
+        backup->AddInstrument("AAPL");
+        {
+            ServerThread<Exchange> follower(*backup, [backup]() { backup->ServeReplication(9131); });
+            REQUIRE(follower.WaitUntil([backup]() { return backup->IsFollowing(); }));
+            {
+                Replicator replicator("127.0.0.1", 9131, ReplicationMode::REPLICATE_SYNC);
+                REQUIRE(replicator.Append(NewOrderEntry(0, OrderSide::ASK, 100, 10)) == 1);
+                replicator.Append(NewOrderEntry(1, OrderSide::BID, 100, 4));
+                replicator.Append(NewOrderEntry(2, OrderSide::ASK, 105, 5));
+                JournalEntry cancel = NewOrderEntry(2, OrderSide::ASK, 0, 0);
+                cancel.action = JournalAction::JOURNAL_CANCEL;
+                uint64_t last = replicator.Append(cancel);
+                replicator.WaitForAck(last);
+                REQUIRE(replicator.GetStats().acknowledged == 4);
+                REQUIRE(backup->GetReplicationStats().applied == 4);
+                REQUIRE_THROWS_AS(backup->Start(9132), std::runtime_error);
+            }
+            // losing the primary ends following it
+            REQUIRE(follower.Returned(std::chrono::seconds(5)));
+            follower.Join();
+        }
+
+        ServerThread<Exchange> exchange(*backup, [backup]() { backup->Start(9132); });
+        REQUIRE(exchange.WaitUntil([]() { return Accepts(9132); }));
+        Client client;
+        client.Start("127.0.0.1", 9132);
+        // order IDs carry on from the primary's, and the ask at 100 has 6 left of its 10
+        REQUIRE(client.PlaceOrder("AAPL", OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 100, 8));
+        auto bid = client.GetOrderStatus(3);
+        REQUIRE(bid.has_value());
+        REQUIRE(bid->GetFilled() == 6);
+        // the ask at 105 was cancelled
+        REQUIRE(client.PlaceOrder("AAPL", OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 105, 1));
+        REQUIRE(client.GetOrderStatus(4)->GetFilled() == 0);
+        client.Stop();
+    }
+
+    SECTION("Backup stops at an instrument it lacks") {
+        Exchange backup;
+        ServerThread<Exchange> follower(backup, [&backup]() { backup.ServeReplication(9133); });
+        REQUIRE(follower.WaitUntil([&backup]() { return backup.IsFollowing(); }));
+        Replicator replicator("127.0.0.1", 9133, ReplicationMode::REPLICATE_SYNC);
+        // returns once the backup drops the connection
+        replicator.WaitForAck(replicator.Append(NewOrderEntry(0, OrderSide::BID, 100, 1, "MSFT")));
+        REQUIRE_THROWS_AS(follower.Join(), std::runtime_error);
+        REQUIRE_FALSE(replicator.GetStats().connected);
+    }
+
+    SECTION("Promoting a backup with no primary") {
+        Exchange backup;
+        ServerThread<Exchange> follower(backup, [&backup]() { backup.ServeReplication(9134); });
+        REQUIRE(follower.WaitUntil([&backup]() { return backup.IsFollowing(); }));
+        backup.Promote();
+        REQUIRE(follower.Returned(std::chrono::seconds(5)));
+        REQUIRE_THROWS_AS(Replicator("127.0.0.1", 9134, ReplicationMode::REPLICATE_ASYNC), std::runtime_error);
+    }
+}
+
+///
+/// Gateway tests
+///
+
+TEST_CASE("Gateways in front of a matching engine", "[Engine]") {
+    // the engine and gateways outlive the test: their sessions are detached threads
+    Exchange* engine = new Exchange();
+    engine->AddInstrument("AAPL");
+    ServerThread<Exchange> engine_thread(*engine, [engine]() { engine->ServeGateways(9135); });
+    REQUIRE(engine_thread.WaitUntil([]() { return Accepts(9135); }));
+
+    // the engine refuses to open a region that is not a channel's
+    std::string foreign = "/foreign-" + std::to_string(getpid());
+    int fd = shm_open(foreign.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    REQUIRE(fd != -1);
+    close(fd);
+    int impostor = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in engine_addr{};
+    engine_addr.sin_family = AF_INET;
+    engine_addr.sin_port = htons(9135);
+    engine_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE(connect(impostor, (struct sockaddr*)&engine_addr, sizeof(engine_addr)) == 0);
+    REQUIRE(send(impostor, foreign.c_str(), foreign.size() + 1, 0) == static_cast<ssize_t>(foreign.size() + 1));
+    char byte;
+    REQUIRE(recv(impostor, &byte, 1, 0) == 0);
+    close(impostor);
+    fd = shm_open(foreign.c_str(), O_RDWR, 0);
+    REQUIRE(fd != -1);
+    close(fd);
+    shm_unlink(foreign.c_str());
+
+    // nor acts on a request it cannot place
+    {
+        int gateway_sock = socket(AF_INET, SOCK_STREAM, 0);
+        REQUIRE(connect(gateway_sock, (struct sockaddr*)&engine_addr, sizeof(engine_addr)) == 0);
+        std::string name = std::string(ShmChannel::NAME_PREFIX) + "test-engine-" + std::to_string(getpid());
+        ShmChannel channel(name, gateway_sock, true);
+        REQUIRE(send(gateway_sock, name.c_str(), name.size() + 1, 0) == static_cast<ssize_t>(name.size() + 1));
+        auto call = [&channel](EngineMessage message) {
+            REQUIRE(channel.Send(std::string_view(reinterpret_cast<char*>(&message), sizeof(message))));
+            REQUIRE(channel.Receive(reinterpret_cast<char*>(&message), sizeof(message)) == sizeof(message));
+            return message;
+        };
+        EngineMessage request{};
+        request.type = EngineMessageType::ENGINE_NEW_ORDER;
+        strncpy(request.ticker, "AAPL", EngineMessage::TICKER_SIZE);
+        request.price = 100;
+        request.quantity = 10;
+        request.side = 2;
+        EngineMessage response = call(request);
+        REQUIRE(response.type == EngineMessageType::ENGINE_REJECTED);
+        REQUIRE(std::string(response.reason) == "Invalid order type");
+        request.side = OrderSide::BID;
+        request.quantity = 0;
+        response = call(request);
+        REQUIRE(response.type == EngineMessageType::ENGINE_REJECTED);
+        REQUIRE(std::string(response.reason) == "Missing required field");
+        request.quantity = 10;
+        request.order_type = OrderType::IMMEDIATE_OR_CANCEL;
+        request.display_quantity = 5;
+        response = call(request);
+        REQUIRE(response.type == EngineMessageType::ENGINE_REJECTED);
+        REQUIRE(std::string(response.reason) == "Invalid display quantity");
+        channel.Close();
+        close(gateway_sock);
+    }
+
+    Gateway* first = new Gateway();
+    first->Connect("127.0.0.1", 9135);
+    REQUIRE_THROWS_AS(first->Connect("127.0.0.1", 9135), std::runtime_error);
+    ServerThread<Gateway> first_thread(*first, [first]() { first->Start(9136); });
+    Gateway* second = new Gateway();
+    second->Connect("127.0.0.1", 9135);
+    ServerThread<Gateway> second_thread(*second, [second]() { second->Start(9137); });
+    REQUIRE(first_thread.WaitUntil([]() { return Accepts(9136); }));
+    REQUIRE(second_thread.WaitUntil([]() { return Accepts(9137); }));
+
+    Client seller;
+    seller.Start("127.0.0.1", 9136);
+    Client buyer;
+    buyer.Start("127.0.0.1", 9137);
+
+    // orders through different gateways trade
+    REQUIRE(seller.PlaceOrder("AAPL", OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, 100, 10));
+    REQUIRE(buyer.PlaceOrder("AAPL", OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 100, 4));
+    auto ask = seller.GetOrderStatus(0);
+    REQUIRE(ask.has_value());
+    REQUIRE(ask->GetFilled() == 4);
+    REQUIRE(ask->GetStatus() == OrderStatus::OPEN);
+    auto bid = buyer.GetOrderStatus(1);
+    REQUIRE(bid.has_value());
+    REQUIRE(bid->GetStatus() == OrderStatus::CLOSED);
+    REQUIRE(seller.CancelOrder(0));
+    // the three requests refused above count too
+    REQUIRE(engine->GetGatewayStats().messages == 8);
+
+    // the engine's rejections reach the client
+    REQUIRE_FALSE(buyer.PlaceOrder("MSFT", OrderSide::BID, OrderType::GOOD_TIL_CANCELED, 100, 1));
+
+    seller.Stop();
+    buyer.Stop();
+}
+
+///
+/// Scenario tests
+///
+
+TEST_CASE("Scenario sweep", "[Scenario]") {
+    SECTION("Pool runs every task once") {
+        WorkStealingPool pool(4);
+        std::vector<std::atomic<int>> runs(1000);
+        std::atomic<unsigned> workers{0};
+        // assertions stay on the test thread
+        pool.Run(runs.size(), [&runs, &workers](size_t task, unsigned worker) {
+            ++runs[task];
+            workers |= 1u << worker;
+        });
+        for (auto& count : runs) REQUIRE(count == 1);
+        REQUIRE(workers < (1u << 4));
+        REQUIRE_THROWS_AS(pool.Run(10, [](size_t task, unsigned) {
+            if (task == 7) throw std::runtime_error("Scenario failed");
+        }), std::runtime_error);
+        // the failed batch leaves nothing behind
+        std::atomic<int> total{0};
+        pool.Run(5, [&total](size_t, unsigned) { ++total; });
+        REQUIRE(total == 5);
+    }
+
+    SECTION("Results do not depend on the workers") {
+        std::vector<ScenarioParams> scenarios(8);
+        for (size_t i = 0; i < scenarios.size(); ++i) {
+            scenarios[i].seed = i + 1;
+            scenarios[i].steps = 2000;
+            scenarios[i].instruments = 2;
+        }
+        std::vector<ScenarioResult> serial;
+        SweepStats one = ScenarioSweep(1).Run(scenarios, &serial);
+        std::vector<ScenarioResult> parallel;
+        SweepStats four = ScenarioSweep(4).Run(scenarios, &parallel);
+        REQUIRE(one.scenarios == 8);
+        REQUIRE(one.orders == four.orders);
+        REQUIRE(one.trades == four.trades);
+        REQUIRE(one.trades > 0);
+        REQUIRE(one.cancelled > 0);
+        uint64_t orders = 0;
+        for (size_t i = 0; i < scenarios.size(); ++i) {
+            REQUIRE(serial[i].traded_quantity == parallel[i].traded_quantity);
+            REQUIRE(serial[i].last_price == parallel[i].last_price);
+            orders += serial[i].orders;
+        }
+        REQUIRE(orders == one.orders);
+    }
+
+    SECTION("Scenarios need agents") {
+        ScenarioParams empty;
+        empty.market_makers = empty.takers = empty.noise_traders = 0;
+        REQUIRE_THROWS_AS(ScenarioSweep::RunScenario(empty), std::invalid_argument);
+    }
+}
+
+///
+/// OrderFlow tests
+///
+
+TEST_CASE("Synthetic order flow", "[OrderFlow]") {
+    FlowParams params;
+    params.instruments = 2;
+
+    SECTION("Flows are reproducible and streams keep their IDs apart") {
+        std::vector<std::vector<FlowEvent>> flows = OrderFlow::Generate(params, 3, 5000, 2);
+        OrderFlow again(params, 1);
+        for (const auto& event : flows[1]) {
+            FlowEvent repeated = again.Next();
+            REQUIRE(repeated.time == event.time);
+            REQUIRE(memcmp(&repeated.command, &event.command, sizeof(ReplayCommand)) == 0);
+        }
+        for (uint32_t stream = 0; stream < 3; ++stream) {
+            Timestamp last = 0;
+            for (const auto& event : flows[stream]) {
+                REQUIRE(event.time >= last);
+                REQUIRE(event.command.order_id >> OrderFlow::STREAM_SHIFT == stream);
+                REQUIRE(event.command.instrument < 2);
+                last = event.time;
+            }
+        }
+    }
+
+    SECTION("Arrival rates match the process") {
+        params.rate = 1000;
+        params.maker_share = 0;
+        OrderFlow poisson(params);
+        FlowEvent event{};
+        size_t events = 0;
+        // without market makers every event is one command
+        for (; events < 100000; ++events) event = poisson.Next();
+        REQUIRE(events / (event.time / 1e9) == Approx(1000).epsilon(0.03));
+
+        params.arrival = ArrivalProcess::ARRIVAL_HAWKES;
+        params.excitation = 0.5;
+        params.decay = 100;
+        OrderFlow hawkes(params);
+        for (events = 0; events < 200000; ++events) event = hawkes.Next();
+        // the stationary rate of a Hawkes process is the baseline over 1 - the branching ratio
+        REQUIRE(events / (event.time / 1e9) == Approx(2000).epsilon(0.05));
+    }
+
+    SECTION("Flow drives books") {
+        std::vector<std::unique_ptr<OrderBook>> books;
+        uint64_t trades = 0;
+        for (int i = 0; i < 2; ++i) {
+            books.push_back(std::make_unique<OrderBook>());
+            books.back()->SetTradeHandler([&trades](const Trade&) { ++trades; });
+        }
+        OrderFlow flow(params);
+        FlowStats stats = OrderFlow::RunBooks(flow, books, 20000);
+        REQUIRE(stats.events == 20000);
+        REQUIRE(stats.orders + stats.cancels == 20000);
+        REQUIRE(stats.cancels > 0);
+        REQUIRE(trades > 0);
+        REQUIRE(books[0]->GetLastPrice() > 0);
+    }
+
+    SECTION("Invalid flows are refused") {
+        FlowParams bad = params;
+        bad.arrival = ArrivalProcess::ARRIVAL_HAWKES;
+        bad.excitation = 1;
+        REQUIRE_THROWS_AS(OrderFlow(bad), std::invalid_argument);
+        bad = params;
+        bad.cancel_ratio = 1.5;
+        REQUIRE_THROWS_AS(OrderFlow(bad), std::invalid_argument);
+        bad = params;
+        bad.market_makers = 0;
+        REQUIRE_THROWS_AS(OrderFlow(bad), std::invalid_argument);
+    }
+}
+
+///
+/// Replay tests
+///
+
+TEST_CASE("Replay from recorded files", "[Replay]") {
+    std::string csv_path = "replay_test.csv";
+    std::string binary_path = "replay_test.bin";
+    std::string events_path = "replay_test_events.csv";
+    {
+        std::ofstream csv(csv_path);
+        csv << "# action,ticker,id,side,type,price,quantity\n"
+            << "N,AAPL,1,B,GTC,15000,100\n"
+            << "N,MSFT,2,S,GTC,30000,50\n"
+            << "N,AAPL,3,S,GTC,14900,60\n"
+            << "N,MSFT,4,B,FOK,30000,80\n"
+            << "N,AAPL,5,S,IOC,15000,100\n"
+            << "C,MSFT,2\n"
+            << "C,AAPL,1\n"
+            << "C,AAPL,1\n";
+    }
+
+    SECTION("CSV input") {
+        Replay replay(csv_path);
+        REQUIRE(replay.GetCommandCount() == 8);
+        REQUIRE(replay.GetInstruments() == std::vector<std::string>{"AAPL", "MSFT"});
+
+        ReplayStats stats = replay.Run(1, events_path);
+        REQUIRE(stats.commands == 8);
+        REQUIRE(stats.trades == 2);
+        REQUIRE(stats.traded_quantity == 100);
+        REQUIRE(stats.rested == 2);
+        REQUIRE(stats.cancelled == 1);
+        REQUIRE(stats.rejected == 3); // FOK without liquidity and cancels of the filled order
+
+        std::ifstream events(events_path);
+        std::string line;
+        std::vector<std::string> lines;
+        while (std::getline(events, line)) lines.push_back(line);
+        REQUIRE(lines.size() == 8);
+        REQUIRE(lines[0] == "A,AAPL,1,B,15000,100");
+        REQUIRE(lines[2] == "T,AAPL,3,1,15000,60");
+        REQUIRE(lines[4] == "T,AAPL,5,1,15000,40");
+    }
+
+    SECTION("Binary round trip and multiple threads") {
+        Replay csv(csv_path);
+        csv.SaveBinary(binary_path);
+
+        Replay binary(binary_path);
+        REQUIRE(binary.GetCommandCount() == csv.GetCommandCount());
+        REQUIRE(binary.GetInstruments() == csv.GetInstruments());
+
+        ReplayStats single = csv.Run(1);
+        ReplayStats threaded = binary.Run(2);
+        REQUIRE(threaded.commands == single.commands);
+        REQUIRE(threaded.trades == single.trades);
+        REQUIRE(threaded.traded_quantity == single.traded_quantity);
+        REQUIRE(threaded.rejected == single.rejected);
+    }
+
+    SECTION("Malformed input") {
+        std::ofstream(csv_path) << "N,AAPL,1,X,GTC,15000,100\n";
+        REQUIRE_THROWS_AS(Replay(csv_path), std::invalid_argument);
+        REQUIRE_THROWS_AS(Replay("replay_test_missing.csv"), std::runtime_error);
+
+        // stops need a stop price, and types past MARKET are no type at all
+        for (uint8_t type : {static_cast<uint8_t>(OrderType::STOP), static_cast<uint8_t>(OrderType::MARKET + 1)}) {
+            ReplayCommand command{ReplayAction::REPLAY_NEW, OrderSide::BID, type, 0, 0, 1, 15000, 100};
+            Replay::WriteBinary(binary_path, {"AAPL"}, &command, 1);
+            REQUIRE_THROWS_AS(Replay(binary_path), std::invalid_argument);
+        }
+    }
+
+    std::remove(csv_path.c_str());
+    std::remove(binary_path.c_str());
+    std::remove(events_path.c_str());
+}
+
 ///
 /// Exchange tests
 ///
@@ -726,6 +2251,143 @@ TEST_CASE("Exchange error handling", "[Exchange]") {
     exchange_thread.wait();
 }
 
+TEST_CASE("FixEncoder responses", "[FixEncoder]") {
+    FixEncoder encoder;
+    std::map<int, std::string> fields;
+
+    SECTION("Logon response") {
+        std::string_view message = encoder.EncodeLogonResponse();
+        REQUIRE(parseFixMessage(std::string(message), "A", fields));
+        REQUIRE(fields[hffix::tag::SenderCompID] == "SERVER");
+        REQUIRE(fields[hffix::tag::TargetCompID] == "CLIENT");
+        REQUIRE(fields[hffix::tag::EncryptMethod] == "0");
+    }
+
+    SECTION("New order acknowledgement") {
+        Order order(1234567890123ULL, "AAPL", 15000, 100, OrderSide::ASK, OrderType::IMMEDIATE_OR_CANCEL);
+        std::string_view message = encoder.EncodeNewOrderAck(order);
+        REQUIRE(parseFixMessage(std::string(message), "8", fields));
+        REQUIRE(fields[hffix::tag::OrderID] == "1234567890123");
+        REQUIRE(fields[hffix::tag::ExecType] == "0");
+        REQUIRE(fields[hffix::tag::OrdStatus] == "0");
+        REQUIRE(fields[hffix::tag::Symbol] == "AAPL");
+        REQUIRE(fields[hffix::tag::Side] == "2");
+        REQUIRE(fields[hffix::tag::OrdType] == "4");
+        REQUIRE(fields[hffix::tag::OrderQty] == "100");
+        REQUIRE(fields[hffix::tag::Price] == "15000");
+    }
+
+    SECTION("Order status of a partially filled order") {
+        Order order(7, "MSFT", 30000, 75, OrderSide::BID, OrderType::GOOD_TIL_CANCELED);
+        order.Fill(25);
+        std::string_view message = encoder.EncodeOrderStatus(order);
+        REQUIRE(parseFixMessage(std::string(message), "8", fields));
+        REQUIRE(fields[hffix::tag::ExecType] == "I");
+        REQUIRE(fields[hffix::tag::OrdStatus] == "1");
+        REQUIRE(fields[hffix::tag::CumQty] == "25");
+        REQUIRE(fields[hffix::tag::LeavesQty] == "50");
+    }
+
+    SECTION("Expiry report") {
+        Order order(9, "MSFT", 30000, 75, OrderSide::BID, OrderType::GOOD_TIL_DATE, 0, 0, PegType::NO_PEG, 0, 1700000000000000000ULL);
+        order.Fill(25);
+        order.SetStatus(OrderStatus::EXPIRED);
+        REQUIRE(parseFixMessage(std::string(encoder.EncodeExpiry(order)), "8", fields));
+        REQUIRE(fields[hffix::tag::ExecType] == "C");
+        REQUIRE(fields[hffix::tag::OrdStatus] == "C");
+        REQUIRE(fields[hffix::tag::OrdType] == "6");
+        REQUIRE(fields[hffix::tag::CumQty] == "25");
+        REQUIRE(fields[hffix::tag::LeavesQty] == "0");
+        fields.clear();
+        REQUIRE(parseFixMessage(std::string(encoder.EncodeOrderStatus(order)), "8", fields));
+        REQUIRE(fields[hffix::tag::OrdStatus] == "C");
+        REQUIRE(fields[hffix::tag::ExpireTime] == "1700000000000000000");
+    }
+
+    SECTION("Buffer is reused across messages") {
+        REQUIRE(parseFixMessage(std::string(encoder.EncodeCancelOrderAck(42)), "8", fields));
+        REQUIRE(fields[hffix::tag::OrderID] == "42");
+        fields.clear();
+        REQUIRE(parseFixMessage(std::string(encoder.EncodeCancelOrderAck(0)), "8", fields));
+        REQUIRE(fields[hffix::tag::OrderID] == "0");
+        REQUIRE(fields[hffix::tag::ExecType] == "4");
+    }
+
+    SECTION("Oversized rejection reason is truncated") {
+        std::string reason(4 * BUFFER_SIZE, 'x');
+        std::string_view message = encoder.EncodeRejection(reason);
+        REQUIRE(message.size() <= BUFFER_SIZE);
+        REQUIRE(parseFixMessage(std::string(message), "3", fields));
+        REQUIRE(fields[hffix::tag::Text].size() < reason.size());
+    }
+}
+
+TEST_CASE("FixDecoder new orders", "[FixEncoder]") {
+    auto decode = [](const std::vector<std::pair<int, std::string>>& fields, OrderRequest& request) {
+        std::string message = createFixMessage("D", fields);
+        hffix::message_reader reader(message.data(), message.data() + message.size());
+        return std::string(FixDecoder::DecodeNewOrder(reader, request));
+    };
+
+    SECTION("A GTC without a price is a market order") {
+        OrderRequest request;
+        REQUIRE(decode({{hffix::tag::Symbol, "AAPL"}, {hffix::tag::Side, "1"}, {hffix::tag::OrdType, "1"},
+            {hffix::tag::OrderQty, "10"}}, request).empty());
+        REQUIRE(request.type == OrderType::MARKET);
+    }
+
+    SECTION("Other limit orders need a price") {
+        for (const char* type : {"0", "3", "4", "6"}) {
+            OrderRequest request;
+            REQUIRE(decode({{hffix::tag::Symbol, "AAPL"}, {hffix::tag::Side, "1"}, {hffix::tag::OrdType, type},
+                {hffix::tag::OrderQty, "10"}, {hffix::tag::ExpireTime, "9000000000000000000"}}, request) == "Missing required field");
+        }
+        OrderRequest request;
+        REQUIRE(decode({{hffix::tag::Symbol, "AAPL"}, {hffix::tag::Side, "1"}, {hffix::tag::OrdType, "4"},
+            {hffix::tag::Price, "0"}, {hffix::tag::OrderQty, "10"}}, request) == "Missing required field");
+        REQUIRE(decode({{hffix::tag::Symbol, "AAPL"}, {hffix::tag::Side, "1"}, {hffix::tag::OrdType, "4"},
+            {hffix::tag::Price, "100"}, {hffix::tag::OrderQty, "10"}}, request).empty());
+    }
+
+    SECTION("Requests from elsewhere meet the same rules") {
+        OrderRequest request;
+        request.ticker = "AAPL";
+        request.price = 100;
+        request.quantity = 10;
+        REQUIRE(FixDecoder::ValidateNewOrder(request).empty());
+        OrderRequest invalid = request;
+        invalid.type = static_cast<OrderType>(OrderType::MARKET + 1);
+        REQUIRE(FixDecoder::ValidateNewOrder(invalid) == "Invalid order type");
+        invalid = request;
+        invalid.quantity = 0;
+        REQUIRE(FixDecoder::ValidateNewOrder(invalid) == "Missing required field");
+        invalid = request;
+        invalid.type = OrderType::STOP_LIMIT;
+        REQUIRE(FixDecoder::ValidateNewOrder(invalid) == "Missing required field");
+        invalid = request;
+        invalid.display_quantity = 11;
+        REQUIRE(FixDecoder::ValidateNewOrder(invalid) == "Invalid display quantity");
+        invalid = request;
+        invalid.type = OrderType::FILL_OR_KILL;
+        invalid.peg_type = PegType::MIDPOINT_PEG;
+        REQUIRE(FixDecoder::ValidateNewOrder(invalid) == "Invalid peg type");
+        invalid = request;
+        invalid.type = OrderType::GOOD_TIL_DATE;
+        REQUIRE(FixDecoder::ValidateNewOrder(invalid) == "Invalid expire time");
+    }
+
+    SECTION("Stop and pegged orders do without one") {
+        OrderRequest stop;
+        REQUIRE(decode({{hffix::tag::Symbol, "AAPL"}, {hffix::tag::Side, "1"}, {hffix::tag::OrdType, "4"},
+            {hffix::tag::StopPx, "100"}, {hffix::tag::OrderQty, "10"}}, stop).empty());
+        REQUIRE(stop.type == OrderType::STOP);
+        OrderRequest pegged;
+        REQUIRE(decode({{hffix::tag::Symbol, "AAPL"}, {hffix::tag::Side, "1"}, {hffix::tag::OrdType, "0"},
+            {hffix::tag::ExecInst, "M"}, {hffix::tag::OrderQty, "10"}}, pegged).empty());
+        REQUIRE(pegged.peg_type == PegType::MIDPOINT_PEG);
+    }
+}
+
 ///
 /// Client tests
 ///
@@ -943,4 +2605,289 @@ TEST_CASE("Client stress test", "[Client]") {
 
     client.Stop();
     server.Stop();
-}
\ No newline at end of file
+}
+
+///
+/// ShmChannel tests
+///
+
+TEST_CASE("ShmChannel messaging", "[ShmChannel]") {
+    int socks[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, socks) == 0);
+    std::string name = "/sx-test-" + std::to_string(getpid());
+    char buffer[BUFFER_SIZE];
+
+    SECTION("Messages in both directions") {
+        ShmChannel client(name, socks[0], true);
+        ShmChannel exchange(name, socks[1], false);
+
+        REQUIRE(client.Send("8=FIX.4.2|35=D|"));
+        ssize_t len = exchange.Receive(buffer, BUFFER_SIZE);
+        REQUIRE(std::string(buffer, len) == "8=FIX.4.2|35=D|");
+        REQUIRE(exchange.Send("8=FIX.4.2|35=8|"));
+        len = client.Receive(buffer, BUFFER_SIZE);
+        REQUIRE(std::string(buffer, len) == "8=FIX.4.2|35=8|");
+    }
+
+    SECTION("Ring wraps around under a concurrent consumer") {
+        ShmChannel client(name, socks[0], true);
+        ShmChannel exchange(name, socks[1], false);
+        const int NUM_MESSAGES = 100000;
+
+        std::thread producer([&client]() {
+            for (int i = 0; i < NUM_MESSAGES; ++i) client.Send(std::string(i % 200 + 1, 'a' + i % 26));
+        });
+        bool intact = true;
+        for (int i = 0; i < NUM_MESSAGES; ++i) {
+            ssize_t len = exchange.Receive(buffer, BUFFER_SIZE);
+            intact &= std::string(buffer, len) == std::string(i % 200 + 1, 'a' + i % 26);
+        }
+        producer.join();
+        REQUIRE(intact);
+    }
+
+    SECTION("Close and disconnect wake the receiver") {
+        ShmChannel client(name, socks[0], true);
+        ShmChannel exchange(name, socks[1], false);
+        std::future<ssize_t> received = std::async(std::launch::async, [&exchange, &buffer]() {
+            return exchange.Receive(buffer, BUFFER_SIZE);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        client.Close();
+        REQUIRE(received.get() == 0);
+        REQUIRE_FALSE(exchange.Send("late"));
+    }
+
+    SECTION("Opening a missing region fails") {
+        REQUIRE_THROWS_AS(ShmChannel(name, socks[1], false), std::runtime_error);
+    }
+
+    SECTION("Names, sizes and records from the peer are checked") {
+        // other shared memory objects are neither opened nor unlinked
+        std::string foreign = "/other-test-" + std::to_string(getpid());
+        int fd = shm_open(foreign.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        REQUIRE(fd != -1);
+        REQUIRE(ftruncate(fd, 64) == 0);
+        close(fd);
+        REQUIRE_THROWS_AS(ShmChannel(foreign, socks[1], false), std::runtime_error);
+        REQUIRE_THROWS_AS(ShmChannel("/sx-../other", socks[1], false), std::runtime_error);
+        fd = shm_open(foreign.c_str(), O_RDWR, 0);
+        REQUIRE(fd != -1);
+        close(fd);
+        shm_unlink(foreign.c_str());
+
+        // nor is a channel-named object too small to be one
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        REQUIRE(fd != -1);
+        REQUIRE(ftruncate(fd, 4096) == 0);
+        close(fd);
+        REQUIRE_THROWS_AS(ShmChannel(name, socks[1], false), std::runtime_error);
+        fd = shm_open(name.c_str(), O_RDWR, 0);
+        REQUIRE(fd != -1);
+        close(fd);
+        shm_unlink(name.c_str());
+
+        // a record length past the end of the ring closes the channel instead of being copied
+        ShmChannel client(name, socks[0], true);
+        fd = shm_open(name.c_str(), O_RDWR, 0);
+        REQUIRE(fd != -1);
+        char* region = static_cast<char*>(mmap(nullptr, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        close(fd);
+        REQUIRE(region != MAP_FAILED);
+        ShmChannel exchange(name, socks[1], false);
+        REQUIRE(client.Send("8=FIX.4.2|35=D|"));
+        // the first ring's records start after its tail and head, each on a cache line of its own
+        uint32_t length = ShmChannel::RING_SIZE;
+        memcpy(region + 128, &length, sizeof(length));
+        munmap(region, 4096);
+        REQUIRE(exchange.Receive(buffer, BUFFER_SIZE) == 0);
+        REQUIRE_FALSE(client.Send("late"));
+    }
+
+    close(socks[0]);
+    close(socks[1]);
+}
+
+///
+/// UringGateway tests
+///
+
+TEST_CASE("UringGateway serving clients", "[Gateway]") {
+    if (!UringGateway::IsSupported()) return;
+
+    int listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    REQUIRE(bind(listen_sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+    REQUIRE(listen(listen_sock, 16) == 0);
+    REQUIRE(getsockname(listen_sock, reinterpret_cast<sockaddr*>(&address), &address_len) == 0);
+
+    // echoes every message and hangs up on a test request
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> syscalls{0};
+    UringGateway gateway(listen_sock);
+    std::future<void> gateway_thread = std::async(std::launch::async, [&]() {
+        gateway.Run(running, [](Session& session, hffix::message_reader& reader, bool) {
+            for (auto field : reader) {
+                if (field.tag() == hffix::tag::MsgType && field.value() == "1") return false;
+            }
+            return session.Send(std::string_view(reader.message_begin(), reader.message_end() - reader.message_begin()));
+        }, syscalls);
+    });
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(connect(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+    char buffer[BUFFER_SIZE];
+
+    SECTION("Messages are echoed, including ones split across receives") {
+        std::string first = createFixMessage("0", {{hffix::tag::TestReqID, "A"}});
+        std::string second = createFixMessage("0", {{hffix::tag::TestReqID, "B"}});
+        std::string both = first + second;
+        REQUIRE(send(sock, both.data(), both.size() - 5, 0) == static_cast<ssize_t>(both.size() - 5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        REQUIRE(send(sock, both.data() + both.size() - 5, 5, 0) == 5);
+
+        std::string echoed;
+        while (echoed.size() < both.size()) {
+            ssize_t len = recv(sock, buffer, BUFFER_SIZE, 0);
+            REQUIRE(len > 0);
+            echoed.append(buffer, len);
+        }
+        REQUIRE(echoed == both);
+    }
+
+    SECTION("A rejected message closes the connection") {
+        std::string request = createFixMessage("1", {{hffix::tag::TestReqID, "A"}});
+        REQUIRE(send(sock, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size()));
+        REQUIRE(recv(sock, buffer, BUFFER_SIZE, 0) == 0);
+    }
+
+    close(sock);
+    running = false;
+    gateway_thread.wait();
+    REQUIRE(syscalls > 0);
+    close(listen_sock);
+}
+
+///
+/// Thread placement tests
+///
+
+TEST_CASE("Thread placement", "[ThreadPlacement]") {
+    SECTION("Pinning a thread") {
+        std::thread([]() {
+            CpuAffinity::PinCurrentThread(0);
+            REQUIRE(sched_getcpu() == 0);
+            CpuAffinity::UnpinCurrentThread();
+        }).join();
+        REQUIRE_THROWS_AS(CpuAffinity::PinCurrentThread(-1), std::runtime_error);
+        REQUIRE_THROWS_AS(CpuAffinity::PinCurrentThread(CPU_SETSIZE), std::runtime_error);
+    }
+
+    SECTION("Core availability and nodes") {
+        REQUIRE(CpuAffinity::IsAvailable(0));
+        REQUIRE_FALSE(CpuAffinity::IsAvailable(-1));
+        REQUIRE_FALSE(CpuAffinity::IsAvailable(CPU_SETSIZE - 1));
+        REQUIRE(CpuAffinity::GetNode(0) >= 0);
+        REQUIRE(CpuAffinity::GetNode(CPU_SETSIZE) == 0);
+    }
+
+    SECTION("Exchange rejects unavailable cores") {
+        Exchange exchange;
+        ThreadPlacement placement;
+        placement.session_cpus = {0};
+        placement.numa_local = true;
+        REQUIRE_NOTHROW(exchange.SetThreadPlacement(placement));
+        REQUIRE_NOTHROW(exchange.AddInstrument("AAPL"));
+        placement.acceptor_cpu = CPU_SETSIZE - 1;
+        REQUIRE_THROWS_AS(exchange.SetThreadPlacement(placement), std::invalid_argument);
+    }
+}
+
+///
+/// Latency tests
+///
+
+TEST_CASE("LatencyHistogram recording", "[Latency]") {
+    LatencyHistogram histogram;
+
+    SECTION("Empty histogram") {
+        REQUIRE(histogram.GetCount() == 0);
+        REQUIRE(histogram.GetMin() == 0);
+        REQUIRE(histogram.GetMax() == 0);
+        REQUIRE(histogram.GetValueAtPercentile(99) == 0);
+    }
+
+    SECTION("Small values are exact") {
+        for (uint64_t i = 1; i <= 100; ++i) histogram.Record(i);
+        REQUIRE(histogram.GetCount() == 100);
+        REQUIRE(histogram.GetMin() == 1);
+        REQUIRE(histogram.GetMax() == 100);
+        REQUIRE(histogram.GetValueAtPercentile(50) == 50);
+        REQUIRE(histogram.GetValueAtPercentile(99) == 99);
+        REQUIRE(histogram.GetMean() == Approx(50.5));
+    }
+
+    SECTION("Large values are within relative precision") {
+        for (uint64_t value : {1000ULL, 123456ULL, 987654321ULL}) {
+            LatencyHistogram single;
+            single.Record(value);
+            single.Record(value * 2);
+            uint64_t reported = single.GetValueAtPercentile(50);
+            REQUIRE(reported >= value);
+            REQUIRE(reported <= value + value / 50);
+        }
+    }
+
+    SECTION("Merge combines samples") {
+        LatencyHistogram other;
+        histogram.Record(10);
+        other.Record(1000);
+        other.Record(2000);
+        histogram.Merge(other);
+        REQUIRE(histogram.GetCount() == 3);
+        REQUIRE(histogram.GetMin() == 10);
+        REQUIRE(histogram.GetMax() == 2000);
+    }
+}
+
+TEST_CASE("LatencyRecorder merges threads", "[Latency]") {
+    LatencyRecorder::Reset();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([]() {
+            for (int j = 0; j < 1000; ++j) LatencyRecorder::Record(LatencyStage::PLACE_ORDER, 100);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    LatencyRecorder::Record(LatencyStage::SEND, 100);
+
+    LatencyReport report = LatencyRecorder::Snapshot();
+    REQUIRE(report[LatencyStage::PLACE_ORDER].GetCount() == 4000);
+    REQUIRE(report[LatencyStage::SEND].GetCount() == 1);
+    REQUIRE(report[LatencyStage::DECODE].GetCount() == 0);
+}
+
+TEST_CASE("LatencyRecorder leaves the wait out of receives", "[Latency]") {
+    int socks[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, socks) == 0);
+    LatencyRecorder::Reset();
+
+    Session session(socks[1]);
+    std::thread sender([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        REQUIRE(send(socks[0], "8=FIX.4.2|35=D|", 15, 0) == 15);
+    });
+    char buffer[BUFFER_SIZE];
+    REQUIRE(session.Receive(buffer, BUFFER_SIZE) == 15);
+    sender.join();
+
+    LatencyReport report = LatencyRecorder::Snapshot();
+    REQUIRE(report[LatencyStage::RECEIVE].GetCount() == 1);
+    REQUIRE(Clock::TicksToNanos(report[LatencyStage::RECEIVE].GetMax()) < 25'000'000);
+    close(socks[0]);
+    close(socks[1]);
+}
@@ -0,0 +1,140 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "book_view.hpp"
+#include "latency.hpp"
+#include "order_flow.hpp"
+#include "thread_placement.hpp"
+
+namespace {
+
+/**
+ * @struct RunResult
+ * Matching latency of one run, and how much the readers read meanwhile.
+ */
+struct RunResult {
+    LatencyHistogram latencies; ///< Nanoseconds per command, publishing included.
+    uint64_t reads = 0; ///< Views copied by all readers.
+    double seconds = 0; ///< Time the writer took.
+};
+
+/**
+ * Apply synthetic order flow to a book, timing every command, while readers copy its views as
+ * fast as they can.
+ *
+ * @param publish Whether a view is published after every command.
+ */
+RunResult Run(const std::vector<ReplayCommand>& commands, bool publish, size_t depth, unsigned readers,
+    const std::vector<int>& reader_cpus) {
+    OrderBook book;
+    auto publisher = std::make_shared<BookViewPublisher>(depth);
+    publisher->Publish(book);
+
+    RunResult result;
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> reads{0};
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < readers; ++i) {
+        threads.emplace_back([&, i]() {
+            if (!reader_cpus.empty()) CpuAffinity::PinCurrentThread(reader_cpus[i % reader_cpus.size()]);
+            BookViewReader reader(publisher);
+            BookView view;
+            uint64_t count = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                if (reader.Read(view)) ++count;
+            }
+            reads.fetch_add(count);
+        });
+    }
+
+    std::string ticker = OrderFlow::GetTicker(0);
+    uint64_t start = CurrentTime();
+    for (const ReplayCommand& command : commands) {
+        std::shared_ptr<Order> order;
+        if (command.action == ReplayAction::REPLAY_NEW) {
+            order = std::make_shared<Order>(command.order_id, ticker, command.price, command.quantity,
+                static_cast<OrderSide>(command.side), static_cast<OrderType>(command.type));
+        }
+        uint64_t begin = CurrentTime();
+        if (order) book.PlaceOrder(order);
+        else if (book.HasOrder(command.order_id)) book.CancelOrder(command.order_id);
+        if (publish) publisher->Publish(book);
+        result.latencies.Record(CurrentTime() - begin);
+    }
+    result.seconds = (CurrentTime() - start) / 1e9;
+
+    done.store(true);
+    for (auto& thread : threads) thread.join();
+    result.reads = reads.load();
+    return result;
+}
+
+/**
+ * Print one run as a row of the report.
+ */
+void Print(const char* name, const RunResult& result) {
+    std::cout << name << "p50/p99/p99.9 " << result.latencies.GetValueAtPercentile(50.0) << "/"
+              << result.latencies.GetValueAtPercentile(99.0) << "/" << result.latencies.GetValueAtPercentile(99.9)
+              << "ns, reads " << static_cast<uint64_t>(result.reads / result.seconds) << "/s" << std::endl;
+}
+
+}
+
+/**
+ * Measures what publishing book views costs matching, and whether readers copying the views
+ * add to it: the latency of every command of a synthetic flow without views, with views but
+ * no readers, and with views and busy readers.
+ *
+ * Usage: book_view_bench [--events N] [--depth N] [--readers N] [--writer-cpu N] [--reader-cpus N,N,...] [--seed N]
+ *
+ * Readers should be pinned to cores other than the writer's; on a shared core they compete
+ * with it for time rather than for cache lines.
+ */
+int main(int argc, char** argv) {
+    size_t events = 1000000;
+    size_t depth = 10;
+    unsigned readers = 2;
+    int writer_cpu = -1;
+    std::vector<int> reader_cpus;
+    FlowParams params;
+    params.instruments = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--events") && i + 1 < argc) events = std::strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--depth") && i + 1 < argc) depth = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--readers") && i + 1 < argc) readers = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--writer-cpu") && i + 1 < argc) writer_cpu = std::strtol(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--reader-cpus") && i + 1 < argc) {
+            for (char* cpu = std::strtok(argv[++i], ","); cpu; cpu = std::strtok(nullptr, ",")) {
+                reader_cpus.push_back(std::strtol(cpu, nullptr, 10));
+            }
+        }
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) params.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        if (writer_cpu >= 0) CpuAffinity::PinCurrentThread(writer_cpu);
+        OrderFlow flow(params, 0);
+        std::vector<ReplayCommand> commands;
+        commands.reserve(events);
+        for (size_t i = 0; i < events; ++i) commands.push_back(flow.Next().command);
+
+        std::cout << "Commands:  " << events << ", views of " << depth << " levels, " << readers << " readers\n";
+        Print("No views:            ", Run(commands, false, depth, 0, reader_cpus));
+        Print("Views, no readers:   ", Run(commands, true, depth, 0, reader_cpus));
+        Print("Views and readers:   ", Run(commands, true, depth, readers, reader_cpus));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "exchange.hpp"
+
+/**
+ * Runs a matching engine that gateway processes attach to.
+ *
+ * Usage: engine <instrument>... [--port N] [--session-cpus N,N,...] [--memory-report SECONDS]
+ *
+ * With --memory-report, the footprint of every book is printed to standard error at that interval.
+ */
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <instrument>... [--port N] [--session-cpus N,N,...] [--memory-report SECONDS]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> instruments;
+    int port = 9200;
+    ThreadPlacement placement;
+    unsigned memory_report = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--port") && i + 1 < argc) port = std::strtol(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--session-cpus") && i + 1 < argc) {
+            for (char* cpu = std::strtok(argv[++i], ","); cpu; cpu = std::strtok(nullptr, ",")) {
+                placement.session_cpus.push_back(std::strtol(cpu, nullptr, 10));
+            }
+        }
+        else if (!strcmp(argv[i], "--memory-report") && i + 1 < argc) memory_report = std::strtoul(argv[++i], nullptr, 10);
+        else if (argv[i][0] != '-') instruments.push_back(argv[i]);
+        else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        Exchange exchange;
+        // every gateway link is served by a session thread, placed like one
+        exchange.SetThreadPlacement(placement);
+        for (const auto& instrument : instruments) exchange.AddInstrument(instrument);
+        if (memory_report) exchange.SetMemoryReport(&std::cerr, std::chrono::seconds(memory_report));
+        exchange.ServeGateways(port);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
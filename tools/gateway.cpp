@@ -0,0 +1,36 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "gateway.hpp"
+
+/**
+ * Runs a gateway serving FIX clients in front of a matching engine process.
+ *
+ * Usage: gateway [--engine-host HOST] [--engine-port N] [--port N]
+ */
+int main(int argc, char** argv) {
+    std::string engine_host = "127.0.0.1";
+    int engine_port = 9200;
+    int port = 9000;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--engine-host") && i + 1 < argc) engine_host = argv[++i];
+        else if (!strcmp(argv[i], "--engine-port") && i + 1 < argc) engine_port = std::strtol(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) port = std::strtol(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        Gateway gateway;
+        gateway.Connect(engine_host, engine_port);
+        gateway.Start(port);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
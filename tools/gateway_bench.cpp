@@ -0,0 +1,174 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "client.hpp"
+#include "exchange.hpp"
+#include "gateway.hpp"
+
+/**
+ * Drives the exchange gateway with concurrent clients and prints message throughput, network
+ * syscalls per message and the order round trip latency seen by the clients.
+ *
+ * Usage: gateway_bench [--backend sockets|io_uring] [--clients N] [--orders N] [--port N]
+ *                      [--acceptor-cpu N] [--session-cpus N,N,...] [--busy-poll] [--numa-local]
+ *                      [--capacity ORDERS] [--huge-pages]
+ *                      [--rate MESSAGES_PER_SECOND] [--burst N] [--queue N] [--max-pending N]
+ *                      [--backup sync|async] [--gateway]
+ *
+ * With --backup, a backup exchange in the same process follows the benched one on the next port.
+ * With --gateway, the clients reach the exchange through a gateway attached to it as a matching
+ * engine on the port after that, so the round trip includes the shared memory hop.
+ */
+int main(int argc, char** argv) {
+    GatewayBackend backend = GatewayBackend::SOCKETS;
+    unsigned clients = 8;
+    unsigned orders = 10000;
+    int port = 9100;
+    ThreadPlacement placement;
+    BookCapacity capacity;
+    ThrottleLimits limits;
+    uint32_t max_pending = 0;
+    bool replicate = false;
+    bool gateway = false;
+    ReplicationMode replication = ReplicationMode::REPLICATE_SYNC;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--backend") && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "sockets") backend = GatewayBackend::SOCKETS;
+            else if (name == "io_uring") backend = GatewayBackend::IO_URING;
+            else {
+                std::cerr << "Unknown backend " << name << std::endl;
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--clients") && i + 1 < argc) clients = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--orders") && i + 1 < argc) orders = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) port = std::strtol(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--acceptor-cpu") && i + 1 < argc) placement.acceptor_cpu = std::strtol(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--session-cpus") && i + 1 < argc) {
+            for (char* cpu = std::strtok(argv[++i], ","); cpu; cpu = std::strtok(nullptr, ",")) {
+                placement.session_cpus.push_back(std::strtol(cpu, nullptr, 10));
+            }
+        }
+        else if (!strcmp(argv[i], "--busy-poll")) placement.busy_poll = true;
+        else if (!strcmp(argv[i], "--numa-local")) placement.numa_local = true;
+        else if (!strcmp(argv[i], "--capacity") && i + 1 < argc) {
+            capacity.orders = std::strtoul(argv[++i], nullptr, 10);
+            // the bench rests orders on 100 prices per side
+            capacity.price_levels = 200;
+        }
+        else if (!strcmp(argv[i], "--huge-pages")) capacity.page_size = PageSize::HUGE_2MB;
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc) limits.messages_per_second = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--burst") && i + 1 < argc) limits.burst = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--queue") && i + 1 < argc) {
+            limits.queue_depth = std::strtoul(argv[++i], nullptr, 10);
+            limits.policy = ThrottlePolicy::THROTTLE_QUEUE;
+        }
+        else if (!strcmp(argv[i], "--max-pending") && i + 1 < argc) max_pending = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--backup") && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "sync") replication = ReplicationMode::REPLICATE_SYNC;
+            else if (mode == "async") replication = ReplicationMode::REPLICATE_ASYNC;
+            else {
+                std::cerr << "Unknown replication mode " << mode << std::endl;
+                return 1;
+            }
+            replicate = true;
+        }
+        else if (!strcmp(argv[i], "--gateway")) gateway = true;
+        else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    // the exchange is never torn down: socket sessions are detached threads
+    Exchange* exchange = new Exchange();
+    exchange->SetThreadPlacement(placement);
+    exchange->AddInstrument("BENCH", capacity);
+    exchange->SetThrottleLimits(limits);
+    exchange->SetOverloadLimit(max_pending);
+    Exchange* backup = nullptr;
+    if (replicate) {
+        backup = new Exchange();
+        backup->AddInstrument("BENCH", capacity);
+        std::thread([backup, port]() { backup->ServeReplication(port + 1); }).detach();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        exchange->ReplicateTo("127.0.0.1", port + 1, replication);
+    }
+    Gateway* front = nullptr;
+    if (gateway) {
+        std::thread([exchange, port]() { exchange->ServeGateways(port + 2); }).detach();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        front = new Gateway();
+        front->Connect("127.0.0.1", port + 2);
+        std::thread([front, port]() { front->Start(port); }).detach();
+    } else {
+        std::thread([exchange, port, backend]() { exchange->Start(port, backend); }).detach();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::vector<std::thread> threads;
+    std::vector<unsigned> failures(clients, 0);
+    std::vector<LatencyHistogram> latencies(clients);
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned c = 0; c < clients; ++c) {
+        threads.emplace_back([c, orders, port, &failures, &latencies]() {
+            Client client;
+            client.Start("127.0.0.1", port);
+            // resting orders on both sides that never cross
+            for (unsigned i = 0; i < orders; ++i) {
+                bool bid = i % 2 == 0;
+                auto sent = std::chrono::steady_clock::now();
+                if (!client.PlaceOrder("BENCH", bid ? OrderSide::BID : OrderSide::ASK, OrderType::GOOD_TIL_CANCELED,
+                    bid ? 9000 + i % 100 : 11000 + i % 100, 1)) ++failures[c];
+                latencies[c].Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sent).count());
+            }
+            client.Stop();
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // socket sessions report their syscalls as they close
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    // the gateway holds the client sockets, the engine only counts the requests it matched
+    GatewayStats stats = front ? front->GetGatewayStats() : exchange->GetGatewayStats();
+    unsigned failed = 0;
+    for (unsigned count : failures) failed += count;
+    LatencyHistogram round_trips;
+    for (const auto& histogram : latencies) round_trips.Merge(histogram);
+
+    std::cout << "Backend:   " << (front ? "gateway" : backend == GatewayBackend::IO_URING ? "io_uring" : "sockets") << "\n"
+              << "Messages:  " << stats.messages << " (" << failed << " failed)\n"
+              << "Elapsed:   " << seconds << "s\n"
+              << "Rate:      " << static_cast<uint64_t>(stats.messages / seconds) << " messages/s\n"
+              << "Syscalls:  " << stats.syscalls << " (" << static_cast<double>(stats.syscalls) / stats.messages
+              << " per message)\n"
+              << "Round trip p50/p99/p99.9: " << round_trips.GetValueAtPercentile(50.0) << "/"
+              << round_trips.GetValueAtPercentile(99.0) << "/" << round_trips.GetValueAtPercentile(99.9) << "ns\n";
+    if (backup) {
+        ReplicationStats replicated = exchange->GetReplicationStats();
+        std::cout << "Backup:    " << (replication == ReplicationMode::REPLICATE_SYNC ? "sync" : "async") << ", "
+                  << replicated.acknowledged << "/" << replicated.journaled << " commands acknowledged, replicate p50/p99: "
+                  << exchange->GetLatencyReport()[LatencyStage::REPLICATE].GetValueAtPercentile(50.0) << "/"
+                  << exchange->GetLatencyReport()[LatencyStage::REPLICATE].GetValueAtPercentile(99.0) << "ns\n";
+    }
+    if (limits.messages_per_second || max_pending) {
+        std::cout << "Refused:   " << stats.throttled << " throttled, " << stats.queued << " queued, "
+                  << stats.shed << " shed\n";
+    }
+    if (capacity.orders) {
+        ArenaStats arena = exchange->GetArenaStats("BENCH");
+        std::cout << "Arena:     " << arena.live_bytes << "/" << arena.reserved_bytes << " bytes live, "
+                  << arena.fallbacks << " fallbacks" << (arena.page_size == PageSize::HUGE_2MB ? ", 2MB pages" : "") << "\n";
+    }
+    std::cout << std::flush;
+    _exit(failed ? 1 : 0);
+}
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "order_book.hpp"
+
+namespace {
+
+/**
+ * @class InstructionCounter
+ * Counts the user space instructions retired by the calling thread, where the kernel allows it.
+ */
+class InstructionCounter {
+public:
+    InstructionCounter() {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~InstructionCounter() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    InstructionCounter(const InstructionCounter&) = delete;
+    InstructionCounter& operator=(const InstructionCounter&) = delete;
+
+    /**
+     * Check whether the counter could be opened; containers and perf_event_paranoid often forbid it.
+     */
+    bool IsAvailable() const {
+        return fd_ >= 0;
+    }
+
+    /**
+     * Get the instructions retired so far, or 0 without a counter.
+     */
+    uint64_t Read() const {
+        uint64_t count = 0;
+        if (fd_ < 0 || read(fd_, &count, sizeof(count)) != sizeof(count)) return 0;
+        return count;
+    }
+private:
+    long fd_; ///< The perf event, or -1.
+};
+
+/**
+ * @struct Combination
+ * An incoming side and order type, and whether the order trades or only rests.
+ */
+struct Combination {
+    const char* name; ///< Name in the report.
+    OrderSide side; ///< Side of the incoming orders.
+    OrderType type; ///< Type of the incoming orders.
+    bool crosses; ///< Whether the incoming orders trade with the book or rest without trading.
+};
+
+/**
+ * @struct Measurement
+ * Cost per incoming order of one combination.
+ */
+struct Measurement {
+    double nanos = std::numeric_limits<double>::max(); ///< Nanoseconds per order, best of the rounds.
+    double instructions = std::numeric_limits<double>::max(); ///< Instructions per order, fewest of the rounds.
+};
+
+/**
+ * Time incoming orders of one combination against a freshly built book, each trading with one
+ * resting order, or resting behind the book's best price when the combination does not cross.
+ */
+Measurement Measure(const Combination& combination, unsigned levels, unsigned depth, unsigned rounds,
+    const InstructionCounter& counter) {
+    constexpr OrderPrice MIDDLE = 100000;
+    OrderSide resting = combination.side == OrderSide::ASK ? OrderSide::BID : OrderSide::ASK;
+    // every level past the middle on the resting side, so the incoming limit crosses all of them
+    auto price_of = [resting](unsigned level) {
+        return resting == OrderSide::ASK ? MIDDLE + 1 + level : MIDDLE - 1 - level;
+    };
+    OrderPrice limit = combination.crosses ? price_of(levels) : (resting == OrderSide::ASK ? MIDDLE - 1 : MIDDLE + 1);
+    size_t count = static_cast<size_t>(levels) * depth;
+
+    Measurement best;
+    for (unsigned round = 0; round < rounds; ++round) {
+        OrderBook book({2 * count, 2 * levels});
+        OrderID id = 1;
+        for (unsigned level = 0; level < levels; ++level) {
+            for (unsigned i = 0; i < depth; ++i) {
+                book.PlaceOrder(std::make_shared<Order>(id++, "BENCH", price_of(level), 1, resting, OrderType::GOOD_TIL_CANCELED));
+            }
+        }
+        std::vector<std::shared_ptr<Order>> incoming;
+        incoming.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            incoming.push_back(std::make_shared<Order>(id++, "BENCH", limit, 1, combination.side, combination.type));
+        }
+
+        uint64_t instructions = counter.Read();
+        uint64_t start = CurrentTime();
+        for (auto& order : incoming) book.PlaceOrder(order);
+        uint64_t elapsed = CurrentTime() - start;
+        instructions = counter.Read() - instructions;
+
+        best.nanos = std::min(best.nanos, static_cast<double>(elapsed) / count);
+        best.instructions = std::min(best.instructions, static_cast<double>(instructions) / count);
+    }
+    return best;
+}
+
+}
+
+/**
+ * Measures the matching kernel of every incoming side and order type: nanoseconds and, where the
+ * kernel allows a perf counter, user space instructions per incoming order.
+ *
+ * Usage: match_bench [--levels N] [--depth N] [--rounds N]
+ *
+ * Every trading order takes a single resting order, best level first; resting orders are placed
+ * behind the best price of their own side without trading.
+ */
+int main(int argc, char** argv) {
+    unsigned levels = 1000;
+    unsigned depth = 10;
+    unsigned rounds = 20;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--levels") && i + 1 < argc) levels = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--depth") && i + 1 < argc) depth = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--rounds") && i + 1 < argc) rounds = std::strtoul(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (!levels || !depth || !rounds) {
+        std::cerr << "Levels, depth and rounds must be positive" << std::endl;
+        return 1;
+    }
+
+    const Combination combinations[] = {
+        {"BID GTC rest", OrderSide::BID, OrderType::GOOD_TIL_CANCELED, false},
+        {"BID GTC fill", OrderSide::BID, OrderType::GOOD_TIL_CANCELED, true},
+        {"BID IOC", OrderSide::BID, OrderType::IMMEDIATE_OR_CANCEL, true},
+        {"BID FOK", OrderSide::BID, OrderType::FILL_OR_KILL, true},
+        {"BID MARKET", OrderSide::BID, OrderType::MARKET, true},
+        {"ASK GTC rest", OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, false},
+        {"ASK GTC fill", OrderSide::ASK, OrderType::GOOD_TIL_CANCELED, true},
+        {"ASK IOC", OrderSide::ASK, OrderType::IMMEDIATE_OR_CANCEL, true},
+        {"ASK FOK", OrderSide::ASK, OrderType::FILL_OR_KILL, true},
+        {"ASK MARKET", OrderSide::ASK, OrderType::MARKET, true},
+    };
+
+    InstructionCounter counter;
+    std::cout << "Book:      " << levels << " levels of " << depth << " orders, best of " << rounds << " rounds\n";
+    if (!counter.IsAvailable()) std::cout << "Instruction counter unavailable, only timing\n";
+    std::printf("%-14s %12s %16s\n", "Kernel", "ns/order", "instr/order");
+    try {
+        for (const Combination& combination : combinations) {
+            Measurement measurement = Measure(combination, levels, depth, rounds, counter);
+            if (counter.IsAvailable()) {
+                std::printf("%-14s %12.1f %16.1f\n", combination.name, measurement.nanos, measurement.instructions);
+            } else {
+                std::printf("%-14s %12.1f %16s\n", combination.name, measurement.nanos, "n/a");
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
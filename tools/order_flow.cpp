@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "client.hpp"
+#include "exchange.hpp"
+#include "order_flow.hpp"
+#include "work_stealing_pool.hpp"
+
+/**
+ * Generates synthetic order flow and either measures the generator, drives order books with it
+ * in process or drives an exchange with it through client sessions.
+ *
+ * Usage: order_flow [--target none|books|exchange] [--streams N] [--events N] [--threads N]
+ *                   [--arrival poisson|hawkes] [--rate EVENTS_PER_SECOND] [--excitation RATIO]
+ *                   [--decay PER_SECOND] [--makers N] [--maker-share SHARE] [--cancel-ratio SHARE]
+ *                   [--market-ratio SHARE] [--prices uniform|exponential] [--depth TICKS]
+ *                   [--spread TICKS] [--volatility TICKS] [--instruments N] [--seed N]
+ *                   [--host ADDRESS] [--port N] [--paced] [--output FILE]
+ *
+ * Every stream is an independent flow on the same instruments. With target none the streams are
+ * generated in parallel and, with --output, merged by time into a binary file for the replay tool.
+ * With target books every stream gets books of its own on a pool worker. With target exchange
+ * every stream is a client session on its own thread, connected to --host or, without it, to an
+ * exchange started in process on --port that lists the flow's instruments.
+ */
+int main(int argc, char** argv) {
+    std::string target = "none";
+    uint32_t streams = 1;
+    size_t events = 1000000;
+    unsigned threads = 0;
+    FlowParams params;
+    std::string host;
+    int port = 9300;
+    bool paced = false;
+    std::string output;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--target") && i + 1 < argc) target = argv[++i];
+        else if (!strcmp(argv[i], "--streams") && i + 1 < argc) streams = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--events") && i + 1 < argc) events = std::strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) threads = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--arrival") && i + 1 < argc) {
+            std::string arrival = argv[++i];
+            if (arrival == "poisson") params.arrival = ArrivalProcess::ARRIVAL_POISSON;
+            else if (arrival == "hawkes") params.arrival = ArrivalProcess::ARRIVAL_HAWKES;
+            else {
+                std::cerr << "Unknown arrival process " << arrival << std::endl;
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc) params.rate = std::strtod(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--excitation") && i + 1 < argc) params.excitation = std::strtod(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--decay") && i + 1 < argc) params.decay = std::strtod(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--makers") && i + 1 < argc) params.market_makers = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--maker-share") && i + 1 < argc) params.maker_share = std::strtod(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--cancel-ratio") && i + 1 < argc) params.cancel_ratio = std::strtod(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--market-ratio") && i + 1 < argc) params.market_ratio = std::strtod(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--prices") && i + 1 < argc) {
+            std::string prices = argv[++i];
+            if (prices == "uniform") params.price_distribution = PriceDistribution::PRICE_UNIFORM;
+            else if (prices == "exponential") params.price_distribution = PriceDistribution::PRICE_EXPONENTIAL;
+            else {
+                std::cerr << "Unknown price distribution " << prices << std::endl;
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--depth") && i + 1 < argc) params.depth = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--spread") && i + 1 < argc) params.spread = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--volatility") && i + 1 < argc) params.volatility = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--instruments") && i + 1 < argc) params.instruments = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) params.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--host") && i + 1 < argc) host = argv[++i];
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) port = std::strtol(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--paced")) paced = true;
+        else if (!strcmp(argv[i], "--output") && i + 1 < argc) output = argv[++i];
+        else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (target != "none" && target != "books" && target != "exchange") {
+        std::cerr << "Unknown target " << target << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> tickers;
+    for (uint32_t instrument = 0; instrument < params.instruments; ++instrument) tickers.push_back(OrderFlow::GetTicker(instrument));
+
+    try {
+        if (target == "none") {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::vector<FlowEvent>> flows = OrderFlow::Generate(params, streams, events, threads);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double span = 0;
+            for (const auto& flow : flows) span = std::max(span, flow.empty() ? 0 : flow.back().time / 1e9);
+            std::cout << "Events:    " << static_cast<uint64_t>(streams) * events << " in " << streams << " streams, "
+                      << span << "s of flow\n"
+                      << "Elapsed:   " << seconds << "s\n"
+                      << "Rate:      " << static_cast<uint64_t>(streams * events / seconds) << " events/s" << std::endl;
+
+            if (!output.empty()) {
+                std::vector<FlowEvent> merged;
+                merged.reserve(static_cast<size_t>(streams) * events);
+                for (const auto& flow : flows) merged.insert(merged.end(), flow.begin(), flow.end());
+                // stable keeps the commands of one event, which share its time, in order
+                std::stable_sort(merged.begin(), merged.end(),
+                    [](const FlowEvent& a, const FlowEvent& b) { return a.time < b.time; });
+                std::vector<ReplayCommand> commands;
+                commands.reserve(merged.size());
+                for (const auto& event : merged) commands.push_back(event.command);
+                Replay::WriteBinary(output, tickers, commands.data(), commands.size());
+                std::cout << "Wrote " << commands.size() << " commands to " << output << std::endl;
+            }
+            return 0;
+        }
+
+        std::vector<FlowStats> results(streams);
+        std::vector<LatencyHistogram> latencies(streams);
+        auto start = std::chrono::steady_clock::now();
+        if (target == "books") {
+            WorkStealingPool pool(threads);
+            pool.Run(streams, [&params, &results, events](size_t stream, unsigned) {
+                OrderFlow flow(params, static_cast<uint32_t>(stream));
+                std::vector<std::unique_ptr<OrderBook>> books;
+                for (uint32_t instrument = 0; instrument < params.instruments; ++instrument) {
+                    books.push_back(std::make_unique<OrderBook>());
+                }
+                results[stream] = OrderFlow::RunBooks(flow, books, events);
+            });
+        } else {
+            if (host.empty()) {
+                // the exchange is never torn down: socket sessions are detached threads
+                Exchange* exchange = new Exchange();
+                for (const auto& ticker : tickers) exchange->AddInstrument(ticker);
+                std::thread([exchange, port]() { exchange->Start(port); }).detach();
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                host = "127.0.0.1";
+            }
+            std::vector<std::thread> sessions;
+            std::vector<std::string> errors(streams);
+            for (uint32_t stream = 0; stream < streams; ++stream) {
+                sessions.emplace_back([&, stream]() {
+                    try {
+                        OrderFlow flow(params, stream);
+                        Client client;
+                        client.Start(host, port);
+                        results[stream] = OrderFlow::RunClient(flow, client, tickers, events, paced, &latencies[stream]);
+                        client.Stop();
+                    } catch (const std::exception& e) {
+                        errors[stream] = e.what();
+                    }
+                });
+            }
+            for (auto& session : sessions) session.join();
+            for (const auto& error : errors) {
+                if (!error.empty()) throw std::runtime_error(error);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        FlowStats total;
+        LatencyHistogram round_trips;
+        for (uint32_t stream = 0; stream < streams; ++stream) {
+            total.events += results[stream].events;
+            total.orders += results[stream].orders;
+            total.cancels += results[stream].cancels;
+            total.rejected += results[stream].rejected;
+            round_trips.Merge(latencies[stream]);
+        }
+        std::cout << "Target:    " << target << (paced ? " (paced)" : "") << ", " << streams << " streams\n"
+                  << "Commands:  " << total.events << " (" << total.orders << " orders, " << total.cancels << " cancels, "
+                  << total.rejected << " rejected)\n"
+                  << "Elapsed:   " << seconds << "s\n"
+                  << "Rate:      " << static_cast<uint64_t>(total.events / seconds) << " commands/s\n";
+        if (target == "exchange") {
+            std::cout << "Round trip p50/p99/p99.9: " << round_trips.GetValueAtPercentile(50.0) << "/"
+                      << round_trips.GetValueAtPercentile(99.0) << "/" << round_trips.GetValueAtPercentile(99.9) << "ns\n";
+        }
+        std::cout << std::flush;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        // exchange sessions may still be running
+        _exit(1);
+    }
+    _exit(0);
+}
@@ -0,0 +1,60 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "order_book.hpp"
+
+/**
+ * Measures what a change of the best bid costs with a growing number of pegged orders
+ * resting in the book, and what an order trading with those pegs costs.
+ *
+ * Usage: peg_bench [--updates N] [--groups N]
+ */
+int main(int argc, char** argv) {
+    unsigned updates = 100000;
+    unsigned groups = 10;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--updates") && i + 1 < argc) updates = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--groups") && i + 1 < argc) groups = std::strtoul(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    for (unsigned pegged : {0u, 1000u, 10000u, 100000u}) {
+        OrderBook book;
+        OrderID id = 1;
+        book.PlaceOrder(std::make_shared<Order>(id++, "BENCH", 1000, 1, OrderSide::BID, OrderType::GOOD_TIL_CANCELED));
+        book.PlaceOrder(std::make_shared<Order>(id++, "BENCH", 2000, 1, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED));
+        // pegged bids spread over a few offsets below the best bid
+        for (unsigned i = 0; i < pegged; ++i) {
+            book.PlaceOrder(std::make_shared<Order>(id++, "BENCH", 0, 1000000, OrderSide::BID, OrderType::GOOD_TIL_CANCELED,
+                0, 0, PegType::PRIMARY_PEG, -static_cast<PriceOffset>(1 + i % groups)));
+        }
+
+        // every update moves the best bid up and back down again
+        uint64_t start = CurrentTime();
+        for (unsigned i = 0; i < updates; ++i) {
+            OrderID improving = id++;
+            book.PlaceOrder(std::make_shared<Order>(improving, "BENCH", 1001 + i % 500, 1, OrderSide::BID, OrderType::GOOD_TIL_CANCELED));
+            book.CancelOrder(improving);
+        }
+        double update_ns = static_cast<double>(CurrentTime() - start) / (2.0 * updates);
+
+        // sells sweeping the limit bid and into the best group of pegs
+        std::vector<std::shared_ptr<Order>> sells;
+        for (unsigned i = 0; i < updates; ++i) {
+            sells.push_back(std::make_shared<Order>(id++, "BENCH", 0, 1, OrderSide::ASK, OrderType::IMMEDIATE_OR_CANCEL));
+        }
+        start = CurrentTime();
+        for (auto& sell : sells) book.PlaceOrder(sell);
+        double match_ns = static_cast<double>(CurrentTime() - start) / updates;
+
+        std::cout << "Pegged " << pegged << ": " << update_ns << "ns per best bid update, " << match_ns << "ns per match\n";
+    }
+    std::cout << std::flush;
+    return 0;
+}
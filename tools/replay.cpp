@@ -0,0 +1,59 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "replay.hpp"
+
+/**
+ * Replays a recorded command file through the matching engine and prints throughput.
+ *
+ * Usage: replay <input> [--threads N] [--output PATH] [--save-binary PATH]
+ */
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <input> [--threads N] [--output PATH] [--save-binary PATH]" << std::endl;
+        return 1;
+    }
+
+    std::string input = argv[1];
+    unsigned threads = 1;
+    std::string output;
+    std::string binary;
+    for (int i = 2; i < argc; ++i) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) threads = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--output") && i + 1 < argc) output = argv[++i];
+        else if (!strcmp(argv[i], "--save-binary") && i + 1 < argc) binary = argv[++i];
+        else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        uint64_t load_start = CurrentTime();
+        Replay replay(input);
+        double load_seconds = (CurrentTime() - load_start) / 1e9;
+        std::cout << "Loaded " << replay.GetCommandCount() << " commands for " << replay.GetInstruments().size()
+                  << " instruments in " << load_seconds << "s" << std::endl;
+
+        if (!binary.empty()) {
+            replay.SaveBinary(binary);
+            std::cout << "Wrote binary replay to " << binary << std::endl;
+            return 0;
+        }
+
+        ReplayStats stats = replay.Run(threads, output);
+        std::cout << "Commands:  " << stats.commands << "\n"
+                  << "Trades:    " << stats.trades << " (" << stats.traded_quantity << " traded)\n"
+                  << "Rested:    " << stats.rested << "\n"
+                  << "Cancelled: " << stats.cancelled << "\n"
+                  << "Rejected:  " << stats.rejected << "\n"
+                  << "Elapsed:   " << stats.seconds << "s\n"
+                  << "Rate:      " << static_cast<uint64_t>(stats.commands / stats.seconds) << " commands/s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
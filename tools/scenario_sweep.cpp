@@ -0,0 +1,61 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "scenario.hpp"
+
+/**
+ * Sweeps simulated market scenarios across every core and prints scenarios per second.
+ *
+ * Usage: scenario_sweep [--scenarios N] [--threads N] [--pin] [--steps N] [--instruments N]
+ *                       [--makers N] [--takers N] [--noise N] [--max-volatility TICKS] [--seed N]
+ *
+ * Scenario i is seeded with seed + i and moves its prices by up to 1 + i % max-volatility ticks a step.
+ */
+int main(int argc, char** argv) {
+    unsigned scenarios = 1000;
+    unsigned threads = 0;
+    bool pin = false;
+    ScenarioParams base;
+    uint32_t max_volatility = 4;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--scenarios") && i + 1 < argc) scenarios = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) threads = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--pin")) pin = true;
+        else if (!strcmp(argv[i], "--steps") && i + 1 < argc) base.steps = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--instruments") && i + 1 < argc) base.instruments = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--makers") && i + 1 < argc) base.market_makers = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--takers") && i + 1 < argc) base.takers = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--noise") && i + 1 < argc) base.noise_traders = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--max-volatility") && i + 1 < argc) max_volatility = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) base.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (!max_volatility) max_volatility = 1;
+
+    std::vector<ScenarioParams> sweep(scenarios, base);
+    for (unsigned i = 0; i < scenarios; ++i) {
+        sweep[i].seed = base.seed + i;
+        sweep[i].volatility = 1 + i % max_volatility;
+    }
+
+    try {
+        ScenarioSweep runner(threads, pin);
+        SweepStats stats = runner.Run(sweep);
+        std::cout << "Threads:   " << runner.GetThreadCount() << (pin ? " (pinned)" : "") << "\n"
+                  << "Scenarios: " << stats.scenarios << " (" << stats.steals << " stolen)\n"
+                  << "Orders:    " << stats.orders << " (" << stats.rejected << " rejected, " << stats.cancelled << " cancelled)\n"
+                  << "Trades:    " << stats.trades << " (" << stats.traded_quantity << " traded)\n"
+                  << "Elapsed:   " << stats.seconds << "s\n"
+                  << "Rate:      " << stats.scenarios / stats.seconds << " scenarios/s, "
+                  << static_cast<uint64_t>(stats.orders / stats.seconds) << " orders/s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "order_book.hpp"
+
+namespace {
+
+/**
+ * Time market orders that each sweep a whole side of a freshly built book.
+ *
+ * @return Nanoseconds per fill.
+ */
+double TimeSweeps(unsigned levels, unsigned depth, unsigned sweeps) {
+    uint64_t elapsed = 0;
+    for (unsigned sweep = 0; sweep < sweeps; ++sweep) {
+        OrderBook book({levels * depth, levels});
+        OrderID id = 1;
+        for (unsigned level = 0; level < levels; ++level) {
+            for (unsigned i = 0; i < depth; ++i) {
+                book.PlaceOrder(std::make_shared<Order>(id++, "BENCH", 1000 + level, 1, OrderSide::ASK, OrderType::GOOD_TIL_CANCELED));
+            }
+        }
+        auto market = std::make_shared<Order>(id++, "BENCH", 0, levels * depth, OrderSide::BID, OrderType::MARKET);
+
+        uint64_t start = CurrentTime();
+        book.PlaceOrder(market);
+        elapsed += CurrentTime() - start;
+    }
+    return static_cast<double>(elapsed) / sweeps / (levels * depth);
+}
+
+}
+
+/**
+ * Measures the cost per fill of market orders sweeping many price levels at once.
+ *
+ * Usage: sweep_bench [--levels N] [--depth N] [--sweeps N]
+ */
+int main(int argc, char** argv) {
+    unsigned levels = 500;
+    unsigned depth = 2;
+    unsigned sweeps = 200;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--levels") && i + 1 < argc) levels = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--depth") && i + 1 < argc) depth = std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--sweeps") && i + 1 < argc) sweeps = std::strtoul(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Levels:    " << levels << " of " << depth << " orders\n"
+              << "Per fill:  " << TimeSweeps(levels, depth, sweeps) << "ns" << std::endl;
+    return 0;
+}